@@ -118,7 +118,7 @@ struct GlobalAllocator {
 		u64 take_index = Ctz64(upper_map);
 		u64 block_size = 1llu << take_index;
 		byte* block = Take(take_index);
-		Assert(block_size > bit * 2);
+		Assert(block_size >= bit * 2);
 
 		pools[index].SetStack(block, block_size);
 		map |= bit;
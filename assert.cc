@@ -1,12 +1,13 @@
 #include "assert.h"
 #include "print.h"
+#include "log.h"
 #include "os.h"
 
 static void AssertImpl(bool b, const char* str, AssertSourceLocation srcloc) {
 	if (b) return;
 
-	Print("%:%:%: error: Assert tripped in function %: %\n", CString(srcloc.file), srcloc.line, srcloc.column, CString(srcloc.function), CString(str));
-	standard_output_buffer.Flush();
+	LogError("%:%:%: Assert tripped in function %: %", CString(srcloc.file), srcloc.line, srcloc.column, CString(srcloc.function), CString(str));
+	FlushLog();
 	Trap();
 	ExitProgram();
 }
@@ -0,0 +1,301 @@
+#include "asset_archive.h"
+#include "hash.h"
+#include "compress.h"
+#include "math.h"
+
+static AssetArchive OpenAssetArchive(String path) {
+	AssetArchive archive;
+	archive.file = MapFile(path, FILE_ADVICE_RANDOM);
+
+	if (!archive.file.IsValid())
+		return archive;
+
+	const byte* data = archive.file.data;
+	u64 length = archive.file.length;
+	const ArchiveHeader* header = (const ArchiveHeader*)data;
+
+	if (length < sizeof(ArchiveHeader) || header->magic != ARCHIVE_MAGIC || header->version != ARCHIVE_VERSION ||
+	    !IsPow2(header->slot_count) || header->slot_count < header->entry_count * 2llu) {
+		archive.Close();
+		return archive;
+	}
+
+	u64 entries_offset = sizeof(ArchiveHeader);
+	u64 slots_offset   = entries_offset + sizeof(ArchiveEntry) * header->entry_count;
+	u64 names_offset   = slots_offset + sizeof(u32) * header->slot_count;
+
+	if (names_offset + header->names_size > Min(header->data_offset, length)) {
+		archive.Close();
+		return archive;
+	}
+
+	const ArchiveEntry* entries = (const ArchiveEntry*)(data + entries_offset);
+
+	// Only the table of contents is read here, the data stays untouched.
+	for (u32 i = 0; i < header->entry_count; i++) {
+		const ArchiveEntry* entry = &entries[i];
+
+		if (entry->offset < header->data_offset || entry->offset > length || entry->packed_size > length - entry->offset ||
+		    (u64)entry->name_offset + entry->name_length > header->names_size) {
+			archive.Close();
+			return archive;
+		}
+
+		// Load allocates size bytes up front, so it can't be more than the packed bytes could unpack to. No LZ4
+		// byte unpacks to more than 255, unknown compression is rejected too.
+		bool plausible_size = false;
+
+		if (entry->compression == ARCHIVE_COMPRESSION_NONE) plausible_size = entry->size == entry->packed_size;
+		if (entry->compression == ARCHIVE_COMPRESSION_LZ4)  plausible_size = entry->size <= entry->packed_size * 255 + 16;
+
+		if (!plausible_size) {
+			archive.Close();
+			return archive;
+		}
+	}
+
+	// Find trusts the slots: each has to name an entry, and with no more used than there are entries, probing
+	// always reaches an empty one.
+	const u32* slots = (const u32*)(data + slots_offset);
+	u32 used_slots = 0;
+
+	for (u32 i = 0; i < header->slot_count; i++) {
+		if (slots[i] > header->entry_count) {
+			archive.Close();
+			return archive;
+		}
+
+		used_slots += slots[i] != 0;
+	}
+
+	if (used_slots > header->entry_count) {
+		archive.Close();
+		return archive;
+	}
+
+	archive.header  = header;
+	archive.entries = entries;
+	archive.slots   = slots;
+	archive.names   = (const char*)(data + names_offset);
+
+	// The table of contents gets used on every lookup, start reading it in now.
+	archive.file.Advise(FILE_ADVICE_WILL_NEED, 0, header->data_offset);
+	return archive;
+}
+
+const ArchiveEntry* AssetArchive::Find(String name) {
+	if (!header || !header->entry_count)
+		return null;
+
+	u64 hash = Hash64(name.data, name.length);
+	u32 mask = header->slot_count - 1;
+
+	for (u32 slot = hash & mask;; slot = (slot + 1) & mask) {
+		u32 index = slots[slot];
+
+		if (!index)
+			return null;
+
+		const ArchiveEntry* entry = &entries[index - 1];
+
+		if (entry->name_hash == hash && entry->name_length == name.length && CompareMemory(names + entry->name_offset, name.data, name.length))
+			return entry;
+	}
+}
+
+String AssetArchive::GetName(const ArchiveEntry* entry) {
+	return String(names + entry->name_offset, entry->name_length, 0);
+}
+
+Asset AssetArchive::Load(const ArchiveEntry* entry) {
+	Asset asset;
+
+	if (!entry)
+		return asset;
+
+	const byte* packed = file.data + entry->offset;
+
+	if (entry->compression == ARCHIVE_COMPRESSION_NONE) {
+		if (entry->packed_size == entry->size) {
+			asset.data     = packed;
+			asset.length   = entry->size;
+			asset.is_valid = true;
+		}
+
+		return asset;
+	}
+
+	// Ask for all the packed bytes at once rather than page fault by page fault.
+	file.Advise(FILE_ADVICE_WILL_NEED, entry->offset, entry->packed_size);
+
+	byte* data = (byte*)AllocMemory(entry->size);
+
+	if (!UnpackArchiveEntry(entry, packed, data)) {
+		FreeMemory(data, entry->size);
+		return asset;
+	}
+
+	asset.data      = data;
+	asset.length    = entry->size;
+	asset.is_valid  = true;
+	asset.owns_data = true;
+	return asset;
+}
+
+static bool UnpackArchiveEntry(const ArchiveEntry* entry, const byte* packed, byte* out) {
+	switch (entry->compression) {
+		case ARCHIVE_COMPRESSION_NONE:
+			if (entry->packed_size != entry->size)
+				return false;
+
+			CopyMemory(out, packed, entry->size);
+			return true;
+
+		case ARCHIVE_COMPRESSION_LZ4:
+			return DecompressLz4(packed, entry->packed_size, out, entry->size);
+	}
+
+	return false;
+}
+
+Asset AssetArchive::Load(String name) {
+	return Load(Find(name));
+}
+
+bool AssetArchive::Verify(const ArchiveEntry* entry) {
+	Asset asset = Load(entry);
+
+	if (!asset.IsValid())
+		return false;
+
+	bool result = Hash64(asset.data, asset.length) == entry->checksum;
+	asset.Free();
+	return result;
+}
+
+void AssetArchive::Close() {
+	file.Unmap();
+	*this = { };
+}
+
+void Asset::Free() {
+	if (owns_data)
+		FreeMemory((void*)data, length);
+
+	*this = { };
+}
+
+static u64 AlignArchiveOffset(u64 offset) {
+	return (offset + ARCHIVE_ALIGNMENT-1) & -(u64)ARCHIVE_ALIGNMENT;
+}
+
+static bool WriteAssetArchive(String path, ArchiveInput* inputs, u32 count, bool compress) {
+	static const byte zeroes[ARCHIVE_ALIGNMENT] = { };
+	Assert(count);
+
+	u32 slot_count = RoundPow2(count * 2);
+	u32 names_size = 0;
+
+	for (u32 i = 0; i < count; i++)
+		names_size += inputs[i].name.length;
+
+	u64 entries_size = sizeof(ArchiveEntry) * count;
+	u64 slots_size   = sizeof(u32) * slot_count;
+	u64 toc_size     = sizeof(ArchiveHeader) + entries_size + slots_size + names_size;
+
+	ArchiveHeader header = {
+		.magic       = ARCHIVE_MAGIC,
+		.version     = ARCHIVE_VERSION,
+		.entry_count = count,
+		.slot_count  = slot_count,
+		.names_size  = names_size,
+		.data_offset = AlignArchiveOffset(toc_size),
+	};
+
+	ArchiveEntry* entries = (ArchiveEntry*)AllocMemory(entries_size);
+	u32*  slots = (u32*)AllocMemory(slots_size);
+	char* names = (char*)AllocMemory(names_size);
+	const byte** packed = (const byte**)AllocMemory(sizeof(byte*) * count);
+	ZeroMemory(slots, slots_size);
+
+	u64 offset = header.data_offset;
+	u32 name_offset = 0;
+
+	for (u32 i = 0; i < count; i++) {
+		ArchiveInput* input = &inputs[i];
+
+		entries[i] = {
+			.name_hash   = Hash64(input->name.data, input->name.length),
+			.offset      = offset,
+			.packed_size = input->size,
+			.size        = input->size,
+			.checksum    = Hash64(input->data, input->size),
+			.name_offset = name_offset,
+			.name_length = (u16)input->name.length,
+			.compression = ARCHIVE_COMPRESSION_NONE,
+		};
+
+		packed[i] = input->data;
+
+		if (compress && input->size) {
+			u64 capacity = input->size - input->size / ARCHIVE_MIN_SAVING;
+			byte* compressed = (byte*)AllocMemory(capacity);
+			u64 compressed_size = CompressLz4(input->data, input->size, compressed, capacity);
+
+			if (compressed_size) {
+				packed[i] = compressed;
+				entries[i].packed_size = compressed_size;
+				entries[i].compression = ARCHIVE_COMPRESSION_LZ4;
+			}
+			else {
+				FreeMemory(compressed, capacity);
+			}
+		}
+
+		CopyMemory(names + name_offset, input->name.data, input->name.length);
+		name_offset += input->name.length;
+		offset = AlignArchiveOffset(offset + entries[i].packed_size);
+
+		u32 slot = entries[i].name_hash & (slot_count - 1);
+		while (slots[slot]) slot = (slot + 1) & (slot_count - 1);
+		slots[slot] = i + 1;
+	}
+
+	// The whole archive in one gathered write: the table of contents, then each entry padded to the alignment.
+	u64 chunk_count = 5 + count * 2;
+	WriteChunk* chunks = (WriteChunk*)AllocMemory(sizeof(WriteChunk) * chunk_count);
+	u64 chunk = 0;
+
+	chunks[chunk++] = { &header, sizeof(header) };
+	chunks[chunk++] = { entries, entries_size };
+	chunks[chunk++] = { slots,   slots_size };
+	chunks[chunk++] = { names,   names_size };
+	chunks[chunk++] = { zeroes,  header.data_offset - toc_size };
+
+	for (u32 i = 0; i < count; i++) {
+		u64 size = entries[i].packed_size;
+		chunks[chunk++] = { packed[i], size };
+		chunks[chunk++] = { zeroes, AlignArchiveOffset(size) - size };
+	}
+
+	File file = OpenFile(path, FILE_MODE_CREATE_OR_TRUNCATE, FILE_ACCESS_WRITE);
+	bool result = file.IsValid();
+
+	if (result) {
+		file.Write(chunks, chunk_count);
+		result = file.QueryFileSize() == offset;
+		file.Close();
+	}
+
+	for (u32 i = 0; i < count; i++) {
+		if (entries[i].compression != ARCHIVE_COMPRESSION_NONE)
+			FreeMemory((void*)packed[i], inputs[i].size - inputs[i].size / ARCHIVE_MIN_SAVING);
+	}
+
+	FreeMemory(packed, sizeof(byte*) * count);
+	FreeMemory(chunks, sizeof(WriteChunk) * chunk_count);
+	FreeMemory(names, names_size);
+	FreeMemory(slots, slots_size);
+	FreeMemory(entries, entries_size);
+	return result;
+}
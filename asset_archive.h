@@ -0,0 +1,98 @@
+#ifndef ASSET_ARCHIVE_H
+#define ASSET_ARCHIVE_H
+
+#include "general.h"
+#include "string.h"
+#include "file_system.h"
+
+// All of the game's assets in one file, so startup is one open and one mmap instead of a syscall chain per asset.
+// The table of contents sits at the front and is used in place from the mapping: a hash table of name hashes
+// finds an entry, and an entry is an offset into the same mapping. Nothing is read until it's touched.
+//
+// An archive file is:
+//   ArchiveHeader
+//   ArchiveEntry[entry_count]
+//   u32 slots[slot_count]  Entry index + 1 for each name hash, 0 for empty, linear probing.
+//   names                  Not terminated, entries point into it.
+//   data                   Each entry starts ARCHIVE_ALIGNMENT aligned.
+
+static const u64 ARCHIVE_MAGIC     = 0x315354455353414Bull; // "KASSETS1"
+static const u32 ARCHIVE_VERSION   = 1;
+static const u32 ARCHIVE_ALIGNMENT = 64;
+
+enum ArchiveCompression : u8 {
+	ARCHIVE_COMPRESSION_NONE,
+	ARCHIVE_COMPRESSION_LZ4,  // compress.h, kept only when it saves at least ARCHIVE_MIN_SAVING.
+};
+
+static const u32 ARCHIVE_MIN_SAVING = 16; // 1/16th of the entry.
+
+struct ArchiveHeader {
+	u64 magic;
+	u32 version;
+	u32 entry_count;
+	u32 slot_count;  // A power of two, at least twice entry_count.
+	u32 names_size;
+	u64 data_offset; // Everything before this is the table of contents.
+};
+
+struct ArchiveEntry {
+	u64 name_hash;   // Hash64 of the name.
+	u64 offset;      // From the start of the file.
+	u64 packed_size; // As stored.
+	u64 size;        // Once unpacked.
+	u64 checksum;    // Hash64 of the unpacked bytes.
+	u32 name_offset; // Into names.
+	u16 name_length;
+	u8  compression; // ArchiveCompression.
+	u8  unused;
+};
+
+// An asset's bytes. Uncompressed assets point straight into the archive's mapping and own nothing,
+// compressed ones are unpacked into memory of their own.
+struct Asset {
+	const byte* data = null;
+	u64 length = 0;
+	bool is_valid = false;
+	bool owns_data = false;
+
+	bool IsValid() { return is_valid; }
+	void Free();
+};
+
+struct AssetArchive {
+	MappedFile file;
+	const ArchiveHeader* header = null;
+	const ArchiveEntry*  entries = null;
+	const u32*           slots = null;
+	const char*          names = null;
+
+	bool IsValid() { return header != null; }
+
+	const ArchiveEntry* Find(String name); // null if there's no such asset.
+	String GetName(const ArchiveEntry* entry);
+	bool   Verify(const ArchiveEntry* entry); // Unpacks and checks the checksum, which touches every page of the entry.
+	Asset  Load(const ArchiveEntry* entry);
+	Asset  Load(String name);
+
+	void Close();
+};
+
+// Checks the header, that every entry lies inside the file and that the hash table only points at entries, an
+// archive that fails comes back invalid.
+static AssetArchive OpenAssetArchive(String path);
+
+// For entries read some other way, like ReadAsync into a buffer of packed_size: unpacks them into out, which
+// has room for entry->size bytes. Returns false if the packed bytes are corrupt.
+static bool UnpackArchiveEntry(const ArchiveEntry* entry, const byte* packed, byte* out);
+
+// What the packer writes.
+struct ArchiveInput {
+	String name;
+	const byte* data;
+	u64 size;
+};
+
+static bool WriteAssetArchive(String path, ArchiveInput* inputs, u32 count, bool compress = true);
+
+#endif // ASSET_ARCHIVE_H
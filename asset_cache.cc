@@ -0,0 +1,108 @@
+#include "asset_cache.h"
+#include "hash.h"
+#include "print.h"
+#include "log.h"
+#include <unistd.h>
+
+static const u64 ASSET_CACHE_SEED_A = 0x6173736574636163; // "assetcac"
+static const u64 ASSET_CACHE_SEED_B = 0x686530726567656E;
+
+static AssetCacheKey AssetCacheKeyBegin(String parameters) {
+	return {
+		.a = Hash64(parameters.data, parameters.length, ASSET_CACHE_SEED_A),
+		.b = Hash64(parameters.data, parameters.length, ASSET_CACHE_SEED_B),
+	};
+}
+
+static AssetCacheKey AssetCacheKeyAdd(AssetCacheKey key, const void* data, u64 size) {
+	return {
+		.a = Hash64(data, size, key.a),
+		.b = Hash64(data, size, key.b),
+	};
+}
+
+static const u32 ASSET_CACHE_PATH_MAX = 256;
+
+// "<directory>/ab/ab12...ef", the first byte as a subdirectory keeps directories small.
+static String FormatAssetCachePath(char* out, AssetCacheKey key, bool directory_only) {
+	static const char digits[] = "0123456789abcdef";
+
+	char hex[32];
+	for (u32 i = 0; i < 16; i++) {
+		hex[i]      = digits[(key.a >> (60 - i * 4)) & 15];
+		hex[16 + i] = digits[(key.b >> (60 - i * 4)) & 15];
+	}
+
+	OutputBuffer path = FixedOutput(out, ASSET_CACHE_PATH_MAX);
+	Print(&path, "%/%", asset_cache_directory, String(hex, 2, 0));
+
+	if (!directory_only)
+		Print(&path, "/%", String(hex, 32, 0));
+
+	return path.GetString();
+}
+
+static MappedFile LookupAssetCache(AssetCacheKey key) {
+	char path[ASSET_CACHE_PATH_MAX];
+	return MapFile(FormatAssetCachePath(path, key, false), FILE_ADVICE_SEQUENTIAL);
+}
+
+static bool StoreAssetCache(AssetCacheKey key, const void* data, u64 size) {
+	char directory[ASSET_CACHE_PATH_MAX];
+	char path[ASSET_CACHE_PATH_MAX];
+	char temporary_path[ASSET_CACHE_PATH_MAX];
+
+	CreateDirectory(asset_cache_directory);
+
+	if (!CreateDirectory(FormatAssetCachePath(directory, key, true)))
+		return false;
+
+	String final_path = FormatAssetCachePath(path, key, false);
+
+	// Unique to this process, so two builds storing the same entry don't write into each other's file.
+	OutputBuffer temporary = FixedOutput(temporary_path, ASSET_CACHE_PATH_MAX);
+	Print(&temporary, "%.%.tmp", final_path, (u64)getpid());
+
+	File file = OpenFile(temporary.GetString(), FILE_MODE_CREATE_OR_TRUNCATE, FILE_ACCESS_WRITE);
+
+	if (!file.IsValid())
+		return false;
+
+	file.Write((const char*)data, size);
+	bool complete = file.QueryFileSize() == size;
+	file.Close();
+
+	if (!complete || !RenameFile(temporary.GetString(), final_path)) {
+		DeleteFile(temporary.GetString());
+		return false;
+	}
+
+	return true;
+}
+
+static MappedFile LoadDerivedAsset(String source_path, String parameters, AssetProcessor* process, void* context) {
+	MappedFile source = MapFile(source_path, FILE_ADVICE_SEQUENTIAL);
+
+	if (!source.IsValid())
+		return source;
+
+	AssetCacheKey key = AssetCacheKeyAdd(AssetCacheKeyBegin(parameters), source.data, source.length);
+	MappedFile result = LookupAssetCache(key);
+
+	if (!result.IsValid()) {
+		OutputBuffer output = GrowableOutput();
+
+		if (process(source.data, source.length, &output, context)) {
+			// Mapped back from the cache rather than handed over, so a hit and a miss give the same thing.
+			if (StoreAssetCache(key, output.data, output.head))
+				result = LookupAssetCache(key);
+			else
+				LogWarning("Can't write % to the asset cache in %", source_path, asset_cache_directory);
+		}
+
+		output.Free();
+	}
+
+	source.Unmap();
+	return result;
+}
@@ -0,0 +1,36 @@
+#ifndef ASSET_CACHE_H
+#define ASSET_CACHE_H
+
+#include "general.h"
+#include "string.h"
+#include "file_system.h"
+
+// Processed assets (SPIR-V, decoded and compressed textures, optimized meshes) on disk, keyed by the hash of
+// everything that went into them: the processing (tool, version, options) and the source bytes. Changing any
+// of it gives a different key, so entries never go stale and nothing is ever invalidated, and going back to an
+// old source finds its old output again. Only what actually changed gets rebuilt.
+// Entries are written to a temporary file and renamed into place, so a crash or two builds at once can't leave
+// a torn entry. Deleting the directory is always safe.
+
+static String asset_cache_directory = ".asset_cache";
+
+struct AssetCacheKey {
+	u64 a;
+	u64 b; // Two differently seeded hashes, 128 bits so a collision isn't a concern.
+};
+
+// Start with the processing, then Add each input.
+static AssetCacheKey AssetCacheKeyBegin(String parameters);
+static AssetCacheKey AssetCacheKeyAdd(AssetCacheKey key, const void* data, u64 size);
+
+static MappedFile LookupAssetCache(AssetCacheKey key); // Invalid on a miss.
+static bool       StoreAssetCache(AssetCacheKey key, const void* data, u64 size);
+
+// Makes output from source, false if it couldn't. parameters has to change whenever what it makes does.
+typedef bool AssetProcessor(const byte* source, u64 size, OutputBuffer* output, void* context);
+
+// The processed form of the file at source_path, from the cache when it's there. Otherwise runs process
+// and stores what it made first. Invalid if the source can't be read, process fails or the cache can't be written.
+static MappedFile LoadDerivedAsset(String source_path, String parameters, AssetProcessor* process, void* context = null);
+
+#endif // ASSET_CACHE_H
@@ -0,0 +1,97 @@
+// Packs files into an asset archive (see asset_archive.h), or lists and verifies one.
+// Build and run with: make asset_pack && ./asset_pack assets.pak vert.spv frag.spv
+//                     ./asset_pack -0 assets.pak ... to store everything uncompressed
+//                     ./asset_pack -l assets.pak
+
+#include "general.h"
+#include "math.h"
+#include "os.h"
+
+#include "assert.cc"
+#include "alloc.cc"
+#include "unix.cc"
+#include "print.cc"
+#include "print_float.cc"
+#include "log.cc"
+#include "file_system.cc"
+#include "hash.cc"
+#include "compress.cc"
+#include "asset_archive.cc"
+
+#include "asset_archive.h"
+
+static int ListArchive(String path) {
+	AssetArchive archive = OpenAssetArchive(path);
+
+	if (!archive.IsValid()) {
+		Print("%: not an asset archive\n", path);
+		return 1;
+	}
+
+	u32 failed = 0;
+
+	for (u32 i = 0; i < archive.header->entry_count; i++) {
+		const ArchiveEntry* entry = &archive.entries[i];
+		bool ok = archive.Verify(entry);
+		failed += !ok;
+		String status = ok ? String("") : String(", checksum mismatch");
+		Print("% % bytes, % packed, at %%\n", archive.GetName(entry), entry->size, entry->packed_size, entry->offset, status);
+	}
+
+	Print("% assets, % bad\n", archive.header->entry_count, failed);
+	archive.Close();
+	return failed ? 1 : 0;
+}
+
+static int PackArchive(String path, char** files, u32 count, bool compress) {
+	ArchiveInput* inputs = (ArchiveInput*)AllocMemory(sizeof(ArchiveInput) * count);
+	MappedFile* mapped   = (MappedFile*)AllocMemory(sizeof(MappedFile) * count);
+	int result = 0;
+
+	// Each asset is named by the path it was given.
+	for (u32 i = 0; i < count; i++) {
+		String name = CString(files[i]);
+		mapped[i] = MapFile(name, FILE_ADVICE_SEQUENTIAL);
+
+		if (!mapped[i].IsValid()) {
+			Print("%: can't read\n", name);
+			result = 1;
+		}
+
+		inputs[i] = { .name = name, .data = mapped[i].data, .size = mapped[i].length };
+	}
+
+	if (!result && !WriteAssetArchive(path, inputs, count, compress)) {
+		Print("%: can't write\n", path);
+		result = 1;
+	}
+
+	for (u32 i = 0; i < count; i++)
+		mapped[i].Unmap();
+
+	FreeMemory(mapped, sizeof(MappedFile) * count);
+	FreeMemory(inputs, sizeof(ArchiveInput) * count);
+	return result;
+}
+
+int main(int argc, char** argv) {
+	InitGlobalAllocator();
+	int result;
+
+	if (argc == 3 && CString(argv[1]) == "-l") {
+		result = ListArchive(CString(argv[2]));
+	}
+	else if (argc >= 4 && CString(argv[1]) == "-0") {
+		result = PackArchive(CString(argv[2]), argv + 3, argc - 3, false);
+	}
+	else if (argc >= 3) {
+		result = PackArchive(CString(argv[1]), argv + 2, argc - 2, true);
+	}
+	else {
+		Print("usage: asset_pack [-0] <archive> <file>...\n       asset_pack -l <archive>\n");
+		result = 1;
+	}
+
+	standard_output_buffer.Flush();
+	return result;
+}
@@ -0,0 +1,540 @@
+#include "async_io.h"
+#include "os.h"
+#include "math.h"
+
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+
+#if LINUX
+	#include <linux/io_uring.h>
+	#include <sys/syscall.h>
+	#include <sys/mman.h>
+#endif
+
+struct IoSlot {
+	FileHandle handle;
+	u64        offset;
+	byte*      buffer;
+	u64        size;
+	u64        done;
+	u64        user_data;
+	u32        generation;
+	IoStatus   status;
+	bool       in_use;
+	bool       cancel_requested;
+	bool       running; // On a pool worker, which is worker.
+	pthread_t  worker;
+};
+
+static struct {
+	bool   use_io_uring;
+	IoSlot slots[ASYNC_IO_MAX_REQUESTS];
+	u32    free_slots[ASYNC_IO_MAX_REQUESTS];
+	u32    free_count;
+	u32    in_flight;
+} async_io;
+
+static IoRequest GetRequest(u32 index) {
+	return (u64)async_io.slots[index].generation << 32 | index;
+}
+
+// Null for requests that have already completed.
+static IoSlot* FindSlot(IoRequest request) {
+	u32 index = (u32)request;
+
+	if (index >= ASYNC_IO_MAX_REQUESTS || !async_io.slots[index].in_use || async_io.slots[index].generation != request >> 32)
+		return null;
+
+	return &async_io.slots[index];
+}
+
+static IoCompletion FinishSlot(u32 index, IoStatus status) {
+	IoSlot* slot = &async_io.slots[index];
+	IoCompletion completion = {
+		.request   = GetRequest(index),
+		.user_data = slot->user_data,
+		.bytes     = slot->done,
+		.status    = status,
+	};
+
+	// A new generation makes the old request id stale, 0 is skipped so no id is ever 0.
+	slot->generation = slot->generation + 1 ? slot->generation + 1 : 1;
+	slot->in_use = false;
+	async_io.free_slots[async_io.free_count++] = index;
+	async_io.in_flight--;
+	return completion;
+}
+
+// Thread pool fallback. A cancelled read that's blocked, on a pipe say, is interrupted with IO_POOL_SIGNAL,
+// whose handler does nothing but is installed without SA_RESTART so pread returns EINTR. The signal can land
+// just before pread starts and be missed, so waiting sends it again every IO_POOL_CANCEL_RETRY until the read
+// gives up.
+
+static const s32 IO_POOL_SIGNAL       = SIGURG; // Ignored by default, nothing else is likely to use it.
+static const u64 IO_POOL_CANCEL_RETRY = 1000000;
+
+static struct {
+	Semaphore    work;
+	Semaphore    finished_signal;
+	ThreadHandle threads[ASYNC_IO_THREADS];
+	bool         lock;
+	bool         stop;
+
+	// Rings of slot indices, there are never more than ASYNC_IO_MAX_REQUESTS in flight.
+	u32 pending[ASYNC_IO_MAX_REQUESTS];
+	u32 pending_head;
+	u32 pending_tail;
+	u32 finished[ASYNC_IO_MAX_REQUESTS];
+	u32 finished_head;
+	u32 finished_tail;
+
+	// Read but not submitted, only touched by the owning thread.
+	u32 queued[ASYNC_IO_MAX_REQUESTS];
+	u32 queued_count;
+} io_pool;
+
+// Held for a few instructions at a time, so spinning is fine.
+static void LockIoPool() {
+	while (__atomic_exchange_n(&io_pool.lock, true, __ATOMIC_ACQUIRE))
+		YieldThread();
+}
+
+static void UnlockIoPool() {
+	__atomic_store_n(&io_pool.lock, false, __ATOMIC_RELEASE);
+}
+
+static void IoWorker(void* argument) {
+	while (true) {
+		WaitSemaphore(io_pool.work);
+
+		LockIoPool();
+
+		if (io_pool.pending_head == io_pool.pending_tail) {
+			UnlockIoPool();
+			if (__atomic_load_n(&io_pool.stop, __ATOMIC_ACQUIRE)) return;
+			continue;
+		}
+
+		u32 index = io_pool.pending[io_pool.pending_head++ % ASYNC_IO_MAX_REQUESTS];
+		IoSlot* slot = &async_io.slots[index];
+		slot->worker  = pthread_self();
+		slot->running = true;
+		UnlockIoPool();
+
+		slot->status = IO_DONE;
+
+		while (slot->status == IO_DONE && slot->done < slot->size) {
+			if (__atomic_load_n(&slot->cancel_requested, __ATOMIC_RELAXED)) {
+				slot->status = IO_CANCELLED;
+				break;
+			}
+
+			ssize_t count = pread(slot->handle, slot->buffer + slot->done, slot->size - slot->done, slot->offset + slot->done);
+
+			if (count < 0 && errno == EINTR) continue;
+			if (count < 0) slot->status = IO_FAILED;
+			if (count <= 0) break;
+
+			slot->done += count;
+		}
+
+		LockIoPool();
+		slot->running = false;
+		io_pool.finished[io_pool.finished_tail++ % ASYNC_IO_MAX_REQUESTS] = index;
+		UnlockIoPool();
+
+		SignalSemaphore(io_pool.finished_signal);
+	}
+}
+
+static void IgnoreIoPoolSignal(s32 signal) { }
+
+static void InitIoPool() {
+	struct sigaction action = { };
+	action.sa_handler = IgnoreIoPoolSignal;
+	sigemptyset(&action.sa_mask);
+	sigaction(IO_POOL_SIGNAL, &action, null);
+
+	io_pool.work = CreateSemaphore(0);
+	io_pool.finished_signal = CreateSemaphore(0);
+
+	for (u32 i = 0; i < ASYNC_IO_THREADS; i++)
+		io_pool.threads[i] = CreateThread(IoWorker, null);
+}
+
+static void ShutdownIoPool() {
+	__atomic_store_n(&io_pool.stop, true, __ATOMIC_RELEASE);
+	SignalSemaphore(io_pool.work, ASYNC_IO_THREADS);
+
+	for (u32 i = 0; i < ASYNC_IO_THREADS; i++)
+		JoinThread(io_pool.threads[i]);
+
+	DestroySemaphore(io_pool.work);
+	DestroySemaphore(io_pool.finished_signal);
+	io_pool = { };
+}
+
+static void SubmitIoPool() {
+	u32 count = io_pool.queued_count;
+
+	if (!count)
+		return;
+
+	LockIoPool();
+	for (u32 i = 0; i < count; i++)
+		io_pool.pending[io_pool.pending_tail++ % ASYNC_IO_MAX_REQUESTS] = io_pool.queued[i];
+	UnlockIoPool();
+
+	io_pool.queued_count = 0;
+	SignalSemaphore(io_pool.work, count);
+}
+
+// Signals the worker of every cancelled read that's still running, false if there are none.
+static bool InterruptCancelledIoPool() {
+	bool interrupted = false;
+
+	LockIoPool();
+	for (u32 i = 0; i < ASYNC_IO_MAX_REQUESTS; i++) {
+		IoSlot* slot = &async_io.slots[i];
+
+		if (slot->in_use && slot->cancel_requested && slot->running) {
+			pthread_kill(slot->worker, IO_POOL_SIGNAL);
+			interrupted = true;
+		}
+	}
+	UnlockIoPool();
+
+	return interrupted;
+}
+
+static u32 PollIoPool(IoCompletion* completions, u32 max) {
+	u32 count = 0;
+
+	LockIoPool();
+	while (count < max && io_pool.finished_head != io_pool.finished_tail) {
+		u32 index = io_pool.finished[io_pool.finished_head++ % ASYNC_IO_MAX_REQUESTS];
+		completions[count++] = FinishSlot(index, async_io.slots[index].status);
+	}
+	UnlockIoPool();
+
+	return count;
+}
+
+// io_uring, through the raw syscalls so there's nothing to link.
+
+#if LINUX
+static struct {
+	s32           fd;
+	u32*          sq_head;
+	u32*          sq_tail;
+	u32*          sq_array;
+	u32           sq_mask;
+	u32           sq_entries;
+	io_uring_sqe* sqes;
+	u32*          cq_head;
+	u32*          cq_tail;
+	u32           cq_mask;
+	io_uring_cqe* cqes;
+	byte*         ring;
+	u64           ring_size;
+	u64           sqes_size;
+	u32           unsubmitted;
+} io_uring;
+
+// user_data of cancel requests, their completions are skipped because no request is 0.
+static const u64 IO_URING_CANCEL = 0;
+
+static bool InitIoUring() {
+	io_uring_params params = { };
+	s32 fd = syscall(__NR_io_uring_setup, ASYNC_IO_MAX_REQUESTS, &params);
+
+	if (fd < 0)
+		return false;
+
+	// IORING_OP_READ came in the same kernel (5.6) as IORING_FEAT_RW_CUR_POS.
+	if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_RW_CUR_POS)) {
+		close(fd);
+		return false;
+	}
+
+	u64 sq_size   = params.sq_off.array + params.sq_entries * sizeof(u32);
+	u64 cq_size   = params.cq_off.cqes  + params.cq_entries * sizeof(io_uring_cqe);
+	u64 ring_size = Max(sq_size, cq_size);
+	u64 sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+
+	void* ring = mmap(null, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	void* sqes = ring == MAP_FAILED ? MAP_FAILED : mmap(null, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+
+	if (sqes == MAP_FAILED) {
+		if (ring != MAP_FAILED) munmap(ring, ring_size);
+		close(fd);
+		return false;
+	}
+
+	byte* p = (byte*)ring;
+	io_uring = {
+		.fd         = fd,
+		.sq_head    = (u32*)(p + params.sq_off.head),
+		.sq_tail    = (u32*)(p + params.sq_off.tail),
+		.sq_array   = (u32*)(p + params.sq_off.array),
+		.sq_mask    = *(u32*)(p + params.sq_off.ring_mask),
+		.sq_entries = params.sq_entries,
+		.sqes       = (io_uring_sqe*)sqes,
+		.cq_head    = (u32*)(p + params.cq_off.head),
+		.cq_tail    = (u32*)(p + params.cq_off.tail),
+		.cq_mask    = *(u32*)(p + params.cq_off.ring_mask),
+		.cqes       = (io_uring_cqe*)(p + params.cq_off.cqes),
+		.ring       = p,
+		.ring_size  = ring_size,
+		.sqes_size  = sqes_size,
+	};
+
+	return true;
+}
+
+static void ShutdownIoUring() {
+	munmap(io_uring.sqes, io_uring.sqes_size);
+	munmap(io_uring.ring, io_uring.ring_size);
+	close(io_uring.fd);
+	io_uring = { };
+}
+
+static void EnterIoUring(u32 wait) {
+	while (true) {
+		s32 result = syscall(__NR_io_uring_enter, io_uring.fd, io_uring.unsubmitted, wait, wait ? IORING_ENTER_GETEVENTS : 0, null, 0);
+
+		if (result >= 0) {
+			io_uring.unsubmitted -= Min((u32)result, io_uring.unsubmitted);
+			return;
+		}
+
+		if (errno != EINTR)
+			return;
+	}
+}
+
+static io_uring_sqe* GetIoUringSqe() {
+	u32 tail = *io_uring.sq_tail;
+
+	// Only full with a pile of unsubmitted cancels on top of a full set of reads.
+	if (tail - __atomic_load_n(io_uring.sq_head, __ATOMIC_ACQUIRE) == io_uring.sq_entries)
+		EnterIoUring(0);
+
+	io_uring_sqe* sqe = &io_uring.sqes[tail & io_uring.sq_mask];
+	*sqe = { };
+	io_uring.sq_array[tail & io_uring.sq_mask] = tail & io_uring.sq_mask;
+	return sqe;
+}
+
+static void PushIoUringSqe() {
+	__atomic_store_n(io_uring.sq_tail, *io_uring.sq_tail + 1, __ATOMIC_RELEASE);
+	io_uring.unsubmitted++;
+}
+
+static void QueueIoUringRead(u32 index) {
+	IoSlot* slot = &async_io.slots[index];
+	io_uring_sqe* sqe = GetIoUringSqe();
+
+	sqe->opcode    = IORING_OP_READ;
+	sqe->fd        = slot->handle;
+	sqe->off       = slot->offset + slot->done;
+	sqe->addr      = (u64)(slot->buffer + slot->done);
+	sqe->len       = Min(slot->size - slot->done, 1llu << 30);
+	sqe->user_data = GetRequest(index);
+	PushIoUringSqe();
+}
+
+static void QueueIoUringCancel(IoRequest request) {
+	io_uring_sqe* sqe = GetIoUringSqe();
+
+	sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+	sqe->fd        = -1;
+	sqe->addr      = request;
+	sqe->user_data = IO_URING_CANCEL;
+	PushIoUringSqe();
+}
+
+static u32 PollIoUring(IoCompletion* completions, u32 max) {
+	u32 count = 0;
+	u32 head = *io_uring.cq_head;
+	u32 tail = __atomic_load_n(io_uring.cq_tail, __ATOMIC_ACQUIRE);
+	bool resubmit = false;
+
+	for (; head != tail && count < max; head++) {
+		io_uring_cqe* cqe = &io_uring.cqes[head & io_uring.cq_mask];
+		IoSlot* slot = FindSlot(cqe->user_data);
+
+		if (!slot)
+			continue;
+
+		u32 index = slot - async_io.slots;
+		s32 result = cqe->res;
+
+		if (result == -ECANCELED || (result < 0 && slot->cancel_requested)) {
+			completions[count++] = FinishSlot(index, IO_CANCELLED);
+			continue;
+		}
+
+		if (result == -EINTR || result == -EAGAIN) {
+			QueueIoUringRead(index);
+			resubmit = true;
+			continue;
+		}
+
+		if (result < 0) {
+			completions[count++] = FinishSlot(index, IO_FAILED);
+			continue;
+		}
+
+		slot->done += result;
+
+		// Regular files only come up short at the end, but reads are capped at 1GB and pipes can come up short too.
+		if (result && slot->done < slot->size && !slot->cancel_requested) {
+			QueueIoUringRead(index);
+			resubmit = true;
+			continue;
+		}
+
+		completions[count++] = FinishSlot(index, IO_DONE);
+	}
+
+	__atomic_store_n(io_uring.cq_head, head, __ATOMIC_RELEASE);
+
+	if (resubmit)
+		EnterIoUring(0);
+
+	return count;
+}
+#endif
+
+static void InitAsyncIo(bool allow_io_uring) {
+	async_io = { };
+
+	for (u32 i = 0; i < ASYNC_IO_MAX_REQUESTS; i++) {
+		async_io.slots[i].generation = 1;
+		async_io.free_slots[i] = ASYNC_IO_MAX_REQUESTS-1 - i;
+	}
+
+	async_io.free_count = ASYNC_IO_MAX_REQUESTS;
+
+#if LINUX
+	async_io.use_io_uring = allow_io_uring && InitIoUring();
+#endif
+
+	if (!async_io.use_io_uring)
+		InitIoPool();
+}
+
+static bool IsUsingIoUring() {
+	return async_io.use_io_uring;
+}
+
+static IoRequest ReadAsync(File file, u64 offset, void* buffer, u64 size, u64 user_data) {
+	if (!async_io.free_count)
+		return 0;
+
+	u32 index = async_io.free_slots[--async_io.free_count];
+	IoSlot* slot = &async_io.slots[index];
+	slot->handle           = file.handle;
+	slot->offset           = offset;
+	slot->buffer           = (byte*)buffer;
+	slot->size             = size;
+	slot->done             = 0;
+	slot->user_data        = user_data;
+	slot->status           = IO_DONE;
+	slot->in_use           = true;
+	slot->cancel_requested = false;
+	async_io.in_flight++;
+
+#if LINUX
+	if (async_io.use_io_uring) {
+		QueueIoUringRead(index);
+		return GetRequest(index);
+	}
+#endif
+
+	io_pool.queued[io_pool.queued_count++] = index;
+	return GetRequest(index);
+}
+
+static void SubmitAsyncIo() {
+#if LINUX
+	if (async_io.use_io_uring) {
+		if (io_uring.unsubmitted) EnterIoUring(0);
+		return;
+	}
+#endif
+
+	SubmitIoPool();
+}
+
+static u32 PollAsyncIo(IoCompletion* completions, u32 max) {
+#if LINUX
+	if (async_io.use_io_uring)
+		return PollIoUring(completions, max);
+#endif
+
+	return PollIoPool(completions, max);
+}
+
+static u32 WaitAsyncIo(IoCompletion* completions, u32 max) {
+	SubmitAsyncIo();
+
+	while (async_io.in_flight) {
+		u32 count = PollAsyncIo(completions, max);
+
+		if (count)
+			return count;
+
+#if LINUX
+		if (async_io.use_io_uring) {
+			EnterIoUring(1);
+			continue;
+		}
+#endif
+
+		if (InterruptCancelledIoPool())
+			SleepNanoseconds(IO_POOL_CANCEL_RETRY); // Finished reads leave the semaphore signalled, that's harmless.
+		else
+			WaitSemaphore(io_pool.finished_signal);
+	}
+
+	return 0;
+}
+
+static void CancelAsyncIo(IoRequest request) {
+	IoSlot* slot = FindSlot(request);
+
+	if (!slot || slot->cancel_requested)
+		return;
+
+	__atomic_store_n(&slot->cancel_requested, true, __ATOMIC_RELAXED);
+
+#if LINUX
+	if (async_io.use_io_uring) {
+		QueueIoUringCancel(request);
+		return;
+	}
+#endif
+
+	InterruptCancelledIoPool();
+}
+
+static void ShutdownAsyncIo() {
+	for (u32 i = 0; i < ASYNC_IO_MAX_REQUESTS; i++)
+		CancelAsyncIo(GetRequest(i));
+
+	IoCompletion completions[32];
+	while (WaitAsyncIo(completions, 32));
+
+#if LINUX
+	if (async_io.use_io_uring) {
+		ShutdownIoUring();
+		return;
+	}
+#endif
+
+	ShutdownIoPool();
+}
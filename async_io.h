@@ -0,0 +1,45 @@
+#ifndef ASYNC_IO_H
+#define ASYNC_IO_H
+
+#include "general.h"
+#include "file_system.h"
+
+// Asynchronous reads into caller buffers. Reads are queued with ReadAsync, sent off together by SubmitAsyncIo and
+// picked up with PollAsyncIo, which never blocks, so a frame can check for finished reads and move on.
+// On Linux this is an io_uring driven through the raw syscalls, one io_uring_enter per batch. Where io_uring
+// isn't available (macOS, old kernels, seccomp sandboxes) a few worker threads do blocking preads instead.
+// Requests, submission and polling all belong to the thread that called InitAsyncIo.
+
+typedef u64 IoRequest; // 0 is never a valid request.
+
+enum IoStatus {
+	IO_DONE,      // bytes is less than the size asked for if the file ended first.
+	IO_FAILED,
+	IO_CANCELLED,
+};
+
+struct IoCompletion {
+	IoRequest request;
+	u64       user_data;
+	u64       bytes;
+	IoStatus  status;
+};
+
+static const u32 ASYNC_IO_MAX_REQUESTS = 256; // In flight at once.
+static const u32 ASYNC_IO_THREADS      = 4;   // For the thread pool fallback.
+
+static void InitAsyncIo(bool allow_io_uring = true);
+static void ShutdownAsyncIo(); // Cancels whatever is still in flight and waits for it.
+static bool IsUsingIoUring();
+
+// Returns 0 when ASYNC_IO_MAX_REQUESTS are already in flight. The buffer has to stay valid until the completion.
+static IoRequest ReadAsync(File file, u64 offset, void* buffer, u64 size, u64 user_data = 0);
+static void      SubmitAsyncIo();
+
+static u32 PollAsyncIo(IoCompletion* completions, u32 max); // Only what's already finished.
+static u32 WaitAsyncIo(IoCompletion* completions, u32 max); // Blocks for at least one, 0 if nothing is in flight.
+
+// A read that has already finished completes normally, check the status.
+static void CancelAsyncIo(IoRequest request);
+
+#endif // ASYNC_IO_H
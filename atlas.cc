@@ -0,0 +1,258 @@
+#include "atlas.h"
+#include "math.h"
+
+static AtlasPacker CreateAtlasPacker(u32 width, u32 height) {
+	AtlasPacker packer = {
+		.width      = width,
+		.height     = height,
+		.node_count = 1,
+		.nodes      = Alloc<AtlasSkylineNode>(width + 1),
+	};
+
+	packer.nodes[0] = { 0, 0, width };
+	return packer;
+}
+
+static void FreeAtlasPacker(AtlasPacker* packer) {
+	Free(packer->nodes, packer->width + 1);
+	packer->nodes = null;
+}
+
+// Where a rectangle width wide starting at node index would sit: on the highest node it spans.
+static bool FitAtlasSkyline(AtlasPacker* packer, u32 index, u32 width, u32 height, u32* y) {
+	u32 x = packer->nodes[index].x;
+
+	if (x + width > packer->width)
+		return false;
+
+	u32 top = 0;
+	for (u32 i = index, covered = 0; covered < width; i++) {
+		top = Max(top, packer->nodes[i].y);
+		covered += packer->nodes[i].width;
+	}
+
+	if (top + height > packer->height)
+		return false;
+
+	*y = top;
+	return true;
+}
+
+static bool PackAtlasRect(AtlasPacker* packer, u32 width, u32 height, u32* x, u32* y) {
+	if (!width || !height)
+		return false;
+
+	u32 best_index  = ~0u;
+	u32 best_top    = ~0u;
+	u32 best_y      = 0;
+
+	for (u32 i = 0; i < packer->node_count; i++) {
+		u32 fit_y;
+		if (FitAtlasSkyline(packer, i, width, height, &fit_y) && fit_y + height < best_top) {
+			best_index = i;
+			best_top   = fit_y + height;
+			best_y     = fit_y;
+		}
+	}
+
+	if (best_index == ~0u)
+		return false;
+
+	*x = packer->nodes[best_index].x;
+	*y = best_y;
+
+	// The rectangle's top becomes a node, and the nodes it covers shrink or go.
+	AtlasSkylineNode* nodes = packer->nodes;
+	MoveMemory(nodes + best_index + 1, nodes + best_index, (packer->node_count - best_index) * sizeof(AtlasSkylineNode));
+	nodes[best_index] = { *x, best_top, width };
+	packer->node_count++;
+
+	u32 end = *x + width;
+
+	for (u32 i = best_index + 1; i < packer->node_count;) {
+		if (nodes[i].x >= end)
+			break;
+
+		u32 node_end = nodes[i].x + nodes[i].width;
+
+		if (node_end <= end) {
+			MoveMemory(nodes + i, nodes + i + 1, (packer->node_count - i - 1) * sizeof(AtlasSkylineNode));
+			packer->node_count--;
+			continue;
+		}
+
+		nodes[i].width = node_end - end;
+		nodes[i].x = end;
+		break;
+	}
+
+	// Neighbors at the same height are one run.
+	for (u32 i = 0; i + 1 < packer->node_count;) {
+		if (nodes[i].y == nodes[i + 1].y) {
+			nodes[i].width += nodes[i + 1].width;
+			MoveMemory(nodes + i + 1, nodes + i + 2, (packer->node_count - i - 2) * sizeof(AtlasSkylineNode));
+			packer->node_count--;
+			continue;
+		}
+
+		i++;
+	}
+
+	return true;
+}
+
+static u32 GetAtlasCellAlignment(AtlasSettings settings) {
+	return Max(4u, 1u << settings.clean_mips);
+}
+
+static void GetAtlasCellSize(u32 width, u32 height, AtlasSettings settings, u32* cell_width, u32* cell_height) {
+	u32 alignment = GetAtlasCellAlignment(settings);
+	*cell_width  = (width  + 2 * settings.gutter + alignment - 1) & ~(alignment - 1);
+	*cell_height = (height + 2 * settings.gutter + alignment - 1) & ~(alignment - 1);
+}
+
+static AtlasRect CopyIntoAtlas(Image* atlas, u32 cell_x, u32 cell_y, Image* image, AtlasSettings settings) {
+	Assert(atlas->channels == 4 && image->channels == 4);
+	Assert(image->width && image->height); // The gutter repeats edge pixels, there have to be some.
+
+	u32 cell_width, cell_height;
+	GetAtlasCellSize(image->width, image->height, settings, &cell_width, &cell_height);
+
+	u32 gutter = settings.gutter;
+	u32* dst = (u32*)atlas->data;
+	u32* src = (u32*)image->data;
+
+	// Every pixel of the cell outside the image repeats the nearest edge pixel, gutter and alignment alike.
+	for (u32 y = 0; y < cell_height; y++) {
+		u32  src_y   = Clamp((s32)y - (s32)gutter, 0, (s32)image->height - 1);
+		u32* in      = src + (u64)src_y * image->width;
+		u32* out     = dst + (u64)(cell_y + y) * atlas->width + cell_x;
+		u32  right   = gutter + image->width;
+
+		for (u32 x = 0; x < gutter; x++)
+			out[x] = in[0];
+
+		CopyMemory(out + gutter, in, image->width * 4);
+
+		for (u32 x = right; x < cell_width; x++)
+			out[x] = in[image->width - 1];
+	}
+
+	return { cell_x + gutter, cell_y + gutter, image->width, image->height };
+}
+
+static AtlasUv GetAtlasUv(Image* atlas, AtlasRect rect) {
+	return {
+		.scale  = { (f32)rect.width / atlas->width, (f32)rect.height / atlas->height },
+		.offset = { (f32)rect.x / atlas->width,     (f32)rect.y / atlas->height },
+	};
+}
+
+static Atlas* BuildAtlas(Image** images, u32 count, AtlasSettings settings) {
+	for (u32 i = 0; i < count; i++) {
+		if (!images[i]->width || !images[i]->height)
+			return null;
+	}
+
+	u32* order = Alloc<u32>(count);
+	u32* cell_x = Alloc<u32>(count);
+	u32* cell_y = Alloc<u32>(count);
+	u64  area = 0;
+	u32  widest = 1, tallest = 1;
+
+	for (u32 i = 0; i < count; i++) {
+		u32 w, h;
+		GetAtlasCellSize(images[i]->width, images[i]->height, settings, &w, &h);
+		area += (u64)w * h;
+		widest  = Max(widest, w);
+		tallest = Max(tallest, h);
+		order[i] = i;
+	}
+
+	// Tallest first, then widest, which is what a skyline packs best: the rows it builds stay level.
+	auto cell_before = [&](u32 a, u32 b) {
+		if (images[a]->height != images[b]->height) return images[a]->height > images[b]->height;
+		return images[a]->width > images[b]->width;
+	};
+
+	for (u32 i = 1; i < count; i++) {
+		u32 index = order[i];
+		u32 j = i;
+
+		for (; j > 0 && cell_before(index, order[j - 1]); j--)
+			order[j] = order[j - 1];
+
+		order[j] = index;
+	}
+
+	// Doubling the shorter side, the width of two equals, from the smallest size with room for the area until
+	// everything fits.
+	u32 width = 1, height = 1;
+	while (width  < widest)  width  <<= 1;
+	while (height < tallest) height <<= 1;
+
+	auto grow = [&]() {
+		if (width <= height)
+			width <<= 1;
+		else
+			height <<= 1;
+	};
+
+	while ((u64)width * height < area)
+		grow();
+
+	bool packed = false;
+
+	for (; width <= settings.max_size && height <= settings.max_size; grow()) {
+		AtlasPacker packer = CreateAtlasPacker(width, height);
+		packed = true;
+
+		for (u32 i = 0; i < count && packed; i++) {
+			u32 w, h;
+			GetAtlasCellSize(images[order[i]]->width, images[order[i]]->height, settings, &w, &h);
+			packed = PackAtlasRect(&packer, w, h, &cell_x[order[i]], &cell_y[order[i]]);
+		}
+
+		FreeAtlasPacker(&packer);
+
+		if (packed)
+			break;
+	}
+
+	Atlas* atlas = null;
+
+	if (packed) {
+		atlas = Alloc<Atlas>();
+		atlas->count = count;
+		atlas->rects = Alloc<AtlasRect>(count);
+		atlas->uvs   = Alloc<AtlasUv>(count);
+
+		Image* image = AllocImage((u64)width * height * 4);
+		image->channels = 4;
+		image->has_alpha_channel = true;
+		image->width  = width;
+		image->height = height;
+		ZeroMemory(image->data, image->GetSize());
+		atlas->image = image;
+
+		for (u32 i = 0; i < count; i++) {
+			atlas->rects[i] = CopyIntoAtlas(image, cell_x[i], cell_y[i], images[i], settings);
+			atlas->uvs[i]   = GetAtlasUv(image, atlas->rects[i]);
+		}
+	}
+
+	Free(order, count);
+	Free(cell_x, count);
+	Free(cell_y, count);
+	return atlas;
+}
+
+static void FreeAtlas(Atlas* atlas) {
+	if (!atlas)
+		return;
+
+	FreeImage(atlas->image);
+	Free(atlas->rects, atlas->count);
+	Free(atlas->uvs, atlas->count);
+	Free(atlas, 1);
+}
@@ -0,0 +1,75 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include "general.h"
+#include "image.h"
+
+// Texture atlases: many small images (sprites, icons, glyphs) in one, so they share one VkImage and one
+// descriptor and draw without rebinding. Rectangles are packed with a skyline, which is quick enough to add
+// images one at a time at runtime and within a few percent of tighter packers when the sizes are known up front
+// and sorted.
+
+// Places rectangles in a fixed size area, bottom left first. The skyline is the top edge of everything placed
+// so far, one node per flat run, and space under an overhang is given up.
+struct AtlasSkylineNode {
+	u32 x;
+	u32 y;
+	u32 width;
+};
+
+struct AtlasPacker {
+	u32 width;
+	u32 height;
+	u32 node_count;
+	AtlasSkylineNode* nodes; // Room for width + 1: every node is at least a pixel wide, plus one being inserted.
+};
+
+static AtlasPacker CreateAtlasPacker(u32 width, u32 height);
+static void        FreeAtlasPacker(AtlasPacker* packer);
+
+// The lowest spot the rectangle fits in, leftmost among equals. False when it fits nowhere.
+static bool PackAtlasRect(AtlasPacker* packer, u32 width, u32 height, u32* x, u32* y);
+
+struct AtlasSettings {
+	u32 max_size;   // Of either side. Atlases are powers of two so every mip level halves exactly.
+	u32 gutter;     // Pixels of each image's edges repeated around it, so bilinear filtering at its edges reads only
+	                // it. Each mip level halves it, 1 << n keeps level n filtering clean.
+	u32 clean_mips; // Box filtered mip levels (mips.h) in which images don't blend with their neighbors: each image
+	                // gets a cell aligned to 1 << clean_mips, its edges repeated to fill it. Cells are aligned to
+	                // at least 4 whatever this is, so BC blocks (block_compress.h) never straddle two images.
+};
+
+// An image's pixels in the atlas, without the gutter.
+struct AtlasRect {
+	u32 x;
+	u32 y;
+	u32 width;
+	u32 height;
+};
+
+// From an image's own texture coordinates to the atlas's: uv * scale + offset. 16 bytes with no padding, so the
+// table goes into a uniform or storage buffer as it is.
+struct AtlasUv {
+	f32 scale[2];
+	f32 offset[2];
+};
+
+struct Atlas {
+	Image*     image; // RGBA8, transparent black outside the cells.
+	u32        count;
+	AtlasRect* rects; // One per image packed, in the order they were given.
+	AtlasUv*   uvs;
+};
+
+// Packs RGBA8 images (as image.h decodes them) into the smallest power of two atlas they fit in, tallest first.
+// null if they don't fit in max_size x max_size, or if any of them is empty.
+static Atlas* BuildAtlas(Image** images, u32 count, AtlasSettings settings);
+static void   FreeAtlas(Atlas* atlas);
+
+// Adding to an atlas at runtime: the cell an image of width x height needs with settings, and copying the
+// image into the cell a packer found for it, which can't be empty. Returns where the image's own pixels went.
+static void      GetAtlasCellSize(u32 width, u32 height, AtlasSettings settings, u32* cell_width, u32* cell_height);
+static AtlasRect CopyIntoAtlas(Image* atlas, u32 cell_x, u32 cell_y, Image* image, AtlasSettings settings);
+static AtlasUv   GetAtlasUv(Image* atlas, AtlasRect rect);
+
+#endif // ATLAS_H
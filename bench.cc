@@ -0,0 +1,1941 @@
+// Micro benchmarks for the engine's kernels. Build and run with: make bench && ./bench
+// Every line reports the best of several trials in nanoseconds per operation, the resulting
+// throughput and the worst error seen against an f64 reference (0 when the output is exact).
+
+#include "general.h"
+#include "math.h"
+#include "os.h"
+
+#include "assert.cc"
+#include "alloc.cc"
+#include "unix.cc"
+#include "print.cc"
+#include "print_float.cc"
+#include "log.cc"
+#include "trace.cc"
+#include "file_system.cc"
+#include "async_io.cc"
+#include "hash.cc"
+#include "compress.cc"
+#include "file_reader.cc"
+#include "asset_archive.cc"
+#include "math_batch.cc"
+#include "culling.cc"
+#include "random.cc"
+#include "noise.cc"
+#include "jobs.cc"
+#include "pixels.cc"
+#include "image.cc"
+#include "packing.cc"
+#include "mips.cc"
+#include "block_compress.cc"
+#include "atlas.cc"
+
+#include "vector.h"
+#include "matrix.h"
+#include "quaternion.h"
+#include "camera.h"
+#include "culling.h"
+#include "packing.h"
+#include "math_batch.h"
+#include "random.h"
+#include "trace.h"
+#include "noise.h"
+#include "async_io.h"
+#include "hash.h"
+#include "asset_archive.h"
+#include "compress.h"
+#include "file_reader.h"
+#include "jobs.h"
+#include "image.h"
+#include "pixels.h"
+#include "mips.h"
+#include "block_compress.h"
+#include "atlas.h"
+
+static const u64 BENCH_TRIALS = 7;
+static const u64 BENCH_MIN_TRIAL_NANOSECONDS = 10000000;
+
+// Stops the compiler from deleting work whose result is never read.
+template<typename T>
+static inline void DoNotOptimize(T* p) { asm volatile("" : : "r"(p) : "memory"); }
+
+// Runs function enough times to take at least BENCH_MIN_TRIAL_NANOSECONDS and returns the best time per operation.
+template<typename F>
+static f64 Measure(u64 ops_per_call, F&& function) {
+	u64 calls = 1;
+	for (;;) {
+		u64 start = GetTimeNanoseconds();
+		for (u64 i = 0; i < calls; i++) function();
+		if (GetTimeNanoseconds() - start >= BENCH_MIN_TRIAL_NANOSECONDS) break;
+		calls *= 2;
+	}
+
+	u64 best = -1;
+	for (u64 trial = 0; trial < BENCH_TRIALS; trial++) {
+		u64 start = GetTimeNanoseconds();
+		for (u64 i = 0; i < calls; i++) function();
+		best = Min(best, GetTimeNanoseconds() - start);
+	}
+
+	return (f64)best / (calls * ops_per_call);
+}
+
+static void WriteFixed(OutputBuffer* buffer, f64 f, u32 decimals) {
+	u64 scale = 1;
+	for (u32 i = 0; i < decimals; i++) scale *= 10;
+
+	u64 n = (u64)(f * scale + 0.5);
+	Write(buffer, n / scale);
+	buffer->Write('.');
+
+	for (u64 digit = scale / 10; digit; digit /= 10)
+		buffer->Write('0' + (n / digit) % 10);
+}
+
+static void WriteScientific(OutputBuffer* buffer, f64 f) {
+	if (f == 0) {
+		buffer->Write("0", 1);
+		return;
+	}
+
+	s32 exponent = 0;
+	for (; f >= 10; f /= 10) exponent++;
+	for (; f <  1;  f *= 10) exponent--;
+
+	WriteFixed(buffer, f, 2);
+	Print(buffer, "e%", exponent);
+}
+
+static void WritePadded(OutputBuffer* buffer, String str, u32 width) {
+	Write(buffer, str);
+	for (u32 i = str.length; i < width; i++) buffer->Write(' ');
+}
+
+static void Report(String name, f64 ns_per_op, f64 max_error) {
+	OutputBuffer* buffer = &standard_output_buffer;
+	WritePadded(buffer, name, 36);
+	WriteFixed(buffer, ns_per_op, 3);
+	buffer->Write(" ns/op  ", 8);
+	WriteFixed(buffer, 1000.0 / ns_per_op, 1);
+	buffer->Write(" Mop/s  max error ", 18);
+	WriteScientific(buffer, max_error);
+	buffer->Write('\n');
+	buffer->Flush();
+}
+
+static Random input_random = { .seed = 0x9E3779B97F4A7C15 };
+
+static f32 RandomInput(f32 lo, f32 hi) { return input_random.NextF32(lo, hi); }
+
+static Vector3 RandomVector3(f32 lo, f32 hi) {
+	return Vector3(RandomInput(lo, hi), RandomInput(lo, hi), RandomInput(lo, hi));
+}
+
+static Quaternion RandomRotation() {
+	return Quaternion::CreateRotation(RandomVector3(-1, 1) + 0.01f, RandomInput(-Math::TAU, Math::TAU));
+}
+
+// Relative error for large references, absolute error close to zero.
+static f64 Error(f64 value, f64 reference) {
+	return Math::Const::Abs(value - reference) / Math::Const::Max(Math::Const::Abs(reference), 1);
+}
+
+static const u64 N = 1024;
+
+// ------------------------------------------------------------------------------------------------ //
+// f64 references
+
+struct Matrix4d {
+	f64 m[4][4]; // [column][row]
+
+	static Matrix4d From(Matrix4 a) {
+		Matrix4d r;
+		const f32* p = &a.x.x;
+		for (u32 i = 0; i < 16; i++) r.m[i / 4][i % 4] = p[i];
+		return r;
+	}
+
+	Matrix4d operator *(const Matrix4d& b) const {
+		Matrix4d r;
+		for (u32 c = 0; c < 4; c++)
+			for (u32 row = 0; row < 4; row++)
+				r.m[c][row] = m[0][row]*b.m[c][0] + m[1][row]*b.m[c][1] + m[2][row]*b.m[c][2] + m[3][row]*b.m[c][3];
+		return r;
+	}
+};
+
+static f64 MatrixError(Matrix4 a, const Matrix4d& reference) {
+	const f32* p = &a.x.x;
+	f64 error = 0;
+	for (u32 i = 0; i < 16; i++) error = Math::Const::Max(error, Error(p[i], reference.m[i / 4][i % 4]));
+	return error;
+}
+
+struct Quaterniond {
+	f64 r, i, j, k;
+
+	static Quaterniond From(Quaternion q) { return { q.r, q.i, q.j, q.k }; }
+
+	f64 Dot(Quaterniond q) const { return r*q.r + i*q.i + j*q.j + k*q.k; }
+	Quaterniond operator *(f64 s) const { return { r*s, i*s, j*s, k*s }; }
+	Quaterniond operator +(Quaterniond q) const { return { r+q.r, i+q.i, j+q.j, k+q.k }; }
+	Quaterniond operator *(Quaterniond q) const {
+		return {
+			r*q.r - i*q.i - j*q.j - k*q.k,
+			r*q.i + i*q.r + j*q.k - k*q.j,
+			r*q.j - i*q.k + j*q.r + k*q.i,
+			r*q.k + i*q.j - j*q.i + k*q.r,
+		};
+	}
+
+	Quaterniond Conjugate() const { return { r, -i, -j, -k }; }
+};
+
+static Quaterniond SlerpReference(Quaterniond a, Quaterniond b, f64 t) {
+	f64 dot = a.Dot(b);
+	if (dot < 0) { b = b * -1; dot = -dot; }
+	if (dot > 1) dot = 1;
+
+	f64 theta = __builtin_acos(dot);
+	if (theta < 1e-12) return a;
+
+	f64 s = __builtin_sin(theta);
+	return a * (__builtin_sin((1 - t) * theta) / s) + b * (__builtin_sin(t * theta) / s);
+}
+
+static Matrix4d ViewProjectionReference(Camera camera, f64 near, f64 far) {
+	f64 f = 1.0 / __builtin_tan(camera.fov_radians / 2.0);
+	Matrix4d projection = { };
+	projection.m[0][0] = f / camera.aspect_ratio;
+	projection.m[1][1] = -f;
+	projection.m[2][2] = far / (far - near);
+	projection.m[2][3] = 1;
+	projection.m[3][2] = -(near * far) / (far - near);
+
+	f64 pitch = camera.rotation.x * 0.5, yaw = camera.rotation.y * 0.5, roll = camera.rotation.z * 0.5;
+	f64 cp = __builtin_cos(pitch), sp = __builtin_sin(pitch);
+	f64 cy = __builtin_cos(yaw),   sy = __builtin_sin(yaw);
+	f64 cr = __builtin_cos(roll),  sr = __builtin_sin(roll);
+	Quaterniond q = Quaterniond {
+		cy*cp*cr + sy*sp*sr,
+		cy*sp*cr + sy*cp*sr,
+		sy*cp*cr - cy*sp*sr,
+		cy*cp*sr - sy*sp*cr,
+	}.Conjugate();
+
+	Matrix4d rotation = { };
+	rotation.m[0][0] = 1 - 2*(q.j*q.j + q.k*q.k); rotation.m[0][1] = 2*(q.i*q.j + q.r*q.k);     rotation.m[0][2] = 2*(q.i*q.k - q.r*q.j);
+	rotation.m[1][0] = 2*(q.i*q.j - q.r*q.k);     rotation.m[1][1] = 1 - 2*(q.i*q.i + q.k*q.k); rotation.m[1][2] = 2*(q.j*q.k + q.r*q.i);
+	rotation.m[2][0] = 2*(q.i*q.k + q.r*q.j);     rotation.m[2][1] = 2*(q.j*q.k - q.r*q.i);     rotation.m[2][2] = 1 - 2*(q.i*q.i + q.j*q.j);
+	rotation.m[3][3] = 1;
+
+	Matrix4d translation = { };
+	for (u32 i = 0; i < 4; i++) translation.m[i][i] = 1;
+	translation.m[3][0] = -camera.position.x;
+	translation.m[3][1] = -camera.position.y;
+	translation.m[3][2] = -camera.position.z;
+
+	return projection * (rotation * translation);
+}
+
+// ------------------------------------------------------------------------------------------------ //
+
+template<typename F, typename R>
+static void BenchUnary(String name, f32 lo, f32 hi, F function, R reference) {
+	static f32 in[N], out[N];
+	for (u64 i = 0; i < N; i++) in[i] = RandomInput(lo, hi);
+
+	f64 ns = Measure(N, [&]() {
+		DoNotOptimize(in);
+		for (u64 i = 0; i < N; i++) out[i] = function(in[i]);
+		DoNotOptimize(out);
+	});
+
+	f64 error = 0;
+	for (u64 i = 0; i < N; i++) error = Math::Const::Max(error, Error(out[i], reference(in[i])));
+
+	Report(name, ns, error);
+}
+
+static void BenchScalarMath() {
+	BenchUnary("Sin",   -Math::TAU, Math::TAU, [](f32 f) { return Sin(f);   }, [](f64 f) { return __builtin_sin(f);  });
+	BenchUnary("Cos",   -Math::TAU, Math::TAU, [](f32 f) { return Cos(f);   }, [](f64 f) { return __builtin_cos(f);  });
+	BenchUnary("Tan",   -1.5f,      1.5f,      [](f32 f) { return Tan(f);   }, [](f64 f) { return __builtin_tan(f);  });
+	BenchUnary("ACos",  -1.0f,      1.0f,      [](f32 f) { return ACos(f);  }, [](f64 f) { return __builtin_acos(f); });
+	BenchUnary("ATan2", -100.0f,    100.0f,    [](f32 f) { return ATan2(f, 1.5f); }, [](f64 f) { return __builtin_atan2(f, 1.5); });
+	BenchUnary("Sqrt",  0.0f,       1000.0f,   [](f32 f) { return Sqrt(f);  }, [](f64 f) { return __builtin_sqrt(f); });
+	BenchUnary("Exp",   -20.0f,     20.0f,     [](f32 f) { return Exp(f);   }, [](f64 f) { return __builtin_exp(f);  });
+	BenchUnary("LogE",  0.001f,     1000.0f,   [](f32 f) { return LogE(f);  }, [](f64 f) { return __builtin_log(f);  });
+	BenchUnary("Pow",   0.001f,     10.0f,     [](f32 f) { return Pow(f, 2.2f); }, [](f64 f) { return __builtin_pow(f, (f64)2.2f); });
+}
+
+static void BenchMatrices() {
+	// Matrix4 has no default constructor.
+	Matrix4* a   = (Matrix4*)AllocMemory(N * sizeof(Matrix4));
+	Matrix4* b   = (Matrix4*)AllocMemory(N * sizeof(Matrix4));
+	Matrix4* out = (Matrix4*)AllocMemory(N * sizeof(Matrix4));
+	static Vector4 v[N], vout[N];
+	for (u64 i = 0; i < N; i++) {
+		a[i] = Matrix4::Rotate(RandomVector3(-3, 3)) * Matrix4::Translate(RandomVector3(-100, 100));
+		b[i] = Matrix4::Perspective(RandomInput(0.5f, 2.0f), RandomInput(0.5f, 2.0f), 0.1f, 100.0f);
+		v[i] = Vector4(RandomVector3(-100, 100), 1);
+	}
+
+	auto matrix_error = [&]() {
+		f64 error = 0;
+		for (u64 i = 0; i < N; i++) error = Math::Const::Max(error, MatrixError(out[i], Matrix4d::From(a[i]) * Matrix4d::From(b[i])));
+		return error;
+	};
+
+	f64 ns = Measure(N, [&]() {
+		DoNotOptimize(a);
+		for (u64 i = 0; i < N; i++) out[i] = a[i] * b[i];
+		DoNotOptimize(out);
+	});
+	Report("Matrix4 * Matrix4", ns, matrix_error());
+
+	ns = Measure(N, [&]() {
+		DoNotOptimize(a);
+		MultiplyMatrices(out, a, b, N);
+		DoNotOptimize(out);
+	});
+	Report("Matrix4 * Matrix4 (batched)", ns, matrix_error());
+
+	ns = Measure(N, [&]() {
+		DoNotOptimize(v);
+		for (u64 i = 0; i < N; i++) vout[i] = a[i] * v[i];
+		DoNotOptimize(vout);
+	});
+
+	// operator*(Vector4) dots v with each of the matrix's columns.
+	f64 error = 0;
+	for (u64 i = 0; i < N; i++) {
+		Matrix4d m = Matrix4d::From(a[i]);
+		const f32* p = &vout[i].x;
+		for (u32 c = 0; c < 4; c++)
+			error = Math::Const::Max(error, Error(p[c], m.m[c][0]*v[i].x + m.m[c][1]*v[i].y + m.m[c][2]*v[i].z + m.m[c][3]*v[i].w));
+	}
+
+	Report("Matrix4 * Vector4", ns, error);
+
+	FreeMemory(a,   N * sizeof(Matrix4));
+	FreeMemory(b,   N * sizeof(Matrix4));
+	FreeMemory(out, N * sizeof(Matrix4));
+}
+
+static void BenchQuaternions() {
+	static f32 x[N], y[N], z[N], rx[N], ry[N], rz[N];
+	static Vector3 vectors[N], rotated[N];
+	static Quaternion a[N], b[N], out[N];
+	static f32 t[N];
+
+	Quaternion q = RandomRotation();
+	for (u64 i = 0; i < N; i++) {
+		vectors[i] = RandomVector3(-10, 10);
+		x[i] = vectors[i].x;
+		y[i] = vectors[i].y;
+		z[i] = vectors[i].z;
+		a[i] = RandomRotation();
+		b[i] = RandomRotation();
+		t[i] = RandomInput(0, 1);
+	}
+
+	auto rotate_error = [&](f32* px, f32* py, f32* pz) {
+		Quaterniond qd = Quaterniond::From(q);
+		f64 error = 0;
+		for (u64 i = 0; i < N; i++) {
+			Quaterniond r = qd * Quaterniond { 0, vectors[i].x, vectors[i].y, vectors[i].z } * qd.Conjugate();
+			error = Math::Const::Max(error, Error(px[i], r.i));
+			error = Math::Const::Max(error, Error(py[i], r.j));
+			error = Math::Const::Max(error, Error(pz[i], r.k));
+		}
+		return error;
+	};
+
+	f64 ns = Measure(N, [&]() {
+		DoNotOptimize(vectors);
+		for (u64 i = 0; i < N; i++) rotated[i] = q.Rotate(vectors[i]);
+		DoNotOptimize(rotated);
+	});
+
+	for (u64 i = 0; i < N; i++) {
+		rx[i] = rotated[i].x;
+		ry[i] = rotated[i].y;
+		rz[i] = rotated[i].z;
+	}
+
+	Report("Quaternion::Rotate", ns, rotate_error(rx, ry, rz));
+
+	ns = Measure(N, [&]() {
+		DoNotOptimize(x);
+		RotateVectors(q, { rx, ry, rz }, { x, y, z }, N);
+		DoNotOptimize(rx);
+	});
+	Report("Quaternion::Rotate (batched)", ns, rotate_error(rx, ry, rz));
+
+	auto slerp_error = [&]() {
+		f64 error = 0;
+		for (u64 i = 0; i < N; i++) {
+			Quaterniond r = SlerpReference(Quaterniond::From(a[i]), Quaterniond::From(b[i]), t[i]);
+			error = Math::Const::Max(error, Error(out[i].r, r.r));
+			error = Math::Const::Max(error, Error(out[i].i, r.i));
+			error = Math::Const::Max(error, Error(out[i].j, r.j));
+			error = Math::Const::Max(error, Error(out[i].k, r.k));
+		}
+		return error;
+	};
+
+	ns = Measure(N, [&]() {
+		DoNotOptimize(a);
+		for (u64 i = 0; i < N; i++) out[i] = Slerp(a[i], b[i], t[i]);
+		DoNotOptimize(out);
+	});
+	Report("Slerp", ns, slerp_error());
+
+	ns = Measure(N, [&]() {
+		DoNotOptimize(a);
+		SlerpQuaternions(out, a, b, t, N);
+		DoNotOptimize(out);
+	});
+	Report("Slerp (batched)", ns, slerp_error());
+}
+
+static void BenchCamera() {
+	static Camera cameras[N];
+	Matrix4* out = (Matrix4*)AllocMemory(N * sizeof(Matrix4));
+	for (u64 i = 0; i < N; i++) {
+		cameras[i].position = RandomVector3(-100, 100);
+		cameras[i].rotation = RandomVector3(-Math::TAU, Math::TAU);
+		cameras[i].aspect_ratio = RandomInput(0.5f, 2.5f);
+	}
+
+	f64 ns = Measure(N, [&]() {
+		DoNotOptimize(cameras);
+		for (u64 i = 0; i < N; i++) out[i] = cameras[i].GenerateVP(0.1f, 100.0f);
+		DoNotOptimize(out);
+	});
+
+	f64 error = 0;
+	for (u64 i = 0; i < N; i++) error = Math::Const::Max(error, MatrixError(out[i], ViewProjectionReference(cameras[i], 0.1f, 100.0f)));
+	Report("Camera::GenerateVP", ns, error);
+
+	FreeMemory(out, N * sizeof(Matrix4));
+}
+
+// 1M instances scattered around a camera, the kernels against the scalar plane tests they vectorize. Per instance,
+// which is also milliseconds per million, and the error is how many instances the two disagree on.
+static u32 CountCullMismatches(const u8* expect, u32 count, const u32* visible, u32 visible_count) {
+	u32 mismatches = 0;
+	u32 next = 0;
+
+	for (u32 i = 0; i < count; i++) {
+		bool found = next < visible_count && visible[next] == i;
+		next += found;
+		mismatches += found != expect[i];
+	}
+
+	return mismatches + (visible_count - next);
+}
+
+static void BenchCulling() {
+	const u32 count = 1 << 20;
+	f32* x = Alloc<f32>(count);
+	f32* y = Alloc<f32>(count);
+	f32* z = Alloc<f32>(count);
+	f32* extent_x = Alloc<f32>(count);
+	f32* extent_y = Alloc<f32>(count);
+	f32* extent_z = Alloc<f32>(count);
+	u32* visible  = Alloc<u32>(count);
+	u8*  expect   = Alloc<u8>(count);
+
+	FillRandomF32(x, count, 31, 0, -100, 100);
+	FillRandomF32(y, count, 32, 0, -100, 100);
+	FillRandomF32(z, count, 33, 0, -100, 100);
+	FillRandomF32(extent_x, count, 34, 0, 0.1f, 5);
+	FillRandomF32(extent_y, count, 35, 0, 0.1f, 5);
+	FillRandomF32(extent_z, count, 36, 0, 0.1f, 5);
+
+	Camera camera = { .position = Vector3(10, 5, -20), .rotation = Vector3(0.3f, 1.2f, 0), .aspect_ratio = 16.0f / 9 };
+	Frustum frustum = Frustum::FromMatrix(camera.GenerateVP(0.1f, 100.0f));
+
+	// The spheres use extent_x as the radius.
+	BoundingSpheres spheres = { x, y, z, extent_x, count };
+	BoundingBoxes   boxes   = { x, y, z, extent_x, extent_y, extent_z, count };
+	u32 visible_count = 0;
+
+	f64 ns = Measure(count, [&]() {
+		DoNotOptimize(x);
+		for (u32 i = 0; i < count; i++) expect[i] = frustum.TestSphere(Vector3(x[i], y[i], z[i]), extent_x[i]);
+		DoNotOptimize(expect);
+	});
+	Report("Frustum::TestSphere (per instance)", ns, 0);
+
+	ns = Measure(count, [&]() {
+		DoNotOptimize(x);
+		visible_count = CullSpheres(&frustum, spheres, visible);
+		DoNotOptimize(visible);
+	});
+	Report("CullSpheres (per instance)", ns, CountCullMismatches(expect, count, visible, visible_count));
+	Print("% of % visible\n", visible_count, count);
+
+	ns = Measure(count, [&]() {
+		DoNotOptimize(x);
+		for (u32 i = 0; i < count; i++) expect[i] = frustum.TestAabb(Vector3(x[i], y[i], z[i]), Vector3(extent_x[i], extent_y[i], extent_z[i]));
+		DoNotOptimize(expect);
+	});
+	Report("Frustum::TestAabb (per instance)", ns, 0);
+
+	ns = Measure(count, [&]() {
+		DoNotOptimize(x);
+		visible_count = CullBoxes(&frustum, boxes, visible);
+		DoNotOptimize(visible);
+	});
+	Report("CullBoxes (per instance)", ns, CountCullMismatches(expect, count, visible, visible_count));
+	Print("% of % visible\n", visible_count, count);
+
+	Free(expect,   count);
+	Free(visible,  count);
+	Free(extent_z, count);
+	Free(extent_y, count);
+	Free(extent_x, count);
+	Free(z, count);
+	Free(y, count);
+	Free(x, count);
+}
+
+// The packers, checked as well as timed: the batched functions have to give the same bits as the scalar ones, and
+// what round-trips has to stay within the bounds packing.h gives. The error is how many values do either wrong.
+static const u64 PACK_COUNT = 1 << 20;
+
+// Normalized formats with one channel, over values a little past the range with exact ties and edge cases mixed in.
+// bound is the round-trip error packing.h gives, the f32 division back adds up to an ulp at 1.
+template<typename T>
+static void BenchPackNormalized(String name, f32 lo, f64 bound, T (*pack)(f32), f32 (*unpack)(T), void (*pack_batched)(T*, const f32*, u64), void (*unpack_batched)(f32*, const T*, u64)) {
+	f32* in       = Alloc<f32>(PACK_COUNT);
+	f32* out      = Alloc<f32>(PACK_COUNT);
+	T*   packed   = Alloc<T>(PACK_COUNT);
+	T*   expect   = Alloc<T>(PACK_COUNT);
+	f32  scale    = 0.5 / bound;
+	FillRandomF32(in, PACK_COUNT, 41, 0, lo - 0.25f, 1.25f);
+
+	for (u64 i = 0; i < PACK_COUNT; i += 4)
+		in[i] = ((s32)(in[i] * scale) + (in[i] < 0 ? -0.5f : 0.5f)) / scale;
+
+	f32 edges[] = { 0.0f, -0.0f, lo, 1.0f, 1e-30f, -1e-30f, 0.5f / scale, -0.5f / scale, __builtin_inff(), -__builtin_inff(), __builtin_nanf("") };
+	CopyMemory(in, edges, sizeof(edges));
+
+	f64 ns = Measure(PACK_COUNT, [&]() {
+		DoNotOptimize(in);
+		for (u64 i = 0; i < PACK_COUNT; i++) expect[i] = pack(in[i]);
+		DoNotOptimize(expect);
+	});
+
+	u64 failures = 0;
+
+	for (u64 i = 0; i < PACK_COUNT; i++) {
+		if (in[i] != in[i]) continue;
+		f64 clamped = Math::Const::Min(Math::Const::Max((f64)in[i], (f64)lo), 1.0);
+		failures += Math::Const::Abs(unpack(expect[i]) - clamped) > bound + 0x1p-23;
+	}
+
+	Report(name, ns, failures);
+
+	ns = Measure(PACK_COUNT, [&]() {
+		DoNotOptimize(in);
+		pack_batched(packed, in, PACK_COUNT);
+		DoNotOptimize(packed);
+	});
+
+	unpack_batched(out, expect, PACK_COUNT);
+
+	for (u64 i = 0; i < PACK_COUNT; i++) {
+		failures += packed[i] != expect[i];
+		failures += __builtin_bit_cast(u32, out[i]) != __builtin_bit_cast(u32, unpack(expect[i]));
+	}
+
+	String batched_name = Format("% (batched)", name);
+	Report(batched_name, ns, failures);
+	batched_name.Free();
+
+	Free(expect, PACK_COUNT);
+	Free(packed, PACK_COUNT);
+	Free(out,    PACK_COUNT);
+	Free(in,     PACK_COUNT);
+}
+
+// Four channels to a u32, checked the same way. bounds are the round-trip errors of the channels.
+static void BenchPackVectors(String name, f32 lo, Vector4 bounds, u32 (*pack)(Vector4), Vector4 (*unpack)(u32), void (*pack_batched)(u32*, const f32*, u64)) {
+	const u64 count = PACK_COUNT / 4;
+	f32* in     = Alloc<f32>(PACK_COUNT);
+	u32* packed = Alloc<u32>(count);
+	u32* expect = Alloc<u32>(count);
+	FillRandomF32(in, PACK_COUNT, 42, 0, lo - 0.25f, 1.25f);
+
+	for (u64 i = 0; i < PACK_COUNT; i += 3) {
+		f32 scale = 0.5f / (&bounds.x)[i % 4];
+		in[i] = ((s32)(in[i] * scale) + (in[i] < 0 ? -0.5f : 0.5f)) / scale;
+	}
+
+	f32 edges[] = { 0.0f, -0.0f, lo, 1.0f, lo, 1.0f, -0.0f, 0.0f, __builtin_inff(), -__builtin_inff(), __builtin_nanf(""), 0.5f };
+	CopyMemory(in, edges, sizeof(edges));
+
+	f64 ns = Measure(count, [&]() {
+		DoNotOptimize(in);
+		for (u64 i = 0; i < count; i++) expect[i] = pack(Vector4(in[i*4], in[i*4 + 1], in[i*4 + 2], in[i*4 + 3]));
+		DoNotOptimize(expect);
+	});
+
+	u64 failures = 0;
+
+	for (u64 i = 0; i < count; i++) {
+		Vector4 back = unpack(expect[i]);
+
+		for (u32 c = 0; c < 4; c++) {
+			f32 f = in[i*4 + c];
+			if (f != f) continue;
+			f64 clamped = Math::Const::Min(Math::Const::Max((f64)f, (f64)lo), 1.0);
+			failures += Math::Const::Abs((&back.x)[c] - clamped) > (&bounds.x)[c] + 0x1p-23;
+		}
+	}
+
+	Report(name, ns, failures);
+
+	ns = Measure(count, [&]() {
+		DoNotOptimize(in);
+		pack_batched(packed, in, count);
+		DoNotOptimize(packed);
+	});
+
+	for (u64 i = 0; i < count; i++)
+		failures += packed[i] != expect[i];
+
+	String batched_name = Format("% (batched)", name);
+	Report(batched_name, ns, failures);
+	batched_name.Free();
+
+	Free(expect, count);
+	Free(packed, count);
+	Free(in,     PACK_COUNT);
+}
+
+static void BenchPacking() {
+	// Every half: unpacking is exact, so packing what comes back has to give the same half, nans made quiet.
+	u16* halves = Alloc<u16>(1 << 16);
+	f32* floats = Alloc<f32>(1 << 16);
+	u16* repacked = Alloc<u16>(1 << 16);
+	u64 failures = 0;
+
+	for (u32 h = 0; h < 1 << 16; h++)
+		halves[h] = h;
+
+	UnpackHalf(floats, halves, 1 << 16);
+	PackHalf(repacked, floats, 1 << 16);
+
+	for (u32 h = 0; h < 1 << 16; h++) {
+		bool nan = (h & 0x7FFF) > 0x7C00;
+		failures += __builtin_bit_cast(u32, floats[h]) != __builtin_bit_cast(u32, UnpackHalf((u16)h));
+		failures += repacked[h] != PackHalf(floats[h]);
+		failures += repacked[h] != (nan ? h | 0x200 : h);
+	}
+
+	Print("% of 65536 halves wrong\n", failures);
+
+	Free(repacked, 1 << 16);
+	Free(floats,   1 << 16);
+	Free(halves,   1 << 16);
+
+	// Random floats, every other one with an exponent near the half range and every fourth an exact tie.
+	u32* bits   = Alloc<u32>(PACK_COUNT);
+	f32* in     = Alloc<f32>(PACK_COUNT);
+	u16* packed = Alloc<u16>(PACK_COUNT);
+	u16* expect = Alloc<u16>(PACK_COUNT);
+	FillRandomU32(bits, PACK_COUNT, 43, 0);
+
+	for (u64 i = 0; i < PACK_COUNT; i++) {
+		if (i & 1) bits[i] = (bits[i] & 0x807FFFFF) | (100 + bits[i] % 46) << 23;
+		if (i % 4 == 1) bits[i] = (bits[i] & ~0x1FFF) | 0x1000;
+	}
+
+	u32 edges[] = { 0, 0x80000000, 0x7F800000, 0xFF800000, 0x7FC00000, 0x7F800001, 0xFFFFFFFF, 0x477FE000, 0x477FEFFF, 0x477FF000, 0x38800000, 0x387FFFFF, 0x33000000, 0x33000001, 0x00000001 };
+	CopyMemory(bits, edges, sizeof(edges));
+	CopyMemory(in, bits, PACK_COUNT * sizeof(u32));
+
+	f64 ns = Measure(PACK_COUNT, [&]() {
+		DoNotOptimize(in);
+		for (u64 i = 0; i < PACK_COUNT; i++) expect[i] = PackHalf(in[i]);
+		DoNotOptimize(expect);
+	});
+
+	failures = 0;
+
+	for (u64 i = 0; i < PACK_COUNT; i++) {
+		f64 f = Math::Const::Abs(in[i]);
+		f64 back = Math::Const::Abs(UnpackHalf(expect[i]));
+		failures += (expect[i] >> 15) != (bits[i] >> 31);
+
+		if (f != f)
+			failures += back == back;
+		else if (f >= 65520)
+			failures += back != __builtin_inf();
+		else
+			failures += Math::Const::Abs(back - f) > (f < 0x1p-14 ? 0x1p-25 : f * 0x1p-11);
+	}
+
+	Report("PackHalf", ns, failures);
+
+	ns = Measure(PACK_COUNT, [&]() {
+		DoNotOptimize(in);
+		PackHalf(packed, in, PACK_COUNT);
+		DoNotOptimize(packed);
+	});
+
+	for (u64 i = 0; i < PACK_COUNT; i++)
+		failures += packed[i] != expect[i];
+
+	Report("PackHalf (batched)", ns, failures);
+
+	Free(expect, PACK_COUNT);
+	Free(packed, PACK_COUNT);
+	Free(in,     PACK_COUNT);
+	Free(bits,   PACK_COUNT);
+
+	BenchPackNormalized<u8> ("PackUnorm8",  0,  1.0 / 510,    PackUnorm8,  UnpackUnorm8,  PackUnorm8,  UnpackUnorm8);
+	BenchPackNormalized<s8> ("PackSnorm8",  -1, 1.0 / 254,    PackSnorm8,  UnpackSnorm8,  PackSnorm8,  UnpackSnorm8);
+	BenchPackNormalized<u16>("PackUnorm16", 0,  1.0 / 131070, PackUnorm16, UnpackUnorm16, PackUnorm16, UnpackUnorm16);
+	BenchPackNormalized<s16>("PackSnorm16", -1, 1.0 / 65534,  PackSnorm16, UnpackSnorm16, PackSnorm16, UnpackSnorm16);
+
+	BenchPackVectors("PackUnorm8x4",     0,  Vector4(1.0f / 510,  1.0f / 510,  1.0f / 510,  1.0f / 510), PackUnorm8x4,     UnpackUnorm8x4,     PackUnorm8x4);
+	BenchPackVectors("PackUnorm1010102", 0,  Vector4(1.0f / 2046, 1.0f / 2046, 1.0f / 2046, 1.0f / 6),   PackUnorm1010102, UnpackUnorm1010102, PackUnorm1010102);
+	BenchPackVectors("PackSnorm1010102", -1, Vector4(1.0f / 1022, 1.0f / 1022, 1.0f / 1022, 1.0f),       PackSnorm1010102, UnpackSnorm1010102, PackSnorm1010102);
+}
+
+static void BenchRandom() {
+	static u32 numbers[N];
+	static f32 floats[N];
+
+	f64 ns = Measure(N, [&]() {
+		for (u64 i = 0; i < N; i++) numbers[i] = RandomU32(1234, i);
+		DoNotOptimize(numbers);
+	});
+	Report("RandomU32", ns, 0);
+
+	ns = Measure(N, [&]() {
+		FillRandomU32(numbers, N, 1234, 0);
+		DoNotOptimize(numbers);
+	});
+	Report("RandomU32 (batched)", ns, 0);
+
+	ns = Measure(N, [&]() {
+		FillRandomF32(floats, N, 1234, 0, -1, 1);
+		DoNotOptimize(floats);
+	});
+	Report("RandomF32 (batched)", ns, 0);
+}
+
+static void BenchNoise() {
+	static f32 x[N], y[N], z[N], out[N];
+	FillRandomF32(x, N, 1, 0, -100, 100);
+	FillRandomF32(y, N, 2, 0, -100, 100);
+	FillRandomF32(z, N, 3, 0, -100, 100);
+	Vector2Soa points2 = { x, y };
+	Vector3Soa points3 = { x, y, z };
+
+	auto bench = [&](String name, auto fill) {
+		f64 ns = Measure(N, [&]() {
+			DoNotOptimize(x);
+			fill();
+			DoNotOptimize(out);
+		});
+		Report(name, ns, 0);
+	};
+
+	bench("ValueNoise 2D (batched)",    [&]() { ValueNoise(out, points2, N, 7);    });
+	bench("ValueNoise 3D (batched)",    [&]() { ValueNoise(out, points3, N, 7);    });
+	bench("GradientNoise 2D (batched)", [&]() { GradientNoise(out, points2, N, 7); });
+	bench("GradientNoise 3D (batched)", [&]() { GradientNoise(out, points3, N, 7); });
+	bench("SimplexNoise 2D (batched)",  [&]() { SimplexNoise(out, points2, N, 7);  });
+	bench("SimplexNoise 3D (batched)",  [&]() { SimplexNoise(out, points3, N, 7);  });
+	bench("SimplexNoise 3D",            [&]() { for (u64 i = 0; i < N; i++) out[i] = SimplexNoise(Vector3(x[i], y[i], z[i]), 7); });
+}
+
+// The formatter Write(OutputBuffer*, u64) used before the digit pair tables, kept as a baseline.
+static u32 FormatU64PerDigit(char* out, u64 n) {
+	const int max = 20;
+	char digits[max];
+	int count = 0;
+
+	do {
+		digits[max - count - 1] = '0' + n % 10;
+	} while (++count < max && (n /= 10));
+
+	CopyMemory(out, digits + (max - count), count);
+	return count;
+}
+
+// Print before FormatString: finds each '%' at runtime.
+template<typename ...Args>
+static void PrintScanned(OutputBuffer* buffer, String format, Args&&... args) {
+	char* end = format.data + format.length;
+	char* p = format.data;
+
+	auto internal_print = [=, &p]<typename T>(T&& t) {
+		char* start = p;
+
+		while (p < end && *p != '%') p++;
+
+		if (start != p)
+			buffer->Write(start, p-start);
+
+		if (p < end)
+		{
+			Write(buffer, t);
+			p++;
+		}
+	};
+
+	(internal_print(args),...);
+
+	if (p < end)
+		buffer->Write(p, end - p);
+}
+
+static void BenchPrint() {
+	static u64 numbers[N];
+	static char characters[N * FORMAT_BINARY_MAX];
+
+	// Every magnitude from 1 to 20 digits, like a mix of counters, sizes and ids.
+	for (u64 i = 0; i < N; i++)
+		numbers[i] = ((u64)RandomU32(99, 2*i) << 32 | RandomU32(99, 2*i+1)) >> (i % 64);
+
+	auto bench = [&](String name, auto format) {
+		f64 ns = Measure(N, [&]() {
+			DoNotOptimize(numbers);
+			char* p = characters;
+			for (u64 i = 0; i < N; i++) p += format(p, numbers[i]);
+			DoNotOptimize(characters);
+		});
+		Report(name, ns, 0);
+	};
+
+	bench("FormatU64 (divide per digit)", [](char* p, u64 n) { return FormatU64PerDigit(p, n); });
+	bench("FormatU64",                    [](char* p, u64 n) { return FormatU64(p, n); });
+	bench("FormatS64",                    [](char* p, u64 n) { return FormatS64(p, (s64)n); });
+	bench("FormatHex",                    [](char* p, u64 n) { return FormatHex(p, n); });
+	bench("FormatBinary",                 [](char* p, u64 n) { return FormatBinary(p, n); });
+
+	static FileOutputBuffer null_output { OpenFile("/dev/null") };
+	f64 ns = Measure(N, [&]() {
+		for (u64 i = 0; i < N; i++) Print(&null_output, "% ", numbers[i]);
+		null_output.Flush();
+	});
+	Report("Print(\"% \", u64) to /dev/null", ns, 0);
+
+	ns = Measure(N, [&]() {
+		for (u64 i = 0; i < N; i++) PrintScanned(&null_output, "frame %: % draws, % triangles, %\n", i, numbers[i], numbers[i] >> 8, Hex(i));
+		null_output.Flush();
+	});
+	Report("Print 4 args (scanned format)", ns, 0);
+
+	ns = Measure(N, [&]() {
+		for (u64 i = 0; i < N; i++) Print(&null_output, "frame %: % draws, % triangles, %\n", i, numbers[i], numbers[i] >> 8, Hex(i));
+		null_output.Flush();
+	});
+	Report("Print 4 args", ns, 0);
+
+	static char label[64];
+	ns = Measure(N, [&]() {
+		for (u64 i = 0; i < N; i++) FormatInto(label, sizeof(label), "cube_%_lod%", numbers[i] & 0xFFFF, i & 3);
+		DoNotOptimize(label);
+	});
+	Report("FormatInto fixed label", ns, 0);
+
+	ns = Measure(N, [&]() {
+		for (u64 i = 0; i < N; i++) {
+			String name = Format("cube_%_lod%", numbers[i] & 0xFFFF, i & 3);
+			DoNotOptimize(name.data);
+			name.Free();
+		}
+	});
+	Report("Format label to String", ns, 0);
+
+	ns = Measure(N, [&]() {
+		for (u64 i = 0; i < N; i++) {
+			OutputBuffer buffer = GrowableOutput();
+			Print(&buffer, "assets/textures/%/%_%.png", Hex(numbers[i]), numbers[i] & 0xFF, i & 3);
+			String path = buffer.TakeString();
+			DoNotOptimize(path.data);
+			path.Free();
+		}
+	});
+	Report("GrowableOutput path, no stack", ns, 0);
+
+	// Flushed often enough that the ring never fills, so this is the full cost of a line including the write.
+	StartLogThread(null_output.file);
+	ns = Measure(N, [&]() {
+		for (u64 i = 0; i < N; i++) {
+			LogInfo("frame %: % draws, % triangles, %", i, numbers[i], numbers[i] >> 8, Hex(i));
+			if (i % 1024 == 1023) FlushLog();
+		}
+		FlushLog();
+	});
+	Report("LogInfo 4 args to /dev/null", ns, 0);
+
+	StartTracing(null_output.file);
+	ns = Measure(N, [&]() {
+		for (u64 i = 0; i < N; i++) {
+			Trace("frame %: % draws, % triangles, %", i, numbers[i], numbers[i] >> 8, Hex(i));
+			if (i % 1024 == 1023) FlushLog();
+		}
+		FlushLog();
+	});
+	StopLogThread();
+	Report("Trace 4 args to /dev/null", ns, 0);
+}
+
+// Write(OutputBuffer*, f64) before print_float.cc: integer part, then 9 truncated fraction digits.
+static u32 FormatF64Truncated(char* out, f64 f) {
+	u32 length = FormatS64(out, (s64)f);
+	out[length++] = '.';
+	s64 frac = (s64)Abs((f-(s64)f) * Pow(10, 9));
+	for (s64 threshold = 100000000; threshold > 1; threshold /= 10)
+		if (frac < threshold) out[length++] = '0';
+	return length + FormatS64(out + length, frac);
+}
+
+// Prints the bits and reads them back with the C library, true when they don't come back the same. Nans only have to
+// stay nans.
+static bool F64RoundTripFails(u64 bits) {
+	char text[FORMAT_FLOAT_MAX + 1];
+	f64 f = __builtin_bit_cast(f64, bits);
+	text[FormatF64(text, f)] = 0;
+	f64 back = strtod(text, null);
+	return f != f ? back == back : __builtin_bit_cast(u64, back) != bits;
+}
+
+static bool F32RoundTripFails(u32 bits) {
+	char text[FORMAT_FLOAT_MAX + 1];
+	f32 f = __builtin_bit_cast(f32, bits);
+	text[FormatF32(text, f)] = 0;
+	f32 back = strtof(text, null);
+	return f != f ? back == back : __builtin_bit_cast(u32, back) != bits;
+}
+
+// Random bit patterns, every power of two and its neighbors, and the edges: zeros, subnormals, min and max normal,
+// infinities and nans. Returns how many don't round-trip.
+static u64 CountF64RoundTripFailures() {
+	const u64 count = 1 << 20;
+	u32* random = Alloc<u32>(count * 2);
+	FillRandomU32(random, count * 2, 51, 0);
+	u64 failures = 0;
+
+	for (u64 i = 0; i < count; i++)
+		failures += F64RoundTripFails((u64)random[i*2] << 32 | random[i*2 + 1]);
+
+	for (u64 sign = 0; sign < 2; sign++) {
+		for (u64 exponent = 0; exponent < 0x7FF; exponent++) {
+			u64 power = sign << 63 | exponent << 52;
+			failures += F64RoundTripFails(power);
+			failures += F64RoundTripFails(power + 1);
+			failures += F64RoundTripFails(power | 0xFFFFFFFFFFFFF);
+		}
+	}
+
+	u64 edges[] = { 0, 1ull << 63, 1, 0xFFFFFFFFFFFFF, 0x10000000000000, 0x7FEFFFFFFFFFFFFF, 0xFFEFFFFFFFFFFFFF, 0x7FF0000000000000, 0xFFF0000000000000, 0x7FF8000000000000, 0x7FF0000000000001 };
+	for (u64 bits : edges)
+		failures += F64RoundTripFails(bits);
+
+	Free(random, count * 2);
+	return failures;
+}
+
+static u64 CountF32RoundTripFailures() {
+	const u64 count = 1 << 20;
+	u32* random = Alloc<u32>(count);
+	FillRandomU32(random, count, 52, 0);
+	u64 failures = 0;
+
+	for (u64 i = 0; i < count; i++)
+		failures += F32RoundTripFails(random[i]);
+
+	for (u32 sign = 0; sign < 2; sign++) {
+		for (u32 exponent = 0; exponent < 0xFF; exponent++) {
+			u32 power = sign << 31 | exponent << 23;
+			failures += F32RoundTripFails(power);
+			failures += F32RoundTripFails(power + 1);
+			failures += F32RoundTripFails(power | 0x7FFFFF);
+		}
+	}
+
+	u32 edges[] = { 0, 1u << 31, 1, 0x7FFFFF, 0x800000, 0x7F7FFFFF, 0xFF7FFFFF, 0x7F800000, 0xFF800000, 0x7FC00000, 0x7F800001 };
+	for (u32 bits : edges)
+		failures += F32RoundTripFails(bits);
+
+	Free(random, count);
+	return failures;
+}
+
+static void BenchFloatPrint() {
+	static f64 numbers[N];
+	static char characters[N * FORMAT_FLOAT_MAX];
+
+	// Mostly game-sized values with a few digits, like positions and timings, plus a spread of exponents.
+	for (u64 i = 0; i < N; i++)
+		numbers[i] = (i & 1) ? RandomInput(-1000, 1000) : RandomInput(-1, 1) * Pow(10, (s64)(i % 32) - 16);
+
+	auto bench = [&](String name, auto format, u64 failures) {
+		f64 ns = Measure(N, [&]() {
+			DoNotOptimize(numbers);
+			char* p = characters;
+			for (u64 i = 0; i < N; i++) p += format(p, numbers[i]);
+			DoNotOptimize(characters);
+		});
+		Report(name, ns, failures);
+	};
+
+	// For the shortest formats the error is how many values don't read back as the same bits.
+	u64 f64_failures = CountF64RoundTripFailures();
+	u64 f32_failures = CountF32RoundTripFailures();
+
+	for (u64 i = 0; i < N; i++) {
+		f64_failures += F64RoundTripFails(__builtin_bit_cast(u64, numbers[i]));
+		f32_failures += F32RoundTripFails(__builtin_bit_cast(u32, (f32)numbers[i]));
+	}
+
+	bench("FormatF64 (old, truncated)", [](char* p, f64 f) { return FormatF64Truncated(p, Math::Const::Min(Math::Const::Max(f, -1e9), 1e9)); }, 0);
+	bench("FormatF64",                  [](char* p, f64 f) { return FormatF64(p, f); }, f64_failures);
+	bench("FormatF32",                  [](char* p, f64 f) { return FormatF32(p, (f32)f); }, f32_failures);
+	bench("FormatFixed (3)",            [](char* p, f64 f) { return FormatFixed(p, Math::Const::Min(Math::Const::Max(f, -1e9), 1e9), 3); }, 0);
+	bench("FormatScientific (6)",       [](char* p, f64 f) { return FormatScientific(p, f, 6); }, 0);
+}
+
+static u64 SumPages(const byte* data, u64 length, u64 stride) {
+	u64 sum = 0;
+	for (u64 i = 0; i < length; i += stride) sum += data[i];
+	return sum;
+}
+
+static void BenchFiles() {
+	const u64 size = 64 << 20;
+	String path = "/tmp/engine_bench_file.bin";
+
+	// Written once, then everything below reads it from the page cache.
+	File file = OpenFile(path, FILE_MODE_CREATE_OR_TRUNCATE, FILE_ACCESS_WRITE);
+	u32* words = (u32*)AllocMemory(size);
+	FillRandomU32(words, size / 4, 123, 0);
+	file.Write((const char*)words, size);
+	file.Close();
+	FreeMemory(words, size);
+
+	// Per MiB, touching one byte per page so the cost is getting the pages rather than summing them.
+	f64 ns = Measure(size >> 20, [&]() {
+		Array<byte> data = LoadFile(path);
+		u64 sum = SumPages((const byte*)data.data, data.length, PAGE_SIZE);
+		DoNotOptimize(&sum);
+		data.Free();
+	});
+	Report("LoadFile 64 MiB (per MiB)", ns, 0);
+
+	ns = Measure(size >> 20, [&]() {
+		MappedFile data = MapFile(path, FILE_ADVICE_SEQUENTIAL);
+		u64 sum = SumPages(data.data, data.length, PAGE_SIZE);
+		DoNotOptimize(&sum);
+		data.Unmap();
+	});
+	Report("MapFile 64 MiB (per MiB)", ns, 0);
+
+	ns = Measure(size >> 20, [&]() {
+		MappedFile data = MapFile(path, FILE_ADVICE_RANDOM);
+		u64 sum = SumPages(data.data, data.length, PAGE_SIZE * 16);
+		DoNotOptimize(&sum);
+		data.Unmap();
+	});
+	Report("MapFile, 1 page in 16 (per MiB)", ns, 0);
+
+	// 64 KiB chunks into one buffer, the way streaming reads them.
+	const u64 chunk = 64 << 10;
+	byte* buffer = (byte*)AllocMemory(size);
+
+	ns = Measure(size >> 20, [&]() {
+		File input = OpenFile(path, FILE_MODE_OPEN, FILE_ACCESS_READ);
+		for (u64 offset = 0; offset < size; offset += chunk) input.Read((char*)buffer + offset, chunk);
+		input.Close();
+		DoNotOptimize(buffer);
+	});
+	Report("Read 64 KiB chunks (per MiB)", ns, 0);
+
+	auto bench_async = [&](String name) {
+		f64 ns = Measure(size >> 20, [&]() {
+			File input = OpenFile(path, FILE_MODE_OPEN, FILE_ACCESS_READ);
+			IoCompletion completions[ASYNC_IO_MAX_REQUESTS];
+			u64 offset = 0;
+			u64 in_flight = 0;
+
+			while (offset < size || in_flight) {
+				while (offset < size && ReadAsync(input, offset, buffer + offset, chunk)) {
+					offset += chunk;
+					in_flight++;
+				}
+
+				SubmitAsyncIo();
+				in_flight -= WaitAsyncIo(completions, ASYNC_IO_MAX_REQUESTS);
+			}
+
+			input.Close();
+			DoNotOptimize(buffer);
+		});
+		Report(name, ns, 0);
+	};
+
+	InitAsyncIo(true);
+	if (IsUsingIoUring()) bench_async("ReadAsync io_uring (per MiB)");
+	ShutdownAsyncIo();
+
+	InitAsyncIo(false);
+	bench_async("ReadAsync thread pool (per MiB)");
+	ShutdownAsyncIo();
+
+	ns = Measure(size >> 20, [&]() {
+		u64 hash = Hash64(buffer, size);
+		DoNotOptimize(&hash);
+	});
+	Report("Hash64 (per MiB)", ns, 0);
+
+	// 1000 small assets: the cost of getting to one, which is the same whatever their size.
+	const u32 asset_count = 1000;
+	ArchiveInput* inputs = (ArchiveInput*)AllocMemory(sizeof(ArchiveInput) * asset_count);
+	char (*names)[32] = (char(*)[32])AllocMemory(32 * asset_count);
+
+	for (u32 i = 0; i < asset_count; i++) {
+		OutputBuffer name = FixedOutput(names[i], 32);
+		Print(&name, "textures/asset_%.bin", i);
+		inputs[i] = { .name = name.GetString(), .data = buffer + i * 4096, .size = 4096 };
+	}
+
+	String archive_path = "/tmp/engine_bench_archive.pak";
+	WriteAssetArchive(archive_path, inputs, asset_count);
+
+	// Loose files cost an open, fstat, mmap, close and munmap each.
+	ns = Measure(asset_count, [&]() {
+		for (u32 i = 0; i < asset_count; i++) {
+			MappedFile file = MapFile(path, FILE_ADVICE_NORMAL);
+			DoNotOptimize(&file);
+			file.Unmap();
+		}
+	});
+	Report("MapFile per loose asset", ns, 0);
+
+	AssetArchive archive = OpenAssetArchive(archive_path);
+	ns = Measure(asset_count, [&]() {
+		for (u32 i = 0; i < asset_count; i++) {
+			Asset asset = archive.Load(inputs[i].name);
+			DoNotOptimize(&asset);
+		}
+	});
+	Report("AssetArchive::Load", ns, 0);
+	archive.Close();
+
+	FreeMemory(names, 32 * asset_count);
+	FreeMemory(inputs, sizeof(ArchiveInput) * asset_count);
+	FreeMemory(buffer, size);
+}
+
+static void BenchFileReader() {
+	String path = "/tmp/engine_bench_text.txt";
+	FileOutputBuffer text { OpenFile(path, FILE_MODE_CREATE_OR_TRUNCATE, FILE_ACCESS_WRITE) };
+	const u64 line_count = 4 << 20; // About 64 MiB.
+
+	for (u64 i = 0; i < line_count; i++)
+		Print(&text, "v % % %\n", RandomU32(11, i) % 10000, RandomU32(12, i) % 10000, RandomU32(13, i) % 10000);
+
+	text.Flush();
+	text.file.Close();
+
+	// Per line, from the page cache.
+	f64 ns = Measure(line_count, [&]() {
+		Array<byte> data = LoadFile(path);
+		u64 lines = 0;
+
+		for (const byte* p = data.data; p < data.data + data.length; lines++)
+			p = (const byte*)__builtin_memchr(p, '\n', data.data + data.length - p) + 1;
+
+		DoNotOptimize(&lines);
+		data.Free();
+	});
+	Report("LoadFile, then split lines", ns, 0);
+
+	auto bench = [&](String name, bool read_ahead) {
+		u64 lines = 0;
+		f64 ns = Measure(line_count, [&]() {
+			FileReader reader = OpenFileReader(path, read_ahead);
+			String line;
+			lines = 0;
+
+			while (reader.ReadLine(&line)) lines++;
+
+			reader.Close();
+		});
+		Report(name, ns, lines == line_count ? 0 : 1);
+	};
+
+	bench("FileReader::ReadLine", false);
+	bench("FileReader::ReadLine, read ahead", true);
+}
+
+static void BenchCompression() {
+	// Text-like data: small numbers and a handful of words, about as compressible as meshes and scene files.
+	static const String words[] = { "vertex", "normal", "position", "texture", "index", "color", "material" };
+	OutputBuffer text = GrowableOutput();
+
+	for (u32 i = 0; text.head < (16 << 20); i++)
+		Print(&text, "% % % %\n", words[RandomU32(7, i) % 7], RandomU32(8, i) % 1000, RandomU32(9, i) % 100, RandomU32(10, i) % 10);
+
+	u64 size = text.head;
+	const byte* data = text.data;
+	u64 capacity = Lz4CompressBound(size);
+	byte* compressed = (byte*)AllocMemory(capacity);
+	byte* decompressed = (byte*)AllocMemory(size);
+	u64 compressed_size = 0;
+
+	f64 ns = Measure(size >> 20, [&]() {
+		compressed_size = CompressLz4(data, size, compressed, capacity);
+		DoNotOptimize(compressed);
+	});
+	Report("CompressLz4 (per MiB)", ns, 0);
+
+	bool ok = true;
+	ns = Measure(size >> 20, [&]() {
+		ok &= DecompressLz4(compressed, compressed_size, decompressed, size);
+		DoNotOptimize(decompressed);
+	});
+	Report("DecompressLz4 (per MiB)", ns, ok && CompareMemory(data, decompressed, size) ? 0 : 1);
+	Print("ratio %\n", (f64)size / compressed_size);
+
+	FreeMemory(decompressed, size);
+	FreeMemory(compressed, capacity);
+	text.Free();
+}
+
+// Texture upload conversions on a 4 MiB RGBA image, against the per-pixel loops they replace.
+static void BenchPixels() {
+	const u64 count = 1 << 20;
+	const f64 mib = count * 4.0 / (1 << 20);
+	u8*  rgb    = Alloc<u8>(count * 3);
+	u8*  rgba   = Alloc<u8>(count * 4);
+	u8*  out    = Alloc<u8>(count * 4);
+	u8*  expect = Alloc<u8>(count * 4);
+	f32* linear = Alloc<f32>(count * 4);
+
+	for (u64 i = 0; i < count * 4; i++) rgba[i] = RandomU32(11, i);
+	for (u64 i = 0; i < count * 3; i++) rgb[i]  = RandomU32(12, i);
+
+	auto max_difference = [&]() {
+		s32 result = 0;
+		for (u64 i = 0; i < count * 4; i++) result = Max(result, out[i] > expect[i] ? out[i] - expect[i] : expect[i] - out[i]);
+		return result;
+	};
+
+	f64 ns = Measure(1, [&]() {
+		for (u64 i = 0; i < count; i++) {
+			expect[i * 4]     = rgb[i * 3];
+			expect[i * 4 + 1] = rgb[i * 3 + 1];
+			expect[i * 4 + 2] = rgb[i * 3 + 2];
+			expect[i * 4 + 3] = 0xFF;
+		}
+		DoNotOptimize(expect);
+	});
+	Report("RGB to RGBA, scalar (per MiB)", ns / mib, 0);
+
+	ns = Measure(1, [&]() {
+		ExpandRgbToRgba(out, rgb, count);
+		DoNotOptimize(out);
+	});
+	Report("ExpandRgbToRgba (per MiB)", ns / mib, max_difference());
+
+	ns = Measure(1, [&]() {
+		for (u64 i = 0; i < count; i++) {
+			expect[i * 4]     = rgba[i * 4 + 2];
+			expect[i * 4 + 1] = rgba[i * 4 + 1];
+			expect[i * 4 + 2] = rgba[i * 4];
+			expect[i * 4 + 3] = rgba[i * 4 + 3];
+		}
+		DoNotOptimize(expect);
+	});
+	Report("RGBA to BGRA, scalar (per MiB)", ns / mib, 0);
+
+	ns = Measure(1, [&]() {
+		SwapRedBlue(out, rgba, count);
+		DoNotOptimize(out);
+	});
+	Report("SwapRedBlue (per MiB)", ns / mib, max_difference());
+
+	ns = Measure(1, [&]() {
+		for (u64 i = 0; i < count; i++) {
+			u32 a = rgba[i * 4 + 3];
+			for (u32 c = 0; c < 3; c++) expect[i * 4 + c] = (rgba[i * 4 + c] * a + 127) / 255;
+			expect[i * 4 + 3] = a;
+		}
+		DoNotOptimize(expect);
+	});
+	Report("Premultiply, scalar (per MiB)", ns / mib, 0);
+
+	ns = Measure(1, [&]() {
+		PremultiplyAlpha(out, rgba, count);
+		DoNotOptimize(out);
+	});
+	Report("PremultiplyAlpha (per MiB)", ns / mib, max_difference());
+
+	ns = Measure(1, [&]() {
+		SrgbToLinear(linear, rgba, count);
+		DoNotOptimize(linear);
+	});
+	Report("SrgbToLinear (per MiB of RGBA8)", ns / mib, 0);
+
+	ns = Measure(1, [&]() {
+		for (u64 i = 0; i < count * 4; i++) {
+			f32 x = Min(Max(linear[i], 0.0f), 1.0f);
+			f32 s = (i & 3) == 3 ? x : x <= 0.0031308f ? x * 12.92f : 1.055f * Pow(x, 1 / 2.4f) - 0.055f;
+			expect[i] = (u8)(s * 255.0f + 0.5f);
+		}
+		DoNotOptimize(expect);
+	});
+	Report("Linear to sRGB, Pow (per MiB)", ns / mib, 0);
+
+	ns = Measure(1, [&]() {
+		LinearToSrgb(out, linear, count);
+		DoNotOptimize(out);
+	});
+	Report("LinearToSrgb (per MiB)", ns / mib, max_difference());
+
+	Free(linear, count * 4);
+	Free(expect, count * 4);
+	Free(out,    count * 4);
+	Free(rgba,   count * 4);
+	Free(rgb,    count * 3);
+}
+
+// Full chains for a 2048 x 2048 RGBA texture, on one thread and then on the job threads.
+static void BenchMips() {
+	const u32 size = 2048;
+	Image* image = AllocImage((u64)size * size * 4);
+	image->channels = 4;
+	image->has_alpha_channel = true;
+	image->width  = size;
+	image->height = size;
+
+	for (u64 i = 0; i < image->GetSize(); i++)
+		image->data[i] = RandomU32(13, i);
+
+	const f64 mib = image->GetSize() / (f64)(1 << 20);
+
+	auto bench = [&](String name, MipFilter filter, bool srgb) {
+		f64 ns = Measure(1, [&]() {
+			MipChain* chain = GenerateMips(image, filter, srgb);
+			DoNotOptimize(chain);
+			FreeMips(chain);
+		});
+		Report(name, ns / mib, 0);
+	};
+
+	for (u32 threaded = 0; threaded < 2; threaded++) {
+		if (threaded) {
+			InitJobs();
+			Print("% threads\n", GetJobThreadCount());
+		}
+
+		bench("Box (per MiB of level 0)",         MIP_FILTER_BOX,    false);
+		bench("Box, sRGB (per MiB of level 0)",   MIP_FILTER_BOX,    true);
+		bench("Kaiser (per MiB of level 0)",      MIP_FILTER_KAISER, false);
+		bench("Kaiser, sRGB (per MiB of level 0)", MIP_FILTER_KAISER, true);
+	}
+
+	ShutdownJobs();
+	FreeImage(image);
+}
+
+// Decoders for what CompressImage writes, to hold it against the source. BC7 covers only the modes the encoder
+// uses, any other decodes to transparent black and shows up as a large error.
+struct BlockBitReader {
+	const u8* data;
+	u32 position;
+
+	u32 Read(u32 count) {
+		u32 value = 0;
+
+		for (u32 i = 0; i < count; i++, position++)
+			value |= (data[position >> 3] >> (position & 7) & 1) << i;
+
+		return value;
+	}
+};
+
+// BC3's colors are always the four color kind, whatever order the endpoints are in.
+static void DecodeBc1Colors(const u8* block, u8* out, bool allow_transparent) {
+	u32 c0 = block[0] | block[1] << 8;
+	u32 c1 = block[2] | block[3] << 8;
+	bool three_color = allow_transparent && c0 <= c1;
+	u32 palette[4][4];
+
+	for (u32 e = 0; e < 2; e++) {
+		u32 c = e ? c1 : c0;
+		palette[e][0] = Expand5(c >> 11);
+		palette[e][1] = Expand6(c >> 5 & 63);
+		palette[e][2] = Expand5(c & 31);
+		palette[e][3] = 255;
+	}
+
+	for (u32 c = 0; c < 3; c++) {
+		palette[2][c] = three_color ? (palette[0][c] + palette[1][c]) / 2 : (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = three_color ? 0 : (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+
+	palette[2][3] = 255;
+	palette[3][3] = three_color ? 0 : 255;
+
+	BlockBitReader reader = { block + 4 };
+
+	for (u32 i = 0; i < 16; i++) {
+		u32 index = reader.Read(2);
+
+		for (u32 c = 0; c < 4; c++)
+			out[i * 4 + c] = palette[index][c];
+	}
+}
+
+static void DecodeBc3Alpha(const u8* block, u8* out) {
+	u32 a0 = block[0];
+	u32 a1 = block[1];
+	u32 palette[8] = { a0, a1, 0, 0, 0, 0, 0, 255 };
+
+	if (a0 > a1) {
+		for (u32 i = 1; i < 7; i++)
+			palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+	}
+	else {
+		for (u32 i = 1; i < 5; i++)
+			palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+	}
+
+	BlockBitReader reader = { block + 2 };
+
+	for (u32 i = 0; i < 16; i++)
+		out[i * 4 + 3] = palette[reader.Read(3)];
+}
+
+static void DecodeBc7Block(const u8* block, u8* out) {
+	BlockBitReader reader = { block };
+	u32 mode = 0;
+
+	while (mode < 8 && !reader.Read(1))
+		mode++;
+
+	u32 endpoints[2][2][4] = { }; // Subset, endpoint, channel, as 8 bits.
+	u32 weights[2][16];           // Color and alpha.
+	u32 partition = 0;
+	u32 rotation  = 0;
+
+	if (mode == 1) {
+		partition = reader.Read(6);
+
+		for (u32 c = 0; c < 3; c++)
+			for (u32 s = 0; s < 2; s++)
+				for (u32 e = 0; e < 2; e++)
+					endpoints[s][e][c] = reader.Read(6) << 1;
+
+		for (u32 s = 0; s < 2; s++) {
+			u32 pbit = reader.Read(1);
+
+			for (u32 e = 0; e < 2; e++) {
+				for (u32 c = 0; c < 3; c++) {
+					u32 v = endpoints[s][e][c] | pbit;
+					endpoints[s][e][c] = v << 1 | v >> 6;
+				}
+
+				endpoints[s][e][3] = 255;
+			}
+		}
+
+		for (u32 i = 0; i < 16; i++)
+			weights[0][i] = weights[1][i] = bc7_weights3[reader.Read(i == 0 || i == bc7_anchors[partition] ? 2 : 3)];
+	}
+	else if (mode == 5) {
+		rotation = reader.Read(2);
+
+		for (u32 c = 0; c < 3; c++) {
+			for (u32 e = 0; e < 2; e++) {
+				u32 v = reader.Read(7);
+				endpoints[0][e][c] = v << 1 | v >> 6;
+			}
+		}
+
+		endpoints[0][0][3] = reader.Read(8);
+		endpoints[0][1][3] = reader.Read(8);
+
+		for (u32 set = 0; set < 2; set++)
+			for (u32 i = 0; i < 16; i++)
+				weights[set][i] = bc7_weights2[reader.Read(i == 0 ? 1 : 2)];
+	}
+	else if (mode == 6) {
+		for (u32 c = 0; c < 4; c++)
+			for (u32 e = 0; e < 2; e++)
+				endpoints[0][e][c] = reader.Read(7) << 1;
+
+		for (u32 e = 0; e < 2; e++) {
+			u32 pbit = reader.Read(1);
+
+			for (u32 c = 0; c < 4; c++)
+				endpoints[0][e][c] |= pbit;
+		}
+
+		for (u32 i = 0; i < 16; i++)
+			weights[0][i] = weights[1][i] = bc7_weights4[reader.Read(i == 0 ? 3 : 4)];
+	}
+	else {
+		ZeroMemory(out, 64);
+		return;
+	}
+
+	for (u32 i = 0; i < 16; i++) {
+		u32 subset = mode == 1 ? bc7_partitions[partition] >> i & 1 : 0;
+		u8* pixel = out + i * 4;
+
+		for (u32 c = 0; c < 4; c++) {
+			u32 w = weights[c == 3][i];
+			pixel[c] = ((64 - w) * endpoints[subset][0][c] + w * endpoints[subset][1][c] + 32) >> 6;
+		}
+
+		if (rotation) {
+			u8 alpha = pixel[3];
+			pixel[3] = pixel[rotation - 1];
+			pixel[rotation - 1] = alpha;
+		}
+	}
+}
+
+// Width and height multiples of 4.
+static void DecodeBlockImage(BlockFormat format, const u8* blocks, u8* pixels, u32 width, u32 height) {
+	u8 decoded[64];
+
+	for (u32 by = 0; by < height / 4; by++) {
+		for (u32 bx = 0; bx < width / 4; bx++) {
+			const u8* block = blocks + ((u64)by * (width / 4) + bx) * GetBlockBytes(format);
+
+			if (format == BLOCK_FORMAT_BC1) DecodeBc1Colors(block, decoded, true);
+			if (format == BLOCK_FORMAT_BC3) DecodeBc1Colors(block + 8, decoded, false), DecodeBc3Alpha(block, decoded);
+			if (format == BLOCK_FORMAT_BC7) DecodeBc7Block(block, decoded);
+
+			for (u32 y = 0; y < 4; y++)
+				CopyMemory(pixels + (((u64)by * 4 + y) * width + bx * 4) * 4, decoded + y * 16, 16);
+		}
+	}
+}
+
+// A 512 x 512 texture: gradients with a little noise, a hard edge through the middle and an alpha ramp, closer
+// to what gets compressed than pure noise, which would only show the slowest paths. Per 4x4 block, the error is
+// the worst channel of any pixel once decoded, and the PSNR over all of them is printed after.
+static void BenchBlockCompress() {
+	const u32 size = 512;
+	const u32 blocks = (size / 4) * (size / 4);
+	u8* pixels = Alloc<u8>((u64)size * size * 4);
+
+	for (u32 y = 0; y < size; y++) {
+		for (u32 x = 0; x < size; x++) {
+			u8* pixel = pixels + ((u64)y * size + x) * 4;
+			u32 noise = RandomU32(17, y * size + x);
+			u32 edge  = x + y > size ? 96 : 0;
+			pixel[0] = Min(x / 2 + edge + (noise & 7), 255u);
+			pixel[1] = Min(y / 2 + (noise >> 8 & 7), 255u);
+			pixel[2] = Min((x + y) / 4 + edge / 2 + (noise >> 16 & 7), 255u);
+			pixel[3] = x / 2;
+		}
+	}
+
+	// Opaque too, BC7 only splits blocks in two (mode 1) when there's no alpha.
+	u8* opaque = Alloc<u8>((u64)size * size * 4);
+	CopyMemory(opaque, pixels, (u64)size * size * 4);
+
+	for (u64 i = 3; i < (u64)size * size * 4; i += 4)
+		opaque[i] = 255;
+
+	u8* blocks_out = Alloc<u8>(GetCompressedSize(BLOCK_FORMAT_BC7, size, size));
+	u8* decoded = Alloc<u8>((u64)size * size * 4);
+	f64 psnr[4];
+
+	auto bench = [&](String name, BlockFormat format, const u8* source, f64* psnr_out) {
+		f64 ns = Measure(blocks, [&]() {
+			CompressImage(format, blocks_out, source, size, size);
+			DoNotOptimize(blocks_out);
+		});
+
+		DecodeBlockImage(format, blocks_out, decoded, size, size);
+		u32 max_error = 0;
+		u64 squared_error = 0;
+		u64 samples = 0;
+
+		for (u64 i = 0; i < (u64)size * size * 4; i++) {
+			u32 expect = source[i];
+
+			// BC1 keeps only whether alpha is at least 128, and the color of transparent pixels is black.
+			if (format == BLOCK_FORMAT_BC1) {
+				bool transparent = source[i | 3] < 128;
+
+				if ((i & 3) == 3)  expect = transparent ? 0 : 255;
+				else if (transparent) expect = 0;
+			}
+
+			u32 error = decoded[i] > expect ? decoded[i] - expect : expect - decoded[i];
+			max_error = Max(max_error, error);
+			squared_error += error * error;
+			samples++;
+		}
+
+		*psnr_out = 10 * Log10(255.0 * 255.0 * samples / Max(squared_error, 1llu));
+		Report(name, ns, max_error);
+	};
+
+	for (u32 threaded = 0; threaded < 2; threaded++) {
+		if (threaded) {
+			InitJobs();
+			Print("% threads\n", GetJobThreadCount());
+		}
+
+		bench("BC1 (per block)",        BLOCK_FORMAT_BC1, pixels, &psnr[0]);
+		bench("BC3 (per block)",        BLOCK_FORMAT_BC3, pixels, &psnr[1]);
+		bench("BC7 (per block)",        BLOCK_FORMAT_BC7, pixels, &psnr[2]);
+		bench("BC7 opaque (per block)", BLOCK_FORMAT_BC7, opaque, &psnr[3]);
+	}
+
+	const char* names[4] = { "PSNR BC1 ", " dB, BC3 ", " dB, BC7 ", " dB, BC7 opaque " };
+
+	for (u32 i = 0; i < 4; i++) {
+		Print("%", CString(names[i]));
+		WriteFixed(&standard_output_buffer, psnr[i], 2);
+	}
+
+	Print(" dB\n");
+
+	ShutdownJobs();
+	Free(decoded, (u64)size * size * 4);
+	Free(blocks_out, GetCompressedSize(BLOCK_FORMAT_BC7, size, size));
+	Free(opaque, (u64)size * size * 4);
+	Free(pixels, (u64)size * size * 4);
+}
+
+// 1000 sprites from 1x1 to 64x64 with a 2 pixel gutter, packed and copied. Per sprite, and how much of the
+// atlas the cells cover. The error is the number of failed checks: cells that overlap each other or the edge,
+// sprites whose cells don't hold their pixels and repeated edges, UVs that aren't exactly their rects, pixels
+// outside the cells that aren't transparent black, and an empty sprite that isn't rejected.
+static void BenchAtlas() {
+	const u32 count = 1000;
+	Image** images = Alloc<Image*>(count);
+
+	for (u32 i = 0; i < count; i++) {
+		u32 width  = 1 + RandomU32(21, i) % 64;
+		u32 height = 1 + RandomU32(22, i) % 64;
+		images[i] = AllocImage((u64)width * height * 4);
+		images[i]->channels = 4;
+		images[i]->width  = width;
+		images[i]->height = height;
+
+		// Never transparent black, so a missing copy can't pass for the fill.
+		u32* pixels = (u32*)images[i]->data;
+		FillRandomU32(pixels, (u64)width * height, 23, (u64)i << 12);
+
+		for (u64 j = 0; j < (u64)width * height; j++)
+			pixels[j] |= 1;
+	}
+
+	AtlasSettings settings = { .max_size = 8192, .gutter = 2, .clean_mips = 2 };
+
+	f64 ns = Measure(count, [&]() {
+		Atlas* atlas = BuildAtlas(images, count, settings);
+		DoNotOptimize(atlas);
+		FreeAtlas(atlas);
+	});
+
+	Atlas* atlas = BuildAtlas(images, count, settings);
+	Image* image = atlas->image;
+	const u32* atlas_pixels = (const u32*)image->data;
+	u8* owned = Alloc<u8>(image->GetNumPixels());
+	ZeroMemory(owned, image->GetNumPixels());
+	u64 covered = 0;
+	u32 failures = 0;
+
+	for (u32 i = 0; i < count; i++) {
+		Image* sprite = images[i];
+		AtlasRect rect = atlas->rects[i];
+		AtlasUv uv = atlas->uvs[i];
+
+		u32 width, height;
+		GetAtlasCellSize(sprite->width, sprite->height, settings, &width, &height);
+		covered += (u64)width * height;
+
+		failures += rect.width != sprite->width || rect.height != sprite->height;
+		failures += uv.scale[0]  != (f32)rect.width / image->width || uv.scale[1]  != (f32)rect.height / image->height;
+		failures += uv.offset[0] != (f32)rect.x / image->width     || uv.offset[1] != (f32)rect.y / image->height;
+
+		if (rect.x < settings.gutter || rect.y < settings.gutter || rect.x - settings.gutter + width > image->width ||
+		    rect.y - settings.gutter + height > image->height) {
+			failures++;
+			continue;
+		}
+
+		// The whole cell: the sprite, with its edge pixels repeated out to the cell's edges.
+		u32 cell_x = rect.x - settings.gutter;
+		u32 cell_y = rect.y - settings.gutter;
+		bool overlaps = false, wrong = false;
+
+		for (u32 y = 0; y < height; y++) {
+			for (u32 x = 0; x < width; x++) {
+				u64 index = (u64)(cell_y + y) * image->width + cell_x + x;
+				u32 src_x = Clamp((s32)x - (s32)settings.gutter, 0, (s32)sprite->width  - 1);
+				u32 src_y = Clamp((s32)y - (s32)settings.gutter, 0, (s32)sprite->height - 1);
+
+				overlaps |= owned[index];
+				wrong    |= atlas_pixels[index] != ((u32*)sprite->data)[(u64)src_y * sprite->width + src_x];
+				owned[index] = 1;
+			}
+		}
+
+		failures += overlaps + wrong;
+	}
+
+	for (u64 i = 0; i < image->GetNumPixels(); i++)
+		failures += !owned[i] && atlas_pixels[i] != 0;
+
+	Image* empty = AllocImage(0);
+	empty->channels = 4;
+	empty->width  = 0;
+	empty->height = 0;
+
+	Image* with_empty[2] = { images[0], empty };
+	Atlas* rejected = BuildAtlas(with_empty, 2, settings);
+	failures += rejected != null;
+	FreeAtlas(rejected);
+	FreeImage(empty);
+
+	Report("BuildAtlas (per sprite)", ns, failures);
+	Print("%x%, cells cover % of it\n", image->width, image->height, (f64)covered / image->GetNumPixels());
+
+	Free(owned, image->GetNumPixels());
+	FreeAtlas(atlas);
+
+	for (u32 i = 0; i < count; i++)
+		FreeImage(images[i]);
+
+	Free(images, count);
+}
+
+// An 8x8 grayscale JPEG of flat gray, with dc_counts for its DC table's code lengths and that many symbols.
+static u64 WriteTestJpeg(u8* out, const u8* dc_counts) {
+	const u8 start[] = { 0xFF, 0xD8, 0xFF, 0xDB, 0x00, 0x43, 0x00 };
+	const u8 frame[] = { 0xFF, 0xC0, 0x00, 0x0B, 0x08, 0x00, 0x08, 0x00, 0x08, 0x01, 0x01, 0x11, 0x00 };
+	const u8 rest[]  = {
+		0xFF, 0xC4, 0x00, 0x14, 0x10, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x00, // One AC code, end of block.
+		0xFF, 0xDA, 0x00, 0x08, 0x01, 0x01, 0x00, 0x00, 0x3F, 0x00,
+		0x3F, // DC difference 0 and end of block, both the one bit code 0.
+		0xFF, 0xD9,
+	};
+
+	u8* p = out;
+	u32 symbol_count = 0;
+
+	for (u32 i = 0; i < 16; i++)
+		symbol_count += dc_counts[i];
+
+	CopyMemory(p, start, sizeof(start));
+	p += sizeof(start);
+
+	for (u32 i = 0; i < 64; i++)
+		*p++ = 1;
+
+	CopyMemory(p, frame, sizeof(frame));
+	p += sizeof(frame);
+
+	*p++ = 0xFF;
+	*p++ = 0xC4;
+	*p++ = (19 + symbol_count) >> 8;
+	*p++ = 19 + symbol_count;
+	*p++ = 0x00;
+	CopyMemory(p, dc_counts, 16);
+	ZeroMemory(p + 16, symbol_count);
+	p += 16 + symbol_count;
+
+	CopyMemory(p, rest, sizeof(rest));
+	return p + sizeof(rest) - out;
+}
+
+// Huffman tables that promise more codes of a length than the length has: too many at the first length, at the
+// last one looked up directly and at the last. They have to be rejected without writing past the table, and a JPEG
+// with one mustn't decode, while the same JPEG with a good table does. Neither may one that ends in an empty scan header.
+static void CheckMalformedJpegs() {
+	struct GuardedHuffman {
+		JpegHuffman table;
+		u8 guard[1 << 17];
+	};
+
+	u8 good_counts[16] = { 1 };
+	u8 bad_counts[3][16] = {
+		{ 3 },
+		{ 1, 0, 0, 0, 0, 0, 0, 128, 1 },
+		{ 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 },
+	};
+
+	u8 symbols[256] = { };
+	GuardedHuffman* guarded = Alloc<GuardedHuffman>();
+	u8* jpeg = Alloc<u8>(1024);
+	u32 failures = 0;
+
+	for (u32 i = 0; i < 3; i++) {
+		ZeroMemory(guarded, sizeof(GuardedHuffman));
+		u32 symbol_count = 0;
+
+		for (u32 length = 0; length < 16; length++)
+			symbol_count += bad_counts[i][length];
+
+		failures += BuildJpegHuffman(&guarded->table, bad_counts[i], symbols, symbol_count);
+
+		bool overwritten = false;
+		for (u32 j = 0; j < sizeof(guarded->guard); j++) overwritten |= guarded->guard[j] != 0;
+		failures += overwritten;
+
+		Image* image = DecodeImage(jpeg, WriteTestJpeg(jpeg, bad_counts[i]));
+		failures += image != null;
+		if (image) FreeImage(image);
+	}
+
+	u64 size = WriteTestJpeg(jpeg, good_counts);
+	Image* image = DecodeImage(jpeg, size);
+	failures += !image || image->width != 8 || image->height != 8 || image->data[0] != 128;
+	if (image) FreeImage(image);
+
+	// A scan header with nothing in it, right at the end of the data.
+	u64 scan = 0;
+	while (jpeg[scan] != 0xFF || jpeg[scan + 1] != 0xDA) scan++;
+
+	u8* truncated = Alloc<u8>(scan + 4);
+	CopyMemory(truncated, jpeg, scan + 2);
+	truncated[scan + 2] = 0x00;
+	truncated[scan + 3] = 0x02;
+
+	image = DecodeImage(truncated, scan + 4);
+	failures += image != null;
+	if (image) FreeImage(image);
+	Free(truncated, scan + 4);
+
+	Print("% malformed JPEG checks failed\n", failures);
+
+	Free(jpeg, 1024);
+	Free(guarded);
+}
+
+// Images from the command line, there are no encoders here to make them: ./bench photo.jpg ui.png ui.qoi...
+// Throughput is of the decoded RGBA, so the formats compare directly.
+static void BenchImages(String* paths, u32 count) {
+	Image** images = Alloc<Image*>(count);
+	u64 total = 0;
+
+	auto bench = [&](String name, String* paths, u32 count, u64 size) {
+		f64 ns = Measure(1, [&]() {
+			LoadImages(paths, images, count);
+			DoNotOptimize(images);
+
+			for (u32 i = 0; i < count; i++)
+				FreeImage(images[i]);
+		});
+		Report(name, ns / ((f64)size / (1 << 20)), 0);
+	};
+
+	Print("ns per MiB of RGBA:\n");
+
+	for (u32 i = 0; i < count; i++) {
+		Image* image = LoadImage(paths[i]);
+
+		if (image) {
+			u64 size = image->GetSize();
+			FreeImage(image);
+			total += size;
+			bench(paths[i], &paths[i], 1, size);
+		}
+	}
+
+	if (total) {
+		InitJobs();
+		Print("% threads\n", GetJobThreadCount());
+		bench("LoadImages, all (per MiB)", paths, count, total);
+		ShutdownJobs();
+	}
+
+	Free(images, count);
+}
+
+int main(int argc, char** argv) {
+	InitGlobalAllocator();
+
+	Print("-- Scalar math --\n");
+	BenchScalarMath();
+
+	Print("-- Matrix4 --\n");
+	BenchMatrices();
+
+	Print("-- Quaternion --\n");
+	BenchQuaternions();
+
+	Print("-- Camera --\n");
+	BenchCamera();
+
+	Print("-- Culling --\n");
+	BenchCulling();
+
+	Print("-- Packing --\n");
+	BenchPacking();
+
+	Print("-- Random --\n");
+	BenchRandom();
+
+	Print("-- Noise --\n");
+	BenchNoise();
+
+	Print("-- Print --\n");
+	BenchPrint();
+
+	Print("-- Float printing --\n");
+	BenchFloatPrint();
+
+	Print("-- Files --\n");
+	BenchFiles();
+
+	Print("-- File reader --\n");
+	BenchFileReader();
+
+	Print("-- Compression --\n");
+	BenchCompression();
+
+	Print("-- Pixels --\n");
+	BenchPixels();
+
+	Print("-- Mips --\n");
+	BenchMips();
+
+	Print("-- Block compression --\n");
+	BenchBlockCompress();
+
+	Print("-- Atlas --\n");
+	BenchAtlas();
+
+	Print("-- Images --\n");
+	CheckMalformedJpegs();
+
+	if (argc > 1) {
+		String* paths = Alloc<String>(argc - 1);
+
+		for (s32 i = 1; i < argc; i++)
+			paths[i - 1] = CString(argv[i]);
+
+		BenchImages(paths, argc - 1);
+		Free(paths, argc - 1);
+	}
+
+	standard_output_buffer.Flush();
+	return 0;
+}
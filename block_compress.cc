@@ -0,0 +1,939 @@
+#include "block_compress.h"
+#include "jobs.h"
+#include "math.h"
+
+static u32 GetBlockBytes(BlockFormat format) {
+	return format == BLOCK_FORMAT_BC1 ? 8 : 16;
+}
+
+static u64 GetCompressedSize(BlockFormat format, u32 width, u32 height) {
+	return (u64)((width + 3) / 4) * ((height + 3) / 4) * GetBlockBytes(format);
+}
+
+//
+// Endpoint fitting shared by the formats: a line through the colors, then least squares once the pixels have
+// picked their spots on it.
+//
+
+// Mean and principal axis of count points with channels dimensions. The axis comes from power iteration on the
+// covariance, starting at the column of the channel that varies most, which is never orthogonal to the answer.
+static void GetPrincipalAxis(const f32 (*points)[4], u32 count, u32 channels, f32 mean[4], f32 axis[4]) {
+	f32 covariance[4][4] = { };
+
+	for (u32 c = 0; c < 4; c++) {
+		mean[c] = 0;
+		axis[c] = 0;
+
+		for (u32 i = 0; i < count; i++)
+			mean[c] += points[i][c];
+
+		mean[c] /= count;
+	}
+
+	for (u32 i = 0; i < count; i++)
+		for (u32 a = 0; a < channels; a++)
+			for (u32 b = 0; b < channels; b++)
+				covariance[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+
+	u32 widest = 0;
+	for (u32 c = 1; c < channels; c++)
+		if (covariance[c][c] > covariance[widest][widest]) widest = c;
+
+	if (covariance[widest][widest] <= 0)
+		return;
+
+	for (u32 c = 0; c < channels; c++)
+		axis[c] = covariance[c][widest];
+
+	for (u32 iteration = 0; iteration < 6; iteration++) {
+		f32 next[4] = { };
+		f32 largest = 0;
+
+		for (u32 a = 0; a < channels; a++) {
+			for (u32 b = 0; b < channels; b++)
+				next[a] += covariance[a][b] * axis[b];
+
+			largest = Max(largest, Abs(next[a]));
+		}
+
+		if (largest == 0)
+			return;
+
+		for (u32 c = 0; c < channels; c++)
+			axis[c] = next[c] / largest;
+	}
+
+	f32 length = 0;
+	for (u32 c = 0; c < channels; c++)
+		length += axis[c] * axis[c];
+
+	length = Sqrt(length);
+	for (u32 c = 0; c < channels; c++)
+		axis[c] /= length;
+}
+
+// Where the points start and end along axis, the first guess at the endpoints.
+static void GetAxisEndpoints(const f32 (*points)[4], u32 count, u32 channels, const f32 mean[4], const f32 axis[4], f32 endpoints[2][4]) {
+	f32 lo = 0, hi = 0;
+
+	for (u32 i = 0; i < count; i++) {
+		f32 t = 0;
+		for (u32 c = 0; c < channels; c++)
+			t += (points[i][c] - mean[c]) * axis[c];
+
+		lo = Min(lo, t);
+		hi = Max(hi, t);
+	}
+
+	for (u32 c = 0; c < 4; c++) {
+		endpoints[0][c] = c < channels ? Min(Max(mean[c] + axis[c] * lo, 0.0f), 255.0f) : 255.0f;
+		endpoints[1][c] = c < channels ? Min(Max(mean[c] + axis[c] * hi, 0.0f), 255.0f) : 255.0f;
+	}
+}
+
+// The endpoints that best fit the points in the least squares sense given how far along from endpoint 0 to 1 each
+// one is. False when they're all at the same spot and there's nothing to solve.
+static bool FitEndpointsToWeights(const f32 (*points)[4], const f32* weights, u32 count, u32 channels, f32 endpoints[2][4]) {
+	f32 aa = 0, ab = 0, bb = 0;
+	f32 ax[4] = { }, bx[4] = { };
+
+	for (u32 i = 0; i < count; i++) {
+		f32 b = weights[i];
+		f32 a = 1 - b;
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+
+		for (u32 c = 0; c < channels; c++) {
+			ax[c] += a * points[i][c];
+			bx[c] += b * points[i][c];
+		}
+	}
+
+	f32 determinant = aa * bb - ab * ab;
+	if (determinant < 1e-3f)
+		return false;
+
+	for (u32 c = 0; c < channels; c++) {
+		endpoints[0][c] = Min(Max((bb * ax[c] - ab * bx[c]) / determinant, 0.0f), 255.0f);
+		endpoints[1][c] = Min(Max((aa * bx[c] - ab * ax[c]) / determinant, 0.0f), 255.0f);
+	}
+
+	return true;
+}
+
+//
+// BC1 colors, also the color half of BC3.
+//
+
+static constexpr u32 Expand5(u32 v) { return v << 3 | v >> 2; }
+static constexpr u32 Expand6(u32 v) { return v << 2 | v >> 4; }
+
+struct Bc1SingleColorTable {
+	u8 five[256][2];
+	u8 six[256][2];
+};
+
+// For each 8 bit value, the 5 and 6 bit endpoints whose 2:1 interpolation comes closest to it. Flat areas come
+// out a lot closer than from quantizing the color itself.
+static constexpr Bc1SingleColorTable GenerateBc1SingleColorTable() {
+	Bc1SingleColorTable table = { };
+
+	for (s32 v = 0; v < 256; v++) {
+		for (s32 bits = 5; bits <= 6; bits++) {
+			s32 max    = (1 << bits) - 1;
+			s32 center = (v * max + 127) / 255;
+			s32 best   = 256;
+
+			for (s32 a = Max(center - 2, 0); a <= Min(center + 2, max); a++) {
+				for (s32 b = Max(center - 6, 0); b <= Min(center + 6, max); b++) {
+					s32 ea = bits == 5 ? Expand5(a) : Expand6(a);
+					s32 eb = bits == 5 ? Expand5(b) : Expand6(b);
+					s32 error = (2 * ea + eb) / 3 - v;
+					error = error < 0 ? -error : error;
+
+					if (error < best) {
+						u8* entry = bits == 5 ? table.five[v] : table.six[v];
+						entry[0] = a;
+						entry[1] = b;
+						best = error;
+					}
+				}
+			}
+		}
+	}
+
+	return table;
+}
+
+static constexpr Bc1SingleColorTable bc1_single_color = GenerateBc1SingleColorTable();
+
+// How far from endpoint 0 to 1 each index is: four colors, or three and transparent.
+static const f32 bc1_weights[2][4] = {
+	{ 0, 1, 1.0f / 3, 2.0f / 3 },
+	{ 0, 1, 0.5f,     0        },
+};
+
+static u16 QuantizeRgb565(const f32 color[4]) {
+	u32 r = (u32)(color[0] * (31.0f / 255.0f) + 0.5f);
+	u32 g = (u32)(color[1] * (63.0f / 255.0f) + 0.5f);
+	u32 b = (u32)(color[2] * (31.0f / 255.0f) + 0.5f);
+	return r << 11 | g << 5 | b;
+}
+
+// The colors a decoder makes from c0 and c1. Symmetric, so it holds whichever way round they're stored.
+static void GetBc1Palette(u16 c0, u16 c1, bool three_color, s32 palette[4][3]) {
+	s32 e0[3] = { (s32)Expand5(c0 >> 11), (s32)Expand6(c0 >> 5 & 63), (s32)Expand5(c0 & 31) };
+	s32 e1[3] = { (s32)Expand5(c1 >> 11), (s32)Expand6(c1 >> 5 & 63), (s32)Expand5(c1 & 31) };
+
+	for (u32 c = 0; c < 3; c++) {
+		palette[0][c] = e0[c];
+		palette[1][c] = e1[c];
+		palette[2][c] = three_color ? (e0[c] + e1[c]) / 2 : (2 * e0[c] + e1[c]) / 3;
+		palette[3][c] = three_color ? 0 : (e0[c] + 2 * e1[c]) / 3;
+	}
+}
+
+// Each pixel's nearest color, transparent ones get index 3. Returns the total squared error.
+static u32 PickBc1Indices(const u8* pixels, u32 transparent, u16 c0, u16 c1, bool three_color, u8* indices) {
+	s32 palette[4][3];
+	GetBc1Palette(c0, c1, three_color, palette);
+
+	u32 colors = three_color ? 3 : 4;
+	u32 total  = 0;
+
+	for (u32 i = 0; i < 16; i++) {
+		if (transparent >> i & 1) {
+			indices[i] = 3;
+			continue;
+		}
+
+		u32 best = ~0u;
+
+		for (u32 k = 0; k < colors; k++) {
+			s32 dr = pixels[i * 4]     - palette[k][0];
+			s32 dg = pixels[i * 4 + 1] - palette[k][1];
+			s32 db = pixels[i * 4 + 2] - palette[k][2];
+			u32 error = dr * dr + dg * dg + db * db;
+
+			if (error < best) {
+				best = error;
+				indices[i] = k;
+			}
+		}
+
+		total += best;
+	}
+
+	return total;
+}
+
+// Four colors need c0 > c1 and three need c0 <= c1, swapping the endpoints swaps the indices too.
+static void WriteBc1Block(u8* out, u16 c0, u16 c1, u8* indices, bool three_color) {
+	bool swap = three_color ? c0 > c1 : c0 < c1;
+
+	if (swap) {
+		u16 t = c0;
+		c0 = c1;
+		c1 = t;
+	}
+
+	if (three_color && swap) {
+		for (u32 i = 0; i < 16; i++)
+			if (indices[i] < 2) indices[i] ^= 1;
+	}
+	else if (swap) {
+		for (u32 i = 0; i < 16; i++)
+			indices[i] ^= 1;
+	}
+	else if (!three_color && c0 == c1) {
+		// Reads as three colors, where only the first few are c0.
+		ZeroMemory(indices, 16);
+	}
+
+	u32 bits = 0;
+	for (u32 i = 0; i < 16; i++)
+		bits |= (u32)indices[i] << (i * 2);
+
+	CopyMemory(out,     &c0,   2);
+	CopyMemory(out + 2, &c1,   2);
+	CopyMemory(out + 4, &bits, 4);
+}
+
+static void EncodeBc1Colors(u8* out, const u8* pixels, bool allow_transparent) {
+	f32 points[16][4];
+	u32 count = 0;
+	u32 transparent = 0;
+	bool single_color = true;
+
+	for (u32 i = 0; i < 16; i++) {
+		const u8* pixel = pixels + i * 4;
+
+		if (allow_transparent && pixel[3] < 128) {
+			transparent |= 1 << i;
+			continue;
+		}
+
+		if (count && (pixel[0] != points[0][0] || pixel[1] != points[0][1] || pixel[2] != points[0][2]))
+			single_color = false;
+
+		points[count][0] = pixel[0];
+		points[count][1] = pixel[1];
+		points[count][2] = pixel[2];
+		points[count][3] = 255;
+		count++;
+	}
+
+	bool three_color = transparent != 0;
+	u8  indices[16];
+	u16 c0 = 0, c1 = 0;
+
+	if (!count) {
+		for (u32 i = 0; i < 16; i++) indices[i] = 3;
+	}
+	else if (single_color && !three_color) {
+		const u8* r = bc1_single_color.five[(u32)points[0][0]];
+		const u8* g = bc1_single_color.six [(u32)points[0][1]];
+		const u8* b = bc1_single_color.five[(u32)points[0][2]];
+		c0 = r[0] << 11 | g[0] << 5 | b[0];
+		c1 = r[1] << 11 | g[1] << 5 | b[1];
+		for (u32 i = 0; i < 16; i++) indices[i] = 2;
+	}
+	else {
+		f32 mean[4], axis[4], endpoints[2][4];
+		GetPrincipalAxis(points, count, 3, mean, axis);
+		GetAxisEndpoints(points, count, 3, mean, axis, endpoints);
+
+		c0 = QuantizeRgb565(endpoints[0]);
+		c1 = QuantizeRgb565(endpoints[1]);
+		u32 error = PickBc1Indices(pixels, transparent, c0, c1, three_color, indices);
+
+		for (u32 iteration = 0; iteration < 2 && error; iteration++) {
+			f32 weights[16];
+			for (u32 i = 0, k = 0; i < 16; i++)
+				if (!(transparent >> i & 1)) weights[k++] = bc1_weights[three_color][indices[i]];
+
+			if (!FitEndpointsToWeights(points, weights, count, 3, endpoints))
+				break;
+
+			u8  next_indices[16];
+			u16 n0 = QuantizeRgb565(endpoints[0]);
+			u16 n1 = QuantizeRgb565(endpoints[1]);
+			u32 next_error = PickBc1Indices(pixels, transparent, n0, n1, three_color, next_indices);
+
+			if (next_error >= error)
+				break;
+
+			c0 = n0;
+			c1 = n1;
+			error = next_error;
+			CopyMemory(indices, next_indices, 16);
+		}
+	}
+
+	WriteBc1Block(out, c0, c1, indices, three_color);
+}
+
+static void EncodeBc1Block(u8* out, const u8* pixels) {
+	EncodeBc1Colors(out, pixels, true);
+}
+
+//
+// BC3: an alpha block like BC4's, then BC1 colors that always use four.
+//
+
+static void EncodeBc3Alpha(u8* out, const u8* pixels) {
+	u8 lo = 255, hi = 0;
+	u8 inner_lo = 255, inner_hi = 0; // Leaving out 0 and 255.
+
+	for (u32 i = 0; i < 16; i++) {
+		u8 a = pixels[i * 4 + 3];
+		lo = Min(lo, a);
+		hi = Max(hi, a);
+
+		if (a != 0 && a != 255) {
+			inner_lo = Min(inner_lo, a);
+			inner_hi = Max(inner_hi, a);
+		}
+	}
+
+	u32 best_error = ~0u;
+	u8  best[2];
+	u8  best_indices[16];
+
+	// a0 > a1 interpolates 8 values. Otherwise 6, and 0 and 255 have indices of their own.
+	auto try_endpoints = [&](u8 a0, u8 a1) {
+		s32 palette[8] = { a0, a1 };
+
+		if (a0 > a1) {
+			for (s32 i = 2; i < 8; i++) palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+		}
+		else {
+			for (s32 i = 2; i < 6; i++) palette[i] = ((6 - i) * a0 + (i - 1) * a1) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+
+		u8  indices[16];
+		u32 total = 0;
+
+		for (u32 i = 0; i < 16; i++) {
+			s32 a = pixels[i * 4 + 3];
+			u32 error = ~0u;
+
+			for (u32 k = 0; k < 8; k++) {
+				u32 d = (a - palette[k]) * (a - palette[k]);
+				if (d < error) {
+					error = d;
+					indices[i] = k;
+				}
+			}
+
+			total += error;
+		}
+
+		if (total < best_error) {
+			best_error = total;
+			best[0] = a0;
+			best[1] = a1;
+			CopyMemory(best_indices, indices, 16);
+		}
+	};
+
+	try_endpoints(hi, lo);
+
+	if (inner_lo <= inner_hi && best_error)
+		try_endpoints(inner_lo, inner_hi);
+
+	u64 bits = 0;
+	for (u32 i = 0; i < 16; i++)
+		bits |= (u64)best_indices[i] << (i * 3);
+
+	out[0] = best[0];
+	out[1] = best[1];
+	CopyMemory(out + 2, &bits, 6);
+}
+
+static void EncodeBc3Block(u8* out, const u8* pixels) {
+	EncodeBc3Alpha(out, pixels);
+	EncodeBc1Colors(out + 8, pixels, false);
+}
+
+//
+// BC7, modes 1, 5 and 6 of its 8.
+//
+
+// Bit i set when pixel i is in the second subset, for each of the 64 two subset partitions.
+static const u16 bc7_partitions[64] = {
+	0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+	0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+	0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+	0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+	0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+	0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+	0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+	0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22,
+};
+
+// The second subset's anchor pixel, whose index is stored a bit short. The first subset's is always pixel 0.
+static const u8 bc7_anchors[64] = {
+	15, 15, 15, 15, 15, 15, 15, 15,
+	15, 15, 15, 15, 15, 15, 15, 15,
+	15,  2,  8,  2,  2,  8,  8, 15,
+	 2,  8,  2,  2,  8,  8,  2,  2,
+	15, 15,  6,  8,  2,  8, 15, 15,
+	 2,  8,  2,  2,  2, 15, 15,  6,
+	 6,  2,  6,  8, 15, 15,  2,  2,
+	15, 15, 15, 15, 15,  2,  2, 15,
+};
+
+static const u8 bc7_weights2[4]  = { 0, 21, 43, 64 };
+static const u8 bc7_weights3[8]  = { 0, 9, 18, 27, 37, 46, 55, 64 };
+static const u8 bc7_weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Mode 1 partitions ranked by estimate and fitted properly, the rest are skipped.
+static const u32 BC7_PARTITION_CANDIDATES = 4;
+
+enum Bc7PBit : u8 {
+	BC7_PBIT_NONE,
+	BC7_PBIT_EACH,   // One low bit for each endpoint.
+	BC7_PBIT_SHARED, // One for both endpoints of a subset.
+	BC7_PBIT_ONES,   // One for each endpoint, always set. Lets opaque blocks in mode 6 keep alpha at 255.
+};
+
+// How one set of endpoints and indices is stored. Covers channels first to first + channels - 1 of the pixels, mode 5
+// has one of these for RGB and another for alpha.
+struct Bc7Mode {
+	u32 first;
+	u32 channels;
+	u32 color_bits; // Per channel of an endpoint, not counting the p-bit.
+	u32 index_bits;
+	Bc7PBit pbit;
+	const u8* weights;
+};
+
+static const Bc7Mode bc7_mode1       = { 0, 3, 6, 3, BC7_PBIT_SHARED, bc7_weights3 };
+static const Bc7Mode bc7_mode5_color = { 0, 3, 7, 2, BC7_PBIT_NONE,   bc7_weights2 };
+static const Bc7Mode bc7_mode5_alpha = { 3, 1, 8, 2, BC7_PBIT_NONE,   bc7_weights2 };
+static const Bc7Mode bc7_mode6       = { 0, 4, 7, 4, BC7_PBIT_EACH,   bc7_weights4 };
+static const Bc7Mode bc7_mode6_opaque = { 0, 4, 7, 4, BC7_PBIT_ONES,  bc7_weights4 };
+
+struct Bc7Endpoints {
+	u8 color[2][4]; // As stored.
+	u8 pbit[2];
+	u8 value[2][4]; // As decoded, 8 bits.
+};
+
+static void QuantizeBc7Endpoints(const f32 endpoints[2][4], const Bc7Mode* mode, u32 pbit0, u32 pbit1, Bc7Endpoints* out) {
+	u32 pbits = mode->pbit != BC7_PBIT_NONE;
+	u32 bits  = mode->color_bits + pbits;
+	f32 scale = ((1 << bits) - 1) / 255.0f;
+	s32 max   = (1 << mode->color_bits) - 1;
+
+	out->pbit[0] = pbit0;
+	out->pbit[1] = pbit1;
+
+	for (u32 e = 0; e < 2; e++) {
+		u32 pbit = out->pbit[e];
+
+		for (u32 c = 0; c < mode->channels; c++) {
+			// Nearest with the p-bit fixed: round (x - pbit) / 2 at the full precision.
+			f32 x = endpoints[e][c] * scale;
+			s32 color = pbits ? (s32)((x - pbit) * 0.5f + 0.5f) : (s32)(x + 0.5f);
+			out->color[e][c] = Clamp(color, 0, max);
+
+			u32 v = pbits ? (u32)out->color[e][c] << 1 | pbit : out->color[e][c];
+			out->value[e][c] = v << (8 - bits) | v >> (2 * bits - 8);
+		}
+	}
+}
+
+// Each member pixel's nearest interpolated color, returns the total squared error. The pixel's projection onto
+// the line between the endpoints lands next to it, the interpolation isn't quite even so its neighbors are checked.
+static u32 PickBc7Indices(const u8* pixels, const u8* members, u32 count, const Bc7Mode* mode, const Bc7Endpoints* endpoints, u8* indices) {
+	s32 entries = 1 << mode->index_bits;
+	s32 palette[16][4];
+	s32 direction[4];
+	s32 length = 0;
+
+	for (s32 k = 0; k < entries; k++) {
+		s32 w = mode->weights[k];
+		for (u32 c = 0; c < mode->channels; c++)
+			palette[k][c] = ((64 - w) * endpoints->value[0][c] + w * endpoints->value[1][c] + 32) >> 6;
+	}
+
+	for (u32 c = 0; c < mode->channels; c++) {
+		direction[c] = endpoints->value[1][c] - endpoints->value[0][c];
+		length += direction[c] * direction[c];
+	}
+
+	f32 scale = length ? (f32)(entries - 1) / length : 0;
+	u32 total = 0;
+
+	for (u32 m = 0; m < count; m++) {
+		const u8* pixel = pixels + members[m] * 4 + mode->first;
+
+		s32 t = 0;
+		for (u32 c = 0; c < mode->channels; c++)
+			t += (pixel[c] - endpoints->value[0][c]) * direction[c];
+
+		s32 guess = Clamp((s32)(t * scale + 0.5f), 0, entries - 1);
+		u32 best = ~0u;
+
+		for (s32 k = Max(guess - 1, 0); k <= Min(guess + 1, entries - 1); k++) {
+			u32 error = 0;
+			for (u32 c = 0; c < mode->channels; c++)
+				error += (pixel[c] - palette[k][c]) * (pixel[c] - palette[k][c]);
+
+			if (error < best) {
+				best = error;
+				indices[members[m]] = k;
+			}
+		}
+
+		total += best;
+	}
+
+	return total;
+}
+
+// Fits the endpoints of one subset and picks its pixels' indices, returns the squared error. Every choice of
+// p-bits is tried against the pixels, rounding each endpoint on its own misses the ones that fit best together.
+static u32 FitBc7Subset(const u8* pixels, const u8* members, u32 count, const Bc7Mode* mode, Bc7Endpoints* endpoints, u8* indices) {
+	f32 points[16][4];
+	for (u32 m = 0; m < count; m++)
+		for (u32 c = 0; c < mode->channels; c++)
+			points[m][c] = pixels[members[m] * 4 + mode->first + c];
+
+	f32 mean[4], axis[4], ends[2][4];
+	GetPrincipalAxis(points, count, mode->channels, mean, axis);
+	GetAxisEndpoints(points, count, mode->channels, mean, axis, ends);
+
+	u32 pbit_choices = mode->pbit == BC7_PBIT_EACH ? 4 : mode->pbit == BC7_PBIT_SHARED ? 2 : 1;
+	u32 best_error = ~0u;
+
+	for (u32 iteration = 0; iteration < 3; iteration++) {
+		u32 error = ~0u;
+		u8  candidate_indices[16];
+
+		for (u32 choice = 0; choice < pbit_choices; choice++) {
+			Bc7Endpoints candidate;
+			u8  choice_indices[16];
+			u32 pbit0 = mode->pbit == BC7_PBIT_ONES ? 1 : choice & 1;
+			u32 pbit1 = mode->pbit == BC7_PBIT_ONES ? 1 : mode->pbit == BC7_PBIT_EACH ? choice >> 1 : choice;
+			QuantizeBc7Endpoints(ends, mode, pbit0, pbit1, &candidate);
+			u32 choice_error = PickBc7Indices(pixels, members, count, mode, &candidate, choice_indices);
+
+			if (choice_error < error) {
+				error = choice_error;
+				CopyMemory(candidate_indices, choice_indices, 16);
+
+				if (error < best_error)
+					*endpoints = candidate;
+			}
+		}
+
+		if (error >= best_error)
+			break;
+
+		best_error = error;
+		for (u32 m = 0; m < count; m++)
+			indices[members[m]] = candidate_indices[members[m]];
+
+		if (!error)
+			break;
+
+		f32 weights[16];
+		for (u32 m = 0; m < count; m++)
+			weights[m] = mode->weights[candidate_indices[members[m]]] * (1.0f / 64);
+
+		if (!FitEndpointsToWeights(points, weights, count, mode->channels, ends))
+			break;
+	}
+
+	return best_error;
+}
+
+// The anchor pixel's index is stored without its top bit, so it has to be in the first half. Swapping the
+// endpoints mirrors the indices and gets it there.
+static void FixBc7Anchor(u32 anchor, const u8* members, u32 count, const Bc7Mode* mode, Bc7Endpoints* endpoints, u8* indices) {
+	u32 entries = 1 << mode->index_bits;
+
+	if (indices[anchor] < entries / 2)
+		return;
+
+	Bc7Endpoints swapped = *endpoints;
+
+	for (u32 e = 0; e < 2; e++) {
+		CopyMemory(endpoints->color[e], swapped.color[1 - e], 4);
+		CopyMemory(endpoints->value[e], swapped.value[1 - e], 4);
+		endpoints->pbit[e] = swapped.pbit[1 - e];
+	}
+
+	for (u32 m = 0; m < count; m++)
+		indices[members[m]] = entries - 1 - indices[members[m]];
+}
+
+// Residual of each half of partition around its own best fitting line: the covariance's trace less its largest
+// eigenvalue. Leaves out quantization, which costs about the same for every partition. sums holds each pixel's
+// RGB and their products, the second subset's are added up and the first's are what's left of the total.
+static f32 EstimateBc7Partition(const f32 (*sums)[9], const f32 total[9], u16 partition) {
+	f32 subsets[2][9] = { };
+	u32 counts[2] = { };
+
+	for (u32 i = 0; i < 16; i++) {
+		if (partition >> i & 1) {
+			for (u32 j = 0; j < 9; j++) subsets[1][j] += sums[i][j];
+			counts[1]++;
+		}
+	}
+
+	for (u32 j = 0; j < 9; j++)
+		subsets[0][j] = total[j] - subsets[1][j];
+
+	counts[0] = 16 - counts[1];
+	f32 residual = 0;
+
+	for (u32 s = 0; s < 2; s++) {
+		// Sums r g b, rr gg bb, rg rb gb to the covariance times count.
+		f32* v = subsets[s];
+		f32 n = 1.0f / counts[s];
+		f32 covariance[3][3] = {
+			{ v[3] - v[0] * v[0] * n, v[6] - v[0] * v[1] * n, v[7] - v[0] * v[2] * n },
+			{ v[6] - v[0] * v[1] * n, v[4] - v[1] * v[1] * n, v[8] - v[1] * v[2] * n },
+			{ v[7] - v[0] * v[2] * n, v[8] - v[1] * v[2] * n, v[5] - v[2] * v[2] * n },
+		};
+
+		f32 trace = covariance[0][0] + covariance[1][1] + covariance[2][2];
+		if (trace <= 0)
+			continue;
+
+		// A few rounds of power iteration and the Rayleigh quotient, which is good to the square of the axis's error.
+		u32 widest = covariance[1][1] > covariance[0][0] ? 1 : 0;
+		if (covariance[2][2] > covariance[widest][widest]) widest = 2;
+
+		f32 axis[3] = { covariance[0][widest], covariance[1][widest], covariance[2][widest] };
+
+		f32 eigenvalue = 0;
+
+		for (u32 iteration = 0; iteration < 4; iteration++) {
+			f32 next[3];
+			for (u32 a = 0; a < 3; a++)
+				next[a] = covariance[a][0] * axis[0] + covariance[a][1] * axis[1] + covariance[a][2] * axis[2];
+
+			f32 length = next[0] * next[0] + next[1] * next[1] + next[2] * next[2];
+			f32 dot    = next[0] * axis[0] + next[1] * axis[1] + next[2] * axis[2];
+			f32 norm   = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+			if (length <= 0)
+				break;
+
+			eigenvalue = dot / norm;
+			f32 scale = 1 / Sqrt(length);
+			for (u32 c = 0; c < 3; c++)
+				axis[c] = next[c] * scale;
+		}
+
+		residual += trace - eigenvalue;
+	}
+
+	return residual;
+}
+
+// 128 bits written from the bottom up.
+struct Bc7Writer {
+	u64 bits[2];
+	u32 position;
+
+	void Write(u32 value, u32 count) {
+		if (position < 64) {
+			bits[0] |= (u64)value << position;
+			if (position + count > 64) bits[1] |= (u64)value >> (64 - position);
+		}
+		else {
+			bits[1] |= (u64)value << (position - 64);
+		}
+
+		position += count;
+	}
+};
+
+static void EncodeBc7Block(u8* out, const u8* pixels) {
+	static const u8 all_pixels[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+
+	bool opaque = true;
+	for (u32 i = 0; i < 16; i++)
+		opaque &= pixels[i * 4 + 3] == 255;
+
+	enum { MODE_1, MODE_5, MODE_6 } best_mode = MODE_6;
+
+	Bc7Endpoints endpoints[2];
+	u8  indices[2][16];
+	u32 partition = 0;
+	u32 best_error = FitBc7Subset(pixels, all_pixels, 16, opaque ? &bc7_mode6_opaque : &bc7_mode6, &endpoints[0], indices[0]);
+
+	// Mode 5 for alpha that doesn't follow the colors, mode 1 for opaque blocks with two sets of colors.
+	if (!opaque && best_error) {
+		Bc7Endpoints color, alpha;
+		u8  color_indices[16], alpha_indices[16];
+		u32 error = FitBc7Subset(pixels, all_pixels, 16, &bc7_mode5_color, &color, color_indices);
+
+		if (error < best_error)
+			error += FitBc7Subset(pixels, all_pixels, 16, &bc7_mode5_alpha, &alpha, alpha_indices);
+
+		if (error < best_error) {
+			best_error = error;
+			best_mode = MODE_5;
+			endpoints[0] = color;
+			endpoints[1] = alpha;
+			CopyMemory(indices[0], color_indices, 16);
+			CopyMemory(indices[1], alpha_indices, 16);
+		}
+	}
+	else if (opaque && best_error) {
+		f32 sums[16][9];
+		f32 total[9] = { };
+
+		for (u32 i = 0; i < 16; i++) {
+			f32 r = pixels[i * 4], g = pixels[i * 4 + 1], b = pixels[i * 4 + 2];
+			f32 products[9] = { r, g, b, r * r, g * g, b * b, r * g, r * b, g * b };
+
+			for (u32 j = 0; j < 9; j++) {
+				sums[i][j] = products[j];
+				total[j] += products[j];
+			}
+		}
+
+		u32 candidates[BC7_PARTITION_CANDIDATES];
+		f32 estimates[BC7_PARTITION_CANDIDATES];
+		u32 candidate_count = 0;
+
+		for (u32 p = 0; p < 64; p++) {
+			f32 estimate = EstimateBc7Partition(sums, total, bc7_partitions[p]);
+
+			// Insertion into the sorted few.
+			u32 slot = candidate_count;
+			while (slot > 0 && estimates[slot - 1] > estimate) slot--;
+			if (slot >= BC7_PARTITION_CANDIDATES) continue;
+
+			for (u32 j = Min(candidate_count, BC7_PARTITION_CANDIDATES - 1); j > slot; j--) {
+				candidates[j] = candidates[j - 1];
+				estimates[j]  = estimates[j - 1];
+			}
+
+			candidates[slot] = p;
+			estimates[slot]  = estimate;
+			candidate_count  = Min(candidate_count + 1, BC7_PARTITION_CANDIDATES);
+		}
+
+		for (u32 j = 0; j < candidate_count; j++) {
+			u32 p = candidates[j];
+			u8  members[2][16];
+			u32 counts[2] = { };
+
+			for (u32 i = 0; i < 16; i++) {
+				u32 subset = bc7_partitions[p] >> i & 1;
+				members[subset][counts[subset]++] = i;
+			}
+
+			Bc7Endpoints split[2];
+			u8  split_indices[16];
+			u32 error = FitBc7Subset(pixels, members[0], counts[0], &bc7_mode1, &split[0], split_indices);
+			if (error >= best_error) continue;
+
+			error += FitBc7Subset(pixels, members[1], counts[1], &bc7_mode1, &split[1], split_indices);
+			if (error >= best_error) continue;
+
+			FixBc7Anchor(0,              members[0], counts[0], &bc7_mode1, &split[0], split_indices);
+			FixBc7Anchor(bc7_anchors[p], members[1], counts[1], &bc7_mode1, &split[1], split_indices);
+
+			best_error = error;
+			best_mode = MODE_1;
+			partition = p;
+			endpoints[0] = split[0];
+			endpoints[1] = split[1];
+			CopyMemory(indices[0], split_indices, 16);
+		}
+	}
+
+	Bc7Writer writer = { };
+
+	if (best_mode == MODE_1) {
+		u32 anchor = bc7_anchors[partition];
+		writer.Write(1 << 1, 2);
+		writer.Write(partition, 6);
+
+		for (u32 c = 0; c < 3; c++)
+			for (u32 s = 0; s < 2; s++)
+				for (u32 e = 0; e < 2; e++)
+					writer.Write(endpoints[s].color[e][c], 6);
+
+		writer.Write(endpoints[0].pbit[0], 1);
+		writer.Write(endpoints[1].pbit[0], 1);
+
+		for (u32 i = 0; i < 16; i++)
+			writer.Write(indices[0][i], i == 0 || i == anchor ? 2 : 3);
+	}
+	else if (best_mode == MODE_5) {
+		FixBc7Anchor(0, all_pixels, 16, &bc7_mode5_color, &endpoints[0], indices[0]);
+		FixBc7Anchor(0, all_pixels, 16, &bc7_mode5_alpha, &endpoints[1], indices[1]);
+
+		// No rotation, alpha stays alpha.
+		writer.Write(1 << 5, 6);
+		writer.Write(0, 2);
+
+		for (u32 c = 0; c < 3; c++)
+			for (u32 e = 0; e < 2; e++)
+				writer.Write(endpoints[0].color[e][c], 7);
+
+		writer.Write(endpoints[1].color[0][0], 8);
+		writer.Write(endpoints[1].color[1][0], 8);
+
+		for (u32 set = 0; set < 2; set++)
+			for (u32 i = 0; i < 16; i++)
+				writer.Write(indices[set][i], i == 0 ? 1 : 2);
+	}
+	else {
+		FixBc7Anchor(0, all_pixels, 16, &bc7_mode6, &endpoints[0], indices[0]);
+		writer.Write(1 << 6, 7);
+
+		for (u32 c = 0; c < 4; c++)
+			for (u32 e = 0; e < 2; e++)
+				writer.Write(endpoints[0].color[e][c], 7);
+
+		writer.Write(endpoints[0].pbit[0], 1);
+		writer.Write(endpoints[0].pbit[1], 1);
+
+		for (u32 i = 0; i < 16; i++)
+			writer.Write(indices[0][i], i == 0 ? 3 : 4);
+	}
+
+	CopyMemory(out, writer.bits, 16);
+}
+
+//
+// Whole images.
+//
+
+struct BlockCompressJob {
+	BlockFormat format;
+	u8* dst;
+	const u8* pixels;
+	u32 width;
+	u32 height;
+	u32 rows_per_task; // Of blocks.
+};
+
+static void CompressBlockRowsJob(void* context, u32 index) {
+	BlockCompressJob* job = (BlockCompressJob*)context;
+	u32 blocks_x = (job->width + 3) / 4;
+	u32 blocks_y = (job->height + 3) / 4;
+	u32 bytes    = GetBlockBytes(job->format);
+
+	u32 y0 = index * job->rows_per_task;
+	u32 y1 = Min(y0 + job->rows_per_task, blocks_y);
+
+	for (u32 by = y0; by < y1; by++) {
+		for (u32 bx = 0; bx < blocks_x; bx++) {
+			u8 block[64];
+
+			for (u32 y = 0; y < 4; y++) {
+				u32 row = Min(by * 4 + y, job->height - 1);
+				for (u32 x = 0; x < 4; x++) {
+					u32 column = Min(bx * 4 + x, job->width - 1);
+					CopyMemory(block + (y * 4 + x) * 4, job->pixels + ((u64)row * job->width + column) * 4, 4);
+				}
+			}
+
+			u8* out = job->dst + ((u64)by * blocks_x + bx) * bytes;
+
+			switch (job->format) {
+			case BLOCK_FORMAT_BC1: EncodeBc1Block(out, block); break;
+			case BLOCK_FORMAT_BC3: EncodeBc3Block(out, block); break;
+			case BLOCK_FORMAT_BC7: EncodeBc7Block(out, block); break;
+			}
+		}
+	}
+}
+
+static void CompressImage(BlockFormat format, u8* dst, const u8* pixels, u32 width, u32 height) {
+	u32 blocks_y = (height + 3) / 4;
+
+	// A few tasks per thread so the slow blocks of one part of the image don't leave the others waiting.
+	u32 tasks = Min(blocks_y, GetJobThreadCount() * 4);
+
+	BlockCompressJob job = {
+		.format = format,
+		.dst    = dst,
+		.pixels = pixels,
+		.width  = width,
+		.height = height,
+		.rows_per_task = (blocks_y + tasks - 1) / tasks,
+	};
+
+	tasks = (blocks_y + job.rows_per_task - 1) / job.rows_per_task;
+
+	if (tasks == 1)
+		CompressBlockRowsJob(&job, 0);
+	else
+		RunParallel(tasks, CompressBlockRowsJob, &job);
+}
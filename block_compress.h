@@ -0,0 +1,33 @@
+#ifndef BLOCK_COMPRESS_H
+#define BLOCK_COMPRESS_H
+
+#include "general.h"
+
+// Encoders for the BCn formats every desktop GPU samples directly, fixed size blocks of 4x4 pixels:
+//   BC1  8 bytes, RGB 5:6:5 endpoints and 2 bit indices. Pixels with alpha < 128 become transparent. 8:1 from RGBA8.
+//   BC3  16 bytes, BC1's colors plus interpolated 8 bit alpha. 4:1.
+//   BC7  16 bytes, RGBA at 7 to 8 bits per channel with 3 or 4 bit indices. 4:1, the best quality by far and the
+//        slowest to encode. Uses modes 1, 5 and 6 of the 8: mode 6 (one set of RGBA endpoints) for everything,
+//        then mode 5 (RGB and alpha with indices of their own) on blocks with alpha and mode 1 (two sets of RGB
+//        endpoints, 64 ways to split the block) on opaque ones, whichever comes out closest.
+// Errors are measured on the stored values, so sRGB textures are matched in sRGB, which is closer to what's seen.
+// A block is 16 RGBA8 pixels, row by row.
+
+enum BlockFormat : u8 {
+	BLOCK_FORMAT_BC1,
+	BLOCK_FORMAT_BC3,
+	BLOCK_FORMAT_BC7,
+};
+
+static u32 GetBlockBytes(BlockFormat format);
+static u64 GetCompressedSize(BlockFormat format, u32 width, u32 height); // Partial blocks at the edges count whole.
+
+static void EncodeBc1Block(u8* out, const u8* pixels);
+static void EncodeBc3Block(u8* out, const u8* pixels);
+static void EncodeBc7Block(u8* out, const u8* pixels);
+
+// A width x height RGBA8 image, rows of blocks spread over the job threads (jobs.h). Blocks hanging over the right
+// and bottom edges repeat the last column and row.
+static void CompressImage(BlockFormat format, u8* dst, const u8* pixels, u32 width, u32 height);
+
+#endif // BLOCK_COMPRESS_H
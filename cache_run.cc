@@ -0,0 +1,115 @@
+// Runs a build command through the asset cache (see asset_cache.h): when the same command has already been run
+// on inputs with the same contents, the output is copied out of the cache instead.
+// Build and run with: make cache_run && ./cache_run vert.spv vert.hlsl -- dxc -spirv -T vs_6_0 -E main -Fo vert.spv vert.hlsl
+
+#include "general.h"
+#include "math.h"
+#include "os.h"
+
+#include "assert.cc"
+#include "alloc.cc"
+#include "unix.cc"
+#include "print.cc"
+#include "print_float.cc"
+#include "log.cc"
+#include "file_system.cc"
+#include "hash.cc"
+#include "asset_cache.cc"
+
+#include "asset_cache.h"
+
+static bool WriteWholeFile(String path, const byte* data, u64 size) {
+	File file = OpenFile(path, FILE_MODE_CREATE_OR_TRUNCATE, FILE_ACCESS_WRITE);
+
+	if (!file.IsValid())
+		return false;
+
+	file.Write(data, size);
+	bool complete = file.QueryFileSize() == size;
+	file.Close();
+	return complete;
+}
+
+static int CacheRun(String output, char** inputs, u32 input_count, char** command) {
+	// The command line is the processing, with the output's name in it as well.
+	OutputBuffer parameters = GrowableOutput();
+
+	for (char** argument = command; *argument; argument++)
+		Print(&parameters, "%\n", CString(*argument));
+
+	AssetCacheKey key = AssetCacheKeyBegin(parameters.GetString());
+	parameters.Free();
+
+	for (u32 i = 0; i < input_count; i++) {
+		String name = CString(inputs[i]);
+		MappedFile input = MapFile(name, FILE_ADVICE_SEQUENTIAL);
+
+		if (!input.IsValid()) {
+			Print("%: can't read\n", name);
+			return 1;
+		}
+
+		key = AssetCacheKeyAdd(key, name.data, name.length);
+		key = AssetCacheKeyAdd(key, input.data, input.length);
+		input.Unmap();
+	}
+
+	MappedFile cached = LookupAssetCache(key);
+
+	if (cached.IsValid()) {
+		bool written = WriteWholeFile(output, cached.data, cached.length);
+		cached.Unmap();
+
+		if (written) {
+			Print("%: from the cache\n", output);
+			return 0;
+		}
+	}
+
+	standard_output_buffer.Flush(); // Before the command prints anything.
+	s32 status = RunProcess(command);
+
+	if (status != 0) {
+		Print("%: % failed (%)\n", output, CString(command[0]), status);
+		return status > 0 ? status : 1;
+	}
+
+	MappedFile made = MapFile(output, FILE_ADVICE_SEQUENTIAL);
+
+	if (!made.IsValid()) {
+		Print("%: % didn't make it\n", output, CString(command[0]));
+		return 1;
+	}
+
+	if (!StoreAssetCache(key, made.data, made.length))
+		Print("%: can't store in %\n", output, asset_cache_directory);
+
+	made.Unmap();
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	InitGlobalAllocator();
+
+	s32 separator = 0;
+	for (s32 i = 2; i < argc; i++) {
+		if (CString(argv[i]) == "--") {
+			separator = i;
+			break;
+		}
+	}
+
+	int result;
+
+	if (separator && separator + 1 < argc) {
+		// argv is null terminated, so the command after -- is too.
+		result = CacheRun(CString(argv[1]), argv + 2, separator - 2, argv + separator + 1);
+	}
+	else {
+		Print("usage: cache_run <output> <input>... -- <command>...\n");
+		result = 1;
+	}
+
+	standard_output_buffer.Flush();
+	return result;
+}
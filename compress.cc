@@ -0,0 +1,604 @@
+#include "compress.h"
+#include "math.h"
+
+// A sequence is a token (literal length << 4 | match length - 4), the literal length's extra bytes, the literals,
+// a little endian u16 offset back into the output, then the match length's extra bytes. Lengths of 15 in the
+// token continue in bytes of 255 until one is smaller. The last sequence has only literals.
+static const u64 LZ4_MIN_MATCH     = 4;
+static const u64 LZ4_LAST_LITERALS = 5;  // The block always ends with at least this many literals.
+static const u64 LZ4_MATCH_LIMIT   = 12; // And no match starts in the last 12 bytes.
+static const u64 LZ4_MAX_OFFSET    = 65535;
+static const u32 LZ4_HASH_BITS     = 12;
+static const u32 LZ4_SKIP_TRIGGER  = 6;  // Every 64 misses the search steps one byte further.
+
+static inline u32 Lz4ReadU32(const byte* p) { u32 n; CopyMemory(&n, p, 4); return n; }
+static inline u64 Lz4ReadU64(const byte* p) { u64 n; CopyMemory(&n, p, 8); return n; }
+static inline void Lz4Copy16(byte* dst, const byte* src) { CopyMemory(dst, src, 16); }
+
+// Of the five bytes at p, like the reference on 64 bit: one more byte than a match needs gives fewer false hits.
+static inline u32 Lz4Hash(const byte* p) { return ((Lz4ReadU64(p) << 24) * 889523592379llu) >> (64 - LZ4_HASH_BITS); }
+
+static u64 Lz4CompressBound(u64 size) {
+	return size + size / 255 + 16;
+}
+
+static inline byte* Lz4WriteLength(byte* p, u64 length) {
+	for (; length >= 255; length -= 255)
+		*p++ = 255;
+
+	*p++ = (byte)length;
+	return p;
+}
+
+// Where the bytes at p stop matching the ones at match, eight at a time.
+static inline const byte* Lz4MatchEnd(const byte* p, const byte* match, const byte* limit) {
+	while (p + 8 <= limit) {
+		u64 difference = Lz4ReadU64(p) ^ Lz4ReadU64(match);
+
+		if (difference)
+			return p + (Ctz64(difference) >> 3);
+
+		p += 8;
+		match += 8;
+	}
+
+	while (p < limit && *p == *match) {
+		p++;
+		match++;
+	}
+
+	return p;
+}
+
+static u64 CompressLz4(const byte* src, u64 size, byte* dst, u64 capacity) {
+	if (size > 0xFFFFFFFF)
+		return 0;
+
+	const byte* ip     = src;
+	const byte* anchor = src;
+	const byte* end    = src + size;
+	byte* op   = dst;
+	byte* oend = dst + capacity;
+
+	if (size > LZ4_MATCH_LIMIT) {
+		u32 table[1 << LZ4_HASH_BITS]; // Positions by the hash of the four bytes there.
+		ZeroMemory(table, sizeof(table));
+
+		const byte* last_match_start = end - LZ4_MATCH_LIMIT;
+		const byte* last_match_end   = end - LZ4_LAST_LITERALS;
+
+		table[Lz4Hash(ip)] = 0;
+		ip++;
+
+		while (true) {
+			const byte* match;
+			u32 attempts = 1 << LZ4_SKIP_TRIGGER;
+
+			// Incompressible data is skipped over faster and faster.
+			while (true) {
+				if (ip > last_match_start)
+					goto last_literals;
+
+				u32 hash = Lz4Hash(ip);
+				match = src + table[hash];
+				table[hash] = ip - src;
+
+				if ((u64)(ip - match) <= LZ4_MAX_OFFSET && Lz4ReadU32(match) == Lz4ReadU32(ip))
+					break;
+
+				ip += attempts++ >> LZ4_SKIP_TRIGGER;
+			}
+
+			while (ip > anchor && match > src && ip[-1] == match[-1]) {
+				ip--;
+				match--;
+			}
+
+			const byte* match_end = Lz4MatchEnd(ip + LZ4_MIN_MATCH, match + LZ4_MIN_MATCH, last_match_end);
+			u64 literal_length = ip - anchor;
+			u64 match_length   = match_end - ip - LZ4_MIN_MATCH;
+
+			if ((u64)(oend - op) < 1 + literal_length / 255 + 1 + literal_length + 2 + match_length / 255 + 1)
+				return 0;
+
+			byte* token = op++;
+
+			if (literal_length >= 15) {
+				*token = 15 << 4;
+				op = Lz4WriteLength(op, literal_length - 15);
+			}
+			else {
+				*token = literal_length << 4;
+			}
+
+			CopyMemory(op, anchor, literal_length);
+			op += literal_length;
+
+			u16 offset = ip - match;
+			CopyMemory(op, &offset, 2);
+			op += 2;
+
+			if (match_length >= 15) {
+				*token |= 15;
+				op = Lz4WriteLength(op, match_length - 15);
+			}
+			else {
+				*token |= match_length;
+			}
+
+			ip = match_end;
+			anchor = ip;
+
+			if (ip > last_match_start)
+				break;
+
+			// Like the reference, remember a position inside the match too, it finds noticeably more.
+			table[Lz4Hash(ip - 2)] = ip - 2 - src;
+		}
+	}
+
+last_literals:
+	u64 literal_length = end - anchor;
+
+	if ((u64)(oend - op) < 1 + literal_length / 255 + 1 + literal_length)
+		return 0;
+
+	if (literal_length >= 15) {
+		*op++ = 15 << 4;
+		op = Lz4WriteLength(op, literal_length - 15);
+	}
+	else {
+		*op++ = literal_length << 4;
+	}
+
+	CopyMemory(op, anchor, literal_length);
+	op += literal_length;
+	return op - dst;
+}
+
+static inline bool Lz4ReadLength(const byte** p, const byte* end, u64* length) {
+	u32 b;
+
+	do {
+		if (*p >= end)
+			return false;
+
+		b = (u8)*(*p)++;
+		*length += b;
+	} while (b == 255);
+
+	return true;
+}
+
+static bool DecompressLz4(const byte* src, u64 size, byte* dst, u64 dst_size) {
+	const byte* ip   = src;
+	const byte* iend = src + size;
+	byte* op   = dst;
+	byte* oend = dst + dst_size;
+
+	while (true) {
+		if (ip >= iend)
+			return false;
+
+		u32 token = (u8)*ip++;
+		u64 literal_length = token >> 4;
+
+		if (literal_length == 15 && !Lz4ReadLength(&ip, iend, &literal_length))
+			return false;
+
+		// Most literal runs are short: with room on both sides they're one 16 byte copy, whatever the length.
+		if (literal_length <= 16 && iend - ip >= 16 && oend - op >= 16) {
+			Lz4Copy16(op, ip);
+		}
+		else {
+			if (literal_length > (u64)(iend - ip) || literal_length > (u64)(oend - op))
+				return false;
+
+			CopyMemory(op, ip, literal_length);
+		}
+
+		ip += literal_length;
+		op += literal_length;
+
+		if (ip == iend)
+			return op == oend;
+
+		if (iend - ip < 2)
+			return false;
+
+		u64 offset = (u8)ip[0] | (u64)(u8)ip[1] << 8;
+		u64 match_length = token & 15;
+		ip += 2;
+
+		if (match_length == 15 && !Lz4ReadLength(&ip, iend, &match_length))
+			return false;
+
+		match_length += LZ4_MIN_MATCH;
+
+		if (offset == 0 || offset > (u64)(op - dst) || match_length > (u64)(oend - op))
+			return false;
+
+		const byte* match = op - offset;
+
+		if ((u64)(oend - op) < match_length + 15) {
+			// Too close to the end for copies that overshoot.
+			for (u64 i = 0; i < match_length; i++)
+				op[i] = match[i];
+		}
+		else {
+			// 16 byte copies need the source 16 bytes behind. A short offset repeats a pattern, so once
+			// the first few bytes are out a multiple of the offset of at least 16 gives the same bytes.
+			u64 distance = offset;
+			while (distance < 16) distance *= 2;
+
+			u64 head = Min(match_length, distance - offset);
+			for (u64 i = 0; i < head; i++)
+				op[i] = match[i];
+
+			for (u64 i = head; i < match_length; i += 16)
+				Lz4Copy16(op + i, op + i - distance);
+		}
+
+		op += match_length;
+	}
+}
+
+//
+// Inflate. Bits are read least significant first from a 64 bit buffer refilled a word at a time, and
+// codes up to INFLATE_FAST_BITS long (nearly all of them) are decoded with one table lookup.
+//
+
+static const u32 INFLATE_FAST_BITS = 10;
+
+struct InflateHuffman {
+	u16 fast[1 << INFLATE_FAST_BITS]; // Symbol << 4 | length for short codes, 0 for longer ones.
+	u16 counts[16];                   // Codes of each length.
+	u16 symbols[288];                 // In code order.
+};
+
+struct InflateBits {
+	const byte* p;
+	const byte* end;
+	u64 buffer;
+	u32 count;
+	u32 padding; // Zero bytes put in past the end. Taking any of them out means the stream was cut short.
+};
+
+static const u16 inflate_length_base[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+
+static const u8 inflate_length_extra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+
+static const u16 inflate_distance_base[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+	4097, 6145, 8193, 12289, 16385, 24577,
+};
+
+static const u8 inflate_distance_extra[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+
+// The order code length code lengths come in.
+static const u8 inflate_length_order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+// At least 56 bits in the buffer afterwards, enough for a length and a distance with their extra bits.
+static inline void RefillInflateBits(InflateBits* bits) {
+	if (bits->end - bits->p >= 8) {
+		// Bytes already in the buffer are ORed in again at the same place, which changes nothing.
+		bits->buffer |= Lz4ReadU64(bits->p) << bits->count;
+		bits->p += (63 - bits->count) >> 3;
+		bits->count |= 56;
+		return;
+	}
+
+	while (bits->count <= 56) {
+		if (bits->p < bits->end)
+			bits->buffer |= (u64)(u8)*bits->p++ << bits->count;
+		else
+			bits->padding++;
+
+		bits->count += 8;
+	}
+}
+
+static inline u32 TakeInflateBits(InflateBits* bits, u32 count) {
+	u32 value = bits->buffer & ((1ull << count) - 1);
+	bits->buffer >>= count;
+	bits->count -= count;
+	return value;
+}
+
+// Lengths of 0 are unused symbols. Incomplete codes are allowed (a single distance code is), oversubscribed ones aren't.
+static bool BuildInflateHuffman(InflateHuffman* table, const u8* lengths, u32 count) {
+	ZeroMemory(table, sizeof(InflateHuffman));
+
+	for (u32 i = 0; i < count; i++)
+		table->counts[lengths[i]]++;
+
+	table->counts[0] = 0;
+
+	s32 left = 1;
+	for (u32 length = 1; length < 16; length++) {
+		left = left * 2 - table->counts[length];
+
+		if (left < 0)
+			return false;
+	}
+
+	u16 offsets[16];
+	u16 next_code[16];
+	offsets[1] = 0;
+	next_code[1] = 0;
+
+	for (u32 length = 1; length < 15; length++) {
+		offsets[length + 1] = offsets[length] + table->counts[length];
+		next_code[length + 1] = (next_code[length] + table->counts[length]) << 1;
+	}
+
+	for (u32 symbol = 0; symbol < count; symbol++) {
+		u32 length = lengths[symbol];
+
+		if (!length)
+			continue;
+
+		table->symbols[offsets[length]++] = symbol;
+		u32 code = next_code[length]++;
+
+		if (length <= INFLATE_FAST_BITS) {
+			// Codes are packed starting from their first bit, so the table is indexed by the reversed code.
+			u32 reversed = 0;
+			for (u32 i = 0; i < length; i++)
+				reversed |= (code >> i & 1) << (length - 1 - i);
+
+			for (u32 i = reversed; i < 1 << INFLATE_FAST_BITS; i += 1 << length)
+				table->fast[i] = symbol << 4 | length;
+		}
+	}
+
+	return true;
+}
+
+static inline u32 DecodeInflateSymbol(InflateBits* bits, const InflateHuffman* table) {
+	u32 entry = table->fast[bits->buffer & ((1 << INFLATE_FAST_BITS) - 1)];
+
+	if (entry) {
+		TakeInflateBits(bits, entry & 15);
+		return entry >> 4;
+	}
+
+	// A bit at a time through the canonical code, first is the first code of each length.
+	s32 code  = 0;
+	s32 first = 0;
+	s32 index = 0;
+
+	for (u32 length = 1; length < 16; length++) {
+		code |= (bits->buffer >> (length - 1)) & 1;
+		s32 count = table->counts[length];
+
+		if (code - first < count) {
+			TakeInflateBits(bits, length);
+			return table->symbols[index + code - first];
+		}
+
+		index += count;
+		first = (first + count) << 1;
+		code <<= 1;
+	}
+
+	return 0xFFFF; // Not a code: the code is incomplete and this isn't in it.
+}
+
+static bool ReadInflateTables(InflateBits* bits, InflateHuffman* literals, InflateHuffman* distances) {
+	RefillInflateBits(bits);
+	u32 literal_count  = TakeInflateBits(bits, 5) + 257;
+	u32 distance_count = TakeInflateBits(bits, 5) + 1;
+	u32 length_count   = TakeInflateBits(bits, 4) + 4;
+
+	u8 lengths[288 + 32] = { };
+
+	for (u32 i = 0; i < length_count; i++) {
+		RefillInflateBits(bits);
+		lengths[inflate_length_order[i]] = TakeInflateBits(bits, 3);
+	}
+
+	InflateHuffman* length_table = literals; // Only needed until the literal table is built.
+
+	if (!BuildInflateHuffman(length_table, lengths, 19))
+		return false;
+
+	u8 code_lengths[288 + 32];
+	u32 total = literal_count + distance_count;
+
+	for (u32 i = 0; i < total; ) {
+		RefillInflateBits(bits);
+		u32 symbol = DecodeInflateSymbol(bits, length_table);
+
+		if (symbol < 16) {
+			code_lengths[i++] = symbol;
+			continue;
+		}
+
+		u32 repeat;
+		u8 value = 0;
+
+		if (symbol == 16) {
+			if (!i)
+				return false;
+
+			value  = code_lengths[i - 1];
+			repeat = 3 + TakeInflateBits(bits, 2);
+		}
+		else if (symbol == 17) {
+			repeat = 3 + TakeInflateBits(bits, 3);
+		}
+		else if (symbol == 18) {
+			repeat = 11 + TakeInflateBits(bits, 7);
+		}
+		else {
+			return false;
+		}
+
+		if (i + repeat > total)
+			return false;
+
+		SetMemory(code_lengths + i, value, repeat);
+		i += repeat;
+	}
+
+	if (!code_lengths[256])
+		return false; // No end of block.
+
+	return BuildInflateHuffman(literals, code_lengths, literal_count)
+	    && BuildInflateHuffman(distances, code_lengths + literal_count, distance_count);
+}
+
+static bool InflateBlock(InflateBits* bits, const InflateHuffman* literals, const InflateHuffman* distances, byte* dst, byte** out, byte* oend) {
+	byte* op = *out;
+
+	while (true) {
+		RefillInflateBits(bits);
+		u32 symbol = DecodeInflateSymbol(bits, literals);
+
+		if (symbol < 256) {
+			if (op == oend)
+				return false;
+
+			*op++ = symbol;
+			continue;
+		}
+
+		if (symbol == 256)
+			break;
+
+		symbol -= 257;
+
+		if (symbol >= 29)
+			return false;
+
+		u64 length = inflate_length_base[symbol] + TakeInflateBits(bits, inflate_length_extra[symbol]);
+		u32 distance_symbol = DecodeInflateSymbol(bits, distances);
+
+		if (distance_symbol >= 30)
+			return false;
+
+		u64 distance = inflate_distance_base[distance_symbol] + TakeInflateBits(bits, inflate_distance_extra[distance_symbol]);
+
+		if (distance > (u64)(op - dst) || length > (u64)(oend - op))
+			return false;
+
+		const byte* match = op - distance;
+
+		if ((u64)(oend - op) < length + 15) {
+			for (u64 i = 0; i < length; i++)
+				op[i] = match[i];
+		}
+		else if (distance == 1) {
+			SetMemory(op, *match, length);
+		}
+		else {
+			// As in DecompressLz4: 16 byte copies from a multiple of a short distance repeat the same pattern.
+			u64 step = distance;
+			while (step < 16) step *= 2;
+
+			u64 head = Min(length, step - distance);
+			for (u64 i = 0; i < head; i++)
+				op[i] = match[i];
+
+			for (u64 i = head; i < length; i += 16)
+				Lz4Copy16(op + i, op + i - step);
+		}
+
+		op += length;
+	}
+
+	*out = op;
+	return true;
+}
+
+static bool Inflate(const byte* src, u64 size, byte* dst, u64 dst_size) {
+	InflateBits bits = { .p = src, .end = src + size, .buffer = 0, .count = 0, .padding = 0 };
+	InflateHuffman literals;
+	InflateHuffman distances;
+	byte* op   = dst;
+	byte* oend = dst + dst_size;
+	bool is_final;
+
+	do {
+		RefillInflateBits(&bits);
+		is_final  = TakeInflateBits(&bits, 1);
+		u32 type  = TakeInflateBits(&bits, 2);
+
+		if (type == 0) {
+			// Stored: from the next byte boundary, a length, its complement and the bytes as they are.
+			TakeInflateBits(&bits, bits.count & 7);
+
+			if (bits.padding * 8 > bits.count)
+				return false;
+
+			bits.p -= bits.count / 8 - bits.padding;
+			bits.buffer  = 0;
+			bits.count   = 0;
+			bits.padding = 0;
+
+			if (bits.end - bits.p < 4)
+				return false;
+
+			u32 length = (u8)bits.p[0] | (u8)bits.p[1] << 8;
+			u32 check  = (u8)bits.p[2] | (u8)bits.p[3] << 8;
+			bits.p += 4;
+
+			if ((length ^ 0xFFFF) != check || length > (u64)(bits.end - bits.p) || length > (u64)(oend - op))
+				return false;
+
+			CopyMemory(op, bits.p, length);
+			bits.p += length;
+			op += length;
+		}
+		else if (type == 1) {
+			u8 lengths[288 + 32];
+			SetMemory(lengths,       8, 144);
+			SetMemory(lengths + 144, 9, 112);
+			SetMemory(lengths + 256, 7, 24);
+			SetMemory(lengths + 280, 8, 8);
+			SetMemory(lengths + 288, 5, 32);
+
+			BuildInflateHuffman(&literals,  lengths, 288);
+			BuildInflateHuffman(&distances, lengths + 288, 32);
+
+			if (!InflateBlock(&bits, &literals, &distances, dst, &op, oend))
+				return false;
+		}
+		else if (type == 2) {
+			if (!ReadInflateTables(&bits, &literals, &distances))
+				return false;
+
+			if (!InflateBlock(&bits, &literals, &distances, dst, &op, oend))
+				return false;
+		}
+		else {
+			return false;
+		}
+
+		if (bits.padding * 8 > bits.count)
+			return false; // Read past the end.
+	} while (!is_final);
+
+	return op == oend;
+}
+
+static bool InflateZlib(const byte* src, u64 size, byte* dst, u64 dst_size) {
+	if (size < 6)
+		return false;
+
+	u32 method = (u8)src[0];
+	u32 flags  = (u8)src[1];
+
+	// Deflate with a window of up to 32 KiB, a valid check and no preset dictionary.
+	if ((method & 15) != 8 || (method >> 4) > 7 || (method << 8 | flags) % 31 || flags & 0x20)
+		return false;
+
+	return Inflate(src + 2, size - 6, dst, dst_size);
+}
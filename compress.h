@@ -0,0 +1,27 @@
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include "general.h"
+
+// LZ4 block format (no frame), written from the format description so there's no dependency.
+// Decoding is a few branches and 16 byte copies per sequence and runs at several GB/s, far faster than disk,
+// so compressed assets load sooner on anything I/O bound. Compression is the greedy single probe LZ4 fast.
+// Streams are interchangeable with the reference implementation's LZ4_compress_default/LZ4_decompress_safe.
+
+static u64 Lz4CompressBound(u64 size);
+
+// Returns the compressed size, 0 if it didn't fit in capacity. Sources up to 4 GiB.
+static u64 CompressLz4(const byte* src, u64 size, byte* dst, u64 capacity);
+
+// Checks every length and offset, so a corrupt stream fails instead of reading or writing out of bounds.
+// Returns true only when the stream decodes to exactly dst_size bytes.
+static bool DecompressLz4(const byte* src, u64 size, byte* dst, u64 dst_size);
+
+// Deflate (RFC 1951) decoding, the compression in PNG and zip. Every block type, checked the same way as
+// DecompressLz4: true only when the final block ends with exactly dst_size bytes written.
+static bool Inflate(const byte* src, u64 size, byte* dst, u64 dst_size);
+
+// Deflate in a zlib (RFC 1950) wrapper, as in PNG. The Adler-32 at the end isn't checked.
+static bool InflateZlib(const byte* src, u64 size, byte* dst, u64 dst_size);
+
+#endif // COMPRESS_H
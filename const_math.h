@@ -0,0 +1,245 @@
+#ifndef CONST_MATH_H
+#define CONST_MATH_H
+
+#include "general.h"
+
+// Software versions of the libm builtins, used by math.h while constant evaluating.
+// Neither clang nor the standard let __builtin_sin and friends run at compile time.
+// Everything is done in f64 and is accurate to a few ulp, which is plenty for f32 tables.
+// Don't call these at runtime; they're slow.
+namespace Math::Const {
+	static constexpr f64 LN2       = 0.693147180559945309417232121458;
+	static constexpr f64 LN10      = 2.30258509299404568401799145468;
+	static constexpr f64 PI        = 3.14159265358979311599796346854;
+	static constexpr f64 INF       = __builtin_huge_val();
+	static constexpr f64 QUIET_NAN = __builtin_nan("");
+
+	static constexpr u64 SIGN_BIT = 1llu << 63;
+
+	static constexpr u64 Bits(f64 f)     { return __builtin_bit_cast(u64, f); }
+	static constexpr f64 FromBits(u64 n) { return __builtin_bit_cast(f64, n); }
+
+	static constexpr bool IsNaN(f64 f)              { return f != f; }
+	static constexpr f64  Abs(f64 f)                { return FromBits(Bits(f) & ~SIGN_BIT); }
+	static constexpr f64  CopySign(f64 x, f64 y)    { return FromBits((Bits(x) & ~SIGN_BIT) | (Bits(y) & SIGN_BIT)); }
+	static constexpr f64  Fma(f64 a, f64 b, f64 c)  { return a * b + c; }
+
+	static constexpr f64 Max(f64 a, f64 b) { return IsNaN(a) ? b : IsNaN(b) ? a : a >= b ? a : b; }
+	static constexpr f64 Min(f64 a, f64 b) { return IsNaN(a) ? b : IsNaN(b) ? a : a <= b ? a : b; }
+
+	static constexpr f64 Trunc(f64 f) {
+		// Anything at or above 2^52 (and inf/nan) is already integral.
+		if (!(Abs(f) < 4503599627370496.0))
+			return f;
+
+		return CopySign((f64)(s64)f, f);
+	}
+
+	static constexpr f64 Floor(f64 f) { f64 t = Trunc(f); return t > f ? t - 1 : t; }
+	static constexpr f64 Ceil(f64 f)  { f64 t = Trunc(f); return t < f ? t + 1 : t; }
+
+	static constexpr f64 Round(f64 f) {
+		f64 t = Trunc(f);
+		if (Abs(f - t) >= 0.5) t += CopySign(1, f);
+		return t;
+	}
+
+	static constexpr f64 RoundEven(f64 f) {
+		f64 t = Trunc(f);
+		f64 d = Abs(f - t);
+		if (d > 0.5 || (d == 0.5 && ((s64)t & 1))) t += CopySign(1, f);
+		return t;
+	}
+
+	// x * 2^n
+	static constexpr f64 ScaleB(f64 x, s64 n) {
+		for (; n >  1000; n -= 1000) x *= FromBits((u64)(1023 + 1000) << 52);
+		for (; n < -1000; n += 1000) x *= FromBits((u64)(1023 - 1000) << 52);
+		return x * FromBits((u64)(1023 + n) << 52);
+	}
+
+	static constexpr f64 FMod(f64 x, f64 y) {
+		if (y == 0 || IsNaN(x) || IsNaN(y) || Abs(x) == INF) return QUIET_NAN;
+
+		f64 r  = Abs(x);
+		f64 ay = Abs(y);
+		if (ay < 0x1p-1022) return x - Trunc(x / y) * y; // Subnormal divisor, the shift below doesn't work.
+
+		// Long division: subtract the largest ay * 2^k that fits, which is always exact.
+		while (r >= ay) {
+			s64 shift = (s64)(Bits(r) >> 52) - (s64)(Bits(ay) >> 52);
+			f64 d = ScaleB(ay, shift);
+			if (d > r) d *= 0.5;
+			r -= d;
+		}
+
+		return CopySign(r, x);
+	}
+
+	static constexpr f64 Sqrt(f64 f) {
+		if (IsNaN(f) || f < 0) return QUIET_NAN;
+		if (f == 0 || f == INF) return f;
+
+		// Halving the exponent gives a guess within a factor of two, Newton doubles the correct bits each step.
+		f64 guess = FromBits((Bits(f) >> 1) + (511llu << 52));
+		for (u32 i = 0; i < 8; i++)
+			guess = 0.5 * (guess + f / guess);
+
+		return guess;
+	}
+
+	static constexpr f64 Sin(f64 f) {
+		if (IsNaN(f) || Abs(f) == INF) return QUIET_NAN;
+
+		// Reduce to [-pi, pi] and then fold into [-pi/2, pi/2].
+		f64 r = f - RoundEven(f / (2*PI)) * (2*PI);
+		if (r >  PI/2) r =  PI - r;
+		if (r < -PI/2) r = -PI - r;
+
+		f64 term = r;
+		f64 sum  = r;
+		for (u32 n = 1; n < 14; n++) {
+			term *= -r*r / ((2*n) * (2*n + 1));
+			sum  += term;
+		}
+
+		return sum;
+	}
+
+	static constexpr f64 Cos(f64 f) { return Sin(f + PI/2); }
+	static constexpr f64 Tan(f64 f) { return Sin(f) / Cos(f); }
+
+	static constexpr f64 Exp(f64 f) {
+		if (IsNaN(f))  return f;
+		if (f >  709.8) return INF;
+		if (f < -745.2) return 0;
+
+		// e^f = 2^k * e^r with |r| <= ln(2)/2
+		f64 k = RoundEven(f / LN2);
+		f64 r = f - k * LN2;
+
+		f64 term = 1;
+		f64 sum  = 1;
+		for (u32 n = 1; n < 20; n++) {
+			term *= r / n;
+			sum  += term;
+		}
+
+		return ScaleB(sum, (s64)k);
+	}
+
+	static constexpr f64 Exp2(f64 f) {
+		if (Trunc(f) == f && Abs(f) < 2000) return ScaleB(1, (s64)f);
+		return Exp(f * LN2);
+	}
+
+	static constexpr f64 LogE(f64 f) {
+		if (IsNaN(f) || f < 0) return QUIET_NAN;
+		if (f == 0)   return -INF;
+		if (f == INF) return INF;
+
+		// Split into m * 2^e with m in [sqrt(1/2), sqrt(2)).
+		s64 e = 0;
+		if (f < 0x1p-1022) { f *= 0x1p54; e -= 54; }
+
+		e += (s64)((Bits(f) >> 52) & 0x7FF) - 1023;
+		f64 m = FromBits((Bits(f) & ((1llu << 52) - 1)) | (1023llu << 52));
+		if (m > 1.41421356237309504880) { m *= 0.5; e++; }
+
+		// ln(m) = 2 * atanh((m-1)/(m+1))
+		f64 s  = (m - 1) / (m + 1);
+		f64 s2 = s * s;
+		f64 term = s;
+		f64 sum  = 0;
+		for (u32 n = 0; n < 24; n++) {
+			sum  += term / (2*n + 1);
+			term *= s2;
+		}
+
+		return 2*sum + e * LN2;
+	}
+
+	static constexpr f64 Log2(f64 f)  { return LogE(f) / LN2;  }
+	static constexpr f64 Log10(f64 f) { return LogE(f) / LN10; }
+
+	static constexpr f64 Pow(f64 x, f64 e) {
+		if (e == 0) return 1;
+		if (IsNaN(x) || IsNaN(e)) return QUIET_NAN;
+
+		// Integer exponents by squaring, this also covers negative bases.
+		if (Trunc(e) == e && Abs(e) < 2147483648.0) {
+			s64 n = (s64)Abs(e);
+			f64 result = 1;
+			for (f64 b = x; n; n >>= 1, b *= b)
+				if (n & 1) result *= b;
+
+			return e < 0 ? 1 / result : result;
+		}
+
+		if (x < 0)  return QUIET_NAN;
+		if (x == 0) return e < 0 ? INF : 0;
+		return Exp(e * LogE(x));
+	}
+
+	static constexpr f64 ATan(f64 f) {
+		if (IsNaN(f)) return f;
+		if (f < 0)    return -ATan(-f);
+		if (f > 1)    return PI/2 - ATan(1 / f);
+
+		// atan(x) = pi/4 + atan((x-1)/(x+1)) moves x into [-tan(pi/8), tan(pi/8)] where the series converges quickly.
+		f64 offset = 0;
+		if (f > 0.41421356237309504880) {
+			offset = PI/4;
+			f = (f - 1) / (f + 1);
+		}
+
+		f64 f2   = f * f;
+		f64 term = f;
+		f64 sum  = 0;
+		for (u32 n = 0; n < 24; n++) {
+			sum  += term / (2*n + 1);
+			term *= -f2;
+		}
+
+		return offset + sum;
+	}
+
+	static constexpr f64 ATan2(f64 y, f64 x) {
+		if (IsNaN(x) || IsNaN(y)) return QUIET_NAN;
+		if (x > 0) return ATan(y / x);
+		if (x < 0) return ATan(y / x) + CopySign(PI, y);
+		if (y == 0) return CopySign(Bits(x) & SIGN_BIT ? PI : 0, y);
+		return CopySign(PI/2, y);
+	}
+
+	static constexpr f64 ASin(f64 f) { return Abs(f) > 1 ? QUIET_NAN : ATan2(f, Sqrt(1 - f*f)); }
+	static constexpr f64 ACos(f64 f) { return Abs(f) > 1 ? QUIET_NAN : ATan2(Sqrt(1 - f*f), f); }
+
+	static constexpr f64 SinH(f64 f) {
+		// (e^x - e^-x)/2 cancels badly near zero, use the series there.
+		if (Abs(f) < 1) {
+			f64 term = f;
+			f64 sum  = f;
+			for (u32 n = 1; n < 12; n++) {
+				term *= f*f / ((2*n) * (2*n + 1));
+				sum  += term;
+			}
+
+			return sum;
+		}
+
+		return (Exp(f) - Exp(-f)) / 2;
+	}
+
+	static constexpr f64 CosH(f64 f) { return (Exp(f) + Exp(-f)) / 2; }
+
+	static constexpr f64 TanH(f64 f) {
+		if (Abs(f) > 20) return CopySign(1, f);
+		return SinH(f) / CosH(f);
+	}
+}
+
+// Picks the software version while constant evaluating, the builtin otherwise.
+#define MATH_CONSTEXPR(runtime, constant) (__builtin_is_constant_evaluated() ? (constant) : (runtime))
+
+#endif // CONST_MATH_H
@@ -0,0 +1,121 @@
+#include "culling.h"
+#include "simd.h"
+
+static const u32 CULL_LANES = 8;
+
+struct FrustumLanes {
+	f32x8 x[6];
+	f32x8 y[6];
+	f32x8 z[6];
+	f32x8 w[6];
+	f32x8 abs_x[6];
+	f32x8 abs_y[6];
+	f32x8 abs_z[6];
+};
+
+static FrustumLanes BroadcastFrustum(Frustum* frustum) {
+	FrustumLanes lanes;
+
+	for (u32 i = 0; i < 6; i++) {
+		Vector4 plane = frustum->planes[i];
+		lanes.x[i] = BroadcastF32x8(plane.x);
+		lanes.y[i] = BroadcastF32x8(plane.y);
+		lanes.z[i] = BroadcastF32x8(plane.z);
+		lanes.w[i] = BroadcastF32x8(plane.w);
+		lanes.abs_x[i] = BroadcastF32x8(Abs(plane.x));
+		lanes.abs_y[i] = BroadcastF32x8(Abs(plane.y));
+		lanes.abs_z[i] = BroadcastF32x8(Abs(plane.z));
+	}
+
+	return lanes;
+}
+
+// For every 8-bit visibility mask, the lanes that are set packed to the front.
+struct CompactTable {
+	u8 lanes[256][8];
+};
+
+static constexpr CompactTable GenerateCompactTable() {
+	CompactTable table = { };
+
+	for (u32 mask = 0; mask < 256; mask++) {
+		u32 count = 0;
+		for (u32 lane = 0; lane < 8; lane++)
+			if (mask & (1 << lane))
+				table.lanes[mask][count++] = lane;
+	}
+
+	return table;
+}
+
+static constexpr CompactTable compact_table = GenerateCompactTable();
+
+// Always stores 8 indices and advances by the number of visible lanes.
+// The write position never overtakes the group being tested, so the output needs no padding.
+static inline u32 CompactLanes(u32* out_indices, u32 count, u32 base, u32 mask) {
+	u32x8 lanes = __builtin_convertvector(LoadU8x8(compact_table.lanes[mask]), u32x8);
+	StoreU32x8(out_indices + count, lanes + base);
+	return count + PopCount(mask);
+}
+
+static u32 CullSpheres(Frustum* frustum, BoundingSpheres spheres, u32* out_indices) {
+	FrustumLanes lanes = BroadcastFrustum(frustum);
+	u32 count = 0;
+	u32 i = 0;
+
+	for (; i + CULL_LANES <= spheres.count; i += CULL_LANES) {
+		f32x8 x = LoadF32x8(spheres.x + i);
+		f32x8 y = LoadF32x8(spheres.y + i);
+		f32x8 z = LoadF32x8(spheres.z + i);
+		f32x8 neg_radius = -LoadF32x8(spheres.radius + i);
+
+		s32x8 inside = (s32x8){ -1, -1, -1, -1, -1, -1, -1, -1 };
+		for (u32 p = 0; p < 6; p++) {
+			f32x8 distance = lanes.x[p]*x + lanes.y[p]*y + lanes.z[p]*z + lanes.w[p];
+			inside &= distance >= neg_radius;
+		}
+
+		count = CompactLanes(out_indices, count, i, MoveMask(inside));
+	}
+
+	for (; i < spheres.count; i++) {
+		out_indices[count] = i;
+		count += frustum->TestSphere(Vector3(spheres.x[i], spheres.y[i], spheres.z[i]), spheres.radius[i]);
+	}
+
+	return count;
+}
+
+static u32 CullBoxes(Frustum* frustum, BoundingBoxes boxes, u32* out_indices) {
+	FrustumLanes lanes = BroadcastFrustum(frustum);
+	u32 count = 0;
+	u32 i = 0;
+
+	for (; i + CULL_LANES <= boxes.count; i += CULL_LANES) {
+		f32x8 cx = LoadF32x8(boxes.center_x + i);
+		f32x8 cy = LoadF32x8(boxes.center_y + i);
+		f32x8 cz = LoadF32x8(boxes.center_z + i);
+		f32x8 ex = LoadF32x8(boxes.extent_x + i);
+		f32x8 ey = LoadF32x8(boxes.extent_y + i);
+		f32x8 ez = LoadF32x8(boxes.extent_z + i);
+
+		s32x8 inside = (s32x8){ -1, -1, -1, -1, -1, -1, -1, -1 };
+		for (u32 p = 0; p < 6; p++) {
+			// Project the extents onto the plane normal to get the box's effective radius.
+			f32x8 radius   = lanes.abs_x[p]*ex + lanes.abs_y[p]*ey + lanes.abs_z[p]*ez;
+			f32x8 distance = lanes.x[p]*cx + lanes.y[p]*cy + lanes.z[p]*cz + lanes.w[p];
+			inside &= distance >= -radius;
+		}
+
+		count = CompactLanes(out_indices, count, i, MoveMask(inside));
+	}
+
+	for (; i < boxes.count; i++) {
+		Vector3 center  = Vector3(boxes.center_x[i], boxes.center_y[i], boxes.center_z[i]);
+		Vector3 extents = Vector3(boxes.extent_x[i], boxes.extent_y[i], boxes.extent_z[i]);
+		out_indices[count] = i;
+		count += frustum->TestAabb(center, extents);
+	}
+
+	return count;
+}
@@ -0,0 +1,76 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include "general.h"
+#include "vector.h"
+#include "matrix.h"
+
+// Planes are stored as (normal, distance) with the normal pointing into the frustum,
+// so a point p is inside when Dot(normal, p) + distance >= 0.
+struct Frustum {
+	Vector4 planes[6];
+
+	// Extracts the planes from a column-major view-projection with Vulkan's [0, 1] depth range.
+	static Frustum FromMatrix(Matrix4 m) {
+		Vector4 row0 = Vector4(m.x.x, m.y.x, m.z.x, m.w.x);
+		Vector4 row1 = Vector4(m.x.y, m.y.y, m.z.y, m.w.y);
+		Vector4 row2 = Vector4(m.x.z, m.y.z, m.z.z, m.w.z);
+		Vector4 row3 = Vector4(m.x.w, m.y.w, m.z.w, m.w.w);
+
+		Frustum result;
+		result.planes[0] = row3 + row0; // Left
+		result.planes[1] = row3 - row0; // Right
+		result.planes[2] = row3 + row1; // Bottom
+		result.planes[3] = row3 - row1; // Top
+		result.planes[4] = row2;        // Near
+		result.planes[5] = row3 - row2; // Far
+
+		for (Vector4& plane : result.planes)
+			plane /= Vector3(plane.x, plane.y, plane.z).Length();
+
+		return result;
+	}
+
+	bool TestSphere(Vector3 center, f32 radius) {
+		for (Vector4 plane : planes)
+			if (plane.x*center.x + plane.y*center.y + plane.z*center.z + plane.w < -radius)
+				return false;
+
+		return true;
+	}
+
+	bool TestAabb(Vector3 center, Vector3 extents) {
+		for (Vector4 plane : planes) {
+			f32 r = extents.x*Abs(plane.x) + extents.y*Abs(plane.y) + extents.z*Abs(plane.z);
+			if (plane.x*center.x + plane.y*center.y + plane.z*center.z + plane.w < -r)
+				return false;
+		}
+
+		return true;
+	}
+};
+
+// Bounds are kept as structure-of-arrays so the kernels can load 8 instances per register.
+struct BoundingSpheres {
+	f32* x;
+	f32* y;
+	f32* z;
+	f32* radius;
+	u32  count;
+};
+
+struct BoundingBoxes {
+	f32* center_x;
+	f32* center_y;
+	f32* center_z;
+	f32* extent_x;
+	f32* extent_y;
+	f32* extent_z;
+	u32  count;
+};
+
+// Writes the indices of the visible bounds to out_indices (which must hold count entries) and returns how many there are.
+static u32 CullSpheres(Frustum* frustum, BoundingSpheres spheres, u32* out_indices);
+static u32 CullBoxes(Frustum* frustum, BoundingBoxes boxes, u32* out_indices);
+
+#endif // CULLING_H
@@ -3,6 +3,7 @@
 #include "fixed_allocator.h"
 #include "vk_helper.h"
 #include "print.h"
+#include "log.h"
 
 #include <vulkan/vulkan.h>
 
@@ -14,10 +15,9 @@ void Device::Init(VkPhysicalDevice pdev, QueueFamilyTable qft) {
 	vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties);
 	name = CString(physical_properties.deviceName);
 
-	Print("Using graphics card: %\n", name);
+	LogInfo("Using graphics card: %", name);
 
 	float priority = 1.0;
-	standard_output_buffer.Flush();
 	VkDeviceQueueCreateInfo queue_create_info = {
 		.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
 		.queueFamilyIndex = queue_family_table.graphics,
@@ -25,7 +25,14 @@ void Device::Init(VkPhysicalDevice pdev, QueueFamilyTable qft) {
 		.pQueuePriorities = &priority,
 	};
 
+	VkPhysicalDeviceFeatures supported_features;
+	vkGetPhysicalDeviceFeatures(physical_device, &supported_features);
+
+	// Every desktop GPU has BC, but not every Vulkan implementation: textures fall back to RGBA8 without it.
+	supports_bc_textures = supported_features.textureCompressionBC;
+
 	VkPhysicalDeviceFeatures features = {
+		.textureCompressionBC = supports_bc_textures,
 	};
 
 	VkPhysicalDevicePrimitiveTopologyListRestartFeaturesEXT primitive_restart_features = {
@@ -88,7 +95,6 @@ VkSemaphore Device::CreateSemaphore() {
 	VkResult vk_result = vkCreateSemaphore(logical_device, &semaphore_info, null, &result);
 	Assert(vk_result == VK_SUCCESS);
 
-	standard_output_buffer.Flush();
  	return result;
 }
 
@@ -162,21 +168,6 @@ u32 Device::FindMemoryType(u32 filter, VkMemoryPropertyFlags properties) {
 	return -1;
 }
 
-VkDeviceMemory Device::AllocateMemory(u64 size, u32 type_index) {
-	VkDeviceMemory device_memory;
-
-	VkMemoryAllocateInfo alloc_info = {
-		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-		.allocationSize = size,
-		.memoryTypeIndex = type_index,
-	};
-
-	VkResult vk_result = vkAllocateMemory(logical_device, &alloc_info, null, &device_memory);
-	Assert(vk_result == VK_SUCCESS);
-
-	return device_memory;
-}
-
 void Device::WaitIdle() {
 	vkDeviceWaitIdle(logical_device);
 }
@@ -21,6 +21,8 @@ struct Device {
 
 	String name;
 
+	bool supports_bc_textures; // textureCompressionBC is enabled, so the BC formats of texture.h can be sampled.
+
 	Queue* general_queue;
 
 	void Init(VkPhysicalDevice pdev, QueueFamilyTable qft);
@@ -36,9 +38,7 @@ struct Device {
 
 	Queue* CreateQueue(u32 family_index);
 
-	u32 FindMemoryType(u32 filter, VkMemoryPropertyFlags properties);
-	VkDeviceMemory AllocateMemory(u64 size, u32 type_index);
-	// VkDeviceMemory AllocateMemory(u64 size, VkMemoryRequirements memory_requirements);
+	u32 FindMemoryType(u32 filter, VkMemoryPropertyFlags properties); // Memory itself comes from gpu_memory.h.
 
 	void WaitIdle();
 } static device = { };
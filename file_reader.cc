@@ -0,0 +1,234 @@
+#include "file_reader.h"
+#include "math.h"
+
+static const u64 FILE_READER_BUFFER_SIZE = FILE_READER_MAX_PEEK + FILE_READER_CHUNK;
+
+// The second buffer and the thread filling it. The semaphores order everything, so nothing here is atomic:
+// the reader only touches buffer and size after done, the thread only after start.
+struct FileReadAhead {
+	File         file = File(-1);
+	byte*        buffer;
+	u64          offset;  // Where the chunk in buffer is read from.
+	u64          size;    // How much of it there was.
+	bool         pending; // A chunk was asked for and not yet taken.
+	bool         stop;
+	Semaphore    start;
+	Semaphore    done;
+	ThreadHandle thread;
+};
+
+static void FileReadAheadThread(void* argument) {
+	FileReadAhead* ahead = (FileReadAhead*)argument;
+
+	while (true) {
+		WaitSemaphore(ahead->start);
+
+		if (ahead->stop)
+			return;
+
+		ahead->size = ahead->file.ReadAt(ahead->buffer + FILE_READER_MAX_PEEK, FILE_READER_CHUNK, ahead->offset);
+		SignalSemaphore(ahead->done);
+	}
+}
+
+static void RequestReadAhead(FileReadAhead* ahead, u64 offset) {
+	ahead->offset  = offset;
+	ahead->pending = true;
+	SignalSemaphore(ahead->start);
+}
+
+static void WaitReadAhead(FileReadAhead* ahead) {
+	if (!ahead->pending)
+		return;
+
+	WaitSemaphore(ahead->done);
+	ahead->pending = false;
+}
+
+static FileReader OpenFileReader(String path, bool read_ahead) {
+	FileReader reader;
+	reader.file = OpenFile(path, FILE_MODE_OPEN, FILE_ACCESS_READ);
+
+	if (!reader.file.IsValid()) {
+		reader.at_end = true;
+		return reader;
+	}
+
+	// Lets the kernel read further ahead of us, and drop what's behind sooner.
+	reader.file.Advise(FILE_ADVICE_SEQUENTIAL);
+
+	reader.data = (byte*)AllocMemory(FILE_READER_BUFFER_SIZE);
+	reader.head = FILE_READER_MAX_PEEK;
+	reader.tail = FILE_READER_MAX_PEEK;
+
+	if (read_ahead) {
+		FileReadAhead* ahead = (FileReadAhead*)AllocMemory(sizeof(FileReadAhead));
+		*ahead = { };
+		ahead->file   = reader.file;
+		ahead->buffer = (byte*)AllocMemory(FILE_READER_BUFFER_SIZE);
+		ahead->start  = CreateSemaphore(0);
+		ahead->done   = CreateSemaphore(0);
+		ahead->thread = CreateThread(FileReadAheadThread, ahead);
+		reader.read_ahead = ahead;
+
+		RequestReadAhead(ahead, 0);
+	}
+
+	return reader;
+}
+
+void FileReader::Refill() {
+	u64 left = tail - head;
+	Assert(left <= FILE_READER_MAX_PEEK);
+
+	u64 size;
+
+	if (read_ahead) {
+		if (!read_ahead->pending)
+			RequestReadAhead(read_ahead, position);
+
+		WaitReadAhead(read_ahead);
+		Assert(read_ahead->offset == position);
+
+		// What's left goes just in front of the new chunk, then the old buffer takes the next one.
+		byte* next = read_ahead->buffer;
+		CopyMemory(next + FILE_READER_MAX_PEEK - left, data + head, left);
+		read_ahead->buffer = data;
+		data = next;
+		size = read_ahead->size;
+
+		if (size == FILE_READER_CHUNK)
+			RequestReadAhead(read_ahead, position + size);
+	}
+	else {
+		MoveMemory(data + FILE_READER_MAX_PEEK - left, data + head, left);
+		size = file.ReadAt(data + FILE_READER_MAX_PEEK, FILE_READER_CHUNK, position);
+	}
+
+	head = FILE_READER_MAX_PEEK - left;
+	tail = FILE_READER_MAX_PEEK + size;
+	position += size;
+	at_end = size < FILE_READER_CHUNK;
+}
+
+bool FileReader::Fill(u64 count) {
+	Assert(count <= FILE_READER_MAX_PEEK);
+
+	while (tail - head < count && !at_end)
+		Refill();
+
+	return tail - head >= count;
+}
+
+String FileReader::Peek(u64 count) {
+	Fill(count);
+	return String(data + head, Min(count, tail - head), 0);
+}
+
+void FileReader::Skip(u64 count) {
+	if (count <= tail - head) head += count;
+	else                      Seek(Tell() + count);
+}
+
+u64 FileReader::Read(void* dest, u64 count) {
+	u64 total = 0;
+
+	while (total < count) {
+		if (head == tail && !Fill(1))
+			break;
+
+		u64 take = Min(count - total, tail - head);
+		CopyMemory((byte*)dest + total, data + head, take);
+		head  += take;
+		total += take;
+
+		// Big reads go straight into dest, unless a chunk is already on its way.
+		if (count - total >= FILE_READER_CHUNK && !read_ahead) {
+			u64 size = file.ReadAt((byte*)dest + total, count - total, position);
+			position += size;
+			total    += size;
+			head = FILE_READER_MAX_PEEK;
+			tail = FILE_READER_MAX_PEEK;
+			at_end = total < count;
+			break;
+		}
+	}
+
+	return total;
+}
+
+bool FileReader::ReadLine(String* line) {
+	if (head == tail && !Fill(1))
+		return false;
+
+	u64 scanned = 0;
+
+	while (true) {
+		const byte* start = data + head;
+		u64 limit = Min(tail - head, FILE_READER_MAX_PEEK);
+		const byte* newline = (const byte*)__builtin_memchr(start + scanned, '\n', limit - scanned);
+
+		if (newline) {
+			u64 length = newline - start;
+			head += length + 1;
+
+			if (length && start[length - 1] == '\r')
+				length--;
+
+			*line = String(start, length, 0);
+			return true;
+		}
+
+		scanned = limit;
+
+		if (scanned >= FILE_READER_MAX_PEEK || !Fill(scanned + 1))
+			break;
+	}
+
+	if (head == tail)
+		return false;
+
+	// No newline before the end of the file or the end of what fits.
+	u64 length = Min(tail - head, FILE_READER_MAX_PEEK);
+	*line = String(data + head, length, 0);
+	head += length;
+	return true;
+}
+
+void FileReader::Seek(u64 offset) {
+	// Within what's buffered nothing has to be read again.
+	u64 buffered_start = position - (tail - FILE_READER_MAX_PEEK);
+
+	if (offset >= buffered_start && offset <= position) {
+		head = FILE_READER_MAX_PEEK + (offset - buffered_start);
+		return;
+	}
+
+	if (read_ahead)
+		WaitReadAhead(read_ahead);
+
+	head = FILE_READER_MAX_PEEK;
+	tail = FILE_READER_MAX_PEEK;
+	position = offset;
+	at_end = false;
+}
+
+void FileReader::Close() {
+	if (read_ahead) {
+		WaitReadAhead(read_ahead);
+		read_ahead->stop = true;
+		SignalSemaphore(read_ahead->start);
+		JoinThread(read_ahead->thread);
+
+		DestroySemaphore(read_ahead->start);
+		DestroySemaphore(read_ahead->done);
+		FreeMemory(read_ahead->buffer, FILE_READER_BUFFER_SIZE);
+		FreeMemory(read_ahead, sizeof(FileReadAhead));
+	}
+
+	if (file.IsValid())
+		file.Close();
+
+	FreeMemory(data, FILE_READER_BUFFER_SIZE);
+	*this = { };
+}
@@ -0,0 +1,49 @@
+#ifndef FILE_READER_H
+#define FILE_READER_H
+
+#include "general.h"
+#include "string.h"
+#include "file_system.h"
+#include "os.h"
+
+// Buffered sequential reading, the input side of OutputBuffer. The file is read a chunk at a time, so parsing
+// line by line or token by token is a memchr or a compare in memory and only one syscall per chunk.
+// With read_ahead a background thread reads the next chunk into a second buffer while this one is parsed,
+// and the two are swapped when this one runs out.
+
+static const u64 FILE_READER_CHUNK    = 256 << 10; // Read from the file at a time.
+static const u64 FILE_READER_MAX_PEEK = 16 << 10;  // The longest Peek, and the longest line ReadLine returns whole.
+
+struct FileReadAhead;
+
+struct FileReader {
+	File  file = File(-1);
+	byte* data = null;     // FILE_READER_MAX_PEEK bytes of room for what's carried over, then a chunk.
+	u64   head = 0;        // The unread bytes are data[head, tail).
+	u64   tail = 0;
+	u64   position = 0;    // File offset of data[tail].
+	bool  at_end = false;  // Reading at position came up short.
+	FileReadAhead* read_ahead = null;
+
+	bool IsValid() { return file.IsValid(); }
+	bool IsAtEnd() { return head == tail && at_end; }
+	u64  Tell()    { return position - (tail - head); }
+
+	String Peek(u64 count); // The next count bytes without taking them, fewer only at the end. At most FILE_READER_MAX_PEEK.
+	void   Skip(u64 count);
+	u64    Read(void* dest, u64 count);
+
+	// The next line without its "\n" or "\r\n", false at the end. The line points into the buffer and is good
+	// until the next call. Lines of FILE_READER_MAX_PEEK or more come back in pieces of that length.
+	bool ReadLine(String* line);
+
+	void Seek(u64 offset);
+	void Close();
+
+	bool Fill(u64 count); // Has at least count bytes buffered unless the file ends first.
+	void Refill();
+};
+
+static FileReader OpenFileReader(String path, bool read_ahead = false);
+
+#endif // FILE_READER_H
@@ -2,6 +2,10 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <stdio.h>
 
 static File OpenFile(String path) {
 	char cpath[path.length+1];
@@ -11,12 +15,138 @@ static File OpenFile(String path) {
 	return File(handle);
 }
 
+static File OpenFile(String path, FileMode mode, FileAccessFlags access) {
+	char cpath[path.length+1];
+	path.ExportCString(cpath);
+
+	// In FileMode order.
+	static const s32 mode_flags[] = {
+		0,
+		O_APPEND,
+		O_TRUNC,
+		O_CREAT | O_EXCL,
+		O_CREAT,
+		O_CREAT | O_APPEND,
+		O_CREAT | O_TRUNC,
+	};
+
+	s32 flags = mode_flags[mode];
+
+	switch (access & (FILE_ACCESS_READ | FILE_ACCESS_WRITE)) {
+		case FILE_ACCESS_WRITE: flags |= O_WRONLY; break;
+		case FILE_ACCESS_READ:  flags |= O_RDONLY; break;
+		default:                flags |= O_RDWR;   break;
+	}
+
+	return File(open(cpath, flags, 0644));
+}
+
 void File::Write(const char* src, u64 size) {
-	write(handle, src, size);
+	while (size) {
+		ssize_t written = write(handle, src, size);
+
+		if (written < 0) {
+			if (errno == EINTR) continue;
+			return;
+		}
+
+		src  += written;
+		size -= written;
+	}
+}
+
+void File::Write(WriteChunk* chunks, u64 count) {
+	static_assert(sizeof(WriteChunk) == sizeof(iovec));
+
+	while (count) {
+		ssize_t written = writev(handle, (iovec*)chunks, Min(count, 1024llu));
+
+		if (written < 0) {
+			if (errno == EINTR) continue;
+			return;
+		}
+
+		for (; count && (u64)written >= chunks->size; chunks++, count--)
+			written -= chunks->size;
+
+		if (count) {
+			chunks->data  = (const byte*)chunks->data + written;
+			chunks->size -= written;
+		}
+	}
+}
+
+u64 File::Read(char* dest, u64 length) {
+	u64 total = 0;
+
+	// A single read can stop early for pipes, signals and reads over 2GB.
+	while (total < length) {
+		ssize_t count = read(handle, dest + total, length - total);
+
+		if (count < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+
+		if (count == 0)
+			break;
+
+		total += count;
+	}
+
+	return total;
 }
 
-void File::Read(char* dest, u64 length) {
-	read(handle, dest, length);
+u64 File::ReadAt(char* dest, u64 length, u64 offset) {
+	u64 total = 0;
+
+	while (total < length) {
+		ssize_t count = pread(handle, dest + total, length - total, offset + total);
+
+		if (count < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+
+		if (count == 0)
+			break;
+
+		total += count;
+	}
+
+	return total;
+}
+
+void File::Advise(FileAdvice advice, u64 offset, u64 size) {
+#if MACOS
+	// No posix_fadvise, read ahead is switched on and off and WILL_NEED is F_RDADVISE.
+	switch (advice) {
+		case FILE_ADVICE_NORMAL:
+		case FILE_ADVICE_SEQUENTIAL: fcntl(handle, F_RDAHEAD, 1); break;
+		case FILE_ADVICE_RANDOM:     fcntl(handle, F_RDAHEAD, 0); break;
+
+		case FILE_ADVICE_WILL_NEED: {
+			u64 file_size = QueryFileSize();
+			u64 count = size ? size : file_size - Min(offset, file_size);
+			struct radvisory advisory = { .ra_offset = (off_t)offset, .ra_count = (s32)Min(count, 0x7FFFFFFFllu) };
+			fcntl(handle, F_RDADVISE, &advisory);
+			break;
+		}
+
+		case FILE_ADVICE_DONT_NEED: break;
+	}
+#else
+	// In FileAdvice order.
+	static const s32 advice_flags[] = {
+		POSIX_FADV_NORMAL,
+		POSIX_FADV_SEQUENTIAL,
+		POSIX_FADV_RANDOM,
+		POSIX_FADV_WILLNEED,
+		POSIX_FADV_DONTNEED,
+	};
+
+	posix_fadvise(handle, offset, size, advice_flags[advice]);
+#endif
 }
 
 u64 File::QueryFileSize() {
@@ -29,6 +159,62 @@ void File::Close() {
 	close(handle);
 }
 
+void OutputBuffer::WriteOverflow(const char* src, u64 size) {
+	switch (kind) {
+		case OUTPUT_FILE:
+			Flush();
+
+			if (size >= capacity) {
+				file.Write(src, size);
+				return;
+			}
+
+			break;
+
+		case OUTPUT_FIXED:
+			size = capacity - head;
+			break;
+
+		case OUTPUT_GROWABLE: {
+			u32 new_capacity = NextPow2((head + size) | 15);
+			byte* new_data;
+
+			if (owns_data) {
+				new_data = (byte*)ReAllocMemory(data, capacity, new_capacity);
+			}
+			else {
+				new_data = (byte*)AllocMemory(new_capacity);
+				CopyMemory(new_data, data, head);
+			}
+
+			data      = new_data;
+			capacity  = new_capacity;
+			owns_data = true;
+			break;
+		}
+	}
+
+	CopyMemory(data + head, src, size);
+	head += size;
+}
+
+String OutputBuffer::TakeString() {
+	Assert(kind == OUTPUT_GROWABLE);
+
+	if (!head)
+		return String();
+
+	if (owns_data)
+		return String(data, head, capacity);
+
+	return String((char*)CopyAllocMemory(data, head), head, head);
+}
+
+void OutputBuffer::Free() {
+	if (owns_data)
+		FreeMemory(data, capacity);
+}
+
 static bool DoesFileExist(String path)
 {
 	char cpath[path.length+1];
@@ -37,12 +223,94 @@ static bool DoesFileExist(String path)
 	return access(cpath, 0) == 0;
 }
 
+static bool CreateDirectory(String path) {
+	char cpath[path.length+1];
+	path.ExportCString(cpath);
+	return mkdir(cpath, 0755) == 0 || errno == EEXIST;
+}
+
+static bool RenameFile(String from, String to) {
+	char cfrom[from.length+1];
+	char cto[to.length+1];
+	from.ExportCString(cfrom);
+	to.ExportCString(cto);
+	return rename(cfrom, cto) == 0;
+}
+
+static bool DeleteFile(String path) {
+	char cpath[path.length+1];
+	path.ExportCString(cpath);
+	return unlink(cpath) == 0;
+}
+
+static void AdviseMemory(const byte* data, u64 length, FileAdvice advice) {
+	// In FileAdvice order.
+	static const s32 advice_flags[] = {
+		MADV_NORMAL,
+		MADV_SEQUENTIAL,
+		MADV_RANDOM,
+		MADV_WILLNEED,
+		MADV_DONTNEED,
+	};
+
+	// madvise wants a page aligned start.
+	u64 start = (u64)data & -PAGE_SIZE;
+	madvise((void*)start, (u64)data + length - start, advice_flags[advice]);
+}
+
+static MappedFile MapFile(String path, FileAdvice advice) {
+	MappedFile result;
+	File file = OpenFile(path, FILE_MODE_OPEN, FILE_ACCESS_READ);
+
+	if (!file.IsValid())
+		return result;
+
+	u64 size = file.QueryFileSize();
+	result.is_valid = true;
+
+	// mmap refuses empty mappings, an empty file is a valid empty view.
+	if (size) {
+		void* p = mmap(null, size, PROT_READ, MAP_PRIVATE, file.handle, 0);
+
+		if (p == MAP_FAILED) {
+			result.is_valid = false;
+		}
+		else {
+			result.data   = (const byte*)p;
+			result.length = size;
+			AdviseMemory(result.data, size, advice);
+		}
+	}
+
+	// The mapping keeps the file alive.
+	file.Close();
+	return result;
+}
+
+void MappedFile::Advise(FileAdvice advice, u64 offset, u64 size) {
+	if (offset >= length)
+		return;
+
+	AdviseMemory(data + offset, Min(size, length - offset), advice);
+}
+
+void MappedFile::Unmap() {
+	if (data)
+		munmap((void*)data, length);
+
+	*this = { };
+}
+
 static Array<byte> LoadFile(String path) {
-	File file = OpenFile(path);
+	File file = OpenFile(path, FILE_MODE_OPEN, FILE_ACCESS_READ);
+
+	if (!file.IsValid())
+		return { };
+
 	u64 size = file.QueryFileSize();
 
 	byte* p = (byte*)AllocMemory(size);
-	file.Read(p, size);
+	size = file.Read(p, size);
 	file.Close();
 
 	Array<byte> result = {
@@ -8,6 +8,20 @@
 
 typedef s32 DirectoryHandle;
 
+// One piece of a gathered write, laid out like struct iovec.
+struct WriteChunk {
+	const void* data;
+	u64 size;
+};
+
+enum FileAdvice {
+	FILE_ADVICE_NORMAL,
+	FILE_ADVICE_SEQUENTIAL, // Read ahead aggressively, pages behind can go early.
+	FILE_ADVICE_RANDOM,     // No read ahead.
+	FILE_ADVICE_WILL_NEED,  // Start reading it in now.
+	FILE_ADVICE_DONT_NEED,  // Done with it, the pages can be dropped.
+};
+
 struct File {
 	FileHandle handle;
 
@@ -15,60 +29,89 @@ struct File {
 
 	bool IsValid() { return handle != -1; }
 	void Write(const char* src, u64 size);
-	void Read(char* dest, u64 length);
+	void Write(WriteChunk* chunks, u64 count); // One writev per batch, advances chunks past partial writes.
+	u64  Read(char* dest, u64 length); // Returns less than length only at the end of the file or on an error.
+	u64  ReadAt(char* dest, u64 length, u64 offset); // Like Read, but at offset and without moving the file position.
+	void Advise(FileAdvice advice, u64 offset = 0, u64 size = 0); // A size of 0 is to the end of the file.
 	u64  QueryFileSize();
 	void Close();
 };
 
 static const u64 OUTPUT_BUFFER_SIZE = 4096 * 2;
 
-struct OutputBuffer {
-	File file;
-	u32  head;
-	byte buffer[OUTPUT_BUFFER_SIZE];
-
-	void Write(const char* data, u64 size) {
-		Assert(head < OUTPUT_BUFFER_SIZE);
+enum OutputKind {
+	OUTPUT_FILE,     // Written to file when full.
+	OUTPUT_FIXED,    // The caller's memory, anything past the end is dropped.
+	OUTPUT_GROWABLE, // Reallocated when full, starting in the caller's memory if there is any.
+};
 
-		if (head + size < OUTPUT_BUFFER_SIZE) {
-			CopyMemory(buffer + head, data, size);
+// Where Print's characters go. A write that fits is a copy, the kind only matters once data is full.
+struct OutputBuffer {
+	byte*      data;
+	u32        head;
+	u32        capacity;
+	OutputKind kind;
+	bool       owns_data; // Growable buffers own data once they've reallocated it.
+	File       file = File(-1);
+
+	void Write(const char* src, u64 size) {
+		if (head + size <= capacity) {
+			CopyMemory(data + head, src, size);
 			head += size;
 			return;
 		}
 
-		file.Write(buffer, head);
-		head = 0;
-
-		if (size > OUTPUT_BUFFER_SIZE) {
-			file.Write(data, size);
-			head = 0;
-			return;
-		}
-
-		CopyMemory(buffer, data, size);
-		head = size;
+		WriteOverflow(src, size);
 	}
 
 	void Write(char c) {
-		Assert(head < OUTPUT_BUFFER_SIZE);
-
-		buffer[head++] = c;
+		if (head < capacity) {
+			data[head++] = c;
+			return;
+		}
 
-		if (head == OUTPUT_BUFFER_SIZE)
-			Flush();
+		WriteOverflow(&c, 1);
 	}
 
 	void Flush() {
-		if (head == 0)
+		if (kind != OUTPUT_FILE || head == 0)
 			return;
 
-		file.Write(buffer, head);
+		file.Write(data, head);
 		head = 0;
 	}
+
+	// What's been written so far, still pointing into the buffer.
+	String GetString() { return String(data, head, 0); }
+
+	// For growable buffers: the characters as a String that owns its memory (Free it). Allocates once if the
+	// buffer never outgrew the caller's memory, and not at all if it did.
+	String TakeString();
+
+	void Free(); // For growable buffers that weren't taken.
+	void WriteOverflow(const char* src, u64 size);
+};
+
+static OutputBuffer FixedOutput(char* memory, u32 capacity) {
+	return (OutputBuffer){ .data = memory, .head = 0, .capacity = capacity, .kind = OUTPUT_FIXED, .owns_data = false };
+}
+
+static OutputBuffer GrowableOutput(char* initial_memory = null, u32 capacity = 0) {
+	return (OutputBuffer){ .data = initial_memory, .head = 0, .capacity = capacity, .kind = OUTPUT_GROWABLE, .owns_data = false };
+}
+
+// A buffered file, data points at its own storage so it can't be copied.
+struct FileOutputBuffer : OutputBuffer {
+	byte storage[OUTPUT_BUFFER_SIZE];
+
+	explicit FileOutputBuffer(File file) :
+		OutputBuffer{ .data = storage, .head = 0, .capacity = OUTPUT_BUFFER_SIZE, .kind = OUTPUT_FILE, .owns_data = false, .file = file } { }
+
+	FileOutputBuffer(const FileOutputBuffer&) = delete;
 };
 
-static OutputBuffer standard_output_buffer { .file = File(STDOUT), .head = 0 };
-static OutputBuffer standard_error_buffer  { .file = File(STDERR), .head = 0 };
+static FileOutputBuffer standard_output_buffer { File(STDOUT) };
+static FileOutputBuffer standard_error_buffer  { File(STDERR) };
 
 enum FileMode
 {
@@ -88,8 +131,27 @@ typedef u32 FileAccessFlags;
 static const FileAccessFlags FILE_ACCESS_READ  = 0x1;
 static const FileAccessFlags FILE_ACCESS_WRITE = 0x2;
 
+// A read-only view of a whole file straight from the page cache, nothing is copied or allocated.
+// Pages are read in when they're first touched, so only what's used counts towards memory.
+struct MappedFile {
+	const byte* data = null;
+	u64 length = 0;
+	bool is_valid = false;
+
+	bool IsValid() { return is_valid; }
+	void Advise(FileAdvice advice, u64 offset = 0, u64 size = -1llu);
+	void Unmap();
+
+	const byte& operator[](u64 n) { return data[n]; }
+};
+
 static File        OpenFile(String path);
+static File        OpenFile(String path, FileMode mode, FileAccessFlags access);
 static Array<byte> LoadFile(String path);
+static MappedFile  MapFile(String path, FileAdvice advice = FILE_ADVICE_SEQUENTIAL);
 static bool        DoesFileExist(String path);
+static bool        CreateDirectory(String path); // Also true if it's already there.
+static bool        RenameFile(String from, String to); // Replaces to atomically if it exists.
+static bool        DeleteFile(String path);
 
 #endif // FILE_SYSTEM_H
@@ -16,12 +16,7 @@ static GpuBuffer CreateBuffer(u64 size, VkBufferUsageFlags usage, VkMemoryProper
 	VkResult vk_result = vkCreateBuffer(device.logical_device, &buffer_info, null, &result.buffer);
 	Assert(vk_result == VK_SUCCESS);
 
-	VkMemoryRequirements memreq;
-	vkGetBufferMemoryRequirements(device.logical_device, result.buffer, &memreq);
-
-	result.memory = device.AllocateMemory(memreq.size, device.FindMemoryType(memreq.memoryTypeBits, properties));
-
-	vkBindBufferMemory(device.logical_device, result.buffer, result.memory, 0);
+	result.memory = AllocateBufferMemory(result.buffer, properties);
 
 	return result;
 }
@@ -46,20 +41,19 @@ static void CopyBuffer(GpuBuffer dst, GpuBuffer src, u64 size) {
 
 void* GpuBuffer::Map() {
 	if (!mapping)
-		vkMapMemory(device.logical_device, memory, 0, size, 0, &mapping);
+		mapping = memory.mapping;
 
+	Assert(mapping);
 	return mapping;
 }
 
 void GpuBuffer::Unmap() {
 	Assert(mapping);
-
-	vkUnmapMemory(device.logical_device, memory);
 	mapping = null;
 }
 
 
-void GpuBuffer::Upload(void* data, u64 size) {
+void GpuBuffer::Upload(const void* data, u64 size) {
 	Assert(this->size >= size);
 
 	bool already_mapped = mapping;
@@ -75,7 +69,7 @@ void GpuBuffer::Upload(void* data, u64 size) {
 
 void GpuBuffer::Destroy() {
 	vkDestroyBuffer(device.logical_device, buffer, null);
-	vkFreeMemory(device.logical_device, memory, null);
+	FreeGpuMemory(&memory);
 
 	SetMemory(this, 0, sizeof(*this));
 }
@@ -3,6 +3,7 @@
 
 #include "general.h"
 #include "assert.h"
+#include "gpu_memory.h"
 #include <vulkan/vulkan.h>
 
 struct GpuBuffer {
@@ -12,13 +13,14 @@ struct GpuBuffer {
 	VkBuffer buffer;
 	VkBufferUsageFlags usage;
 
-	VkDeviceMemory memory;
+	GpuAllocation memory;
 	VkMemoryPropertyFlags properties;
 
+	// Host visible memory is mapped for as long as it lives (gpu_memory.h), these only hand the mapping out.
 	void* Map();
 	void  Unmap();
 
-	void Upload(void* data, u64 size);
+	void Upload(const void* data, u64 size);
 
 	void Destroy();
 
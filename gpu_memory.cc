@@ -0,0 +1,535 @@
+#include "gpu_memory.h"
+#include "device.h"
+#include "list.h"
+#include "math.h"
+#include "log.h"
+
+// Two level segregated fit: free ranges are listed by size class, the first level a power of two and the second
+// that split TLSF_SL_COUNT ways. Bitmaps of the lists that aren't empty make finding a big enough range two bit
+// scans, and freeing merges a range with free neighbors, so a block never has two free ranges side by side.
+static const u32 TLSF_SL_BITS    = 4;
+static const u32 TLSF_SL_COUNT   = 1 << TLSF_SL_BITS;
+static const u32 TLSF_SMALL_BITS = 8;  // Sizes below 256 share the first level, split linearly.
+static const u32 TLSF_FL_COUNT   = 48;
+static const u64 TLSF_ALIGNMENT  = 16; // Of every range, so alignments up to this cost nothing.
+static const u32 TLSF_NONE       = ~0u;
+
+struct TlsfNode {
+	u64  offset;
+	u64  size;
+	u32  prev_physical; // Neighbors in the block, by offset.
+	u32  next_physical;
+	u32  prev_free;     // In the size class's list, while free.
+	u32  next_free;
+	bool free;
+};
+
+struct GpuMemoryBlock {
+	VkDeviceMemory memory;
+	u64   size;
+	byte* mapping;
+	u64   used;
+	u32   allocation_count;
+
+	List<TlsfNode> nodes;
+	List<u32>      unused_nodes;
+
+	u64 fl_bitmap;
+	u32 sl_bitmap[TLSF_FL_COUNT];
+	u32 free_heads[TLSF_FL_COUNT][TLSF_SL_COUNT];
+};
+
+struct GpuMemoryPool {
+	u32 type_index;
+	u64 block_size;
+	List<GpuMemoryBlock*> blocks; // Freed blocks leave a null, so allocations keep their index.
+};
+
+static struct {
+	GpuMemoryPool pools[VK_MAX_MEMORY_TYPES * 2]; // Linear then optimal for each memory type.
+	bool separate_kinds;
+	u64  non_coherent_atom;
+	u32  allocation_count;
+	u32  dedicated_count;
+	u64  dedicated_bytes;
+} gpu_memory;
+
+static u64 AlignGpuMemory(u64 offset, u64 alignment) {
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+static void GetTlsfClass(u64 size, u32* fl, u32* sl) {
+	if (size < 1 << TLSF_SMALL_BITS) {
+		*fl = 0;
+		*sl = size >> (TLSF_SMALL_BITS - TLSF_SL_BITS);
+		return;
+	}
+
+	u32 log2 = 63 - Clz64(size);
+	*fl = log2 - TLSF_SMALL_BITS + 1;
+	*sl = (size >> (log2 - TLSF_SL_BITS)) & (TLSF_SL_COUNT - 1);
+}
+
+static u32 NewTlsfNode(GpuMemoryBlock* block) {
+	if (block->unused_nodes.count)
+		return block->unused_nodes.elements[--block->unused_nodes.count];
+
+	block->nodes.Add(TlsfNode { });
+	return block->nodes.count - 1;
+}
+
+static void InsertTlsfFree(GpuMemoryBlock* block, u32 index) {
+	TlsfNode* node = &block->nodes[index];
+	u32 fl, sl;
+	GetTlsfClass(node->size, &fl, &sl);
+
+	u32 head = block->free_heads[fl][sl];
+	node->free      = true;
+	node->prev_free = TLSF_NONE;
+	node->next_free = head;
+
+	if (head != TLSF_NONE)
+		block->nodes[head].prev_free = index;
+
+	block->free_heads[fl][sl] = index;
+	block->sl_bitmap[fl] |= 1u << sl;
+	block->fl_bitmap     |= 1ull << fl;
+}
+
+static void RemoveTlsfFree(GpuMemoryBlock* block, u32 index) {
+	TlsfNode* node = &block->nodes[index];
+	u32 fl, sl;
+	GetTlsfClass(node->size, &fl, &sl);
+
+	if (node->prev_free != TLSF_NONE)
+		block->nodes[node->prev_free].next_free = node->next_free;
+	else
+		block->free_heads[fl][sl] = node->next_free;
+
+	if (node->next_free != TLSF_NONE)
+		block->nodes[node->next_free].prev_free = node->prev_free;
+
+	if (block->free_heads[fl][sl] == TLSF_NONE) {
+		block->sl_bitmap[fl] &= ~(1u << sl);
+
+		if (!block->sl_bitmap[fl])
+			block->fl_bitmap &= ~(1ull << fl);
+	}
+
+	node->free = false;
+}
+
+// A free range of at least size, TLSF_NONE if there's none. Searching from the class above size's, unless size
+// starts its class, means whatever is found fits without looking at it.
+static u32 FindTlsfFree(GpuMemoryBlock* block, u64 size) {
+	if (size >= 1 << TLSF_SMALL_BITS)
+		size += (1ull << (63 - Clz64(size) - TLSF_SL_BITS)) - 1;
+
+	u32 fl, sl;
+	GetTlsfClass(size, &fl, &sl);
+
+	if (fl >= TLSF_FL_COUNT)
+		return TLSF_NONE;
+
+	u32 sl_map = block->sl_bitmap[fl] & (~0u << sl);
+
+	if (!sl_map) {
+		u64 fl_map = block->fl_bitmap & (~0ull << (fl + 1));
+
+		if (!fl_map)
+			return TLSF_NONE;
+
+		fl = Ctz64(fl_map);
+		sl_map = block->sl_bitmap[fl];
+	}
+
+	return block->free_heads[fl][Ctz32(sl_map)];
+}
+
+// Splits the free range at index in two, the second part from offset at, and returns it.
+static u32 SplitTlsfNode(GpuMemoryBlock* block, u32 index, u64 at) {
+	u32 split = NewTlsfNode(block);
+	TlsfNode* node = &block->nodes[index];
+
+	block->nodes[split] = {
+		.offset        = at,
+		.size          = node->offset + node->size - at,
+		.prev_physical = index,
+		.next_physical = node->next_physical,
+	};
+
+	if (node->next_physical != TLSF_NONE)
+		block->nodes[node->next_physical].prev_physical = split;
+
+	node->size = at - node->offset;
+	node->next_physical = split;
+	return split;
+}
+
+static bool AllocateTlsf(GpuMemoryBlock* block, u64 size, u64 alignment, u32* result) {
+	size = AlignGpuMemory(size, TLSF_ALIGNMENT);
+
+	// Room for the worst padding, so the range found is sure to fit.
+	u64 padded = size + (alignment > TLSF_ALIGNMENT ? alignment - TLSF_ALIGNMENT : 0);
+	u32 index  = FindTlsfFree(block, padded);
+
+	if (index == TLSF_NONE)
+		return false;
+
+	RemoveTlsfFree(block, index);
+
+	// The padding before and the rest after go back as free ranges of their own. Neither has a free neighbor:
+	// the range they came from didn't.
+	u64 offset  = block->nodes[index].offset;
+	u64 aligned = AlignGpuMemory(offset, alignment);
+
+	if (aligned != offset) {
+		u32 front = index;
+		index = SplitTlsfNode(block, front, aligned);
+		InsertTlsfFree(block, front);
+	}
+
+	if (block->nodes[index].size - size >= TLSF_ALIGNMENT)
+		InsertTlsfFree(block, SplitTlsfNode(block, index, aligned + size));
+
+	block->used += block->nodes[index].size;
+	block->allocation_count++;
+	*result = index;
+	return true;
+}
+
+static void FreeTlsf(GpuMemoryBlock* block, u32 index) {
+	block->used -= block->nodes[index].size;
+	block->allocation_count--;
+
+	u32 prev = block->nodes[index].prev_physical;
+	u32 next = block->nodes[index].next_physical;
+
+	if (next != TLSF_NONE && block->nodes[next].free) {
+		RemoveTlsfFree(block, next);
+		block->nodes[index].size += block->nodes[next].size;
+		block->nodes[index].next_physical = block->nodes[next].next_physical;
+
+		if (block->nodes[next].next_physical != TLSF_NONE)
+			block->nodes[block->nodes[next].next_physical].prev_physical = index;
+
+		block->unused_nodes.Add(next);
+	}
+
+	if (prev != TLSF_NONE && block->nodes[prev].free) {
+		RemoveTlsfFree(block, prev);
+		block->nodes[prev].size += block->nodes[index].size;
+		block->nodes[prev].next_physical = block->nodes[index].next_physical;
+
+		if (block->nodes[index].next_physical != TLSF_NONE)
+			block->nodes[block->nodes[index].next_physical].prev_physical = prev;
+
+		block->unused_nodes.Add(index);
+		index = prev;
+	}
+
+	InsertTlsfFree(block, index);
+}
+
+static u64 GetLargestTlsfFree(GpuMemoryBlock* block) {
+	if (!block->fl_bitmap)
+		return 0;
+
+	// The highest class that isn't empty, its ranges can differ in size.
+	u32 fl = 63 - Clz64(block->fl_bitmap);
+	u32 sl = 31 - Clz32(block->sl_bitmap[fl]);
+	u64 largest = 0;
+
+	for (u32 i = block->free_heads[fl][sl]; i != TLSF_NONE; i = block->nodes[i].next_free)
+		largest = Max(largest, block->nodes[i].size);
+
+	return largest;
+}
+
+static bool IsHostVisible(u32 type_index) {
+	return device.memory_properties.memoryTypes[type_index].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+}
+
+// VK_NULL_HANDLE when the device is out of memory of the type.
+static VkDeviceMemory AllocateDeviceMemory(u64 size, u32 type_index, const void* next, byte** mapping) {
+	VkMemoryAllocateInfo alloc_info = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+		.pNext = next,
+		.allocationSize = size,
+		.memoryTypeIndex = type_index,
+	};
+
+	VkDeviceMemory memory;
+	VkResult vk_result = vkAllocateMemory(device.logical_device, &alloc_info, null, &memory);
+
+	if (vk_result != VK_SUCCESS)
+		return VK_NULL_HANDLE;
+
+	*mapping = null;
+
+	if (IsHostVisible(type_index)) {
+		vk_result = vkMapMemory(device.logical_device, memory, 0, VK_WHOLE_SIZE, 0, (void**)mapping);
+		Assert(vk_result == VK_SUCCESS);
+	}
+
+	return memory;
+}
+
+static GpuMemoryBlock* CreateGpuMemoryBlock(GpuMemoryPool* pool, u64 size) {
+	byte* mapping;
+	VkDeviceMemory memory = AllocateDeviceMemory(size, pool->type_index, null, &mapping);
+
+	if (!memory)
+		return null;
+
+	GpuMemoryBlock* block = Alloc<GpuMemoryBlock>();
+	ZeroMemory(block, sizeof(GpuMemoryBlock));
+	SetMemory(block->free_heads, 0xFF, sizeof(block->free_heads));
+	block->memory  = memory;
+	block->size    = size;
+	block->mapping = mapping;
+
+	block->nodes.Add({
+		.offset        = 0,
+		.size          = size,
+		.prev_physical = TLSF_NONE,
+		.next_physical = TLSF_NONE,
+	});
+
+	InsertTlsfFree(block, 0);
+	return block;
+}
+
+static void DestroyGpuMemoryBlock(GpuMemoryBlock* block) {
+	vkFreeMemory(device.logical_device, block->memory, null);
+	block->nodes.Free();
+	block->unused_nodes.Free();
+	Free(block, 1);
+}
+
+static void InitGpuMemory() {
+	VkPhysicalDeviceLimits* limits = &device.physical_properties.limits;
+	gpu_memory.separate_kinds    = limits->bufferImageGranularity > 1;
+	gpu_memory.non_coherent_atom = limits->nonCoherentAtomSize;
+
+	for (u32 type = 0; type < device.memory_properties.memoryTypeCount; type++) {
+		u64 heap_size = device.memory_properties.memoryHeaps[device.memory_properties.memoryTypes[type].heapIndex].size;
+
+		for (u32 kind = 0; kind < 2; kind++) {
+			GpuMemoryPool* pool = &gpu_memory.pools[type * 2 + kind];
+			pool->type_index = type;
+			pool->block_size = heap_size <= (1ull << 30) ? AlignGpuMemory(heap_size / 8, TLSF_ALIGNMENT) : GPU_MEMORY_BLOCK_SIZE;
+		}
+	}
+}
+
+static GpuAllocation AllocateDedicated(u64 size, u32 type_index, VkBuffer buffer, VkImage image) {
+	VkMemoryDedicatedAllocateInfo dedicated_info = {
+		.sType  = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO,
+		.image  = image,
+		.buffer = buffer,
+	};
+
+	byte* mapping;
+	VkDeviceMemory memory = AllocateDeviceMemory(size, type_index, &dedicated_info, &mapping);
+	Assert(memory);
+
+	gpu_memory.dedicated_count++;
+	gpu_memory.dedicated_bytes += size;
+	gpu_memory.allocation_count++;
+
+	return {
+		.memory  = memory,
+		.offset  = 0,
+		.size    = size,
+		.mapping = mapping,
+		.pool    = GPU_MEMORY_DEDICATED,
+	};
+}
+
+static GpuAllocation AllocateGpuMemory(VkMemoryRequirements2* requirements, VkMemoryDedicatedRequirements* dedicated,
+                                       VkMemoryPropertyFlags properties, GpuResourceKind kind, VkBuffer buffer, VkImage image) {
+	VkMemoryRequirements memreq = requirements->memoryRequirements;
+	u32 type_index = device.FindMemoryType(memreq.memoryTypeBits, properties);
+
+	u64 size      = memreq.size;
+	u64 alignment = Max((u64)memreq.alignment, (u64)1);
+
+	// Flushes and invalidates of memory that isn't coherent go by whole atoms, which mustn't reach a neighbor.
+	VkMemoryPropertyFlags type_flags = device.memory_properties.memoryTypes[type_index].propertyFlags;
+	if ((type_flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(type_flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+		alignment = Max(alignment, gpu_memory.non_coherent_atom);
+		size = AlignGpuMemory(size, gpu_memory.non_coherent_atom);
+	}
+
+	u32 pool_index = type_index * 2 + (gpu_memory.separate_kinds ? kind : 0);
+	GpuMemoryPool* pool = &gpu_memory.pools[pool_index];
+
+	// The padding is only for sharing blocks, dedicated memory has to be exactly the size the resource asked for.
+	if (dedicated->prefersDedicatedAllocation || dedicated->requiresDedicatedAllocation || size > pool->block_size / 2)
+		return AllocateDedicated(memreq.size, type_index, buffer, image);
+
+	u32 block_index = 0;
+	u32 node = TLSF_NONE;
+
+	for (; block_index < pool->blocks.count; block_index++) {
+		GpuMemoryBlock* block = pool->blocks[block_index];
+
+		if (block && AllocateTlsf(block, size, alignment, &node))
+			break;
+	}
+
+	if (node == TLSF_NONE) {
+		// Smaller blocks when the device is short of memory, then memory of its own as a last try.
+		GpuMemoryBlock* block = null;
+
+		for (u64 block_size = pool->block_size; !block && block_size >= size * 2; block_size /= 2)
+			block = CreateGpuMemoryBlock(pool, block_size);
+
+		if (!block) {
+			LogWarning("Out of memory for % byte blocks of memory type %", pool->block_size, type_index);
+			return AllocateDedicated(memreq.size, type_index, buffer, image);
+		}
+
+		for (block_index = 0; block_index < pool->blocks.count && pool->blocks[block_index]; block_index++);
+
+		if (block_index == pool->blocks.count)
+			pool->blocks.Add(block);
+		else
+			pool->blocks[block_index] = block;
+
+		bool allocated = AllocateTlsf(block, size, alignment, &node);
+		Assert(allocated);
+	}
+
+	GpuMemoryBlock* block = pool->blocks[block_index];
+	TlsfNode* range = &block->nodes[node];
+	gpu_memory.allocation_count++;
+
+	return {
+		.memory  = block->memory,
+		.offset  = range->offset,
+		.size    = range->size,
+		.mapping = block->mapping ? block->mapping + range->offset : null,
+		.pool    = pool_index,
+		.block   = block_index,
+		.node    = node,
+	};
+}
+
+static GpuAllocation AllocateBufferMemory(VkBuffer buffer, VkMemoryPropertyFlags properties) {
+	VkBufferMemoryRequirementsInfo2 info = {
+		.sType  = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2,
+		.buffer = buffer,
+	};
+
+	VkMemoryDedicatedRequirements dedicated = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS,
+	};
+
+	VkMemoryRequirements2 requirements = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2,
+		.pNext = &dedicated,
+	};
+
+	vkGetBufferMemoryRequirements2(device.logical_device, &info, &requirements);
+
+	GpuAllocation allocation = AllocateGpuMemory(&requirements, &dedicated, properties, GPU_RESOURCE_LINEAR, buffer, VK_NULL_HANDLE);
+	VkResult vk_result = vkBindBufferMemory(device.logical_device, buffer, allocation.memory, allocation.offset);
+	Assert(vk_result == VK_SUCCESS);
+
+	return allocation;
+}
+
+static GpuAllocation AllocateImageMemory(VkImage image, VkMemoryPropertyFlags properties) {
+	VkImageMemoryRequirementsInfo2 info = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2,
+		.image = image,
+	};
+
+	VkMemoryDedicatedRequirements dedicated = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS,
+	};
+
+	VkMemoryRequirements2 requirements = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2,
+		.pNext = &dedicated,
+	};
+
+	vkGetImageMemoryRequirements2(device.logical_device, &info, &requirements);
+
+	GpuAllocation allocation = AllocateGpuMemory(&requirements, &dedicated, properties, GPU_RESOURCE_OPTIMAL, VK_NULL_HANDLE, image);
+	VkResult vk_result = vkBindImageMemory(device.logical_device, image, allocation.memory, allocation.offset);
+	Assert(vk_result == VK_SUCCESS);
+
+	return allocation;
+}
+
+static void FreeGpuMemory(GpuAllocation* allocation) {
+	if (!allocation->memory)
+		return;
+
+	gpu_memory.allocation_count--;
+
+	if (allocation->pool == GPU_MEMORY_DEDICATED) {
+		vkFreeMemory(device.logical_device, allocation->memory, null);
+		gpu_memory.dedicated_count--;
+		gpu_memory.dedicated_bytes -= allocation->size;
+		*allocation = { };
+		return;
+	}
+
+	GpuMemoryPool*  pool  = &gpu_memory.pools[allocation->pool];
+	GpuMemoryBlock* block = pool->blocks[allocation->block];
+	FreeTlsf(block, allocation->node);
+
+	// An empty block is kept only while it's the pool's last, so freeing and allocating again doesn't thrash.
+	if (!block->allocation_count) {
+		u32 live_blocks = 0;
+		for (GpuMemoryBlock* other : pool->blocks)
+			live_blocks += other != null;
+
+		if (live_blocks > 1) {
+			DestroyGpuMemoryBlock(block);
+			pool->blocks[allocation->block] = null;
+		}
+	}
+
+	*allocation = { };
+}
+
+static GpuMemoryStats GetGpuMemoryStats() {
+	GpuMemoryStats stats = {
+		.allocations     = gpu_memory.allocation_count,
+		.dedicated_count = gpu_memory.dedicated_count,
+		.dedicated_bytes = gpu_memory.dedicated_bytes,
+	};
+
+	for (GpuMemoryPool& pool : gpu_memory.pools) {
+		for (GpuMemoryBlock* block : pool.blocks) {
+			if (!block)
+				continue;
+
+			stats.block_count++;
+			stats.block_bytes      += block->size;
+			stats.block_used_bytes += block->used;
+			stats.largest_free = Max(stats.largest_free, GetLargestTlsfFree(block));
+		}
+	}
+
+	stats.device_allocations = stats.block_count + stats.dedicated_count;
+	return stats;
+}
+
+static void ShutdownGpuMemory() {
+	if (gpu_memory.allocation_count)
+		LogWarning("% GPU memory allocations weren't freed", gpu_memory.allocation_count);
+
+	for (GpuMemoryPool& pool : gpu_memory.pools) {
+		for (GpuMemoryBlock* block : pool.blocks)
+			if (block)
+				DestroyGpuMemoryBlock(block);
+
+		pool.blocks.Free();
+	}
+}
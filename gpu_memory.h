@@ -0,0 +1,56 @@
+#ifndef GPU_MEMORY_H
+#define GPU_MEMORY_H
+
+#include "general.h"
+
+#include <vulkan/vulkan.h>
+
+// Device memory for buffers and images, carved out of big blocks rather than one vkAllocateMemory each: devices
+// allow few allocations (maxMemoryAllocationCount, often 4096) and each one is slow. Every memory type has its
+// own blocks, and inside a block a TLSF allocator finds a free range in constant time. Resources that are big
+// next to a block, or that the driver wants alone, get memory of their own.
+//
+// Buffers and linear images can't share a bufferImageGranularity page with optimal images, so where that's more
+// than a byte they come from separate blocks. Host visible blocks are mapped for as long as they live.
+
+static const u64 GPU_MEMORY_BLOCK_SIZE = 64 << 20; // Heaps of a gigabyte or less get blocks an eighth their size.
+
+enum GpuResourceKind : u8 {
+	GPU_RESOURCE_LINEAR,  // Buffers and linear images.
+	GPU_RESOURCE_OPTIMAL, // Optimal tiling images.
+};
+
+struct GpuAllocation {
+	VkDeviceMemory memory;
+	u64   offset;
+	u64   size;
+	void* mapping; // Where offset is, when the memory is host visible.
+	u32   pool;    // GPU_MEMORY_DEDICATED when it's memory of its own.
+	u32   block;
+	u32   node;
+};
+
+static const u32 GPU_MEMORY_DEDICATED = ~0u;
+
+struct GpuMemoryStats {
+	u32 device_allocations; // vkAllocateMemory calls live, blocks and dedicated together.
+	u32 allocations;        // Buffers and images.
+	u32 block_count;
+	u32 dedicated_count;
+	u64 block_bytes;
+	u64 block_used_bytes;   // Alignment padding included.
+	u64 dedicated_bytes;
+	u64 largest_free;       // The biggest range left in any block.
+};
+
+static void InitGpuMemory();     // After the device.
+static void ShutdownGpuMemory(); // After everything allocated is freed.
+
+// Allocate and bind in one go. Images are taken to be optimal tiling.
+static GpuAllocation AllocateBufferMemory(VkBuffer buffer, VkMemoryPropertyFlags properties);
+static GpuAllocation AllocateImageMemory(VkImage image, VkMemoryPropertyFlags properties);
+static void          FreeGpuMemory(GpuAllocation* allocation);
+
+static GpuMemoryStats GetGpuMemoryStats();
+
+#endif // GPU_MEMORY_H
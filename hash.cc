@@ -0,0 +1,69 @@
+#include "hash.h"
+
+static const u64 XXH_PRIME1 = 0x9E3779B185EBCA87;
+static const u64 XXH_PRIME2 = 0xC2B2AE3D27D4EB4F;
+static const u64 XXH_PRIME3 = 0x165667B19E3779F9;
+static const u64 XXH_PRIME4 = 0x85EBCA77C2B2AE63;
+static const u64 XXH_PRIME5 = 0x27D4EB2F165667C5;
+
+static inline u64 RotateLeft(u64 x, u32 n) { return (x << n) | (x >> (64 - n)); }
+
+static inline u64 ReadU64(const byte* p) { u64 n; CopyMemory(&n, p, 8); return n; }
+static inline u32 ReadU32(const byte* p) { u32 n; CopyMemory(&n, p, 4); return n; }
+
+static inline u64 HashRound(u64 acc, u64 input) {
+	return RotateLeft(acc + input * XXH_PRIME2, 31) * XXH_PRIME1;
+}
+
+static inline u64 HashMergeRound(u64 acc, u64 lane) {
+	return (acc ^ HashRound(0, lane)) * XXH_PRIME1 + XXH_PRIME4;
+}
+
+static u64 Hash64(const void* data, u64 size, u64 seed) {
+	const byte* p   = (const byte*)data;
+	const byte* end = p + size;
+	u64 h;
+
+	if (size >= 32) {
+		u64 v1 = seed + XXH_PRIME1 + XXH_PRIME2;
+		u64 v2 = seed + XXH_PRIME2;
+		u64 v3 = seed;
+		u64 v4 = seed - XXH_PRIME1;
+
+		for (; p + 32 <= end; p += 32) {
+			v1 = HashRound(v1, ReadU64(p));
+			v2 = HashRound(v2, ReadU64(p + 8));
+			v3 = HashRound(v3, ReadU64(p + 16));
+			v4 = HashRound(v4, ReadU64(p + 24));
+		}
+
+		h = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+		h = HashMergeRound(h, v1);
+		h = HashMergeRound(h, v2);
+		h = HashMergeRound(h, v3);
+		h = HashMergeRound(h, v4);
+	}
+	else {
+		h = seed + XXH_PRIME5;
+	}
+
+	h += size;
+
+	for (; p + 8 <= end; p += 8)
+		h = RotateLeft(h ^ HashRound(0, ReadU64(p)), 27) * XXH_PRIME1 + XXH_PRIME4;
+
+	if (p + 4 <= end) {
+		h = RotateLeft(h ^ (ReadU32(p) * XXH_PRIME1), 23) * XXH_PRIME2 + XXH_PRIME3;
+		p += 4;
+	}
+
+	for (; p < end; p++)
+		h = RotateLeft(h ^ (*p * XXH_PRIME5), 11) * XXH_PRIME1;
+
+	h ^= h >> 33;
+	h *= XXH_PRIME2;
+	h ^= h >> 29;
+	h *= XXH_PRIME3;
+	h ^= h >> 32;
+	return h;
+}
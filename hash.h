@@ -0,0 +1,11 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include "general.h"
+
+// XXH64 (Yann Collet), for asset names, checksums and content addresses. Not for anything adversarial.
+// Four independent lanes over 32-byte stripes, so long inputs run at several bytes per cycle.
+
+static u64 Hash64(const void* data, u64 size, u64 seed = 0);
+
+#endif // HASH_H
@@ -1,24 +1,1525 @@
 #include "image.h"
+#include "jobs.h"
+#include "simd.h"
+#include "file_system.h"
+#include "math.h"
+#include "log.h"
+#include "compress.h"
+#include "pixels.h"
 
-void* njAllocMem(int size) {
-	return AllocMemory(sizeof(int) + size) + sizeof(int);
+static Image* AllocImage(u64 data_size) {
+	Image* image = (Image*)AllocMemory(sizeof(Image) + data_size);
+	return image;
 }
 
-void njFreeMem(void* block) {
-	int* p = (int*)block - 1;
-	FreeMemory(p, *p);
+static void FreeImage(Image* image) {
+	if (image)
+		FreeMemory(image, sizeof(Image) + image->GetSize());
 }
 
-void njFillMem(void* block, unsigned char b, int size) { SetMemory(block, b,   size); }
-void njCopyMem(void* dest,  const void* src, int size) { CopyMemory(dest, src, size); }
+// 16384 x 16384. Headers saying more are taken as corrupt rather than trying to allocate gigabytes.
+static const u64 IMAGE_MAX_PIXELS = 1 << 28;
+
+static u32 ReadBigEndianU16(const u8* p) {
+	return p[0] << 8 | p[1];
+}
 
-#include "nanojpeg.c"
+static u32 ReadBigEndianU32(const u8* p) {
+	return (u32)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
 
-static Image* AllocImage(u64 data_size) {
-	Image* image = AllocMemory(sizeof(Image) + data_size);
+//
+// JPEG. Everything about one image is parsed and allocated up front on the calling thread, then the entropy
+// coded data is decoded a restart interval segment at a time (the Huffman state and the DC predictions start
+// over at each restart marker, so the segments are independent) and converted to RGBA a band of rows at a
+// time, both as jobs. An image without restart markers is a single segment.
+//
+
+enum : u8 {
+	JPEG_SOF0 = 0xC0, // Baseline.
+	JPEG_SOF1 = 0xC1, // Extended sequential.
+	JPEG_SOF2 = 0xC2, // Progressive.
+	JPEG_DHT  = 0xC4,
+	JPEG_RST0 = 0xD0,
+	JPEG_RST7 = 0xD7,
+	JPEG_SOI  = 0xD8,
+	JPEG_EOI  = 0xD9,
+	JPEG_SOS  = 0xDA,
+	JPEG_DQT  = 0xDB,
+	JPEG_DRI  = 0xDD,
+};
+
+static const u32 JPEG_MAX_COMPONENTS = 3;
+static const u32 JPEG_LOOKUP_BITS    = 9;
+static const u32 JPEG_BAND_ROWS      = 64; // Rows converted per job.
+
+// Zigzag position to row major position.
+static const u8 jpeg_zigzag[64] = {
+	 0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+	12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+	35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+	58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+// cos(k * pi / 16) * sqrt(2), 1 for k = 0. The AAN IDCT leaves these out, so they're folded into the dequantization.
+static const f32 jpeg_aan_scale[8] = {
+	1.0f, 1.387039845f, 1.306562965f, 1.175875602f, 1.0f, 0.785694958f, 0.541196100f, 0.275899379f,
+};
+
+struct JpegHuffman {
+	u16 lookup[1 << JPEG_LOOKUP_BITS]; // Length << 8 | symbol for codes up to JPEG_LOOKUP_BITS long, 0 for longer ones.
+	s32 max_code[17];                  // Largest code of each length, -1 if there are none.
+	s32 value_offset[17];              // Code of a length to its index in symbols.
+	u8  symbols[256];
+	bool is_defined;
+};
+
+struct JpegComponent {
+	u32 id;
+	u32 h, v;           // Sampling factors, in blocks per MCU.
+	u32 quant;
+	u32 dc_table;
+	u32 ac_table;
+	u32 stride;         // Bytes per row of the plane, a multiple of 8.
+	u32 rows;
+	u8* plane;          // Decoded samples, padded out to whole MCUs.
+};
+
+struct JpegSegment {
+	const u8* begin;
+	const u8* end;      // Without the restart marker.
+};
+
+struct JpegDecoder {
+	u32 width, height;
+	u32 component_count;
+	JpegComponent components[JPEG_MAX_COMPONENTS];
+	u32 h_max, v_max;
+	u32 mcus_x, mcus_y;
+	u32 restart_interval; // MCUs per segment, all of them without restart markers.
+	alignas(32) f32 quant[4][64]; // Row major, scaled for the IDCT.
+	JpegHuffman dc[4];
+	JpegHuffman ac[4];
+	JpegSegment* segments;
+	u32 segment_count;
+	u8* scratch;          // Per band room for upsampled rows, after the planes.
+	u64 scratch_size;     // Per band.
+	u64 planes_size;      // The planes and the scratch.
+	Image* image;
+};
+
+static bool BuildJpegHuffman(JpegHuffman* table, const u8* counts, const u8* symbols, u32 symbol_count) {
+	ZeroMemory(table, sizeof(JpegHuffman));
+	CopyMemory(table->symbols, symbols, symbol_count);
+
+	u32 code = 0;
+	u32 k = 0;
+
+	for (u32 length = 1; length <= 16; length++) {
+		u32 count = counts[length - 1];
+
+		// Checked before filling the lookup, a code that doesn't fit would index past it.
+		if (code + count > 1u << length)
+			return false; // More codes than fit in this length.
+
+		table->value_offset[length] = (s32)k - (s32)code;
+		table->max_code[length] = count ? code + count - 1 : -1;
+
+		for (u32 i = 0; i < count; i++, code++, k++) {
+			if (length <= JPEG_LOOKUP_BITS) {
+				u32 shift = JPEG_LOOKUP_BITS - length;
+				u16 entry = length << 8 | symbols[k];
+
+				for (u32 j = 0; j < 1u << shift; j++)
+					table->lookup[(code << shift) + j] = entry;
+			}
+		}
+
+		code <<= 1;
+	}
+
+	table->is_defined = true;
+	return true;
+}
+
+// Reads the tables and the frame and finds the segments of the scan. Allocates the planes and the image.
+static bool ParseJpeg(JpegDecoder* decoder, const u8* data, u64 size) {
+	const u8* p   = data;
+	const u8* end = data + size;
+
+	if (size < 4 || p[0] != 0xFF || p[1] != JPEG_SOI)
+		return false;
+
+	p += 2;
+	bool has_frame = false;
+
+	while (true) {
+		// Markers can be padded with any number of 0xFF.
+		while (p < end && *p == 0xFF && p + 1 < end && p[1] == 0xFF)
+			p++;
+
+		if (end - p < 4 || p[0] != 0xFF)
+			return false;
+
+		u8 marker = p[1];
+		u32 length = ReadBigEndianU16(p + 2);
+		const u8* segment = p + 4;
+
+		if (length < 2 || (u64)(end - segment) < length - 2)
+			return false;
+
+		p = segment + length - 2;
+		const u8* segment_end = p;
+
+		if (marker == JPEG_DQT) {
+			while (segment < segment_end) {
+				u32 precision = segment[0] >> 4;
+				u32 index     = segment[0] & 15;
+				u32 bytes     = precision ? 2 : 1;
+
+				if (index > 3 || segment + 1 + 64 * bytes > segment_end)
+					return false;
+
+				for (u32 k = 0; k < 64; k++) {
+					u32 q = bytes == 2 ? ReadBigEndianU16(segment + 1 + k * 2) : segment[1 + k];
+					u32 i = jpeg_zigzag[k];
+					decoder->quant[index][i] = q * jpeg_aan_scale[i >> 3] * jpeg_aan_scale[i & 7] * 0.125f;
+				}
+
+				segment += 1 + 64 * bytes;
+			}
+		}
+		else if (marker == JPEG_DHT) {
+			while (segment < segment_end) {
+				if (segment_end - segment < 17)
+					return false;
+
+				u32 table_class = segment[0] >> 4;
+				u32 index       = segment[0] & 15;
+				const u8* counts = segment + 1;
+
+				u32 symbol_count = 0;
+				for (u32 i = 0; i < 16; i++)
+					symbol_count += counts[i];
+
+				if (table_class > 1 || index > 3 || symbol_count > 256 || segment + 17 + symbol_count > segment_end)
+					return false;
+
+				JpegHuffman* table = table_class ? &decoder->ac[index] : &decoder->dc[index];
+
+				if (!BuildJpegHuffman(table, counts, segment + 17, symbol_count))
+					return false;
+
+				segment += 17 + symbol_count;
+			}
+		}
+		else if (marker == JPEG_DRI) {
+			if (length < 4)
+				return false;
+
+			decoder->restart_interval = ReadBigEndianU16(segment);
+		}
+		else if (marker == JPEG_SOF0 || marker == JPEG_SOF1) {
+			if (length < 8 || segment[0] != 8)
+				return false; // 12 bit samples.
+
+			decoder->height = ReadBigEndianU16(segment + 1);
+			decoder->width  = ReadBigEndianU16(segment + 3);
+			decoder->component_count = segment[5];
+
+			if (!decoder->width || !decoder->height)
+				return false; // A height defined by a DNL marker later on.
+
+			if ((u64)decoder->width * decoder->height > IMAGE_MAX_PIXELS)
+				return false;
+
+			if (decoder->component_count != 1 && decoder->component_count != 3)
+				return false; // CMYK.
+
+			if (length < 8 + decoder->component_count * 3)
+				return false;
+
+			decoder->h_max = 1;
+			decoder->v_max = 1;
+
+			for (u32 i = 0; i < decoder->component_count; i++) {
+				JpegComponent* component = &decoder->components[i];
+				component->id    = segment[6 + i * 3];
+				component->h     = segment[7 + i * 3] >> 4;
+				component->v     = segment[7 + i * 3] & 15;
+				component->quant = segment[8 + i * 3];
+
+				if (component->h < 1 || component->h > 4 || component->v < 1 || component->v > 4 || component->quant > 3)
+					return false;
+
+				decoder->h_max = Max(decoder->h_max, component->h);
+				decoder->v_max = Max(decoder->v_max, component->v);
+			}
+
+			// A single component is never interleaved, its MCU is one block whatever the factors say.
+			if (decoder->component_count == 1) {
+				decoder->components[0].h = 1;
+				decoder->components[0].v = 1;
+				decoder->h_max = 1;
+				decoder->v_max = 1;
+			}
+
+			for (u32 i = 0; i < decoder->component_count; i++) {
+				JpegComponent* component = &decoder->components[i];
+
+				if (decoder->h_max % component->h || decoder->v_max % component->v)
+					return false; // Non integer upsampling.
+			}
+
+			has_frame = true;
+		}
+		else if (marker >= JPEG_SOF2 && marker <= 0xCF && marker != JPEG_DHT && marker != 0xC8 && marker != 0xCC) {
+			return false; // Progressive, lossless, hierarchical or arithmetic coded.
+		}
+		else if (marker == JPEG_SOS) {
+			if (!has_frame || length < 3)
+				return false;
+
+			u32 count = segment[0];
+
+			// Only a single scan with every component, which is all baseline encoders write in practice.
+			if (count != decoder->component_count || length < 6 + count * 2)
+				return false;
+
+			for (u32 i = 0; i < count; i++) {
+				JpegComponent* component = &decoder->components[i];
+
+				if (segment[1 + i * 2] != component->id)
+					return false;
+
+				component->dc_table = segment[2 + i * 2] >> 4;
+				component->ac_table = segment[2 + i * 2] & 15;
+
+				if (component->dc_table > 3 || component->ac_table > 3)
+					return false;
+
+				if (!decoder->dc[component->dc_table].is_defined || !decoder->ac[component->ac_table].is_defined)
+					return false;
+			}
+
+			break;
+		}
+		else if (marker == JPEG_EOI) {
+			return false;
+		}
+	}
+
+	decoder->mcus_x = (decoder->width  + decoder->h_max * 8 - 1) / (decoder->h_max * 8);
+	decoder->mcus_y = (decoder->height + decoder->v_max * 8 - 1) / (decoder->v_max * 8);
+
+	u32 mcu_count = decoder->mcus_x * decoder->mcus_y;
+	u64 block_count = 0;
+
+	for (u32 i = 0; i < decoder->component_count; i++)
+		block_count += (u64)decoder->components[i].h * decoder->components[i].v * mcu_count;
+
+	// A block is at least two bits, its DC difference and end of block codes, so the scan can't be shorter.
+	if (block_count / 4 > (u64)(end - p))
+		return false;
+
+	if (!decoder->restart_interval || decoder->restart_interval > mcu_count)
+		decoder->restart_interval = mcu_count;
+
+	decoder->segment_count = (mcu_count + decoder->restart_interval - 1) / decoder->restart_interval;
+	decoder->segments = Alloc<JpegSegment>(decoder->segment_count);
+
+	// Split the scan at the restart markers. Missing segments are left empty and decode as zeros.
+	const u8* begin = p;
+	u32 found = 0;
+
+	while (found < decoder->segment_count) {
+		const u8* marker = (const u8*)__builtin_memchr(p, 0xFF, end - p);
+
+		if (!marker || marker + 1 >= end) {
+			decoder->segments[found++] = { begin, end };
+			break;
+		}
+
+		const u8* next = marker + 1;
+
+		while (next < end && *next == 0xFF)
+			next++;
+
+		if (next == end || *next == 0x00) {
+			p = next + 1;
+			continue;
+		}
+
+		decoder->segments[found++] = { begin, marker };
+
+		if (*next < JPEG_RST0 || *next > JPEG_RST7)
+			break;
+
+		begin = p = next + 1;
+	}
+
+	for (u32 i = found; i < decoder->segment_count; i++)
+		decoder->segments[i] = { end, end };
+
+	decoder->planes_size = 0;
+	decoder->scratch_size = ((decoder->width + 16) & ~15) * (JPEG_MAX_COMPONENTS + 2);
+
+	for (u32 i = 0; i < decoder->component_count; i++) {
+		JpegComponent* component = &decoder->components[i];
+		component->stride = decoder->mcus_x * component->h * 8;
+		component->rows   = decoder->mcus_y * component->v * 8;
+		decoder->planes_size += (u64)component->stride * component->rows;
+	}
+
+	if (decoder->component_count > 1)
+		decoder->planes_size += decoder->scratch_size * ((decoder->height + JPEG_BAND_ROWS - 1) / JPEG_BAND_ROWS);
+
+	u8* planes = (u8*)AllocMemory(decoder->planes_size);
+
+	for (u32 i = 0; i < decoder->component_count; i++) {
+		JpegComponent* component = &decoder->components[i];
+		component->plane = planes;
+		planes += (u64)component->stride * component->rows;
+	}
+
+	decoder->scratch = planes;
+
+	decoder->image = AllocImage((u64)decoder->width * decoder->height * 4);
+	decoder->image->channels = 4;
+	decoder->image->has_alpha_channel = false;
+	decoder->image->width  = decoder->width;
+	decoder->image->height = decoder->height;
+	return true;
+}
+
+static void FreeJpegDecoder(JpegDecoder* decoder) {
+	if (decoder->segments)
+		Free(decoder->segments, decoder->segment_count);
+
+	if (decoder->planes_size)
+		FreeMemory(decoder->components[0].plane, decoder->planes_size);
+
+	decoder->segments = null;
+	decoder->planes_size = 0;
+}
+
+// Bits are taken from the top of buffer. Stuffed zero bytes are dropped on the way in, and past the end of the
+// segment it reads zeros, so corrupt data decodes to garbage instead of running off.
+struct JpegBits {
+	const u8* p;
+	const u8* end;
+	u64 buffer;
+	u32 count;
+};
+
+static inline void RefillJpegBits(JpegBits* bits) {
+	// Whole bytes at once when there isn't an 0xFF among the next 8, which is nearly always.
+	if (bits->end - bits->p >= 8) {
+		u64 word;
+		CopyMemory(&word, bits->p, 8);
+		word = __builtin_bswap64(word);
+
+		u64 inverted = ~word;
+		if (!((inverted - 0x0101010101010101) & ~inverted & 0x8080808080808080)) {
+			u32 bytes = (63 - bits->count) >> 3;
+			u32 total = bits->count + bytes * 8;
+			bits->buffer |= (word >> bits->count) & ~(~0ull >> total);
+			bits->count = total;
+			bits->p += bytes;
+			return;
+		}
+	}
+
+	while (bits->count <= 56) {
+		u64 byte = 0;
+
+		if (bits->p < bits->end) {
+			byte = *bits->p++;
+
+			if (byte == 0xFF)
+				bits->p++;
+		}
+
+		bits->buffer |= byte << (56 - bits->count);
+		bits->count += 8;
+	}
+}
+
+static inline void ConsumeJpegBits(JpegBits* bits, u32 count) {
+	bits->buffer <<= count;
+	bits->count -= count;
+}
+
+static inline u32 DecodeJpegSymbol(JpegBits* bits, const JpegHuffman* table) {
+	if (bits->count < 16)
+		RefillJpegBits(bits);
+
+	u32 entry = table->lookup[bits->buffer >> (64 - JPEG_LOOKUP_BITS)];
+
+	if (entry) {
+		ConsumeJpegBits(bits, entry >> 8);
+		return entry & 255;
+	}
+
+	for (u32 length = JPEG_LOOKUP_BITS + 1; length <= 16; length++) {
+		s32 code = bits->buffer >> (64 - length);
+
+		if (code <= table->max_code[length]) {
+			ConsumeJpegBits(bits, length);
+			return table->symbols[(code + table->value_offset[length]) & 255];
+		}
+	}
+
+	ConsumeJpegBits(bits, 16); // Not a code, corrupt.
+	return 0;
+}
+
+// The next size bits as a signed coefficient: the top bit clear means negative.
+static inline s32 ReceiveJpegValue(JpegBits* bits, u32 size) {
+	if (!size)
+		return 0;
+
+	if (bits->count < size)
+		RefillJpegBits(bits);
+
+	s32 value = bits->buffer >> (64 - size);
+	ConsumeJpegBits(bits, size);
+	return value < 1 << (size - 1) ? value - (1 << size) + 1 : value;
+}
+
+// One dimensional AAN IDCT (as in libjpeg's jidctflt.c) on 8 blocks at once, a lane each.
+static inline void JpegIdct8(f32x8 v[8]) {
+	f32x8 tmp10 = v[0] + v[4];
+	f32x8 tmp11 = v[0] - v[4];
+	f32x8 tmp13 = v[2] + v[6];
+	f32x8 tmp12 = (v[2] - v[6]) * 1.414213562f - tmp13;
+
+	f32x8 tmp0 = tmp10 + tmp13;
+	f32x8 tmp3 = tmp10 - tmp13;
+	f32x8 tmp1 = tmp11 + tmp12;
+	f32x8 tmp2 = tmp11 - tmp12;
+
+	f32x8 z13 = v[5] + v[3];
+	f32x8 z10 = v[5] - v[3];
+	f32x8 z11 = v[1] + v[7];
+	f32x8 z12 = v[1] - v[7];
+
+	f32x8 tmp7 = z11 + z13;
+	f32x8 z5   = (z10 + z12) * 1.847759065f;
+	f32x8 tmp6 = z5 - z10 * 2.613125930f - tmp7;
+	f32x8 tmp5 = (z11 - z13) * 1.414213562f - tmp6;
+	f32x8 tmp4 = z12 * 1.082392200f - z5 + tmp5;
+
+	v[0] = tmp0 + tmp7;
+	v[7] = tmp0 - tmp7;
+	v[1] = tmp1 + tmp6;
+	v[6] = tmp1 - tmp6;
+	v[2] = tmp2 + tmp5;
+	v[5] = tmp2 - tmp5;
+	v[4] = tmp3 + tmp4;
+	v[3] = tmp3 - tmp4;
+}
+
+// Dequantizes a row major block of coefficients and writes its 8x8 samples.
+static void JpegIdctBlock(const s32* coefficients, const f32* quant, u8* out, u32 stride) {
+	f32x8 m[8];
+
+	for (u32 row = 0; row < 8; row++)
+		m[row] = __builtin_convertvector(LoadVector<s32x8>(coefficients + row * 8), f32x8) * LoadF32x8(quant + row * 8);
+
+	JpegIdct8(m);     // Columns: m[y] is row y, lanes are horizontal frequencies.
+	Transpose8x8(m);
+	JpegIdct8(m);     // Rows: m[x] is column x, lanes are rows.
+	Transpose8x8(m);
+
+	for (u32 y = 0; y < 8; y++) {
+		f32x8 sample = MinF32x8(MaxF32x8(m[y] + 128.5f, BroadcastF32x8(0.0f)), BroadcastF32x8(255.0f));
+		u8x8 bytes = __builtin_convertvector(__builtin_convertvector(sample, s32x8), u8x8);
+		StoreVector(out + y * stride, bytes);
+	}
+}
+
+static void DecodeJpegSegment(JpegDecoder* decoder, u32 index) {
+	JpegSegment* segment = &decoder->segments[index];
+	JpegBits bits = { .p = segment->begin, .end = segment->end, .buffer = 0, .count = 0 };
+	s32 predictions[JPEG_MAX_COMPONENTS] = { };
+	alignas(32) s32 coefficients[64];
+
+	u32 first = index * decoder->restart_interval;
+	u32 last  = Min(first + decoder->restart_interval, decoder->mcus_x * decoder->mcus_y);
+
+	for (u32 mcu = first; mcu < last; mcu++) {
+		u32 mcu_x = mcu % decoder->mcus_x;
+		u32 mcu_y = mcu / decoder->mcus_x;
+
+		for (u32 c = 0; c < decoder->component_count; c++) {
+			JpegComponent* component = &decoder->components[c];
+			const JpegHuffman* dc = &decoder->dc[component->dc_table];
+			const JpegHuffman* ac = &decoder->ac[component->ac_table];
+
+			for (u32 by = 0; by < component->v; by++) {
+				for (u32 bx = 0; bx < component->h; bx++) {
+					ZeroMemory(coefficients, sizeof(coefficients));
+
+					predictions[c] += ReceiveJpegValue(&bits, DecodeJpegSymbol(&bits, dc) & 15);
+					coefficients[0] = predictions[c];
+					bool has_ac = false;
+
+					for (u32 k = 1; k < 64; ) {
+						u32 symbol = DecodeJpegSymbol(&bits, ac);
+						u32 run  = symbol >> 4;
+						u32 size = symbol & 15;
+
+						if (!size) {
+							if (run != 15)
+								break; // End of block.
+
+							k += 16;
+							continue;
+						}
+
+						k += run;
+
+						if (k > 63)
+							break;
+
+						coefficients[jpeg_zigzag[k++]] = ReceiveJpegValue(&bits, size);
+						has_ac = true;
+					}
+
+					u32 x = (mcu_x * component->h + bx) * 8;
+					u32 y = (mcu_y * component->v + by) * 8;
+					u8* out = component->plane + (u64)y * component->stride + x;
+					const f32* quant = decoder->quant[component->quant];
+
+					if (has_ac) {
+						JpegIdctBlock(coefficients, quant, out, component->stride);
+					}
+					else {
+						// Flat, common in smooth areas and at low quality.
+						u8 sample = Clamp((s32)(coefficients[0] * quant[0] + 128.5f), 0, 255);
+
+						for (u32 row = 0; row < 8; row++)
+							SetMemory(out + row * component->stride, sample, 8);
+					}
+				}
+			}
+		}
+	}
+}
+
+// Row y of a component at full width. Twice subsampled directions are interpolated between the nearest two
+// samples with 3/4 and 1/4 weights like libjpeg's fancy upsampling, other factors repeat samples.
+static void UpsampleJpegRow(JpegDecoder* decoder, JpegComponent* component, u32 y, u16* scratch, u8* out) {
+	u32 sx = decoder->h_max / component->h;
+	u32 sy = decoder->v_max / component->v;
+	u32 width  = (decoder->width  + sx - 1) / sx;
+	u32 height = (decoder->height + sy - 1) / sy;
+
+	// Vertically, into scratch at 4 times the scale.
+	const u8* near = component->plane + (u64)(y / sy) * component->stride;
+
+	if (sy == 2) {
+		u32 near_row = y >> 1;
+		u32 far_row  = y & 1 ? Min(near_row + 1, height - 1) : (near_row ? near_row - 1 : 0);
+		const u8* far = component->plane + (u64)far_row * component->stride;
+
+		for (u32 x = 0; x < width; x++)
+			scratch[x] = near[x] * 3 + far[x];
+	}
+	else {
+		for (u32 x = 0; x < width; x++)
+			scratch[x] = near[x] * 4;
+	}
+
+	if (sx == 2) {
+		out[0] = (scratch[0] * 4 + 8) >> 4;
+
+		for (u32 x = 0; x + 1 < width; x++) {
+			out[x * 2 + 1] = (scratch[x] * 3 + scratch[x + 1] + 7) >> 4;
+			out[x * 2 + 2] = (scratch[x + 1] * 3 + scratch[x] + 8) >> 4;
+		}
+
+		if (width * 2 <= decoder->width)
+			out[width * 2 - 1] = (scratch[width - 1] * 4 + 7) >> 4;
+	}
+	else {
+		for (u32 x = 0; x < decoder->width; x++)
+			out[x] = (scratch[x / sx] + 2) >> 2;
+	}
+}
+
+// The usual JFIF conversion in 16.16 fixed point, rounded like libjpeg.
+static void ConvertYCbCrRow(const u8* luma, const u8* blue, const u8* red, u32* out, u32 width) {
+	s32x8 zero = { };
+	s32x8 full = zero + 255;
+	u32 x = 0;
+
+	for (; x + 8 <= width; x += 8) {
+		s32x8 y  = __builtin_convertvector(LoadU8x8(luma + x), s32x8);
+		s32x8 cb = __builtin_convertvector(LoadU8x8(blue + x), s32x8) - 128;
+		s32x8 cr = __builtin_convertvector(LoadU8x8(red + x), s32x8) - 128;
+
+		s32x8 r = y + ((91881 * cr + 32768) >> 16);
+		s32x8 g = y + ((-22554 * cb - 46802 * cr + 32768) >> 16);
+		s32x8 b = y + ((116130 * cb + 32768) >> 16);
+
+		r = r < zero ? zero : r > full ? full : r;
+		g = g < zero ? zero : g > full ? full : g;
+		b = b < zero ? zero : b > full ? full : b;
+
+		StoreU32x8(out + x, (u32x8)r | (u32x8)g << 8 | (u32x8)b << 16 | 0xFF000000);
+	}
+
+	for (; x < width; x++) {
+		s32 cb = blue[x] - 128;
+		s32 cr = red[x]  - 128;
+		s32 r = Clamp(luma[x] + ((91881 * cr + 32768) >> 16), 0, 255);
+		s32 g = Clamp(luma[x] + ((-22554 * cb - 46802 * cr + 32768) >> 16), 0, 255);
+		s32 b = Clamp(luma[x] + ((116130 * cb + 32768) >> 16), 0, 255);
+		out[x] = r | g << 8 | b << 16 | 0xFF000000;
+	}
+}
+
+static void ConvertJpegBand(JpegDecoder* decoder, u32 band) {
+	u32 width  = decoder->width;
+	u32 first  = band * JPEG_BAND_ROWS;
+	u32 last   = Min(first + JPEG_BAND_ROWS, decoder->height);
+	u32* pixels = (u32*)decoder->image->data;
+
+	if (decoder->component_count == 1) {
+		JpegComponent* component = &decoder->components[0];
+
+		for (u32 y = first; y < last; y++) {
+			const u8* row = component->plane + (u64)y * component->stride;
+			u32* out = pixels + (u64)y * width;
+
+			for (u32 x = 0; x < width; x++)
+				out[x] = row[x] * 0x010101 | 0xFF000000;
+		}
+
+		return;
+	}
+
+	u64  row_size = (width + 16) & ~15;
+	u8*  rows     = decoder->scratch + band * decoder->scratch_size;
+	u16* scratch  = (u16*)(rows + row_size * JPEG_MAX_COMPONENTS);
+
+	for (u32 y = first; y < last; y++) {
+		const u8* samples[JPEG_MAX_COMPONENTS];
+
+		for (u32 c = 0; c < JPEG_MAX_COMPONENTS; c++) {
+			JpegComponent* component = &decoder->components[c];
+
+			if (component->h == decoder->h_max && component->v == decoder->v_max) {
+				samples[c] = component->plane + (u64)y * component->stride;
+			}
+			else {
+				u8* row = rows + row_size * c;
+				UpsampleJpegRow(decoder, component, y, scratch, row);
+				samples[c] = row;
+			}
+		}
+
+		ConvertYCbCrRow(samples[0], samples[1], samples[2], pixels + (u64)y * width, width);
+	}
+}
+
+// Parsing only. The decoder is empty afterwards when it failed.
+static bool BeginJpeg(JpegDecoder* decoder, const u8* data, u64 size) {
+	if (ParseJpeg(decoder, data, size))
+		return true;
+
+	FreeJpegDecoder(decoder);
+	FreeImage(decoder->image);
+	ZeroMemory(decoder, sizeof(JpegDecoder));
+	return false;
+}
+
+//
+// PNG. The zlib stream of all the IDAT chunks is inflated at once into a buffer of filtered rows, which are
+// unfiltered in place and expanded to RGBA. Non-interlaced 8 bit RGBA, the usual case, unfilters straight into
+// the image instead. Every color type, bit depth and Adam7 interlacing are supported, 16 bit samples are cut to 8.
+// The CRCs aren't checked.
+//
+
+static const u8 png_signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+enum : u8 {
+	PNG_COLOR_GRAY       = 0,
+	PNG_COLOR_RGB        = 2,
+	PNG_COLOR_PALETTE    = 3,
+	PNG_COLOR_GRAY_ALPHA = 4,
+	PNG_COLOR_RGBA       = 6,
+};
+
+enum : u8 {
+	PNG_FILTER_NONE,
+	PNG_FILTER_SUB,
+	PNG_FILTER_UP,
+	PNG_FILTER_AVERAGE,
+	PNG_FILTER_PAETH,
+};
+
+// The seven Adam7 passes: first column and row, then the steps between them.
+static const u8 png_adam7[7][4] = {
+	{ 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 }, { 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 },
+};
+
+struct PngDecoder {
+	u32 width, height;
+	u32 bit_depth;
+	u32 color_type;
+	u32 channels;
+	bool is_interlaced;
+	bool has_key;         // tRNS for gray and RGB: pixels of exactly this color are transparent.
+	u16  key[3];
+	u32  palette[256];    // RGBA in memory order.
+	const u8* compressed; // The zlib stream, gathered from the IDAT chunks when there's more than one.
+	u64 compressed_size;
+	u8* gathered;
+	u8* raw;              // Filtered rows, each after its filter byte.
+	u64 raw_size;
+	Image* image;
+	bool failed;          // The stream was corrupt, found on a job thread.
+};
+
+static u32 GetPngPassWidth(PngDecoder* png, u32 pass) {
+	if (!png->is_interlaced)
+		return pass ? 0 : png->width;
+
+	u32 x0 = png_adam7[pass][0], dx = png_adam7[pass][2];
+	return png->width > x0 ? (png->width - x0 + dx - 1) / dx : 0;
+}
+
+static u32 GetPngPassHeight(PngDecoder* png, u32 pass) {
+	if (!png->is_interlaced)
+		return pass ? 0 : png->height;
+
+	u32 y0 = png_adam7[pass][1], dy = png_adam7[pass][3];
+	return png->height > y0 ? (png->height - y0 + dy - 1) / dy : 0;
+}
+
+static u64 GetPngRowBytes(PngDecoder* png, u32 width) {
+	return ((u64)width * png->channels * png->bit_depth + 7) / 8;
+}
+
+static bool ParsePng(PngDecoder* png, const u8* data, u64 size) {
+	if (size < 8 + 25 || !CompareMemory(data, png_signature, 8))
+		return false;
+
+	const u8* end = data + size;
+	u32 chunk_count = 0;
+	u32 idat_count  = 0;
+	u32 palette_size = 0;
+	u64 compressed_size = 0;
+	const u8* first_idat = null;
+
+	for (u32 i = 0; i < 256; i++)
+		png->palette[i] = 0xFF000000;
+
+	for (const u8* p = data + 8; end - p >= 12; ) {
+		u32 length = ReadBigEndianU32(p);
+		const u8* type = p + 4;
+		const u8* chunk = p + 8;
+
+		if (length > (u64)(end - chunk) - 4)
+			return false;
+
+		p = chunk + length + 4;
+
+		if (chunk_count++ == 0) {
+			if (!CompareMemory(type, "IHDR", 4) || length < 13)
+				return false;
+
+			png->width         = ReadBigEndianU32(chunk);
+			png->height        = ReadBigEndianU32(chunk + 4);
+			png->bit_depth     = chunk[8];
+			png->color_type    = chunk[9];
+			png->is_interlaced = chunk[12];
+
+			if (!png->width || !png->height || (u64)png->width * png->height > IMAGE_MAX_PIXELS)
+				return false;
+
+			if (chunk[10] || chunk[11] || png->is_interlaced > 1)
+				return false; // Unknown compression or filter method.
+
+			u32 depth = png->bit_depth;
+
+			switch (png->color_type) {
+			case PNG_COLOR_GRAY:       png->channels = 1; break;
+			case PNG_COLOR_RGB:        png->channels = 3; break;
+			case PNG_COLOR_PALETTE:    png->channels = 1; break;
+			case PNG_COLOR_GRAY_ALPHA: png->channels = 2; break;
+			case PNG_COLOR_RGBA:       png->channels = 4; break;
+			default: return false;
+			}
+
+			if (depth != 1 && depth != 2 && depth != 4 && depth != 8 && depth != 16)
+				return false;
+
+			if ((png->channels > 1 && depth < 8) || (png->color_type == PNG_COLOR_PALETTE && depth > 8))
+				return false;
+		}
+		else if (CompareMemory(type, "PLTE", 4)) {
+			palette_size = Min(length / 3, 256u);
+
+			for (u32 i = 0; i < palette_size; i++)
+				png->palette[i] = chunk[i * 3] | chunk[i * 3 + 1] << 8 | chunk[i * 3 + 2] << 16 | 0xFF000000;
+		}
+		else if (CompareMemory(type, "tRNS", 4)) {
+			if (png->color_type == PNG_COLOR_PALETTE) {
+				for (u32 i = 0; i < Min(length, 256u); i++)
+					png->palette[i] = (png->palette[i] & 0xFFFFFF) | (u32)chunk[i] << 24;
+
+				png->has_key = true; // Only so the image is marked as having alpha.
+			}
+			else if (png->color_type == PNG_COLOR_GRAY && length >= 2) {
+				png->key[0] = ReadBigEndianU16(chunk);
+				png->has_key = true;
+			}
+			else if (png->color_type == PNG_COLOR_RGB && length >= 6) {
+				for (u32 i = 0; i < 3; i++)
+					png->key[i] = ReadBigEndianU16(chunk + i * 2);
+
+				png->has_key = true;
+			}
+		}
+		else if (CompareMemory(type, "IDAT", 4)) {
+			if (!idat_count++)
+				first_idat = chunk;
+
+			compressed_size += length;
+		}
+		else if (CompareMemory(type, "IEND", 4)) {
+			break;
+		}
+	}
+
+	if (!compressed_size || (png->color_type == PNG_COLOR_PALETTE && !palette_size))
+		return false;
+
+	png->raw_size = 0;
+
+	for (u32 pass = 0; pass < 7; pass++) {
+		u32 width  = GetPngPassWidth(png, pass);
+		u32 height = GetPngPassHeight(png, pass);
+
+		if (width && height)
+			png->raw_size += (1 + GetPngRowBytes(png, width)) * height;
+	}
+
+	// Deflate expands at most 1032 times (258 byte matches at less than 2 bits each), anything more is corrupt.
+	if (png->raw_size / 1032 > compressed_size)
+		return false;
+
+	png->compressed_size = compressed_size;
+
+	if (idat_count == 1) {
+		png->compressed = first_idat;
+	}
+	else {
+		png->gathered = (u8*)AllocMemory(compressed_size);
+		png->compressed = png->gathered;
+		u8* out = png->gathered;
+
+		// The same chunks as above, which have all been checked.
+		for (const u8* p = data + 8; out < png->gathered + compressed_size; ) {
+			u32 length = ReadBigEndianU32(p);
+
+			if (CompareMemory(p + 4, "IDAT", 4)) {
+				CopyMemory(out, p + 8, length);
+				out += length;
+			}
+
+			p += 12 + length;
+		}
+	}
+
+	png->raw = (u8*)AllocMemory(png->raw_size);
+
+	png->image = AllocImage((u64)png->width * png->height * 4);
+	png->image->channels = 4;
+	png->image->has_alpha_channel = png->color_type == PNG_COLOR_GRAY_ALPHA || png->color_type == PNG_COLOR_RGBA || png->has_key;
+	png->image->width  = png->width;
+	png->image->height = png->height;
+	return true;
+}
+
+static void FreePngDecoder(PngDecoder* png) {
+	if (png->gathered)
+		FreeMemory(png->gathered, png->compressed_size);
+
+	if (png->raw)
+		FreeMemory(png->raw, png->raw_size);
+
+	png->gathered = null;
+	png->raw = null;
+}
+
+static inline u8 PngPaeth(u8 a, u8 b, u8 c) {
+	s32 pa = (s32)b - c;
+	s32 pb = (s32)a - c;
+	s32 pc = pa + pb;
+	pa = pa < 0 ? -pa : pa;
+	pb = pb < 0 ? -pb : pb;
+	pc = pc < 0 ? -pc : pc;
+	return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+}
+
+// in and out can be the same row. prior is the unfiltered row above, null for the first row of a pass.
+// bpp is the bytes per pixel the filters look back, at least 1.
+static bool UnfilterPngRow(u32 filter, const u8* in, const u8* prior, u8* out, u64 count, u32 bpp) {
+	if (!prior) {
+		// The row above is zeros: up is none, Paeth picks the left byte and is sub.
+		if (filter == PNG_FILTER_UP)
+			filter = PNG_FILTER_NONE;
+		else if (filter == PNG_FILTER_PAETH)
+			filter = PNG_FILTER_SUB;
+	}
+
+	u64 head = Min((u64)bpp, count);
+
+	// RGBA8, the common case: a whole pixel at a time in a vector, the dependency is on the pixel to the left.
+	if (bpp == 4 && filter != PNG_FILTER_NONE && filter != PNG_FILTER_UP && filter <= PNG_FILTER_PAETH) {
+		s16x4 a = { };
+		s16x4 c = { };
+
+		for (u64 i = 0; i + 4 <= count; i += 4) {
+			s16x4 x = __builtin_convertvector(LoadVector<u8x4>(in + i), s16x4);
+			s16x4 b = prior ? __builtin_convertvector(LoadVector<u8x4>(prior + i), s16x4) : (s16x4){ };
+			s16x4 predicted;
+
+			if (filter == PNG_FILTER_SUB) {
+				predicted = a;
+			}
+			else if (filter == PNG_FILTER_AVERAGE) {
+				predicted = (a + b) >> 1;
+			}
+			else {
+				s16x4 pa = b - c;
+				s16x4 pb = a - c;
+				s16x4 pc = pa + pb;
+				pa = pa < 0 ? -pa : pa;
+				pb = pb < 0 ? -pb : pb;
+				pc = pc < 0 ? -pc : pc;
+				predicted = (pa <= pb) & (pa <= pc) ? a : pb <= pc ? b : c;
+			}
+
+			a = (x + predicted) & 0xFF;
+			c = b;
+			StoreVector(out + i, __builtin_convertvector(a, u8x4));
+		}
+
+		return true;
+	}
+
+	switch (filter) {
+	case PNG_FILTER_NONE:
+		if (in != out)
+			CopyMemory(out, in, count);
+		break;
+
+	case PNG_FILTER_SUB:
+		for (u64 i = 0; i < head; i++)
+			out[i] = in[i];
+
+		for (u64 i = bpp; i < count; i++)
+			out[i] = in[i] + out[i - bpp];
+		break;
+
+	case PNG_FILTER_UP:
+		for (u64 i = 0; i < count; i++)
+			out[i] = in[i] + prior[i];
+		break;
+
+	case PNG_FILTER_AVERAGE:
+		if (prior) {
+			for (u64 i = 0; i < head; i++)
+				out[i] = in[i] + (prior[i] >> 1);
+
+			for (u64 i = bpp; i < count; i++)
+				out[i] = in[i] + ((out[i - bpp] + prior[i]) >> 1);
+		}
+		else {
+			for (u64 i = 0; i < head; i++)
+				out[i] = in[i];
+
+			for (u64 i = bpp; i < count; i++)
+				out[i] = in[i] + (out[i - bpp] >> 1);
+		}
+		break;
+
+	case PNG_FILTER_PAETH:
+		for (u64 i = 0; i < head; i++)
+			out[i] = in[i] + prior[i];
+
+		for (u64 i = bpp; i < count; i++)
+			out[i] = in[i] + PngPaeth(out[i - bpp], prior[i], prior[i - bpp]);
+		break;
+
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+// Sample i of an unfiltered row, at its full bit depth.
+static inline u32 GetPngSample(const u8* row, u64 i, u32 depth) {
+	if (depth == 8)
+		return row[i];
+
+	if (depth == 16)
+		return row[i * 2] << 8 | row[i * 2 + 1];
+
+	u64 bit = i * depth;
+	return (row[bit >> 3] >> (8 - depth - (bit & 7))) & ((1 << depth) - 1);
+}
+
+// count pixels of an unfiltered row to RGBA, step pixels apart.
+static void ExpandPngRow(PngDecoder* png, const u8* row, u32 count, u32* out, u32 step) {
+	u32 depth = png->bit_depth;
+
+	if (depth == 8 && !png->has_key && step == 1) {
+		switch (png->color_type) {
+		case PNG_COLOR_RGB:        ExpandRgbToRgba((u8*)out, row, count);       return;
+		case PNG_COLOR_GRAY:       ExpandGrayToRgba((u8*)out, row, count);      return;
+		case PNG_COLOR_GRAY_ALPHA: ExpandGrayAlphaToRgba((u8*)out, row, count); return;
+		}
+	}
+
+	if (depth == 8 && !png->has_key) {
+		switch (png->color_type) {
+		case PNG_COLOR_RGBA:
+			for (u32 i = 0; i < count; i++, out += step)
+				CopyMemory(out, row + i * 4, 4);
+			return;
+
+		case PNG_COLOR_RGB:
+			for (u32 i = 0; i < count; i++, out += step)
+				*out = row[i * 3] | row[i * 3 + 1] << 8 | row[i * 3 + 2] << 16 | 0xFF000000;
+			return;
+
+		case PNG_COLOR_GRAY:
+			for (u32 i = 0; i < count; i++, out += step)
+				*out = row[i] * 0x010101 | 0xFF000000;
+			return;
+
+		case PNG_COLOR_GRAY_ALPHA:
+			for (u32 i = 0; i < count; i++, out += step)
+				*out = row[i * 2] * 0x010101 | row[i * 2 + 1] << 24;
+			return;
+		}
+	}
+
+	// Everything else a sample at a time: bit depths other than 8, palettes and color keys.
+	u32 shift = depth == 16 ? 8 : 0;
+	u32 scale = depth < 8 ? 255 / ((1 << depth) - 1) : 1; // Gray up to 8 bits.
+
+	for (u32 i = 0; i < count; i++, out += step) {
+		switch (png->color_type) {
+		case PNG_COLOR_PALETTE: {
+			*out = png->palette[GetPngSample(row, i, depth)];
+			break;
+		}
+
+		case PNG_COLOR_GRAY: {
+			u32 gray = GetPngSample(row, i, depth);
+			u32 alpha = png->has_key && gray == png->key[0] ? 0 : 0xFF;
+			*out = ((gray >> shift) * scale) * 0x010101 | alpha << 24;
+			break;
+		}
+
+		case PNG_COLOR_GRAY_ALPHA: {
+			u32 gray  = GetPngSample(row, i * 2, depth) >> shift;
+			u32 alpha = GetPngSample(row, i * 2 + 1, depth) >> shift;
+			*out = gray * 0x010101 | alpha << 24;
+			break;
+		}
+
+		case PNG_COLOR_RGB: {
+			u32 r = GetPngSample(row, i * 3, depth);
+			u32 g = GetPngSample(row, i * 3 + 1, depth);
+			u32 b = GetPngSample(row, i * 3 + 2, depth);
+			u32 alpha = png->has_key && r == png->key[0] && g == png->key[1] && b == png->key[2] ? 0 : 0xFF;
+			*out = (r >> shift) | (g >> shift) << 8 | (b >> shift) << 16 | alpha << 24;
+			break;
+		}
+
+		case PNG_COLOR_RGBA: {
+			u32 pixel = 0;
+
+			for (u32 c = 0; c < 4; c++)
+				pixel |= (GetPngSample(row, i * 4 + c, depth) >> shift) << (c * 8);
+
+			*out = pixel;
+			break;
+		}
+		}
+	}
+}
+
+static void DecodePng(PngDecoder* png) {
+	if (!InflateZlib((const byte*)png->compressed, png->compressed_size, (byte*)png->raw, png->raw_size)) {
+		png->failed = true;
+		return;
+	}
+
+	u32* pixels = (u32*)png->image->data;
+	u32  bpp    = Max(png->channels * png->bit_depth / 8, 1u);
+	bool direct = !png->is_interlaced && png->bit_depth == 8 && png->color_type == PNG_COLOR_RGBA;
+	u8*  row    = png->raw;
+
+	for (u32 pass = 0; pass < 7; pass++) {
+		u32 width  = GetPngPassWidth(png, pass);
+		u32 height = GetPngPassHeight(png, pass);
+
+		if (!width || !height)
+			continue;
+
+		u64 row_bytes = GetPngRowBytes(png, width);
+		u32 x0 = 0, y0 = 0, dx = 1, dy = 1;
+
+		if (png->is_interlaced) {
+			x0 = png_adam7[pass][0];
+			y0 = png_adam7[pass][1];
+			dx = png_adam7[pass][2];
+			dy = png_adam7[pass][3];
+		}
+
+		const u8* prior = null;
+
+		for (u32 y = 0; y < height; y++) {
+			u32 filter = row[0];
+			u8* line = row + 1;
+			u32* out = pixels + (u64)(y0 + y * dy) * png->width + x0;
+
+			if (direct) {
+				if (!UnfilterPngRow(filter, line, prior, (u8*)out, row_bytes, bpp)) {
+					png->failed = true;
+					return;
+				}
+
+				prior = (u8*)out;
+			}
+			else {
+				if (!UnfilterPngRow(filter, line, prior, line, row_bytes, bpp)) {
+					png->failed = true;
+					return;
+				}
+
+				ExpandPngRow(png, line, width, out, dx);
+				prior = line;
+			}
+
+			row += 1 + row_bytes;
+		}
+	}
+}
+
+//
+// QOI, the Quite OK Image format: a byte oriented format that decodes in one pass with no tables besides
+// 64 recent colors. Decodes straight into the image.
+//
+
+static const u32 QOI_HEADER_SIZE = 14;
+static const u32 QOI_PADDING     = 8; // The end marker, seven 0x00 then 0x01.
+
+enum : u8 {
+	QOI_OP_INDEX = 0x00,
+	QOI_OP_DIFF  = 0x40,
+	QOI_OP_LUMA  = 0x80,
+	QOI_OP_RUN   = 0xC0,
+	QOI_OP_RGB   = 0xFE,
+	QOI_OP_RGBA  = 0xFF,
+};
+
+struct QoiDecoder {
+	const u8* data;
+	u64 size;
+	Image* image;
+};
+
+static bool ParseQoi(QoiDecoder* qoi, const u8* data, u64 size) {
+	if (size < QOI_HEADER_SIZE + QOI_PADDING || !CompareMemory(data, "qoif", 4))
+		return false;
+
+	u32 width    = ReadBigEndianU32(data + 4);
+	u32 height   = ReadBigEndianU32(data + 8);
+	u32 channels = data[12];
+
+	if (!width || !height || (u64)width * height > IMAGE_MAX_PIXELS || (channels != 3 && channels != 4))
+		return false;
+
+	if ((u64)width * height / 62 > size - QOI_HEADER_SIZE - QOI_PADDING)
+		return false; // A byte is at most 62 pixels, a run.
+
+	qoi->data = data;
+	qoi->size = size;
+	qoi->image = AllocImage((u64)width * height * 4);
+	qoi->image->channels = 4;
+	qoi->image->has_alpha_channel = channels == 4;
+	qoi->image->width  = width;
+	qoi->image->height = height;
+	return true;
+}
+
+static inline u32 QoiHash(u32 pixel) {
+	u32 r = pixel & 0xFF, g = pixel >> 8 & 0xFF, b = pixel >> 16 & 0xFF, a = pixel >> 24;
+	return (r * 3 + g * 5 + b * 7 + a * 11) & 63;
+}
+
+// Truncated data ends the decode early, and the rest of the pixels repeat the last one, like the reference.
+static void DecodeQoi(QoiDecoder* qoi) {
+	const u8* p   = qoi->data + QOI_HEADER_SIZE;
+	const u8* end = qoi->data + qoi->size - QOI_PADDING; // An op reads at most 5 bytes, so past end is still in the data.
+	u32* out = (u32*)qoi->image->data;
+	u64 count = qoi->image->GetNumPixels();
+
+	u32 index[64] = { };
+	u32 pixel = 0xFF000000;
+	u32 run = 0;
+
+	for (u64 i = 0; i < count; i++) {
+		if (run) {
+			run--;
+		}
+		else if (p < end) {
+			u32 op = *p++;
+
+			if (op == QOI_OP_RGB) {
+				pixel = (pixel & 0xFF000000) | p[0] | p[1] << 8 | p[2] << 16;
+				p += 3;
+			}
+			else if (op == QOI_OP_RGBA) {
+				pixel = p[0] | p[1] << 8 | p[2] << 16 | (u32)p[3] << 24;
+				p += 4;
+			}
+			else if ((op & 0xC0) == QOI_OP_INDEX) {
+				pixel = index[op];
+			}
+			else if ((op & 0xC0) == QOI_OP_DIFF) {
+				u32 r = ((pixel & 0xFF)       + (op >> 4 & 3) - 2) & 0xFF;
+				u32 g = ((pixel >> 8 & 0xFF)  + (op >> 2 & 3) - 2) & 0xFF;
+				u32 b = ((pixel >> 16 & 0xFF) + (op      & 3) - 2) & 0xFF;
+				pixel = (pixel & 0xFF000000) | r | g << 8 | b << 16;
+			}
+			else if ((op & 0xC0) == QOI_OP_LUMA) {
+				u32 next = *p++;
+				s32 dg = (s32)(op & 63) - 32;
+				u32 r = ((pixel & 0xFF)       + dg - 8 + (next >> 4)) & 0xFF;
+				u32 g = ((pixel >> 8 & 0xFF)  + dg) & 0xFF;
+				u32 b = ((pixel >> 16 & 0xFF) + dg - 8 + (next & 15)) & 0xFF;
+				pixel = (pixel & 0xFF000000) | r | g << 8 | b << 16;
+			}
+			else {
+				run = op & 63;
+			}
+
+			index[QoiHash(pixel)] = pixel;
+		}
+
+		out[i] = pixel;
+	}
+}
+
+//
+// Loading any of them. Everything is parsed and allocated on the calling thread, then the decoding runs as jobs:
+// each PNG and QOI image is one job, each JPEG segment another, then the JPEG color conversion bands.
+//
+
+enum ImageFormat : u32 {
+	IMAGE_FORMAT_UNKNOWN,
+	IMAGE_FORMAT_JPEG,
+	IMAGE_FORMAT_PNG,
+	IMAGE_FORMAT_QOI,
+};
+
+struct ImageDecoder {
+	ImageFormat format;
+	Image* image;
+	JpegDecoder jpeg;
+	PngDecoder  png;
+	QoiDecoder  qoi;
+};
+
+struct ImageTask {
+	ImageDecoder* decoder;
+	u32 index;
+};
+
+static ImageFormat GetImageFormat(const u8* data, u64 size) {
+	if (size >= 3 && data[0] == 0xFF && data[1] == JPEG_SOI && data[2] == 0xFF)
+		return IMAGE_FORMAT_JPEG;
+
+	if (size >= 8 && CompareMemory(data, png_signature, 8))
+		return IMAGE_FORMAT_PNG;
+
+	if (size >= 4 && CompareMemory(data, "qoif", 4))
+		return IMAGE_FORMAT_QOI;
+
+	return IMAGE_FORMAT_UNKNOWN;
+}
+
+// Parses and allocates. Null if the format isn't known or supported, or the headers are corrupt.
+static Image* BeginImage(ImageDecoder* decoder, const byte* data, u64 size) {
+	ZeroMemory(decoder, sizeof(ImageDecoder));
+	const u8* bytes = (const u8*)data;
+	decoder->format = GetImageFormat(bytes, size);
+
+	switch (decoder->format) {
+	case IMAGE_FORMAT_JPEG:
+		if (BeginJpeg(&decoder->jpeg, bytes, size))
+			decoder->image = decoder->jpeg.image;
+		break;
+
+	case IMAGE_FORMAT_PNG:
+		if (ParsePng(&decoder->png, bytes, size)) {
+			decoder->image = decoder->png.image;
+		}
+		else {
+			FreePngDecoder(&decoder->png);
+			FreeImage(decoder->png.image);
+		}
+		break;
+
+	case IMAGE_FORMAT_QOI:
+		if (ParseQoi(&decoder->qoi, bytes, size))
+			decoder->image = decoder->qoi.image;
+		break;
+
+	default:
+		break;
+	}
+
+	if (!decoder->image)
+		decoder->format = IMAGE_FORMAT_UNKNOWN;
+
+	return decoder->image;
+}
+
+static void DecodeImageJob(void* context, u32 index) {
+	ImageTask* task = (ImageTask*)context + index;
+	ImageDecoder* decoder = task->decoder;
+
+	switch (decoder->format) {
+	case IMAGE_FORMAT_JPEG: DecodeJpegSegment(&decoder->jpeg, task->index); break;
+	case IMAGE_FORMAT_PNG:  DecodePng(&decoder->png);                      break;
+	case IMAGE_FORMAT_QOI:  DecodeQoi(&decoder->qoi);                      break;
+	default: break;
+	}
+}
+
+static void ConvertJpegBandJob(void* context, u32 index) {
+	ImageTask* task = (ImageTask*)context + index;
+	ConvertJpegBand(&task->decoder->jpeg, task->index);
+}
+
+// Runs the decoding of the begun images and frees what it used. An image is null afterwards if its data was corrupt.
+static void DecodeImages(ImageDecoder* decoders, u32 count) {
+	u32 capacity = 0;
+
+	for (u32 i = 0; i < count; i++) {
+		if (decoders[i].format == IMAGE_FORMAT_JPEG)
+			capacity += Max(decoders[i].jpeg.segment_count, (decoders[i].jpeg.height + JPEG_BAND_ROWS - 1) / JPEG_BAND_ROWS);
+		else if (decoders[i].format != IMAGE_FORMAT_UNKNOWN)
+			capacity++;
+	}
+
+	ImageTask* tasks = Alloc<ImageTask>(capacity);
+	u32 task_count = 0;
+
+	// Whole images first, they're the longest tasks.
+	for (u32 i = 0; i < count; i++) {
+		if (decoders[i].format == IMAGE_FORMAT_PNG || decoders[i].format == IMAGE_FORMAT_QOI)
+			tasks[task_count++] = { &decoders[i], 0 };
+	}
+
+	for (u32 i = 0; i < count; i++) {
+		if (decoders[i].format == IMAGE_FORMAT_JPEG)
+			for (u32 j = 0; j < decoders[i].jpeg.segment_count; j++)
+				tasks[task_count++] = { &decoders[i], j };
+	}
+
+	RunParallel(task_count, DecodeImageJob, tasks);
+
+	task_count = 0;
+	for (u32 i = 0; i < count; i++) {
+		if (decoders[i].format == IMAGE_FORMAT_JPEG)
+			for (u32 j = 0; j * JPEG_BAND_ROWS < decoders[i].jpeg.height; j++)
+				tasks[task_count++] = { &decoders[i], j };
+	}
+
+	RunParallel(task_count, ConvertJpegBandJob, tasks);
+
+	Free(tasks, capacity);
+
+	for (u32 i = 0; i < count; i++) {
+		ImageDecoder* decoder = &decoders[i];
+
+		if (decoder->format == IMAGE_FORMAT_JPEG) {
+			FreeJpegDecoder(&decoder->jpeg);
+		}
+		else if (decoder->format == IMAGE_FORMAT_PNG) {
+			FreePngDecoder(&decoder->png);
+
+			if (decoder->png.failed) {
+				FreeImage(decoder->image);
+				decoder->image = null;
+			}
+		}
+	}
+}
+
+static Image* DecodeImage(const byte* data, u64 size) {
+	ImageDecoder* decoder = Alloc<ImageDecoder>();
+	Image* image = null;
+
+	if (BeginImage(decoder, data, size)) {
+		DecodeImages(decoder, 1);
+		image = decoder->image;
+	}
+
+	Free(decoder);
 	return image;
 }
 
-static Image* LoadImage(String path) {
+static void LoadImages(String* paths, Image** images, u32 count) {
+	ImageDecoder* decoders = Alloc<ImageDecoder>(count);
+	MappedFile*   files    = Alloc<MappedFile>(count);
+
+	for (u32 i = 0; i < count; i++) {
+		files[i] = MapFile(paths[i], FILE_ADVICE_SEQUENTIAL);
+
+		if (!files[i].IsValid()) {
+			LogWarning("Can't read image %", paths[i]);
+			ZeroMemory(&decoders[i], sizeof(ImageDecoder));
+			continue;
+		}
+
+		if (!BeginImage(&decoders[i], files[i].data, files[i].length))
+			LogWarning("Can't decode image %: not a JPEG, PNG or QOI this can read", paths[i]);
+	}
+
+	DecodeImages(decoders, count);
+
+	for (u32 i = 0; i < count; i++) {
+		if (decoders[i].format != IMAGE_FORMAT_UNKNOWN && !decoders[i].image)
+			LogWarning("Can't decode image %: the data is corrupt", paths[i]);
+
+		images[i] = decoders[i].image;
+
+		if (files[i].IsValid())
+			files[i].Unmap();
+	}
+
+	Free(files, count);
+	Free(decoders, count);
 }
 
+static Image* LoadImage(String path) {
+	Image* image;
+	LoadImages(&path, &image, 1);
+	return image;
+}
@@ -12,7 +12,7 @@ struct Image {
 	u8 data[];
 
 	u64 GetNumPixels() {
-		return width * height;
+		return (u64)width * height;
 	}
 
 	u64 GetSize() {
@@ -21,6 +21,20 @@ struct Image {
 };
 
 static Image* AllocImage(u64 data_size);
+static void   FreeImage(Image* image);
+
+// Decoded images are 8 bit RGBA, ready to upload. null if the file can't be read or decoded, which is logged.
+// The format is found from the data:
+//   JPEG: baseline and extended sequential Huffman, grayscale or YCbCr, any chroma subsampling.
+//         Progressive, arithmetic coded and 12 bit JPEGs aren't supported.
+//   PNG:  everything in the standard, 16 bit samples are cut to 8. For lossless UI, normal maps and masks.
+//   QOI:  lossless like PNG and several times faster to decode.
 static Image* LoadImage(String path);
 
+// Decodes all of them at once on the job threads (jobs.h): images in parallel, and each JPEG's restart
+// interval segments in parallel too, so one big image with restart markers also uses every core.
+static void LoadImages(String* paths, Image** images, u32 count);
+
+static Image* DecodeImage(const byte* data, u64 size);
+
 #endif // IMAGE_H_INCLUDED
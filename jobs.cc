@@ -0,0 +1,92 @@
+#include "jobs.h"
+#include "os.h"
+#include "math.h"
+
+static struct {
+	JobFunction* function;
+	void*        context;
+	u32          count;
+	u32          next;     // The next index to hand out.
+	bool         stop;
+	Semaphore    start;    // One count per worker per RunParallel.
+	Semaphore    finished; // Each worker signals once it's run out of indices.
+	ThreadHandle threads[JOBS_MAX_THREADS];
+	u32          thread_count;
+} jobs;
+
+static void RunJobIndices() {
+	while (true) {
+		u32 index = __atomic_fetch_add(&jobs.next, 1, __ATOMIC_RELAXED);
+
+		if (index >= jobs.count)
+			return;
+
+		jobs.function(jobs.context, index);
+	}
+}
+
+static void JobThread(void* argument) {
+	while (true) {
+		WaitSemaphore(jobs.start);
+
+		if (jobs.stop)
+			return;
+
+		RunJobIndices();
+		SignalSemaphore(jobs.finished);
+	}
+}
+
+static void InitJobs(u32 thread_count) {
+	if (!thread_count)
+		thread_count = GetProcessorCount() - 1;
+
+	jobs.thread_count = Min(thread_count, JOBS_MAX_THREADS);
+	jobs.stop = false;
+	jobs.start = CreateSemaphore(0);
+	jobs.finished = CreateSemaphore(0);
+
+	for (u32 i = 0; i < jobs.thread_count; i++)
+		jobs.threads[i] = CreateThread(JobThread, null);
+}
+
+static void ShutdownJobs() {
+	if (!jobs.start)
+		return;
+
+	jobs.stop = true;
+	SignalSemaphore(jobs.start, jobs.thread_count);
+
+	for (u32 i = 0; i < jobs.thread_count; i++)
+		JoinThread(jobs.threads[i]);
+
+	DestroySemaphore(jobs.start);
+	DestroySemaphore(jobs.finished);
+	jobs = { };
+}
+
+static u32 GetJobThreadCount() {
+	return jobs.thread_count + 1;
+}
+
+static void RunParallel(u32 count, JobFunction* function, void* context) {
+	if (!jobs.thread_count || count <= 1) {
+		for (u32 i = 0; i < count; i++)
+			function(context, i);
+
+		return;
+	}
+
+	// Every worker is waiting on start here, the semaphores order these writes before their reads.
+	jobs.function = function;
+	jobs.context  = context;
+	jobs.count    = count;
+	jobs.next     = 0;
+
+	SignalSemaphore(jobs.start, jobs.thread_count);
+	RunJobIndices();
+
+	// Not done until every worker is back to waiting, so none of them can still be looking at this job.
+	for (u32 i = 0; i < jobs.thread_count; i++)
+		WaitSemaphore(jobs.finished);
+}
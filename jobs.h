@@ -0,0 +1,23 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include "general.h"
+
+// A fixed pool of worker threads for data parallel loops: RunParallel hands out the indices of a loop to the
+// workers and the calling thread, and returns when they're all done. Tasks should be coarse (a slice of an
+// image, a whole image), every call wakes every worker.
+// Tasks run on other threads, so they mustn't use the global allocator: allocate up front and hand the memory in.
+// One RunParallel at a time, from the thread that called InitJobs.
+
+typedef void JobFunction(void* context, u32 index);
+
+static const u32 JOBS_MAX_THREADS = 64;
+
+static void InitJobs(u32 thread_count = 0); // Workers besides the calling thread, 0 for one per other processor.
+static void ShutdownJobs();
+static u32  GetJobThreadCount();            // Workers plus the calling thread.
+
+// Calls function(context, i) for every i < count. Runs everything on the calling thread before InitJobs.
+static void RunParallel(u32 count, JobFunction* function, void* context);
+
+#endif // JOBS_H
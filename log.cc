@@ -0,0 +1,298 @@
+#include "log.h"
+#include "os.h"
+#include "math.h"
+
+static const u16 LOG_PADDING    = 0xFFFF; // Fills the unused end of the ring before it wraps.
+static const u32 LOG_BATCH      = 256;    // Messages per writev.
+static const u32 LOG_PREFIX_MAX = 32;
+
+struct LogRing {
+	alignas(64) u64 write_head; // Only the owning thread writes these three.
+	u64 reserved_head;
+	u64 dropped;
+	bool released;              // Its thread exited, the next thread to need a ring takes it over.
+	alignas(64) u64 read_head;  // Only the flusher writes these two.
+	u64 reported_dropped;
+	alignas(64) byte data[LOG_RING_SIZE];
+};
+
+static struct {
+	LogRing*     rings[LOG_MAX_THREADS];
+	u32          ring_count;
+	u64          dropped_without_ring; // By threads past LOG_MAX_THREADS.
+	u64          reported_without_ring;
+	File         file = File(STDOUT);
+	File         trace_file = File(-1);
+	bool         flushing;
+	bool         stop;
+	ThreadHandle thread;
+} log_state;
+
+static u64 log_start_time = GetTimeNanoseconds();
+static thread_local LogRing* log_ring;
+
+// Hands the thread's ring back when the thread exits. Whatever is still in it gets written as usual, the ring is
+// only a queue with one producer at a time, so the next owner just carries on after it.
+struct LogRingRelease {
+	LogRing* ring;
+
+	~LogRingRelease() {
+		if (ring)
+			__atomic_store_n(&ring->released, true, __ATOMIC_RELEASE);
+	}
+};
+
+static thread_local LogRingRelease log_ring_release;
+
+static LogRing* SetLogRing(LogRing* ring) {
+	log_ring = ring;
+	log_ring_release.ring = ring;
+	return ring;
+}
+
+static LogRing* GetLogRing() {
+	if (log_ring)
+		return log_ring;
+
+	u32 index = __atomic_load_n(&log_state.ring_count, __ATOMIC_ACQUIRE);
+
+	for (u32 i = 0; i < Min(index, LOG_MAX_THREADS); i++) {
+		LogRing* ring = __atomic_load_n(&log_state.rings[i], __ATOMIC_ACQUIRE);
+		bool released = true;
+
+		if (ring && __atomic_compare_exchange_n(&ring->released, &released, false, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			return SetLogRing(ring);
+	}
+
+	do {
+		if (index >= LOG_MAX_THREADS)
+			return null;
+	} while (!__atomic_compare_exchange_n(&log_state.ring_count, &index, index + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+	// Pages come zeroed and don't go through the global allocator, which isn't thread safe.
+	LogRing* ring = (LogRing*)AllocPages(sizeof(LogRing));
+	__atomic_store_n(&log_state.rings[index], ring, __ATOMIC_RELEASE);
+	return SetLogRing(ring);
+}
+
+static LogEntry* ReserveLogEntry(u16 level, u32 length) {
+	u64 time = GetTimeNanoseconds();
+	LogRing* ring = GetLogRing();
+
+	if (!ring) {
+		__atomic_fetch_add(&log_state.dropped_without_ring, 1, __ATOMIC_RELAXED);
+		return null;
+	}
+
+	u64 size    = (sizeof(LogEntry) + length + 15) & -16llu;
+	u64 head    = ring->write_head;
+	u64 tail    = __atomic_load_n(&ring->read_head, __ATOMIC_ACQUIRE);
+	u64 offset  = head & (LOG_RING_SIZE-1);
+	u64 padding = offset + size > LOG_RING_SIZE ? LOG_RING_SIZE - offset : 0;
+
+	if (head + padding + size - tail > LOG_RING_SIZE) {
+		__atomic_store_n(&ring->dropped, ring->dropped + 1, __ATOMIC_RELAXED);
+		return null;
+	}
+
+	// Entries never wrap, so the flusher can hand them straight to writev.
+	if (padding) {
+		*(LogEntry*)(ring->data + offset) = { .time = time, .size = (u32)padding, .level = LOG_PADDING, .length = 0 };
+		head  += padding;
+		offset = 0;
+	}
+
+	LogEntry* entry = (LogEntry*)(ring->data + offset);
+	*entry = { .time = time, .size = (u32)size, .level = level, .length = (u16)length };
+	ring->reserved_head = head + size;
+	return entry;
+}
+
+static void CommitLogEntry() {
+	__atomic_store_n(&log_ring->write_head, log_ring->reserved_head, __ATOMIC_RELEASE);
+}
+
+static void PushLogMessage(LogLevel level, const char* text, u32 length) {
+	length = Min(length, LOG_MAX_MESSAGE-1);
+	LogEntry* entry = ReserveLogEntry(level, length + 1);
+
+	if (!entry)
+		return;
+
+	char* characters = (char*)(entry + 1);
+	CopyMemory(characters, text, length);
+	characters[length] = '\n';
+	CommitLogEntry();
+}
+
+// "[   12.345678] warning: "
+static u32 FormatLogPrefix(char* out, u64 time, u16 level) {
+	static const String level_names[] = { "debug: ", "info: ", "warning: ", "error: " };
+
+	u64 microseconds = (time - Min(time, log_start_time)) / 1000;
+	u64 seconds = microseconds / 1000000;
+	u32 length = 0;
+
+	out[length++] = '[';
+	for (u32 digits = CountDecimalDigits(seconds); digits < 4; digits++)
+		out[length++] = ' ';
+	length += FormatU64(out + length, seconds);
+
+	char fraction[FORMAT_U64_MAX];
+	u32 fraction_length = FormatU64(fraction, microseconds % 1000000 + 1000000);
+	out[length++] = '.';
+	CopyMemory(out + length, fraction + 1, fraction_length - 1);
+	length += fraction_length - 1;
+
+	out[length++] = ']';
+	out[length++] = ' ';
+
+	String name = level_names[level];
+	CopyMemory(out + length, name.data, name.length);
+	return length + name.length;
+}
+
+// Writes everything published so far, oldest first across all threads. Only called with log_state.flushing held.
+static u64 DrainLog() {
+	LogRing* rings[LOG_MAX_THREADS];
+	u64 cursors[LOG_MAX_THREADS];
+	u64 ends[LOG_MAX_THREADS];
+	u32 ring_count = 0;
+
+	u32 registered = Min(__atomic_load_n(&log_state.ring_count, __ATOMIC_ACQUIRE), LOG_MAX_THREADS);
+
+	for (u32 i = 0; i < registered; i++) {
+		LogRing* ring = __atomic_load_n(&log_state.rings[i], __ATOMIC_ACQUIRE);
+
+		if (!ring)
+			continue;
+
+		rings[ring_count]   = ring;
+		cursors[ring_count] = ring->read_head;
+		ends[ring_count]    = __atomic_load_n(&ring->write_head, __ATOMIC_ACQUIRE);
+		ring_count++;
+	}
+
+	WriteChunk chunks[LOG_BATCH * 2];
+	WriteChunk trace_chunks[LOG_BATCH];
+	char prefixes[LOG_BATCH][LOG_PREFIX_MAX];
+	u64 total = 0;
+
+	while (true) {
+		u32 count = 0;
+		u32 chunk_count = 0;
+		u32 trace_count = 0;
+
+		for (; count < LOG_BATCH; count++) {
+			LogEntry* oldest = null;
+			u32 oldest_ring = 0;
+
+			for (u32 i = 0; i < ring_count; i++) {
+				LogEntry* entry = null;
+
+				while (cursors[i] < ends[i]) {
+					entry = (LogEntry*)(rings[i]->data + (cursors[i] & (LOG_RING_SIZE-1)));
+					if (entry->level != LOG_PADDING) break;
+					cursors[i] += entry->size;
+					entry = null;
+				}
+
+				if (entry && (!oldest || entry->time < oldest->time)) {
+					oldest = entry;
+					oldest_ring = i;
+				}
+			}
+
+			if (!oldest)
+				break;
+
+			cursors[oldest_ring] += oldest->size;
+
+			// Binary records go to the trace file as they are, header included.
+			if (oldest->level >= LOG_ENTRY_TRACE) {
+				if (log_state.trace_file.IsValid())
+					trace_chunks[trace_count++] = { oldest, oldest->size };
+				continue;
+			}
+
+			chunks[chunk_count++] = { prefixes[count], FormatLogPrefix(prefixes[count], oldest->time, oldest->level) };
+			chunks[chunk_count++] = { oldest + 1, oldest->length };
+		}
+
+		if (!count)
+			break;
+
+		if (chunk_count) log_state.file.Write(chunks, chunk_count);
+		if (trace_count) log_state.trace_file.Write(trace_chunks, trace_count);
+		total += count;
+
+		// Only now that writev is done with the text can the producers reuse it.
+		for (u32 i = 0; i < ring_count; i++)
+			__atomic_store_n(&rings[i]->read_head, cursors[i], __ATOMIC_RELEASE);
+	}
+
+	for (u32 i = 0; i < ring_count; i++) {
+		u64 dropped = __atomic_load_n(&rings[i]->dropped, __ATOMIC_RELAXED);
+
+		if (dropped == rings[i]->reported_dropped)
+			continue;
+
+		char characters[128];
+		OutputBuffer buffer = FixedOutput(characters, sizeof(characters));
+		buffer.head = FormatLogPrefix(characters, GetTimeNanoseconds(), LOG_WARNING);
+		Print(&buffer, "% messages dropped, the log ring of thread % was full\n", dropped - rings[i]->reported_dropped, i);
+		log_state.file.Write(characters, buffer.head);
+		rings[i]->reported_dropped = dropped;
+	}
+
+	u64 dropped = __atomic_load_n(&log_state.dropped_without_ring, __ATOMIC_RELAXED);
+
+	if (dropped != log_state.reported_without_ring) {
+		char characters[128];
+		OutputBuffer buffer = FixedOutput(characters, sizeof(characters));
+		buffer.head = FormatLogPrefix(characters, GetTimeNanoseconds(), LOG_WARNING);
+		Print(&buffer, "% messages dropped, more than % threads were logging at once\n", dropped - log_state.reported_without_ring, LOG_MAX_THREADS);
+		log_state.file.Write(characters, buffer.head);
+		log_state.reported_without_ring = dropped;
+	}
+
+	return total;
+}
+
+static bool TryLockLogFlush() { return !__atomic_exchange_n(&log_state.flushing, true, __ATOMIC_ACQUIRE); }
+static void UnlockLogFlush()  { __atomic_store_n(&log_state.flushing, false, __ATOMIC_RELEASE); }
+
+static void FlushLog() {
+	while (!TryLockLogFlush())
+		YieldThread();
+
+	DrainLog();
+	UnlockLogFlush();
+}
+
+static void LogThread(void* argument) {
+	while (!__atomic_load_n(&log_state.stop, __ATOMIC_ACQUIRE)) {
+		u64 written = 0;
+
+		if (TryLockLogFlush()) {
+			written = DrainLog();
+			UnlockLogFlush();
+		}
+
+		if (!written)
+			SleepNanoseconds(LOG_FLUSH_INTERVAL);
+	}
+
+	FlushLog();
+}
+
+static void StartLogThread(File file) {
+	log_state.file = file;
+	log_state.stop = false;
+	log_state.thread = CreateThread(LogThread, null);
+}
+
+static void StopLogThread() {
+	__atomic_store_n(&log_state.stop, true, __ATOMIC_RELEASE);
+	JoinThread(log_state.thread);
+}
@@ -0,0 +1,86 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include "general.h"
+#include "file_system.h"
+#include "print.h"
+
+// Every thread logs into its own ring, which only that thread writes and only the flusher reads, so logging
+// is a format, a copy and a release store: it never blocks and never makes a syscall. A background thread
+// merges the rings by timestamp and writes them out in batches with one writev.
+// When a ring is full new messages are dropped and counted instead of waiting, the count shows up in the log.
+// A thread's ring is handed to the next new thread once it exits, so only threads logging at once are limited.
+
+enum LogLevel {
+	LOG_DEBUG,
+	LOG_INFO,
+	LOG_WARNING,
+	LOG_ERROR,
+};
+
+// Kinds of binary entries besides the LogLevels, see trace.h.
+static const u16 LOG_ENTRY_TRACE      = 0x100;
+static const u16 LOG_ENTRY_TRACE_SITE = 0x101;
+
+// Header of every ring entry, followed by length bytes of text or trace record.
+// Trace files are these entries back to back.
+struct LogEntry {
+	u64 time;
+	u32 size;   // Bytes to the next entry, header included.
+	u16 level;  // A LogLevel or one of the LOG_ENTRY kinds.
+	u16 length;
+};
+
+static const u64 LOG_RING_SIZE      = 64 << 10; // Per thread, a power of two.
+static const u32 LOG_MAX_THREADS    = 64;       // Logging at once, messages from any more are dropped and counted.
+static const u32 LOG_MAX_MESSAGE    = 1024;
+static const u64 LOG_FLUSH_INTERVAL = 2000000;  // Nanoseconds the flush thread sleeps when there's nothing to write.
+
+static LogLevel log_level = LOG_DEBUG; // Messages below this are skipped before formatting.
+
+static void StartLogThread(File file);
+static void StopLogThread(); // Writes everything that's left first.
+static void FlushLog();      // Writes everything logged so far before returning, for asserts and exit.
+
+static void PushLogMessage(LogLevel level, const char* text, u32 length);
+
+// For writing an entry in place: length bytes after the returned header, then Commit to publish it.
+// Returns null when the ring is full, the entry is dropped then.
+static LogEntry* ReserveLogEntry(u16 level, u32 length);
+static void      CommitLogEntry();
+
+template<typename ...Args>
+static void LogMessage(LogLevel level, FormatString<NoDeduce<Args>...> format, Args&&... args) {
+	if (level < log_level)
+		return;
+
+	char characters[LOG_MAX_MESSAGE];
+	OutputBuffer buffer = FixedOutput(characters, LOG_MAX_MESSAGE);
+	Print<Args...>(&buffer, format, static_cast<Args&&>(args)...);
+	PushLogMessage(level, characters, buffer.head);
+}
+
+template<typename ...Args>
+static void LogDebug(FormatString<NoDeduce<Args>...> format, Args&&... args) { LogMessage<Args...>(LOG_DEBUG, format, static_cast<Args&&>(args)...); }
+
+template<typename ...Args>
+static void LogInfo(FormatString<NoDeduce<Args>...> format, Args&&... args) { LogMessage<Args...>(LOG_INFO, format, static_cast<Args&&>(args)...); }
+
+template<typename ...Args>
+static void LogWarning(FormatString<NoDeduce<Args>...> format, Args&&... args) { LogMessage<Args...>(LOG_WARNING, format, static_cast<Args&&>(args)...); }
+
+template<typename ...Args>
+static void LogError(FormatString<NoDeduce<Args>...> format, Args&&... args) { LogMessage<Args...>(LOG_ERROR, format, static_cast<Args&&>(args)...); }
+
+#ifndef LOG_BINARY
+	#define LOG_BINARY 0
+#endif
+
+// With -DLOG_BINARY=1 Log goes through Trace (trace.h) and is decoded offline into the same text.
+#if LOG_BINARY
+	#define Log(var) Trace(#var " = %", var)
+#else
+	#define Log(var) LogDebug("%:%: " #var " = %", CString(__FILE__), __LINE__, var)
+#endif
+
+#endif // LOG_H
@@ -14,16 +14,38 @@
 #include "unix.cc"
 #include "window.cc"
 #include "print.cc"
+#include "print_float.cc"
+#include "log.cc"
+#include "trace.cc"
 #include "file_system.cc"
+#include "async_io.cc"
+#include "file_reader.cc"
+#include "hash.cc"
+#include "compress.cc"
+#include "asset_archive.cc"
+#include "asset_cache.cc"
+#include "jobs.cc"
+#include "pixels.cc"
+#include "image.cc"
+#include "mips.cc"
+#include "block_compress.cc"
+#include "texture.cc"
+#include "atlas.cc"
 #include "swapchain.cc"
 #include "device.cc"
 #include "queue.cc"
 #include "vk_helper.cc"
+#include "gpu_memory.cc"
 #include "gpu_buffer.cc"
 #include "command_buffer.cc"
+#include "texture_stream.cc"
 #include "engine.cc"
+#include "culling.cc"
+#include "packing.cc"
 
 #include "engine.h"
+#include "log.h"
+#include "trace.h"
 #include "vk_helper.h"
 #include "vector.h"
 #include "matrix.h"
@@ -36,8 +58,14 @@
 #include "camera.h"
 #include "keyboard.h"
 #include "mouse.h"
+#include "culling.h"
+#include "packing.h"
+#include "asset_archive.h"
+#include "async_io.h"
+#include "texture_stream.h"
 
 static Swapchain swapchain;
+static AssetArchive assets;
 static VkShaderModule vert;
 static VkShaderModule frag;
 static VkRenderPass renderpass;
@@ -61,6 +89,7 @@ struct Frame {
 	GpuBuffer       instance_buffer;
 	GpuBuffer       uniform_buffer;
 	VkDescriptorSet uniform_descriptor_set;
+	u32             instance_count;
 
 	void Destroy() {
 		command_buffer.Destroy();
@@ -107,16 +136,17 @@ static void UpdateTime() {
 	last_frame_time = current_time;
 }
 
-static VkShaderModule LoadShader(String path) {
+static VkShaderModule LoadShader(String name) {
 	VkShaderModule module;
 
-	Array<byte> code = LoadFile(path);
+	// Vulkan copies the code, so it can come straight from the archive's mapping. Entries are aligned, as pCode needs.
+	Asset code = assets.Load(name);
 	Assert(code.length);
 	Assert((code.length & 3) == 0);
 
 	VkShaderModuleCreateInfo create_info = {
 		.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-		.pCode    = (u32*)code.data,
+		.pCode    = (const u32*)code.data,
 		.codeSize = code.length,
 	};
 
@@ -129,67 +159,82 @@ static VkShaderModule LoadShader(String path) {
 }
 
 struct Vertex {
-	Vector3 position;
-	Vector3 color;
+	u16 position[4]; // f16, w is padding.
+	u32 color;       // unorm8 rgba.
 };
 
+static constexpr Vertex MakeVertex(Vector3 position, Vector3 color) {
+	return {
+		.position = { PackHalf(position.x), PackHalf(position.y), PackHalf(position.z), 0 },
+		.color    = PackUnorm8x4(Vector4(color, 1)),
+	};
+}
+
 struct CubeInstance {
 	Vector3 position;
 };
 
-static void InitCubeVertexBuffer() {
-	Vertex vertices[24] = {
-		// Front face (red)
-		{ .position = { -0.5f, -0.5f,  0.5f }, .color = { 1, 0, 0 } },
-		{ .position = {  0.5f, -0.5f,  0.5f }, .color = { 1, 0, 0 } },
-		{ .position = {  0.5f,  0.5f,  0.5f }, .color = { 1, 0, 0 } },
-		{ .position = { -0.5f,  0.5f,  0.5f }, .color = { 1, 0, 0 } },
-		// Back face (green)
-		{ .position = {  0.5f, -0.5f, -0.5f }, .color = { 0, 1, 0 } },
-		{ .position = { -0.5f, -0.5f, -0.5f }, .color = { 0, 1, 0 } },
-		{ .position = { -0.5f,  0.5f, -0.5f }, .color = { 0, 1, 0 } },
-		{ .position = {  0.5f,  0.5f, -0.5f }, .color = { 0, 1, 0 } },
-		// Top face (blue)
-		{ .position = { -0.5f,  0.5f,  0.5f }, .color = { 0, 0, 1 } },
-		{ .position = {  0.5f,  0.5f,  0.5f }, .color = { 0, 0, 1 } },
-		{ .position = {  0.5f,  0.5f, -0.5f }, .color = { 0, 0, 1 } },
-		{ .position = { -0.5f,  0.5f, -0.5f }, .color = { 0, 0, 1 } },
-		// Bottom face (yellow)
-		{ .position = { -0.5f, -0.5f, -0.5f }, .color = { 1, 1, 0 } },
-		{ .position = {  0.5f, -0.5f, -0.5f }, .color = { 1, 1, 0 } },
-		{ .position = {  0.5f, -0.5f,  0.5f }, .color = { 1, 1, 0 } },
-		{ .position = { -0.5f, -0.5f,  0.5f }, .color = { 1, 1, 0 } },
-		// Right face (magenta)
-		{ .position = {  0.5f, -0.5f,  0.5f }, .color = { 1, 0, 1 } },
-		{ .position = {  0.5f, -0.5f, -0.5f }, .color = { 1, 0, 1 } },
-		{ .position = {  0.5f,  0.5f, -0.5f }, .color = { 1, 0, 1 } },
-		{ .position = {  0.5f,  0.5f,  0.5f }, .color = { 1, 0, 1 } },
-		// Left face (cyan)
-		{ .position = { -0.5f, -0.5f, -0.5f }, .color = { 0, 1, 1 } },
-		{ .position = { -0.5f, -0.5f,  0.5f }, .color = { 0, 1, 1 } },
-		{ .position = { -0.5f,  0.5f,  0.5f }, .color = { 0, 1, 1 } },
-		{ .position = { -0.5f,  0.5f, -0.5f }, .color = { 0, 1, 1 } },
-	};
-
-	u16 indices[36] = {
-		0,  1,  2,   2,  3,  0,   // Front
-		4,  5,  6,   6,  7,  4,   // Back
-		8,  9,  10,  10, 11, 8,   // Top
-		12, 13, 14,  14, 15, 12,  // Bottom
-		16, 17, 18,  18, 19, 16,  // Right
-		20, 21, 22,  22, 23, 20,  // Left
-	};
+static const u32 CUBE_INSTANCE_COUNT = 2;
+static constexpr f32 CUBE_BOUNDING_RADIUS = Sqrt(3) * 0.5f; // Half the cube's diagonal.
+
+static f32 cube_x[CUBE_INSTANCE_COUNT] = { 0, 5 };
+static f32 cube_y[CUBE_INSTANCE_COUNT] = { 0, 5 };
+static f32 cube_z[CUBE_INSTANCE_COUNT] = { 0, 5 };
+static f32 cube_radius[CUBE_INSTANCE_COUNT] = { CUBE_BOUNDING_RADIUS, CUBE_BOUNDING_RADIUS };
+
+static constexpr Vertex cube_vertices[24] = {
+	// Front face (red)
+	MakeVertex({ -0.5f, -0.5f,  0.5f }, { 1, 0, 0 }),
+	MakeVertex({  0.5f, -0.5f,  0.5f }, { 1, 0, 0 }),
+	MakeVertex({  0.5f,  0.5f,  0.5f }, { 1, 0, 0 }),
+	MakeVertex({ -0.5f,  0.5f,  0.5f }, { 1, 0, 0 }),
+	// Back face (green)
+	MakeVertex({  0.5f, -0.5f, -0.5f }, { 0, 1, 0 }),
+	MakeVertex({ -0.5f, -0.5f, -0.5f }, { 0, 1, 0 }),
+	MakeVertex({ -0.5f,  0.5f, -0.5f }, { 0, 1, 0 }),
+	MakeVertex({  0.5f,  0.5f, -0.5f }, { 0, 1, 0 }),
+	// Top face (blue)
+	MakeVertex({ -0.5f,  0.5f,  0.5f }, { 0, 0, 1 }),
+	MakeVertex({  0.5f,  0.5f,  0.5f }, { 0, 0, 1 }),
+	MakeVertex({  0.5f,  0.5f, -0.5f }, { 0, 0, 1 }),
+	MakeVertex({ -0.5f,  0.5f, -0.5f }, { 0, 0, 1 }),
+	// Bottom face (yellow)
+	MakeVertex({ -0.5f, -0.5f, -0.5f }, { 1, 1, 0 }),
+	MakeVertex({  0.5f, -0.5f, -0.5f }, { 1, 1, 0 }),
+	MakeVertex({  0.5f, -0.5f,  0.5f }, { 1, 1, 0 }),
+	MakeVertex({ -0.5f, -0.5f,  0.5f }, { 1, 1, 0 }),
+	// Right face (magenta)
+	MakeVertex({  0.5f, -0.5f,  0.5f }, { 1, 0, 1 }),
+	MakeVertex({  0.5f, -0.5f, -0.5f }, { 1, 0, 1 }),
+	MakeVertex({  0.5f,  0.5f, -0.5f }, { 1, 0, 1 }),
+	MakeVertex({  0.5f,  0.5f,  0.5f }, { 1, 0, 1 }),
+	// Left face (cyan)
+	MakeVertex({ -0.5f, -0.5f, -0.5f }, { 0, 1, 1 }),
+	MakeVertex({ -0.5f, -0.5f,  0.5f }, { 0, 1, 1 }),
+	MakeVertex({ -0.5f,  0.5f,  0.5f }, { 0, 1, 1 }),
+	MakeVertex({ -0.5f,  0.5f, -0.5f }, { 0, 1, 1 }),
+};
 
+static constexpr u16 cube_indices[36] = {
+	0,  1,  2,   2,  3,  0,   // Front
+	4,  5,  6,   6,  7,  4,   // Back
+	8,  9,  10,  10, 11, 8,   // Top
+	12, 13, 14,  14, 15, 12,  // Bottom
+	16, 17, 18,  18, 19, 16,  // Right
+	20, 21, 22,  22, 23, 20,  // Left
+};
+
+static void InitCubeVertexBuffer() {
 	GpuBuffer staging_buffer;
-	staging_buffer = CreateBuffer(Max(sizeof(vertices), sizeof(indices)), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-	cube_vertex_buffer  = CreateBuffer(sizeof(vertices), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-	cube_index_buffer   = CreateBuffer(sizeof(indices),  VK_BUFFER_USAGE_INDEX_BUFFER_BIT  | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	staging_buffer = CreateBuffer(Max(sizeof(cube_vertices), sizeof(cube_indices)), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	cube_vertex_buffer  = CreateBuffer(sizeof(cube_vertices), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	cube_index_buffer   = CreateBuffer(sizeof(cube_indices),  VK_BUFFER_USAGE_INDEX_BUFFER_BIT  | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-	staging_buffer.Upload(vertices, sizeof(vertices));
-	CopyBuffer(cube_vertex_buffer, staging_buffer, sizeof(vertices));
+	staging_buffer.Upload(cube_vertices, sizeof(cube_vertices));
+	CopyBuffer(cube_vertex_buffer, staging_buffer, sizeof(cube_vertices));
 
-	staging_buffer.Upload(indices, sizeof(indices));
-	CopyBuffer(cube_index_buffer, staging_buffer, sizeof(indices));
+	staging_buffer.Upload(cube_indices, sizeof(cube_indices));
+	CopyBuffer(cube_index_buffer, staging_buffer, sizeof(cube_indices));
 
 	staging_buffer.Destroy();
 }
@@ -308,8 +353,8 @@ static void CreateGraphicsPipeline() {
 	};
 
 	VkVertexInputAttributeDescription vertex_attributes[] = {
-		{ .binding = 0, .location = 0, .format = VK_FORMAT_R32G32B32_SFLOAT, .offset = offsetof(Vertex, position), },
-		{ .binding = 0, .location = 1, .format = VK_FORMAT_R32G32B32_SFLOAT, .offset = offsetof(Vertex, color), },
+		{ .binding = 0, .location = 0, .format = VK_FORMAT_R16G16B16A16_SFLOAT, .offset = offsetof(Vertex, position), },
+		{ .binding = 0, .location = 1, .format = VK_FORMAT_R8G8B8A8_UNORM,      .offset = offsetof(Vertex, color), },
 		{ .binding = 1, .location = 2, .format = VK_FORMAT_R32G32B32_SFLOAT, .offset = offsetof(CubeInstance, position), }
 	};
 
@@ -492,7 +537,7 @@ static void RecordCommandBuffer(Frame* frame, u32 image_index) {
 	frame->command_buffer.BindVertexBuffer(frame->instance_buffer, 1);
 	frame->command_buffer.BindIndexBuffer(cube_index_buffer.buffer, 0, VK_INDEX_TYPE_UINT16);
 	frame->command_buffer.BindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, &frame->uniform_descriptor_set, 1);
-	frame->command_buffer.DrawIndexed(36, 2, 0, 0, 0);
+	frame->command_buffer.DrawIndexed(36, frame->instance_count, 0, 0, 0);
 	frame->command_buffer.EndRenderPass();
 
 	frame->command_buffer.End();
@@ -580,16 +625,30 @@ static void CreateUbo() {
 }
 
 static void UploadCubeData(Frame* frame) {
+	Matrix4 vp = camera.GenerateVP(0.1f, 100.0f);
+
 	Ubo* ubo = (Ubo*)frame->uniform_buffer.Map();
 	*ubo = {
 		.time = (f32)current_time,
-		.projection  = camera.GenerateVP(0.1f, 100.0f),
+		.projection  = vp,
 	};
 	frame->uniform_buffer.Unmap();
 
+	Frustum frustum = Frustum::FromMatrix(vp);
+	BoundingSpheres bounds = {
+		.x = cube_x, .y = cube_y, .z = cube_z,
+		.radius = cube_radius,
+		.count  = CUBE_INSTANCE_COUNT,
+	};
+
+	u32 visible[CUBE_INSTANCE_COUNT];
+	frame->instance_count = CullSpheres(&frustum, bounds, visible);
+
 	CubeInstance* instances = (CubeInstance*)frame->instance_buffer.Map();
-	instances[0] = { { 0, 0, 0 } };
-	instances[1] = { { 5, 5, 5 } };
+	for (u32 i = 0; i < frame->instance_count; i++) {
+		u32 index = visible[i];
+		instances[i] = { { cube_x[index], cube_y[index], cube_z[index] } };
+	}
 	frame->instance_buffer.Unmap();
 }
 
@@ -630,6 +689,10 @@ static bool DrawFrame(Frame* frame) {
 		return true;
 
 	vkResetFences(device.logical_device, 1, &frame->inflight_fence);
+
+	// Upload first, the instance count from culling is baked into the draw.
+	UploadCubeData(frame);
+
 	frame->command_buffer.Reset();
 	RecordCommandBuffer(frame, image.Get());
 
@@ -638,8 +701,6 @@ static bool DrawFrame(Frame* frame) {
 	VkPipelineStageFlags wait_stages[]       = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
 	VkSemaphore          signal_semaphores[] = { render_finished_semaphores[image.Get()] };
 
-	UploadCubeData(frame);
-
 	VkSubmitInfo submit_info = {
 		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
 		.waitSemaphoreCount = 1,
@@ -713,14 +774,23 @@ static void InitializeFrames() {
 		Frame* frame = &frames[i];
 		frame->inflight_fence = device.CreateFence(true);
 		frame->command_buffer = device.CreateCommandBuffer();
-		frame->instance_buffer = CreateBuffer(sizeof(CubeInstance) * 2, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		frame->instance_buffer = CreateBuffer(sizeof(CubeInstance) * CUBE_INSTANCE_COUNT, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 	}
 }
 
 int main(int argc, char** argv) {
-	Print("Initializing...\n");
+	StartLogThread(File(STDOUT));
+
+#if LOG_BINARY
+	// Decode with ./trace_decode trace.bin. Each run starts it over, the header is only read at the start.
+	StartTracing(OpenFile("trace.bin", FILE_MODE_CREATE_OR_TRUNCATE, FILE_ACCESS_WRITE));
+#endif
+
+	LogInfo("Initializing...");
 
 	InitGlobalAllocator();
+	InitJobs();
+	InitAsyncIo();
 
 	InitTime();
 	InitWindowSystem();
@@ -733,8 +803,19 @@ int main(int argc, char** argv) {
 	QueueFamilyTable qft = QueryQueueFamilyTable(physical_device, &Engine::window);
 
 	device.Init(physical_device, qft);
+	InitGpuMemory();
 	swapchain.Init(&Engine::window);
 
+	InitTextureStreaming({
+		.budget           = 256 << 20,
+		.staging_size     = 64 << 20,
+		.frames_in_flight = INFLIGHT_FRAME_COUNT,
+	});
+
+	// Built by make assets, every asset comes out of this one mapping.
+	assets = OpenAssetArchive("assets.pak");
+	Assert(assets.IsValid());
+
 	vert = LoadShader("vert.spv");
 	frag = LoadShader("frag.spv");
 
@@ -752,7 +833,7 @@ int main(int argc, char** argv) {
 
 	CreateImageSemaphores();
 
-	Print("Running...\n");
+	LogInfo("Running...");
 
 	UpdateTime();
 
@@ -776,22 +857,26 @@ int main(int argc, char** argv) {
 
 		Update();
 
+		// Ahead of the frame on the same queue, so levels copied in are there for it.
+		UpdateTextureStreaming();
+
 		if (DrawFrame(frame)) {
 			RecreateSwapchain();
 			continue;
 		}
 
 		frame_counter++;
-		standard_output_buffer.Flush();
 	}
 
 	device.WaitIdle();
 
-	Print("Terminating...\n");
+	LogInfo("Terminating...");
 
 	for (Frame& frame : frames)
 		frame.Destroy();
 
+	ShutdownTextureStreaming();
+
 	DestroyImageSemaphores();
 
 	vkDestroyDescriptorSetLayout(device.logical_device, descriptor_set_layout, null);
@@ -809,12 +894,16 @@ int main(int argc, char** argv) {
 
 	swapchain.Destroy();
 	Engine::window.Destroy();
+	ShutdownGpuMemory();
 	device.Destroy();
 	vk_helper.Destroy();
 	glfwTerminate();
+	assets.Close();
+	ShutdownAsyncIo();
+	ShutdownJobs();
 
-	Print("Goodbye!\n");
-	standard_output_buffer.Flush();
+	LogInfo("Goodbye!");
+	StopLogThread();
 
 	return 0;
 }
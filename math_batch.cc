@@ -0,0 +1,138 @@
+#include "math_batch.h"
+#include "simd.h"
+
+static void MultiplyMatrices(Matrix4* out, const Matrix4* a, const Matrix4* b, u64 count) {
+	for (u64 i = 0; i < count; i++) {
+		const f32* pa = &a[i].x.x;
+		const f32* pb = &b[i].x.x;
+		f32* po = &out[i].x.x;
+
+		f32x4 ax = LoadF32x4(pa + 0);
+		f32x4 ay = LoadF32x4(pa + 4);
+		f32x4 az = LoadF32x4(pa + 8);
+		f32x4 aw = LoadF32x4(pa + 12);
+
+		// Each column of the result is a's columns weighted by the matching column of b.
+		for (u32 column = 0; column < 4; column++) {
+			const f32* c = pb + column*4;
+			StoreF32x4(po + column*4, ax*c[0] + ay*c[1] + az*c[2] + aw*c[3]);
+		}
+	}
+}
+
+static void RotateVectors(Quaternion q, Vector3Soa out, Vector3Soa in, u64 count) {
+	f32x8 qi = BroadcastF32x8(q.i);
+	f32x8 qj = BroadcastF32x8(q.j);
+	f32x8 qk = BroadcastF32x8(q.k);
+	f32x8 qr = BroadcastF32x8(q.r);
+	u64 i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		f32x8 x = LoadF32x8(in.x + i);
+		f32x8 y = LoadF32x8(in.y + i);
+		f32x8 z = LoadF32x8(in.z + i);
+
+		f32x8 tx = 2.0f * (qj*z - qk*y);
+		f32x8 ty = 2.0f * (qk*x - qi*z);
+		f32x8 tz = 2.0f * (qi*y - qj*x);
+
+		StoreF32x8(out.x + i, x + qr*tx + (qj*tz - qk*ty));
+		StoreF32x8(out.y + i, y + qr*ty + (qk*tx - qi*tz));
+		StoreF32x8(out.z + i, z + qr*tz + (qi*ty - qj*tx));
+	}
+
+	for (; i < count; i++) {
+		Vector3 u = Vector3(q.i, q.j, q.k);
+		Vector3 v = Vector3(in.x[i], in.y[i], in.z[i]);
+		Vector3 t = Cross(u, v) * 2.0f;
+		Vector3 r = v + t * q.r + Cross(u, t);
+		out.x[i] = r.x;
+		out.y[i] = r.y;
+		out.z[i] = r.z;
+	}
+}
+
+// The series from "A Fast and Accurate Algorithm for Computing SLERP" (David Eberly, 2011).
+// Converges slowest at theta = pi/2, 16 terms with the last one scaled by 1 + mu keep the error below 3.1e-8 there.
+static const u32 SLERP_TERMS = 16;
+static constexpr f64 SLERP_ONE_PLUS_MU = 1.91667102836589;
+
+struct SlerpCoefficients {
+	f32 u[SLERP_TERMS];
+	f32 v[SLERP_TERMS];
+};
+
+static constexpr SlerpCoefficients GenerateSlerpCoefficients() {
+	SlerpCoefficients result = { };
+
+	for (u32 n = 1; n <= SLERP_TERMS; n++) {
+		f64 scale = n == SLERP_TERMS ? SLERP_ONE_PLUS_MU : 1.0;
+		result.u[n-1] = scale / (n * (2.0*n + 1));
+		result.v[n-1] = scale * n / (2.0*n + 1);
+	}
+
+	return result;
+}
+
+static constexpr SlerpCoefficients slerp_coefficients = GenerateSlerpCoefficients();
+
+// sin(t * theta) / sin(theta) as a polynomial in t^2 and (cos(theta) - 1).
+static inline f32x4 SlerpWeight(f32x4 t, f32x4 xm1) {
+	f32x4 tt = t * t;
+	f32x4 result = BroadcastF32x4(1.0f);
+
+	for (s32 n = SLERP_TERMS-1; n >= 0; n--)
+		result = 1.0f + (slerp_coefficients.u[n]*tt - slerp_coefficients.v[n]) * xm1 * result;
+
+	return t * result;
+}
+
+static inline void SlerpLanes(Quaternion* out, const Quaternion* a, const Quaternion* b, f32x4 t) {
+	f32x4 ai = LoadF32x4(&a[0].i), aj = LoadF32x4(&a[1].i), ak = LoadF32x4(&a[2].i), ar = LoadF32x4(&a[3].i);
+	f32x4 bi = LoadF32x4(&b[0].i), bj = LoadF32x4(&b[1].i), bk = LoadF32x4(&b[2].i), br = LoadF32x4(&b[3].i);
+	Transpose4x4(&ai, &aj, &ak, &ar);
+	Transpose4x4(&bi, &bj, &bk, &br);
+
+	// Take the short way around like Slerp does by flipping the sign of b's weight.
+	f32x4 dot  = ai*bi + aj*bj + ak*bk + ar*br;
+	f32x4 sign = (f32x4)((u32x4)dot & 0x80000000);
+	f32x4 xm1  = AbsF32x4(dot) - 1.0f;
+
+	f32x4 wa = SlerpWeight(1.0f - t, xm1);
+	f32x4 wb = (f32x4)((u32x4)SlerpWeight(t, xm1) ^ (u32x4)sign);
+
+	f32x4 ri = ai*wa + bi*wb;
+	f32x4 rj = aj*wa + bj*wb;
+	f32x4 rk = ak*wa + bk*wb;
+	f32x4 rr = ar*wa + br*wb;
+	Transpose4x4(&ri, &rj, &rk, &rr);
+
+	StoreF32x4(&out[0].i, ri);
+	StoreF32x4(&out[1].i, rj);
+	StoreF32x4(&out[2].i, rk);
+	StoreF32x4(&out[3].i, rr);
+}
+
+static void SlerpQuaternions(Quaternion* out, const Quaternion* a, const Quaternion* b, const f32* t, u64 count) {
+	u64 i = 0;
+
+	for (; i + 4 <= count; i += 4)
+		SlerpLanes(out + i, a + i, b + i, LoadF32x4(t + i));
+
+	// Pad the tail out to a full group so it goes through the same approximation.
+	if (i < count) {
+		Quaternion ta[4], tb[4], tout[4];
+		f32 tt[4] = { };
+
+		for (u64 n = 0; n < 4; n++) {
+			ta[n] = a[i + (n < count - i ? n : 0)];
+			tb[n] = b[i + (n < count - i ? n : 0)];
+			if (n < count - i) tt[n] = t[i + n];
+		}
+
+		SlerpLanes(tout, ta, tb, LoadF32x4(tt));
+
+		for (u64 n = 0; n < count - i; n++)
+			out[i + n] = tout[n];
+	}
+}
@@ -0,0 +1,34 @@
+#ifndef MATH_BATCH_H
+#define MATH_BATCH_H
+
+#include "general.h"
+#include "vector.h"
+#include "matrix.h"
+#include "quaternion.h"
+
+// Batched versions of the hot math.h/matrix.h/quaternion.h operations.
+// bench.cc compares them against the scalar versions for speed and against f64 for accuracy.
+
+struct Vector2Soa {
+	f32* x;
+	f32* y;
+};
+
+struct Vector3Soa {
+	f32* x;
+	f32* y;
+	f32* z;
+};
+
+// out[i] = a[i] * b[i], same rounding as Matrix4::operator* so the results are identical.
+static void MultiplyMatrices(Matrix4* out, const Matrix4* a, const Matrix4* b, u64 count);
+
+// Rotates count vectors by the same unit quaternion. out may alias in.
+// Uses v + r*t + u x t with t = 2 * (u x v), which is cheaper than the two products in Quaternion::Rotate.
+static void RotateVectors(Quaternion q, Vector3Soa out, Vector3Soa in, u64 count);
+
+// out[i] = Slerp(a[i], b[i], t[i]) using Eberly's polynomial approximation instead of acos/sin.
+// Stays within a few f32 ulp of the exact result for unit quaternions, including nearly parallel ones.
+static void SlerpQuaternions(Quaternion* out, const Quaternion* a, const Quaternion* b, const f32* t, u64 count);
+
+#endif // MATH_BATCH_H
@@ -7,7 +7,7 @@ struct Matrix2 {
 	Vector2 x;
 	Vector2 y;
 
-	Matrix2(
+	constexpr Matrix2(
 		Vector2 x,
 		Vector2 y
 	) : x(x), y(y) { }
@@ -23,14 +23,14 @@ struct Matrix4 {
 	Vector4 z;
 	Vector4 w;
 
-	explicit Matrix4(
+	explicit constexpr Matrix4(
 		Vector4 x,
 		Vector4 y,
 		Vector4 z,
 		Vector4 w
 	) : x(x), y(y), z(z), w(w) { }
 
-	explicit Matrix4(
+	explicit constexpr Matrix4(
 		f32 xx, f32 xy, f32 xz, f32 xw,
 		f32 yx, f32 yy, f32 yz, f32 yw,
 		f32 zx, f32 zy, f32 zz, f32 zw,
@@ -42,7 +42,7 @@ struct Matrix4 {
 		Vector4(wx, wy, wz, ww)
 	) { }
 
-	static inline Matrix4 One() {
+	static constexpr Matrix4 One() {
 		return Matrix4(
 			Vector4(1, 0, 0, 0),
 			Vector4(0, 1, 0, 0),
@@ -51,7 +51,7 @@ struct Matrix4 {
 		);
 	};
 
-	Vector4 operator*(Vector4 v) {
+	constexpr Vector4 operator*(Vector4 v) const {
 		return Vector4(
 			Dot(v, x),
 			Dot(v, y),
@@ -60,7 +60,7 @@ struct Matrix4 {
 		);
 	}
 
-	Matrix4 operator*(Matrix4 b) {
+	constexpr Matrix4 operator*(Matrix4 b) const {
 		return Matrix4(
 			Vector4(x.x*b.x.x + y.x*b.x.y + z.x*b.x.z + w.x*b.x.w,
 			        x.y*b.x.x + y.y*b.x.y + z.y*b.x.z + w.y*b.x.w,
@@ -81,7 +81,7 @@ struct Matrix4 {
 		);
 	}
 
-	static Matrix4 Perspective(f32 fov_y, f32 aspect, f32 near, f32 far) {
+	static constexpr Matrix4 Perspective(f32 fov_y, f32 aspect, f32 near, f32 far) {
 		f32 f = 1.0f / Tan(fov_y / 2.0f);
 		return Matrix4(
 			f/aspect, 0,   0,                        0,
@@ -91,7 +91,7 @@ struct Matrix4 {
 		);
 	}
 
-	static Matrix4 LookAt(Vector3 eye, Vector3 target, Vector3 up) {
+	static constexpr Matrix4 LookAt(Vector3 eye, Vector3 target, Vector3 up) {
 		Vector3 f = (target - eye).Normal();
 		Vector3 r = Cross(f, up).Normal();
 		Vector3 u = Cross(r, f);
@@ -103,7 +103,7 @@ struct Matrix4 {
 		);
 	}
 
-	static Matrix4 RotateX(f32 a) {
+	static constexpr Matrix4 RotateX(f32 a) {
 		f32 c = Cos(a);
 		f32 s = Sin(a);
 		return Matrix4(
@@ -114,7 +114,7 @@ struct Matrix4 {
 		);
 	}
 
-	static Matrix4 RotateY(f32 a) {
+	static constexpr Matrix4 RotateY(f32 a) {
 		f32 c = Cos(a);
 		f32 s = Sin(a);
 		return Matrix4(
@@ -125,7 +125,7 @@ struct Matrix4 {
 		);
 	}
 
-	static Matrix4 RotateZ(f32 a) {
+	static constexpr Matrix4 RotateZ(f32 a) {
 		f32 c = Cos(a), s = Sin(a);
 		return Matrix4(
 			 c, s, 0, 0,
@@ -135,7 +135,7 @@ struct Matrix4 {
 		);
 	}
 
-	static Matrix4 Translate(Vector3 v) {
+	static constexpr Matrix4 Translate(Vector3 v) {
 		return Matrix4(
 			1, 0, 0, 0,
 			0, 1, 0, 0,
@@ -144,7 +144,7 @@ struct Matrix4 {
 		);
 	}
 
-	static Matrix4 Rotate(Vector3 v) {
+	static constexpr Matrix4 Rotate(Vector3 v) {
 		return RotateZ(v.z) * RotateY(v.y) * RotateX(v.x);
 	}
 };
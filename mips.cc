@@ -0,0 +1,323 @@
+#include "mips.h"
+#include "jobs.h"
+#include "simd.h"
+#include "math.h"
+#include "pixels.h"
+#include "packing.h"
+
+static const f32 MIP_KAISER_RADIUS = 3.0f; // In destination pixels.
+static const f32 MIP_KAISER_ALPHA  = 4.0f;
+
+// Levels with fewer pixels than this are made on the calling thread, waking the workers would cost more.
+static const u64 MIP_MIN_SLAB_PIXELS = 1 << 14;
+
+static u32 GetMipLevelCount(u32 width, u32 height) {
+	u32 count = 1;
+
+	for (u32 size = Max(width, height); size > 1; size >>= 1)
+		count++;
+
+	return count;
+}
+
+// The zeroth order modified Bessel function of the first kind, from its power series.
+static f32 BesselI0(f32 x) {
+	f32 sum = 1, term = 1;
+
+	for (u32 k = 1; term > sum * 1e-7f; k++) {
+		f32 t = x / (2 * k);
+		term *= t * t;
+		sum += term;
+	}
+
+	return sum;
+}
+
+// Weight of source pixel i for the destination pixel centered on center, in source pixels. Not normalized.
+static f32 GetMipWeight(MipFilter filter, f32 scale, f32 center, s32 i) {
+	if (filter == MIP_FILTER_BOX) {
+		// How much of the source pixel the destination pixel covers.
+		f32 lo = Max((f32)i, center - 0.5f * scale);
+		f32 hi = Min((f32)(i + 1), center + 0.5f * scale);
+		return Max(hi - lo, 0.0f);
+	}
+
+	f32 d = (i + 0.5f - center) / scale;
+	if (Abs(d) >= MIP_KAISER_RADIUS)
+		return 0;
+
+	f32 sinc = d == 0 ? 1 : Sin((f32)Math::PI * d) / ((f32)Math::PI * d);
+	f32 r = d / MIP_KAISER_RADIUS;
+	return sinc * BesselI0(MIP_KAISER_ALPHA * Sqrt(1 - r*r)) / BesselI0(MIP_KAISER_ALPHA);
+}
+
+// One axis of a level: destination pixel i is the sum of weights[i * count + k] times source pixel first[i] + k.
+// Taps past the edges are clamped to the edge pixel, their weight folded into its.
+struct MipTaps {
+	u32* first;
+	f32* weights;
+	u32  count;
+};
+
+static MipTaps BuildMipTaps(MipFilter filter, u32 src_size, u32 dst_size) {
+	f32 scale  = (f32)src_size / dst_size;
+	f32 radius = (filter == MIP_FILTER_BOX ? 0.5f : MIP_KAISER_RADIUS) * scale;
+
+	auto center_of = [&](u32 i) { return (i + 0.5f) * scale; };
+
+	// The source pixels with weight, clamped to the image.
+	auto span_of = [&](u32 i, s32* lo, s32* hi) {
+		f32 center = center_of(i);
+		s32 start  = (s32)Floor(center - radius);
+		s32 end    = (s32)Ceil(center + radius);
+		*lo = end;
+		*hi = start;
+
+		for (s32 s = start; s <= end; s++) {
+			if (GetMipWeight(filter, scale, center, s) != 0) {
+				*lo = Min(*lo, s);
+				*hi = Max(*hi, s);
+			}
+		}
+
+		*lo = Clamp(*lo, 0, (s32)src_size - 1);
+		*hi = Clamp(*hi, 0, (s32)src_size - 1);
+	};
+
+	// As many taps as the widest span, so the 2x box filter is two taps and not four.
+	MipTaps taps = { };
+	taps.count = 1;
+
+	for (u32 i = 0; i < dst_size; i++) {
+		s32 lo, hi;
+		span_of(i, &lo, &hi);
+		taps.count = Max(taps.count, (u32)(hi - lo + 1));
+	}
+
+	taps.first   = Alloc<u32>(dst_size);
+	taps.weights = Alloc<f32>((u64)dst_size * taps.count);
+	ZeroMemory(taps.weights, (u64)dst_size * taps.count * sizeof(f32));
+
+	for (u32 i = 0; i < dst_size; i++) {
+		s32 lo, hi;
+		span_of(i, &lo, &hi);
+
+		u32  first   = Min((u32)lo, src_size - taps.count);
+		f32* weights = taps.weights + (u64)i * taps.count;
+		f32  center  = center_of(i);
+		f32  sum     = 0;
+
+		for (s32 s = (s32)Floor(center - radius); s <= (s32)Ceil(center + radius); s++) {
+			f32 weight = GetMipWeight(filter, scale, center, s);
+			if (weight == 0)
+				continue;
+
+			weights[Clamp(s, 0, (s32)src_size - 1) - first] += weight;
+			sum += weight;
+		}
+
+		for (u32 k = 0; k < taps.count; k++)
+			weights[k] /= sum;
+
+		taps.first[i] = first;
+	}
+
+	return taps;
+}
+
+static void FreeMipTaps(MipTaps* taps, u32 dst_size) {
+	Free(taps->first, dst_size);
+	Free(taps->weights, (u64)dst_size * taps->count);
+}
+
+struct MipLevelJob {
+	MipTaps horizontal;
+	MipTaps vertical;
+	u32 src_width;
+	u32 dst_width;
+	u32 dst_height;
+	const u8*  src_pixels; // Level 0, decoded a row at a time into a ring of rows as the filter reaches them.
+	const f32* src_linear; // The f32 of the level above, for the levels after 1.
+	f32* dst_linear;       // Kept for the next level, null for the last one.
+	u8*  dst_pixels;
+	bool srgb;
+	u32  slab_rows;
+	f32* scratch;
+	u64  scratch_stride;   // Floats per slab.
+};
+
+// dst += src * weight, count floats.
+static void MultiplyAddRow(f32* dst, const f32* src, f32 weight, u64 count) {
+	u64 i = 0;
+
+	for (; i + 8 <= count; i += 8)
+		StoreF32x8(dst + i, LoadF32x8(dst + i) + LoadF32x8(src + i) * weight);
+
+	for (; i < count; i++)
+		dst[i] += src[i] * weight;
+}
+
+// Level 0 to f32. UnpackUnorm8 divides to match PackUnorm8 exactly, the reciprocal is within an ulp and is
+// enough for filtering, at a fraction of the cost.
+static void DecodeMipRow(f32* dst, const u8* src, u32 width, bool srgb) {
+	if (srgb) {
+		SrgbToLinear(dst, src, width);
+		return;
+	}
+
+	u64 count = (u64)width * 4;
+	u64 i = 0;
+
+	for (; i + 8 <= count; i += 8)
+		StoreF32x8(dst + i, LoadU8x8AsF32x8(src + i) * (1.0f / 255.0f));
+
+	for (; i < count; i++)
+		dst[i] = src[i] * (1.0f / 255.0f);
+}
+
+// Filters a slab of the destination rows: each row is the weighted sum of whole source rows, then that sum is
+// filtered horizontally.
+static void MakeMipSlab(void* context, u32 index) {
+	MipLevelJob* job = (MipLevelJob*)context;
+	u64 src_stride = (u64)job->src_width * 4;
+	u64 dst_stride = (u64)job->dst_width * 4;
+	u32 ring_rows  = job->vertical.count;
+
+	f32* ring    = job->scratch + index * job->scratch_stride;
+	f32* column  = ring + (job->src_pixels ? ring_rows * src_stride : 0);
+	f32* row_out = column + src_stride;
+
+	u32 y0 = index * job->slab_rows;
+	u32 y1 = Min(y0 + job->slab_rows, job->dst_height);
+	u32 decoded_end = job->vertical.first[y0];
+
+	for (u32 y = y0; y < y1; y++) {
+		u32 first = job->vertical.first[y];
+		const f32* weights = job->vertical.weights + (u64)y * ring_rows;
+
+		// The first rows only move down, so a ring of as many rows as there are taps holds all this row needs.
+		if (job->src_pixels) {
+			for (; decoded_end < first + ring_rows; decoded_end++) {
+				f32* dst = ring + (decoded_end % ring_rows) * src_stride;
+				DecodeMipRow(dst, job->src_pixels + decoded_end * src_stride, job->src_width, job->srgb);
+			}
+		}
+
+		ZeroMemory(column, src_stride * sizeof(f32));
+
+		for (u32 k = 0; k < ring_rows; k++) {
+			u32 row = first + k;
+			const f32* src = job->src_pixels ? ring + (row % ring_rows) * src_stride : job->src_linear + row * src_stride;
+			MultiplyAddRow(column, src, weights[k], src_stride);
+		}
+
+		f32* out = job->dst_linear ? job->dst_linear + y * dst_stride : row_out;
+		u32  taps = job->horizontal.count;
+
+		for (u32 x = 0; x < job->dst_width; x++) {
+			const f32* in = column + job->horizontal.first[x] * 4;
+			const f32* w  = job->horizontal.weights + (u64)x * taps;
+			f32x4 sum = LoadF32x4(in) * w[0];
+
+			for (u32 k = 1; k < taps; k++)
+				sum += LoadF32x4(in + k * 4) * w[k];
+
+			StoreF32x4(out + x * 4, sum);
+		}
+
+		u8* pixels = job->dst_pixels + y * dst_stride;
+
+		if (job->srgb)
+			LinearToSrgb(pixels, out, job->dst_width);
+		else
+			PackUnorm8(pixels, out, dst_stride);
+	}
+}
+
+static MipChain* GenerateMips(Image* image, MipFilter filter, bool srgb) {
+	Assert(image->channels == 4);
+
+	MipLevel levels[MIP_MAX_LEVELS];
+	u32 level_count = GetMipLevelCount(image->width, image->height);
+	u64 size = 0;
+
+	for (u32 i = 0; i < level_count; i++) {
+		levels[i].width  = Max(image->width  >> i, 1u);
+		levels[i].height = Max(image->height >> i, 1u);
+		levels[i].offset = size;
+		levels[i].size   = (u64)levels[i].width * levels[i].height * 4;
+		size = (size + levels[i].size + MIP_LEVEL_ALIGNMENT - 1) & ~(u64)(MIP_LEVEL_ALIGNMENT - 1);
+	}
+
+	MipChain* chain = (MipChain*)AllocMemory(sizeof(MipChain) + size);
+	chain->level_count = level_count;
+	chain->size = size;
+	CopyMemory(chain->levels, levels, level_count * sizeof(MipLevel));
+	CopyMemory(chain->data, image->data, levels[0].size);
+
+	if (level_count == 1)
+		return chain;
+
+	// The f32 of the levels in between ping-pong between two buffers, level 1's size and level 2's.
+	f32* linear[2] = { };
+	u64  linear_floats[2] = { };
+
+	for (u32 i = 1; i < Min(level_count - 1, 3u); i++) {
+		linear_floats[i & 1] = (u64)levels[i].width * levels[i].height * 4;
+		linear[i & 1] = Alloc<f32>(linear_floats[i & 1]);
+	}
+
+	u32  threads = GetJobThreadCount();
+	f32* scratch = null;
+	u64  scratch_stride = 0;
+
+	for (u32 i = 1; i < level_count; i++) {
+		MipLevel* src = &levels[i - 1];
+		MipLevel* dst = &levels[i];
+
+		MipLevelJob job = { };
+		job.horizontal = BuildMipTaps(filter, src->width,  dst->width);
+		job.vertical   = BuildMipTaps(filter, src->height, dst->height);
+		job.src_width  = src->width;
+		job.dst_width  = dst->width;
+		job.dst_height = dst->height;
+		job.src_pixels = i == 1 ? chain->data : null;
+		job.src_linear = i == 1 ? null : linear[(i - 1) & 1];
+		job.dst_linear = i + 1 < level_count ? linear[i & 1] : null;
+		job.dst_pixels = chain->data + dst->offset;
+		job.srgb       = srgb;
+
+		// Level 1 needs the most: level 0's ring and column sum and a row of level 1. The rest only the latter two.
+		if (i == 1) {
+			scratch_stride = ((u64)job.vertical.count + 1) * src->width * 4 + (u64)dst->width * 4;
+			scratch = Alloc<f32>(scratch_stride * threads);
+		}
+
+		job.scratch        = scratch;
+		job.scratch_stride = scratch_stride;
+
+		u32 slabs = (u32)Min((u64)threads, Max((u64)dst->width * dst->height / MIP_MIN_SLAB_PIXELS, (u64)1));
+		job.slab_rows = (dst->height + slabs - 1) / slabs;
+		slabs = (dst->height + job.slab_rows - 1) / job.slab_rows;
+
+		if (slabs == 1)
+			MakeMipSlab(&job, 0);
+		else
+			RunParallel(slabs, MakeMipSlab, &job);
+
+		FreeMipTaps(&job.horizontal, dst->width);
+		FreeMipTaps(&job.vertical,   dst->height);
+	}
+
+	Free(scratch, scratch_stride * threads);
+
+	for (u32 i = 0; i < 2; i++)
+		if (linear[i]) Free(linear[i], linear_floats[i]);
+
+	return chain;
+}
+
+static void FreeMips(MipChain* chain) {
+	if (chain)
+		FreeMemory(chain, sizeof(MipChain) + chain->size);
+}
@@ -0,0 +1,43 @@
+#ifndef MIPS_H
+#define MIPS_H
+
+#include "general.h"
+#include "image.h"
+
+// Mipmap chains for the RGBA8 images image.h decodes, made on the CPU so a texture is uploaded in one copy.
+
+enum MipFilter {
+	MIP_FILTER_BOX,    // Averages the pixels under each destination pixel. The usual 2x2 average, odd sizes included.
+	MIP_FILTER_KAISER, // Kaiser windowed sinc, three lobes. Sharper and less aliased, a few times slower to make.
+};
+
+static const u32 MIP_MAX_LEVELS      = 32;
+static const u32 MIP_LEVEL_ALIGNMENT = 16;
+
+struct MipLevel {
+	u32 width;
+	u32 height;
+	u64 offset; // Into MipChain::data.
+	u64 size;
+};
+
+// Every level of a texture in one allocation, level 0 first and each MIP_LEVEL_ALIGNMENT aligned, so it can be
+// copied into a staging GpuBuffer whole and uploaded with one vkCmdCopyBufferToImage: a VkBufferImageCopy per
+// level with bufferOffset = offset, imageExtent = width x height and mipLevel = the level's index.
+struct MipChain {
+	u32 level_count;
+	MipLevel levels[MIP_MAX_LEVELS];
+	u64 size;
+	u8 data[];
+};
+
+static u32 GetMipLevelCount(u32 width, u32 height); // Down to 1x1.
+
+// Each level is filtered from the one above in f32. With srgb set the colors are decoded to linear light first
+// and encoded again after, otherwise mips of sRGB textures come out darker than the texture looks from afar.
+// Alpha is filtered like a color, so premultiply (pixels.h) anything blended or the transparent pixels' colors
+// bleed into the mips. The rows of each level are split over the job threads (jobs.h).
+static MipChain* GenerateMips(Image* image, MipFilter filter, bool srgb);
+static void      FreeMips(MipChain* chain);
+
+#endif // MIPS_H
@@ -0,0 +1,303 @@
+#include "noise.h"
+#include "simd.h"
+
+static const u32 NOISE_LANES = 8;
+
+// Multiplying lattice coordinates by a different odd constant per axis before mixing them together
+// keeps (x, y) and (y, x) apart. Neighbouring corners are then just one add of the constant away.
+static const u32 NOISE_PRIME_X = 0x8DA6B343;
+static const u32 NOISE_PRIME_Y = 0xD8163841;
+static const u32 NOISE_PRIME_Z = 0xCB1AB31F;
+
+// Scales that bring each noise to roughly [-1, 1], measured over a few million points.
+static const f32 GRADIENT_NOISE_2D_SCALE = 0.66f;
+static const f32 GRADIENT_NOISE_3D_SCALE = 1.0f;
+static const f32 SIMPLEX_NOISE_2D_SCALE  = 45.0f;
+static const f32 SIMPLEX_NOISE_3D_SCALE  = 32.5f;
+
+// lowbias32 by Chris Wellons.
+static inline u32x8 HashLanes(u32x8 h) {
+	h ^= h >> 16;
+	h *= 0x7FEB352D;
+	h ^= h >> 15;
+	h *= 0x846CA68B;
+	h ^= h >> 16;
+	return h;
+}
+
+static inline s32x8 FloorLanes(f32x8 x, f32x8* fraction) {
+	s32x8 i = __builtin_convertvector(x, s32x8);
+	i += (s32x8)(__builtin_convertvector(i, f32x8) > x); // Conversion truncates, step down for negatives.
+	*fraction = x - __builtin_convertvector(i, f32x8);
+	return i;
+}
+
+// 6t^5 - 15t^4 + 10t^3, zero first and second derivatives at the lattice points.
+static inline f32x8 Fade(f32x8 t) { return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f); }
+
+static inline f32x8 Lerp(f32x8 a, f32x8 b, f32x8 t) { return a + t * (b - a); }
+
+// Top 24 bits of the hash as a signed value in [-1, 1).
+static inline f32x8 HashToValue(u32x8 h) {
+	return __builtin_convertvector((s32x8)h >> 8, f32x8) * (1.0f / (1 << 23));
+}
+
+static inline f32x8 FlipSign(f32x8 f, u32x8 sign_bit) { return (f32x8)((u32x8)f ^ sign_bit); }
+
+// One of 8 gradients (+-1, +-2), (+-2, +-1) dotted with (x, y).
+static inline f32x8 Gradient(u32x8 h, f32x8 x, f32x8 y) {
+	s32x8 swap = (s32x8)((h & 4) != 0);
+	f32x8 u = Select(swap, y, x);
+	f32x8 v = Select(swap, x, y);
+	return FlipSign(u, (h & 1) << 31) + FlipSign(v + v, (h & 2) << 30);
+}
+
+// Ken Perlin's 12 edge gradients (+-1, +-1, 0) and permutations, 16 entries with 4 repeated.
+static inline f32x8 Gradient(u32x8 h, f32x8 x, f32x8 y, f32x8 z) {
+	h &= 15;
+	f32x8 u = Select((s32x8)(h < 8), x, y);
+	f32x8 v = Select((s32x8)(h < 4), y, Select((s32x8)((h == 12) | (h == 14)), x, z));
+	return FlipSign(u, (h & 1) << 31) + FlipSign(v, (h & 2) << 30);
+}
+
+// ------------------------------------------------------------------------------------------------ //
+
+static inline f32x8 ValueNoiseLanes(f32x8 x, f32x8 y, u32 seed) {
+	f32x8 fx, fy;
+	u32x8 x0 = (u32x8)FloorLanes(x, &fx) * NOISE_PRIME_X;
+	u32x8 y0 = (u32x8)FloorLanes(y, &fy) * NOISE_PRIME_Y;
+	u32x8 x1 = x0 + NOISE_PRIME_X;
+	u32x8 y1 = y0 + NOISE_PRIME_Y;
+
+	f32x8 v00 = HashToValue(HashLanes(seed ^ x0 ^ y0));
+	f32x8 v10 = HashToValue(HashLanes(seed ^ x1 ^ y0));
+	f32x8 v01 = HashToValue(HashLanes(seed ^ x0 ^ y1));
+	f32x8 v11 = HashToValue(HashLanes(seed ^ x1 ^ y1));
+
+	f32x8 u = Fade(fx);
+	return Lerp(Lerp(v00, v10, u), Lerp(v01, v11, u), Fade(fy));
+}
+
+static inline f32x8 ValueNoiseLanes(f32x8 x, f32x8 y, f32x8 z, u32 seed) {
+	f32x8 fx, fy, fz;
+	u32x8 x0 = (u32x8)FloorLanes(x, &fx) * NOISE_PRIME_X;
+	u32x8 y0 = (u32x8)FloorLanes(y, &fy) * NOISE_PRIME_Y;
+	u32x8 z0 = (u32x8)FloorLanes(z, &fz) * NOISE_PRIME_Z;
+	u32x8 x1 = x0 + NOISE_PRIME_X;
+	u32x8 y1 = y0 + NOISE_PRIME_Y;
+	u32x8 z1 = z0 + NOISE_PRIME_Z;
+
+	f32x8 u = Fade(fx);
+	f32x8 v = Fade(fy);
+
+	f32x8 near = Lerp(Lerp(HashToValue(HashLanes(seed ^ x0 ^ y0 ^ z0)), HashToValue(HashLanes(seed ^ x1 ^ y0 ^ z0)), u),
+	                  Lerp(HashToValue(HashLanes(seed ^ x0 ^ y1 ^ z0)), HashToValue(HashLanes(seed ^ x1 ^ y1 ^ z0)), u), v);
+	f32x8 far  = Lerp(Lerp(HashToValue(HashLanes(seed ^ x0 ^ y0 ^ z1)), HashToValue(HashLanes(seed ^ x1 ^ y0 ^ z1)), u),
+	                  Lerp(HashToValue(HashLanes(seed ^ x0 ^ y1 ^ z1)), HashToValue(HashLanes(seed ^ x1 ^ y1 ^ z1)), u), v);
+
+	return Lerp(near, far, Fade(fz));
+}
+
+static inline f32x8 GradientNoiseLanes(f32x8 x, f32x8 y, u32 seed) {
+	f32x8 fx, fy;
+	u32x8 x0 = (u32x8)FloorLanes(x, &fx) * NOISE_PRIME_X;
+	u32x8 y0 = (u32x8)FloorLanes(y, &fy) * NOISE_PRIME_Y;
+	u32x8 x1 = x0 + NOISE_PRIME_X;
+	u32x8 y1 = y0 + NOISE_PRIME_Y;
+
+	f32x8 n00 = Gradient(HashLanes(seed ^ x0 ^ y0), fx,        fy);
+	f32x8 n10 = Gradient(HashLanes(seed ^ x1 ^ y0), fx - 1.0f, fy);
+	f32x8 n01 = Gradient(HashLanes(seed ^ x0 ^ y1), fx,        fy - 1.0f);
+	f32x8 n11 = Gradient(HashLanes(seed ^ x1 ^ y1), fx - 1.0f, fy - 1.0f);
+
+	f32x8 u = Fade(fx);
+	return Lerp(Lerp(n00, n10, u), Lerp(n01, n11, u), Fade(fy)) * GRADIENT_NOISE_2D_SCALE;
+}
+
+static inline f32x8 GradientNoiseLanes(f32x8 x, f32x8 y, f32x8 z, u32 seed) {
+	f32x8 fx, fy, fz;
+	u32x8 x0 = (u32x8)FloorLanes(x, &fx) * NOISE_PRIME_X;
+	u32x8 y0 = (u32x8)FloorLanes(y, &fy) * NOISE_PRIME_Y;
+	u32x8 z0 = (u32x8)FloorLanes(z, &fz) * NOISE_PRIME_Z;
+	u32x8 x1 = x0 + NOISE_PRIME_X;
+	u32x8 y1 = y0 + NOISE_PRIME_Y;
+	u32x8 z1 = z0 + NOISE_PRIME_Z;
+	f32x8 gx = fx - 1.0f;
+	f32x8 gy = fy - 1.0f;
+	f32x8 gz = fz - 1.0f;
+
+	f32x8 u = Fade(fx);
+	f32x8 v = Fade(fy);
+
+	f32x8 near = Lerp(Lerp(Gradient(HashLanes(seed ^ x0 ^ y0 ^ z0), fx, fy, fz), Gradient(HashLanes(seed ^ x1 ^ y0 ^ z0), gx, fy, fz), u),
+	                  Lerp(Gradient(HashLanes(seed ^ x0 ^ y1 ^ z0), fx, gy, fz), Gradient(HashLanes(seed ^ x1 ^ y1 ^ z0), gx, gy, fz), u), v);
+	f32x8 far  = Lerp(Lerp(Gradient(HashLanes(seed ^ x0 ^ y0 ^ z1), fx, fy, gz), Gradient(HashLanes(seed ^ x1 ^ y0 ^ z1), gx, fy, gz), u),
+	                  Lerp(Gradient(HashLanes(seed ^ x0 ^ y1 ^ z1), fx, gy, gz), Gradient(HashLanes(seed ^ x1 ^ y1 ^ z1), gx, gy, gz), u), v);
+
+	return Lerp(near, far, Fade(fz)) * GRADIENT_NOISE_3D_SCALE;
+}
+
+// Contribution of one simplex corner: (r^2 - d^2)^4 * gradient, zero outside the radius.
+static inline f32x8 SimplexCorner(f32x8 r2, u32x8 h, f32x8 x, f32x8 y) {
+	f32x8 t = MaxF32x8(r2 - x*x - y*y, BroadcastF32x8(0.0f));
+	t *= t;
+	return t * t * Gradient(h, x, y);
+}
+
+static inline f32x8 SimplexCorner(f32x8 r2, u32x8 h, f32x8 x, f32x8 y, f32x8 z) {
+	f32x8 t = MaxF32x8(r2 - x*x - y*y - z*z, BroadcastF32x8(0.0f));
+	t *= t;
+	return t * t * Gradient(h, x, y, z);
+}
+
+// Stefan Gustavson's "Simplex noise demystified" with the branches on the corner order replaced by masks.
+static inline f32x8 SimplexNoiseLanes(f32x8 x, f32x8 y, u32 seed) {
+	const f32 F2 = 0.366025403784438647f; // (sqrt(3) - 1) / 2
+	const f32 G2 = 0.211324865405187118f; // (3 - sqrt(3)) / 6
+
+	f32x8 s = (x + y) * F2;
+	f32x8 unused;
+	s32x8 i = FloorLanes(x + s, &unused);
+	s32x8 j = FloorLanes(y + s, &unused);
+
+	f32x8 t  = __builtin_convertvector(i + j, f32x8) * G2;
+	f32x8 x0 = x - (__builtin_convertvector(i, f32x8) - t);
+	f32x8 y0 = y - (__builtin_convertvector(j, f32x8) - t);
+
+	// Lower or upper triangle of the skewed square.
+	s32x8 lower = (s32x8)(x0 > y0);
+	u32x8 i1 = (u32x8)lower & 1;
+	u32x8 j1 = i1 ^ 1;
+
+	f32x8 x1 = x0 - __builtin_convertvector(i1, f32x8) + G2;
+	f32x8 y1 = y0 - __builtin_convertvector(j1, f32x8) + G2;
+	f32x8 x2 = x0 - 1.0f + 2.0f*G2;
+	f32x8 y2 = y0 - 1.0f + 2.0f*G2;
+
+	u32x8 xp = (u32x8)i * NOISE_PRIME_X;
+	u32x8 yp = (u32x8)j * NOISE_PRIME_Y;
+	u32x8 h0 = HashLanes(seed ^ xp ^ yp);
+	u32x8 h1 = HashLanes(seed ^ (xp + i1*NOISE_PRIME_X) ^ (yp + j1*NOISE_PRIME_Y));
+	u32x8 h2 = HashLanes(seed ^ (xp + NOISE_PRIME_X) ^ (yp + NOISE_PRIME_Y));
+
+	f32x8 r2 = BroadcastF32x8(0.5f);
+	return (SimplexCorner(r2, h0, x0, y0) + SimplexCorner(r2, h1, x1, y1) + SimplexCorner(r2, h2, x2, y2)) * SIMPLEX_NOISE_2D_SCALE;
+}
+
+static inline f32x8 SimplexNoiseLanes(f32x8 x, f32x8 y, f32x8 z, u32 seed) {
+	const f32 F3 = 1.0f / 3.0f;
+	const f32 G3 = 1.0f / 6.0f;
+
+	f32x8 s = (x + y + z) * F3;
+	f32x8 unused;
+	s32x8 i = FloorLanes(x + s, &unused);
+	s32x8 j = FloorLanes(y + s, &unused);
+	s32x8 k = FloorLanes(z + s, &unused);
+
+	f32x8 t  = __builtin_convertvector(i + j + k, f32x8) * G3;
+	f32x8 x0 = x - (__builtin_convertvector(i, f32x8) - t);
+	f32x8 y0 = y - (__builtin_convertvector(j, f32x8) - t);
+	f32x8 z0 = z - (__builtin_convertvector(k, f32x8) - t);
+
+	// Which of the six tetrahedra we're in, the second and third corners step along the largest coordinates first.
+	s32x8 xy = (s32x8)(x0 >= y0);
+	s32x8 yz = (s32x8)(y0 >= z0);
+	s32x8 xz = (s32x8)(x0 >= z0);
+
+	u32x8 i1 = (u32x8)( xy &  xz) & 1;
+	u32x8 j1 = (u32x8)(~xy &  yz) & 1;
+	u32x8 k1 = (u32x8)(~xz & ~yz) & 1;
+	u32x8 i2 = (u32x8)( xy |  xz) & 1;
+	u32x8 j2 = (u32x8)(~xy |  yz) & 1;
+	u32x8 k2 = (u32x8)(~xz | ~yz) & 1;
+
+	f32x8 x1 = x0 - __builtin_convertvector(i1, f32x8) + G3;
+	f32x8 y1 = y0 - __builtin_convertvector(j1, f32x8) + G3;
+	f32x8 z1 = z0 - __builtin_convertvector(k1, f32x8) + G3;
+	f32x8 x2 = x0 - __builtin_convertvector(i2, f32x8) + 2.0f*G3;
+	f32x8 y2 = y0 - __builtin_convertvector(j2, f32x8) + 2.0f*G3;
+	f32x8 z2 = z0 - __builtin_convertvector(k2, f32x8) + 2.0f*G3;
+	f32x8 x3 = x0 - 1.0f + 3.0f*G3;
+	f32x8 y3 = y0 - 1.0f + 3.0f*G3;
+	f32x8 z3 = z0 - 1.0f + 3.0f*G3;
+
+	u32x8 xp = (u32x8)i * NOISE_PRIME_X;
+	u32x8 yp = (u32x8)j * NOISE_PRIME_Y;
+	u32x8 zp = (u32x8)k * NOISE_PRIME_Z;
+	u32x8 h0 = HashLanes(seed ^ xp ^ yp ^ zp);
+	u32x8 h1 = HashLanes(seed ^ (xp + i1*NOISE_PRIME_X) ^ (yp + j1*NOISE_PRIME_Y) ^ (zp + k1*NOISE_PRIME_Z));
+	u32x8 h2 = HashLanes(seed ^ (xp + i2*NOISE_PRIME_X) ^ (yp + j2*NOISE_PRIME_Y) ^ (zp + k2*NOISE_PRIME_Z));
+	u32x8 h3 = HashLanes(seed ^ (xp + NOISE_PRIME_X) ^ (yp + NOISE_PRIME_Y) ^ (zp + NOISE_PRIME_Z));
+
+	f32x8 r2 = BroadcastF32x8(0.6f);
+	f32x8 n = SimplexCorner(r2, h0, x0, y0, z0) + SimplexCorner(r2, h1, x1, y1, z1)
+	        + SimplexCorner(r2, h2, x2, y2, z2) + SimplexCorner(r2, h3, x3, y3, z3);
+	return n * SIMPLEX_NOISE_3D_SCALE;
+}
+
+// ------------------------------------------------------------------------------------------------ //
+
+// Runs a lane kernel over SoA points. The tail is padded out to a full group so it takes the same path.
+template<typename F>
+static inline void FillNoise(f32* out, Vector2Soa points, u64 count, F lanes) {
+	u64 i = 0;
+
+	for (; i + NOISE_LANES <= count; i += NOISE_LANES)
+		StoreF32x8(out + i, lanes(LoadF32x8(points.x + i), LoadF32x8(points.y + i)));
+
+	if (i < count) {
+		f32 x[NOISE_LANES] = { }, y[NOISE_LANES] = { }, result[NOISE_LANES];
+		CopyMemory(x, points.x + i, (count - i) * sizeof(f32));
+		CopyMemory(y, points.y + i, (count - i) * sizeof(f32));
+		StoreF32x8(result, lanes(LoadF32x8(x), LoadF32x8(y)));
+		CopyMemory(out + i, result, (count - i) * sizeof(f32));
+	}
+}
+
+template<typename F>
+static inline void FillNoise(f32* out, Vector3Soa points, u64 count, F lanes) {
+	u64 i = 0;
+
+	for (; i + NOISE_LANES <= count; i += NOISE_LANES)
+		StoreF32x8(out + i, lanes(LoadF32x8(points.x + i), LoadF32x8(points.y + i), LoadF32x8(points.z + i)));
+
+	if (i < count) {
+		f32 x[NOISE_LANES] = { }, y[NOISE_LANES] = { }, z[NOISE_LANES] = { }, result[NOISE_LANES];
+		CopyMemory(x, points.x + i, (count - i) * sizeof(f32));
+		CopyMemory(y, points.y + i, (count - i) * sizeof(f32));
+		CopyMemory(z, points.z + i, (count - i) * sizeof(f32));
+		StoreF32x8(result, lanes(LoadF32x8(x), LoadF32x8(y), LoadF32x8(z)));
+		CopyMemory(out + i, result, (count - i) * sizeof(f32));
+	}
+}
+
+static void ValueNoise(f32* out, Vector2Soa points, u64 count, u32 seed) {
+	FillNoise(out, points, count, [=](f32x8 x, f32x8 y) { return ValueNoiseLanes(x, y, seed); });
+}
+
+static void ValueNoise(f32* out, Vector3Soa points, u64 count, u32 seed) {
+	FillNoise(out, points, count, [=](f32x8 x, f32x8 y, f32x8 z) { return ValueNoiseLanes(x, y, z, seed); });
+}
+
+static void GradientNoise(f32* out, Vector2Soa points, u64 count, u32 seed) {
+	FillNoise(out, points, count, [=](f32x8 x, f32x8 y) { return GradientNoiseLanes(x, y, seed); });
+}
+
+static void GradientNoise(f32* out, Vector3Soa points, u64 count, u32 seed) {
+	FillNoise(out, points, count, [=](f32x8 x, f32x8 y, f32x8 z) { return GradientNoiseLanes(x, y, z, seed); });
+}
+
+static void SimplexNoise(f32* out, Vector2Soa points, u64 count, u32 seed) {
+	FillNoise(out, points, count, [=](f32x8 x, f32x8 y) { return SimplexNoiseLanes(x, y, seed); });
+}
+
+static void SimplexNoise(f32* out, Vector3Soa points, u64 count, u32 seed) {
+	FillNoise(out, points, count, [=](f32x8 x, f32x8 y, f32x8 z) { return SimplexNoiseLanes(x, y, z, seed); });
+}
+
+static f32 ValueNoise(Vector2 p, u32 seed)    { return ValueNoiseLanes(BroadcastF32x8(p.x), BroadcastF32x8(p.y), seed)[0]; }
+static f32 ValueNoise(Vector3 p, u32 seed)    { return ValueNoiseLanes(BroadcastF32x8(p.x), BroadcastF32x8(p.y), BroadcastF32x8(p.z), seed)[0]; }
+static f32 GradientNoise(Vector2 p, u32 seed) { return GradientNoiseLanes(BroadcastF32x8(p.x), BroadcastF32x8(p.y), seed)[0]; }
+static f32 GradientNoise(Vector3 p, u32 seed) { return GradientNoiseLanes(BroadcastF32x8(p.x), BroadcastF32x8(p.y), BroadcastF32x8(p.z), seed)[0]; }
+static f32 SimplexNoise(Vector2 p, u32 seed)  { return SimplexNoiseLanes(BroadcastF32x8(p.x), BroadcastF32x8(p.y), seed)[0]; }
+static f32 SimplexNoise(Vector3 p, u32 seed)  { return SimplexNoiseLanes(BroadcastF32x8(p.x), BroadcastF32x8(p.y), BroadcastF32x8(p.z), seed)[0]; }
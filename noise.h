@@ -0,0 +1,27 @@
+#ifndef NOISE_H
+#define NOISE_H
+
+#include "general.h"
+#include "vector.h"
+#include "math_batch.h"
+
+// Value, gradient (Perlin) and simplex noise in 2D and 3D, roughly in [-1, 1].
+// Lattice points are hashed with the seed instead of looked up in a permutation table, so there is no
+// period and no setup. Everything goes through the same 8 lane kernel, the single point versions included,
+// so a point gives the same value no matter how the samples are batched or split between threads.
+
+static void ValueNoise(f32* out, Vector2Soa points, u64 count, u32 seed);
+static void ValueNoise(f32* out, Vector3Soa points, u64 count, u32 seed);
+static void GradientNoise(f32* out, Vector2Soa points, u64 count, u32 seed);
+static void GradientNoise(f32* out, Vector3Soa points, u64 count, u32 seed);
+static void SimplexNoise(f32* out, Vector2Soa points, u64 count, u32 seed);
+static void SimplexNoise(f32* out, Vector3Soa points, u64 count, u32 seed);
+
+static f32 ValueNoise(Vector2 p, u32 seed);
+static f32 ValueNoise(Vector3 p, u32 seed);
+static f32 GradientNoise(Vector2 p, u32 seed);
+static f32 GradientNoise(Vector3 p, u32 seed);
+static f32 SimplexNoise(Vector2 p, u32 seed);
+static f32 SimplexNoise(Vector3 p, u32 seed);
+
+#endif // NOISE_H
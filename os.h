@@ -20,7 +20,28 @@ static void* AllocPages(u64 size);
 static void  FreePages(void* p, u64 size);
 
 static u64 GetTimeMicroseconds();
+static u64 GetTimeNanoseconds(); // Monotonic, for measuring intervals.
 
 static void ExitProgram();
 
+// Runs a program found on PATH with a null terminated argument list (arguments[0] is the program) and waits
+// for it. Returns its exit status, -1 if it couldn't be started or didn't exit normally.
+static s32 RunProcess(char** arguments);
+
+typedef u64 ThreadHandle;
+
+static ThreadHandle CreateThread(void (*function)(void*), void* argument);
+static void         JoinThread(ThreadHandle thread);
+static void         SleepNanoseconds(u64 nanoseconds);
+static void         YieldThread();
+static u32          GetProcessorCount(); // Online logical processors.
+
+// Counting semaphore for handing work between threads, waiting sleeps until the count is above zero.
+typedef void* Semaphore;
+
+static Semaphore CreateSemaphore(u32 count);
+static void      DestroySemaphore(Semaphore semaphore);
+static void      SignalSemaphore(Semaphore semaphore, u32 count = 1);
+static void      WaitSemaphore(Semaphore semaphore);
+
 #endif // OS_H
@@ -0,0 +1,134 @@
+#include "packing.h"
+#include "simd.h"
+
+// Vector versions of PackHalf/UnpackHalf from packing.h, same bit tricks with selects instead of branches.
+static inline u16x4 PackHalfLanes(f32x4 v) {
+#if defined(__F16C__)
+	__m128i halves = _mm_cvtps_ph((__m128)v, _MM_FROUND_TO_NEAREST_INT);
+	return LoadVector<u16x4>(&halves);
+#else
+	u32x4 x    = (u32x4)v;
+	u32x4 sign = (x & 0x80000000) >> 16;
+	x &= 0x7FFFFFFF;
+
+	u32x4 magic     = (u32x4){ 0, 0, 0, 0 } + ((u32)((127 - 15) + (23 - 10) + 1) << 23);
+	u32x4 subnormal = (u32x4)((f32x4)x + (f32x4)magic) - magic;
+	u32x4 normal    = (x + (((u32)(15 - 127) << 23) + 0xFFF) + ((x >> 13) & 1)) >> 13;
+	u32x4 infnan    = 0x7C00 | ((u32x4)(x > 0x7F800000) & (0x0200 | (x >> 13 & 0x3FF)));
+
+	u32x4 result = Select(x < (113 << 23), subnormal, normal);
+	result = Select(x >= ((127 + 16) << 23), infnan, result);
+
+	return __builtin_convertvector(result | sign, u16x4);
+#endif
+}
+
+static inline f32x4 UnpackHalfLanes(u16x4 h) {
+#if defined(__F16C__)
+	__m128i halves = { };
+	CopyMemory(&halves, &h, sizeof(h));
+	return (f32x4)_mm_cvtph_ps(halves);
+#else
+	u32x4 x = __builtin_convertvector(h, u32x4);
+	f32x4 f = (f32x4)((x & 0x7FFF) << 13) * BroadcastF32x4(__builtin_bit_cast(f32, (u32)(254 - 15) << 23));
+
+	u32x4 bits = (u32x4)f;
+	bits |= (u32x4)(f >= __builtin_bit_cast(f32, (u32)(127 + 16) << 23)) & (0xFF << 23);
+	bits |= (u32x4)((x & 0x7FFF) > 0x7C00) & (1 << 22);
+	return (f32x4)(bits | (x & 0x8000) << 16);
+#endif
+}
+
+static void PackHalf(u16* dst, const f32* src, u64 count) {
+	u64 i = 0;
+
+	for (; i + 4 <= count; i += 4)
+		StoreVector(dst + i, PackHalfLanes(LoadF32x4(src + i)));
+
+	for (; i < count; i++)
+		dst[i] = PackHalf(src[i]);
+}
+
+static void UnpackHalf(f32* dst, const u16* src, u64 count) {
+	u64 i = 0;
+
+	for (; i + 4 <= count; i += 4)
+		StoreF32x4(dst + i, UnpackHalfLanes(LoadVector<u16x4>(src + i)));
+
+	for (; i < count; i++)
+		dst[i] = UnpackHalf(src[i]);
+}
+
+// Clamp, scale and round half away from zero. The conversion to int truncates, so add +-0.5 first.
+static inline s32x4 NormalizedLanes(f32x4 v, f32 lo, f32 hi, f32 scale) {
+	v = MinF32x4(MaxF32x4(v, BroadcastF32x4(lo)), BroadcastF32x4(hi)) * scale;
+	v += Select(v < 0, BroadcastF32x4(-0.5f), BroadcastF32x4(0.5f));
+	return __builtin_convertvector(v, s32x4);
+}
+
+template<typename T, typename TLanes>
+static void PackNormalized(T* dst, const f32* src, u64 count, f32 lo, f32 scale, T (*pack)(f32)) {
+	u64 i = 0;
+
+	for (; i + 4 <= count; i += 4)
+		StoreVector(dst + i, __builtin_convertvector(NormalizedLanes(LoadF32x4(src + i), lo, 1.0f, scale), TLanes));
+
+	for (; i < count; i++)
+		dst[i] = pack(src[i]);
+}
+
+template<typename T, typename TLanes>
+static void UnpackNormalized(f32* dst, const T* src, u64 count, f32 max, f32 (*unpack)(T)) {
+	u64 i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		f32x4 v = __builtin_convertvector(LoadVector<TLanes>(src + i), f32x4) / max; // Divide to match the scalar versions exactly.
+		StoreF32x4(dst + i, MaxF32x4(v, BroadcastF32x4(-1.0f)));
+	}
+
+	for (; i < count; i++)
+		dst[i] = unpack(src[i]);
+}
+
+static void PackUnorm8(u8* dst, const f32* src, u64 count)    { PackNormalized<u8,  u8x4> (dst, src, count,  0.0f, 255.0f,   PackUnorm8);  }
+static void PackSnorm8(s8* dst, const f32* src, u64 count)    { PackNormalized<s8,  s8x4> (dst, src, count, -1.0f, 127.0f,   PackSnorm8);  }
+static void PackUnorm16(u16* dst, const f32* src, u64 count)  { PackNormalized<u16, u16x4>(dst, src, count,  0.0f, 65535.0f, PackUnorm16); }
+static void PackSnorm16(s16* dst, const f32* src, u64 count)  { PackNormalized<s16, s16x4>(dst, src, count, -1.0f, 32767.0f, PackSnorm16); }
+
+static void UnpackUnorm8(f32* dst, const u8* src, u64 count)   { UnpackNormalized<u8,  u8x4> (dst, src, count, 255.0f,   UnpackUnorm8);  }
+static void UnpackSnorm8(f32* dst, const s8* src, u64 count)   { UnpackNormalized<s8,  s8x4> (dst, src, count, 127.0f,   UnpackSnorm8);  }
+static void UnpackUnorm16(f32* dst, const u16* src, u64 count) { UnpackNormalized<u16, u16x4>(dst, src, count, 65535.0f, UnpackUnorm16); }
+static void UnpackSnorm16(f32* dst, const s16* src, u64 count) { UnpackNormalized<s16, s16x4>(dst, src, count, 32767.0f, UnpackSnorm16); }
+
+static void PackUnorm8x4(u32* dst, const f32* src, u64 count) {
+	for (u64 i = 0; i < count; i++) {
+		s32x4 n = NormalizedLanes(LoadF32x4(src + i*4), 0.0f, 1.0f, 255.0f);
+		dst[i] = __builtin_bit_cast(u32, __builtin_convertvector(n, u8x4));
+	}
+}
+
+static void PackUnorm1010102(u32* dst, const f32* src, u64 count) {
+	const f32x4 scale = { 1023.0f, 1023.0f, 1023.0f, 3.0f };
+	const u32x4 shift = { 0, 10, 20, 30 };
+
+	for (u64 i = 0; i < count; i++) {
+		// Scaled and rounded in two statements, a fused multiply-add would round ties differently from the scalar version.
+		f32x4 v = MinF32x4(MaxF32x4(LoadF32x4(src + i*4), BroadcastF32x4(0.0f)), BroadcastF32x4(1.0f)) * scale;
+		v += 0.5f;
+		u32x4 n = __builtin_convertvector(v, u32x4) << shift;
+		dst[i] = n[0] | n[1] | n[2] | n[3];
+	}
+}
+
+static void PackSnorm1010102(u32* dst, const f32* src, u64 count) {
+	const f32x4 scale = { 511.0f, 511.0f, 511.0f, 1.0f };
+	const u32x4 mask  = { 0x3FF, 0x3FF, 0x3FF, 0x3 };
+	const u32x4 shift = { 0, 10, 20, 30 };
+
+	for (u64 i = 0; i < count; i++) {
+		f32x4 v = MinF32x4(MaxF32x4(LoadF32x4(src + i*4), BroadcastF32x4(-1.0f)), BroadcastF32x4(1.0f)) * scale;
+		v += Select(v < 0, BroadcastF32x4(-0.5f), BroadcastF32x4(0.5f));
+		u32x4 n = ((u32x4)__builtin_convertvector(v, s32x4) & mask) << shift;
+		dst[i] = n[0] | n[1] | n[2] | n[3];
+	}
+}
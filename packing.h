@@ -0,0 +1,118 @@
+#ifndef PACKING_H
+#define PACKING_H
+
+#include "general.h"
+#include "math.h"
+#include "vector.h"
+
+// Conversions between f32 and the compact vertex formats Vulkan can read directly.
+// All of them round to nearest, the worst case error after a round-trip is:
+//
+//   f16            relative 2^-11 in the normal range, absolute 2^-25 for subnormals.
+//   snorm8/unorm8  1/254 and 1/510.
+//   snorm16/unorm16 1/65534 and 1/131070.
+//   10:10:10:2     1/2046 for the unorm rgb channels (1/1022 snorm), 1/6 (1 snorm) for alpha.
+//
+// Values outside of a normalized format's range are clamped and out-of-range f16 becomes inf. Nans stay nans,
+// made quiet and keeping the top of the payload, as the F16C instructions do.
+
+static constexpr u16 PackHalf(f32 f) {
+	u32 x    = __builtin_bit_cast(u32, f);
+	u32 sign = (x & 0x80000000) >> 16;
+	x &= 0x7FFFFFFF;
+
+	if (x >= (127 + 16) << 23)
+		return sign | (x > 0x7F800000 ? 0x7E00 | (x >> 13 & 0x3FF) : 0x7C00); // NaN or overflow to inf.
+
+	if (x < 113 << 23) {
+		// Subnormal half: adding the magic number lines the 10 mantissa bits up at the bottom and rounds for us.
+		f32 magic = __builtin_bit_cast(f32, (u32)((127 - 15) + (23 - 10) + 1) << 23);
+		return sign | (__builtin_bit_cast(u32, __builtin_bit_cast(f32, x) + magic) - __builtin_bit_cast(u32, magic));
+	}
+
+	// Rebias the exponent and round to nearest even.
+	u32 odd = (x >> 13) & 1;
+	x += ((u32)(15 - 127) << 23) + 0xFFF + odd;
+	return sign | (x >> 13);
+}
+
+static constexpr f32 UnpackHalf(u16 h) {
+	f32 magic = __builtin_bit_cast(f32, (u32)(254 - 15) << 23);
+	f32 f = __builtin_bit_cast(f32, (u32)(h & 0x7FFF) << 13) * magic;
+
+	u32 x = __builtin_bit_cast(u32, f);
+	if (f >= __builtin_bit_cast(f32, (u32)(127 + 16) << 23))
+		x |= 0xFF << 23 | (u32)((h & 0x7FFF) > 0x7C00) << 22; // Keep inf and nan, quiet.
+
+	return __builtin_bit_cast(f32, x | (u32)(h & 0x8000) << 16);
+}
+
+static constexpr s32 RoundToInt(f32 f) { return (s32)(f + (f < 0 ? -0.5f : 0.5f)); }
+
+static constexpr u8  PackUnorm8(f32 f)   { return (u8) RoundToInt(Min(Max(f,  0.0f), 1.0f) * 255.0f);   }
+static constexpr s8  PackSnorm8(f32 f)   { return (s8) RoundToInt(Min(Max(f, -1.0f), 1.0f) * 127.0f);   }
+static constexpr u16 PackUnorm16(f32 f)  { return (u16)RoundToInt(Min(Max(f,  0.0f), 1.0f) * 65535.0f); }
+static constexpr s16 PackSnorm16(f32 f)  { return (s16)RoundToInt(Min(Max(f, -1.0f), 1.0f) * 32767.0f); }
+
+static constexpr f32 UnpackUnorm8(u8 n)   { return n / 255.0f; }
+static constexpr f32 UnpackSnorm8(s8 n)   { return Max(n / 127.0f, -1.0f); }
+static constexpr f32 UnpackUnorm16(u16 n) { return n / 65535.0f; }
+static constexpr f32 UnpackSnorm16(s16 n) { return Max(n / 32767.0f, -1.0f); }
+
+// Four unorm8 channels, x in the low byte. Matches VK_FORMAT_R8G8B8A8_UNORM.
+static constexpr u32 PackUnorm8x4(Vector4 v) {
+	return (u32)PackUnorm8(v.x) | (u32)PackUnorm8(v.y) << 8 | (u32)PackUnorm8(v.z) << 16 | (u32)PackUnorm8(v.w) << 24;
+}
+
+static constexpr Vector4 UnpackUnorm8x4(u32 n) {
+	return Vector4(UnpackUnorm8(n), UnpackUnorm8(n >> 8), UnpackUnorm8(n >> 16), UnpackUnorm8(n >> 24));
+}
+
+// x in bits 0..9, y in 10..19, z in 20..29, w in 30..31. Matches VK_FORMAT_A2B10G10R10_UNORM_PACK32.
+static constexpr u32 PackUnorm1010102(Vector4 v) {
+	u32 x = RoundToInt(Min(Max(v.x, 0.0f), 1.0f) * 1023.0f);
+	u32 y = RoundToInt(Min(Max(v.y, 0.0f), 1.0f) * 1023.0f);
+	u32 z = RoundToInt(Min(Max(v.z, 0.0f), 1.0f) * 1023.0f);
+	u32 w = RoundToInt(Min(Max(v.w, 0.0f), 1.0f) * 3.0f);
+	return x | y << 10 | z << 20 | w << 30;
+}
+
+static constexpr Vector4 UnpackUnorm1010102(u32 n) {
+	return Vector4((n & 0x3FF) / 1023.0f, (n >> 10 & 0x3FF) / 1023.0f, (n >> 20 & 0x3FF) / 1023.0f, (n >> 30) / 3.0f);
+}
+
+// Same layout, VK_FORMAT_A2B10G10R10_SNORM_PACK32. Handy for normals and tangents.
+static constexpr u32 PackSnorm1010102(Vector4 v) {
+	u32 x = RoundToInt(Min(Max(v.x, -1.0f), 1.0f) * 511.0f);
+	u32 y = RoundToInt(Min(Max(v.y, -1.0f), 1.0f) * 511.0f);
+	u32 z = RoundToInt(Min(Max(v.z, -1.0f), 1.0f) * 511.0f);
+	u32 w = RoundToInt(Min(Max(v.w, -1.0f), 1.0f));
+	return (x & 0x3FF) | (y & 0x3FF) << 10 | (z & 0x3FF) << 20 | w << 30;
+}
+
+static constexpr Vector4 UnpackSnorm1010102(u32 n) {
+	// Shift each field to the top so the arithmetic shift back down sign extends it.
+	s32 x = (s32)(n << 22) >> 22;
+	s32 y = (s32)(n << 12) >> 22;
+	s32 z = (s32)(n <<  2) >> 22;
+	s32 w = (s32)n >> 30;
+	return Vector4(Max(x / 511.0f, -1.0f), Max(y / 511.0f, -1.0f), Max(z / 511.0f, -1.0f), Max((f32)w, -1.0f));
+}
+
+// Batched versions for filling vertex and instance buffers. They vectorize and use F16C when the target has it.
+// The 1010102 and 8x4 versions read 4 floats per element.
+static void PackHalf(u16* dst, const f32* src, u64 count);
+static void UnpackHalf(f32* dst, const u16* src, u64 count);
+static void PackUnorm8(u8* dst, const f32* src, u64 count);
+static void PackSnorm8(s8* dst, const f32* src, u64 count);
+static void PackUnorm16(u16* dst, const f32* src, u64 count);
+static void PackSnorm16(s16* dst, const f32* src, u64 count);
+static void UnpackUnorm8(f32* dst, const u8* src, u64 count);
+static void UnpackSnorm8(f32* dst, const s8* src, u64 count);
+static void UnpackUnorm16(f32* dst, const u16* src, u64 count);
+static void UnpackSnorm16(f32* dst, const s16* src, u64 count);
+static void PackUnorm8x4(u32* dst, const f32* src, u64 count);
+static void PackUnorm1010102(u32* dst, const f32* src, u64 count);
+static void PackSnorm1010102(u32* dst, const f32* src, u64 count);
+
+#endif // PACKING_H
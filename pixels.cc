@@ -0,0 +1,205 @@
+#include "pixels.h"
+#include "simd.h"
+#include "const_math.h"
+
+static const u8x16 opaque_alpha = { 0, 0, 0, 0xFF, 0, 0, 0, 0xFF, 0, 0, 0, 0xFF, 0, 0, 0, 0xFF };
+
+static void ExpandGrayToRgba(u8* dst, const u8* src, u64 count) {
+	u64 i = 0;
+
+	for (; i + 16 <= count; i += 16) {
+		u8x16 v = LoadVector<u8x16>(src + i);
+		u8* out = dst + i * 4;
+		StoreVector(out,      __builtin_shufflevector(v, v, 0,  0,  0,  0,  1,  1,  1,  1,  2,  2,  2,  2,  3,  3,  3,  3)  | opaque_alpha);
+		StoreVector(out + 16, __builtin_shufflevector(v, v, 4,  4,  4,  4,  5,  5,  5,  5,  6,  6,  6,  6,  7,  7,  7,  7)  | opaque_alpha);
+		StoreVector(out + 32, __builtin_shufflevector(v, v, 8,  8,  8,  8,  9,  9,  9,  9,  10, 10, 10, 10, 11, 11, 11, 11) | opaque_alpha);
+		StoreVector(out + 48, __builtin_shufflevector(v, v, 12, 12, 12, 12, 13, 13, 13, 13, 14, 14, 14, 14, 15, 15, 15, 15) | opaque_alpha);
+	}
+
+	for (; i < count; i++) {
+		u8* out = dst + i * 4;
+		out[0] = out[1] = out[2] = src[i];
+		out[3] = 0xFF;
+	}
+}
+
+static void ExpandGrayAlphaToRgba(u8* dst, const u8* src, u64 count) {
+	u64 i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		u8x16 v = LoadVector<u8x16>(src + i * 2);
+		u8* out = dst + i * 4;
+		StoreVector(out,      __builtin_shufflevector(v, v, 0, 0, 0, 1, 2,  2,  2,  3,  4,  4,  4,  5,  6,  6,  6,  7));
+		StoreVector(out + 16, __builtin_shufflevector(v, v, 8, 8, 8, 9, 10, 10, 10, 11, 12, 12, 12, 13, 14, 14, 14, 15));
+	}
+
+	for (; i < count; i++) {
+		u8* out = dst + i * 4;
+		out[0] = out[1] = out[2] = src[i * 2];
+		out[3] = src[i * 2 + 1];
+	}
+}
+
+static void ExpandRgbToRgba(u8* dst, const u8* src, u64 count) {
+	u64 i = 0;
+
+	// 16 pixels are 48 bytes in and 64 out. Each output vector takes 12 bytes that may straddle two input vectors.
+	for (; i + 16 <= count; i += 16) {
+		const u8* in = src + i * 3;
+		u8x16 a = LoadVector<u8x16>(in);
+		u8x16 b = LoadVector<u8x16>(in + 16);
+		u8x16 c = LoadVector<u8x16>(in + 32);
+		u8* out = dst + i * 4;
+		StoreVector(out,      __builtin_shufflevector(a, a, 0,  1,  2,  0, 3,  4,  5,  0, 6,  7,  8,  0, 9,  10, 11, 0) | opaque_alpha);
+		StoreVector(out + 16, __builtin_shufflevector(a, b, 12, 13, 14, 0, 15, 16, 17, 0, 18, 19, 20, 0, 21, 22, 23, 0) | opaque_alpha);
+		StoreVector(out + 32, __builtin_shufflevector(b, c, 8,  9,  10, 0, 11, 12, 13, 0, 14, 15, 16, 0, 17, 18, 19, 0) | opaque_alpha);
+		StoreVector(out + 48, __builtin_shufflevector(c, c, 4,  5,  6,  0, 7,  8,  9,  0, 10, 11, 12, 0, 13, 14, 15, 0) | opaque_alpha);
+	}
+
+	for (; i < count; i++) {
+		u8* out = dst + i * 4;
+		out[0] = src[i * 3];
+		out[1] = src[i * 3 + 1];
+		out[2] = src[i * 3 + 2];
+		out[3] = 0xFF;
+	}
+}
+
+static void SwapRedBlue(u8* dst, const u8* src, u64 count) {
+	u64 i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		u8x16 v = LoadVector<u8x16>(src + i * 4);
+		StoreVector(dst + i * 4, __builtin_shufflevector(v, v, 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15));
+	}
+
+	for (; i < count; i++) {
+		u8 r = src[i * 4], g = src[i * 4 + 1], b = src[i * 4 + 2], a = src[i * 4 + 3];
+		dst[i * 4]     = b;
+		dst[i * 4 + 1] = g;
+		dst[i * 4 + 2] = r;
+		dst[i * 4 + 3] = a;
+	}
+}
+
+// t + t/256 rounds t/255 correctly for every product of two bytes.
+static inline u8 MultiplyUnorm8(u32 a, u32 b) {
+	u32 t = a * b + 128;
+	return (t + (t >> 8)) >> 8;
+}
+
+static void PremultiplyAlpha(u8* dst, const u8* src, u64 count) {
+	u64 i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		u8x16 v = LoadVector<u8x16>(src + i * 4);
+
+		// Each pixel's alpha in its color lanes and 255 in its alpha lane, which then stays the same.
+		u8x16 a = __builtin_shufflevector(v, opaque_alpha, 3, 3, 3, 19, 7, 7, 7, 19, 11, 11, 11, 19, 15, 15, 15, 19);
+		u16x16 t = __builtin_convertvector(v, u16x16) * __builtin_convertvector(a, u16x16) + 128;
+		t = (t + (t >> 8)) >> 8;
+		StoreVector(dst + i * 4, __builtin_convertvector(t, u8x16));
+	}
+
+	for (; i < count; i++) {
+		u8 a = src[i * 4 + 3];
+		dst[i * 4]     = MultiplyUnorm8(src[i * 4],     a);
+		dst[i * 4 + 1] = MultiplyUnorm8(src[i * 4 + 1], a);
+		dst[i * 4 + 2] = MultiplyUnorm8(src[i * 4 + 2], a);
+		dst[i * 4 + 3] = a;
+	}
+}
+
+//
+// sRGB. Decoding has only 256 inputs so it's a table, which beats any vector pow.
+// Encoding is x * 12.92 near black and otherwise a polynomial in x^(1/4), which is close enough to
+// 1.055 * x^(1/2.4) - 0.055 that a degree 5 fit stays within 0.0017 of the exact value times 255.
+//
+
+struct SrgbTable {
+	f32 linear[256];
+};
+
+static constexpr SrgbTable GenerateSrgbTable() {
+	SrgbTable result = { };
+
+	for (u32 i = 0; i < 256; i++) {
+		f64 c = i / 255.0;
+		result.linear[i] = c <= 0.04045 ? c / 12.92 : Math::Const::Pow((c + 0.055) / 1.055, 2.4);
+	}
+
+	return result;
+}
+
+static constexpr SrgbTable srgb_table = GenerateSrgbTable();
+
+static const f32 srgb_polynomial[] = {
+	-0.06800852219859352f, 0.2891029870637133f, -0.5769790264347568f, 1.2551289849163731f, 0.16209558701101404f, -0.06134656199502703f,
+};
+
+static inline f32x8 ClampUnitF32x8(f32x8 x) {
+	// Max first so NaN, which compares false, becomes 0.
+	return MinF32x8(MaxF32x8(x, BroadcastF32x8(0.0f)), BroadcastF32x8(1.0f));
+}
+
+// Clamped linear values to sRGB times 255, plus 0.5 so the conversion to integer rounds.
+static inline f32x8 EncodeSrgbLanes(f32x8 x) {
+	x = ClampUnitF32x8(x);
+	f32x8 t = SqrtF32x8(SqrtF32x8(x));
+	f32x8 p = BroadcastF32x8(srgb_polynomial[0]);
+
+	for (u32 i = 1; i < sizeof(srgb_polynomial) / sizeof(srgb_polynomial[0]); i++)
+		p = p * t + srgb_polynomial[i];
+
+	f32x8 srgb = x <= 0.0031308f ? x * 12.92f : p;
+	return srgb * 255.0f + 0.5f;
+}
+
+static f32 SrgbToLinear(u8 value) {
+	return srgb_table.linear[value];
+}
+
+static u8 LinearToSrgb(f32 value) {
+	return (u8)EncodeSrgbLanes(BroadcastF32x8(value))[0];
+}
+
+static void SrgbToLinear(f32* dst, const u8* src, u64 count) {
+	u64 i = 0;
+
+#if defined(__AVX2__)
+	const s32x8 alpha_lanes = { 0, 0, 0, -1, 0, 0, 0, -1 };
+
+	for (; i + 2 <= count; i += 2) {
+		__m256i bytes = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + i * 4)));
+		f32x8 color = (f32x8)_mm256_i32gather_ps(srgb_table.linear, bytes, 4);
+		f32x8 alpha = (f32x8)_mm256_cvtepi32_ps(bytes) * (1.0f / 255.0f);
+		StoreF32x8(dst + i * 4, Select(alpha_lanes, alpha, color));
+	}
+#endif
+
+	for (; i < count; i++) {
+		const u8* in = src + i * 4;
+		StoreF32x4(dst + i * 4, (f32x4){ srgb_table.linear[in[0]], srgb_table.linear[in[1]], srgb_table.linear[in[2]], in[3] * (1.0f / 255.0f) });
+	}
+}
+
+static void LinearToSrgb(u8* dst, const f32* src, u64 count) {
+	const s32x8 alpha_lanes = { 0, 0, 0, -1, 0, 0, 0, -1 };
+
+	auto encode = [&](f32x8 v) {
+		f32x8 alpha = ClampUnitF32x8(v) * 255.0f + 0.5f;
+		return __builtin_convertvector(__builtin_convertvector(Select(alpha_lanes, alpha, EncodeSrgbLanes(v)), s32x8), u8x8);
+	};
+
+	u64 i = 0;
+
+	for (; i + 2 <= count; i += 2)
+		StoreVector(dst + i * 4, encode(LoadF32x8(src + i * 4)));
+
+	// The last odd pixel goes through the same lanes so it rounds the same way.
+	if (i < count) {
+		f32x8 v = { src[i * 4], src[i * 4 + 1], src[i * 4 + 2], src[i * 4 + 3] };
+		u8x8 pixel = encode(v);
+		CopyMemory(dst + i * 4, &pixel, 4);
+	}
+}
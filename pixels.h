@@ -0,0 +1,33 @@
+#ifndef PIXELS_H
+#define PIXELS_H
+
+#include "general.h"
+
+// Conversions between the 8 bit pixel layouts images decode to and the ones textures and the swapchain want,
+// a vector of pixels at a time. count is in pixels, RGBA is R in the lowest byte like VK_FORMAT_R8G8B8A8_*.
+//
+// They write dst front to back and never read it, so dst can be a GpuBuffer mapping in write-combined memory.
+// The ones that keep the pixel size also work in place, dst == src.
+
+static void ExpandGrayToRgba(u8* dst, const u8* src, u64 count);      // Alpha 255.
+static void ExpandGrayAlphaToRgba(u8* dst, const u8* src, u64 count);
+static void ExpandRgbToRgba(u8* dst, const u8* src, u64 count);       // Alpha 255.
+
+// RGBA <-> BGRA, for VK_FORMAT_B8G8R8A8_*. In place OK.
+static void SwapRedBlue(u8* dst, const u8* src, u64 count);
+
+// Color times alpha, rounded to nearest like an exact c * a / 255. In place OK.
+// The multiply is on the stored values, so on sRGB data it's the usual approximation rather than a linear premultiply.
+static void PremultiplyAlpha(u8* dst, const u8* src, u64 count);
+
+// sRGB encoded RGBA8 to linear f32 RGBA (4 floats per pixel) and back, for filtering and mip generation.
+// Alpha isn't encoded in either direction. SrgbToLinear is exact, LinearToSrgb is within 0.002 of exact
+// before rounding so it very rarely differs by one from a correctly rounded result. Inputs outside of [0, 1]
+// are clamped and NaN becomes 0.
+static void SrgbToLinear(f32* dst, const u8* src, u64 count);
+static void LinearToSrgb(u8* dst, const f32* src, u64 count);
+
+static f32 SrgbToLinear(u8 value);
+static u8  LinearToSrgb(f32 value);
+
+#endif // PIXELS_H
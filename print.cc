@@ -6,103 +6,130 @@
 static void Write(OutputBuffer* buffer, char c) { buffer->Write(c); }
 static void Write(OutputBuffer* buffer, unsigned long int n) { Write(buffer, (u64)n); }
 
-// 3 5 10 20
-// Lut for n < 256?
-static void Write(OutputBuffer* buffer, u64 n) {
-	const int max = 20; // ceil(log10(pow(2, sizeof(n)*8-1)))
-	char digits[max];
-	int count = 0;
+static constexpr u64 powers_of_10[20] = {
+	1llu,                10llu,                100llu,                1000llu,
+	10000llu,            100000llu,            1000000llu,            10000000llu,
+	100000000llu,        1000000000llu,        10000000000llu,        100000000000llu,
+	1000000000000llu,    10000000000000llu,    100000000000000llu,    1000000000000000llu,
+	10000000000000000llu, 100000000000000000llu, 1000000000000000000llu, 10000000000000000000llu,
+};
+
+static u32 CountDecimalDigits(u64 n) {
+	// log10(2) ~= 1233/4096 turns the bit count into a guess that's at most one too small.
+	u32 guess = (64 - Clz64(n | 1)) * 1233 >> 12;
+	return guess + ((n | 1) >= powers_of_10[guess]);
+}
+
+// Two digits per entry so every division by 100 emits a pair.
+static const char decimal_pairs[201] =
+	"0001020304050607080910111213141516171819"
+	"2021222324252627282930313233343536373839"
+	"4041424344454647484950515253545556575859"
+	"6061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+static u32 FormatU64(char* out, u64 n) {
+	u32 count = CountDecimalDigits(n);
+	char* p = out + count;
+
+	while (n >= 100) {
+		u64 pair = n % 100;
+		n /= 100;
+		p -= 2;
+		CopyMemory(p, decimal_pairs + pair*2, 2);
+	}
 
-	do {
-		digits[max - count - 1] = '0' + n % 10;
-	} while (++count < max && (n /= 10));
+	if (n >= 10) CopyMemory(p - 2, decimal_pairs + n*2, 2);
+	else         p[-1] = '0' + n;
 
-	buffer->Write(digits + (max - count), count);
+	return count;
 }
 
-static void Write(OutputBuffer* buffer, s64 n) {
-	if (n < 0) { buffer->Write('-'); n = -n; }
-	Write(buffer, (u64)n);
+static u32 FormatS64(char* out, s64 n) {
+	// Negate as unsigned, -n overflows for the minimum value.
+	u64 magnitude = n < 0 ? 0 - (u64)n : n;
+	*out = '-';
+	return (n < 0) + FormatU64(out + (n < 0), magnitude);
 }
 
-static void Write(OutputBuffer* buffer, void* p) { Write(buffer, Hex((u64)p)); }
+struct HexPairTable {
+	char pairs[256][2];
+};
+
+static constexpr HexPairTable GenerateHexPairTable() {
+	HexPairTable table = { };
+
+	for (u32 i = 0; i < 256; i++) {
+		table.pairs[i][0] = "0123456789ABCDEF"[i >> 4];
+		table.pairs[i][1] = "0123456789ABCDEF"[i & 15];
+	}
+
+	return table;
+}
+
+static constexpr HexPairTable hex_pairs = GenerateHexPairTable();
 
-static void WriteBase16(OutputBuffer* buffer, u64 n) {
-	const u8 length_table[65] = {
-		16, 16, 16, 16,
-		15, 15, 15, 15,
-		14, 14, 14, 14,
-		13, 13, 13, 13,
-		12, 12, 12, 12,
-		11, 11, 11, 11,
-		10, 10, 10, 10,
-		9,  9,  9,  9,
-		8,  8,  8,  8,
-		7,  7,  7,  7,
-		6,  6,  6,  6,
-		5,  5,  5,  5,
-		4,  4,  4,  4,
-		3,  3,  3,  3,
-		2,  2,  2,  2,
-		1,  1,  1,  1, 1
-	};
-
-	char character_buffer[17];
-
-	u64 digits = length_table[Clz64(n)];
-	u64 k = digits << 2;
-
-	for (u64 i = 0; i < digits; i++) {
-		k -= 4;
-		character_buffer[i] = "0123456789ABCDEF"[(n >> k) & 0xF];
+static u32 FormatHex(char* out, u64 n) {
+	u32 digits = (64 - Clz64(n | 1) + 3) >> 2;
+
+	// Whole bytes from the bottom up, then the odd leading digit if there is one.
+	char* p = out + digits;
+	u64 m = n;
+	for (; p - out >= 2; m >>= 8) {
+		p -= 2;
+		CopyMemory(p, hex_pairs.pairs[m & 0xFF], 2);
 	}
 
-	character_buffer[digits] = 'h';
-	buffer->Write(character_buffer, digits+1);
+	if (p > out) out[0] = hex_pairs.pairs[m & 0xF][1];
+
+	out[digits] = 'h';
+	return digits + 1;
 }
 
-static void WriteBase2(OutputBuffer* buffer, u64 n) {
+static u32 FormatBinary(char* out, u64 n) {
 	if (!n) {
-		buffer->Write("0b", 2);
-		return;
+		CopyMemory(out, "0b", 2);
+		return 2;
 	}
 
-	const u32 table[16] = {
-		0x30303030,
-		0x31303030,
-		0x30313030,
-		0x31313030,
-		0x30303130,
-		0x31303130,
-		0x30313130,
-		0x31313130,
-		0x30303031,
-		0x31303031,
-		0x30313031,
-		0x31313031,
-		0x30303131,
-		0x31303131,
-		0x30313131,
-		0x31313131,
-	};
-
-	char character_buffer[65];
-	s64 lz = Clz64(n);
-
-	for (s64 i = 0; i < 16; i++) {
-		((u32*)character_buffer)[i] = table[(n >> (60-(i*4))) & 0x0f];
+	u32 bits = 64 - Clz64(n);
+	char characters[64];
+
+	// Multiplying a byte by 0x8040201008040201 puts bit 7-k at the top of byte k, with no carries between copies.
+	for (u32 i = 0; i < 8; i++) {
+		u64 byte   = (n >> (56 - i*8)) & 0xFF;
+		u64 spread = ((byte * 0x8040201008040201llu) >> 7 & 0x0101010101010101llu) | 0x3030303030303030llu;
+		CopyMemory(characters + i*8, &spread, 8);
 	}
 
-	character_buffer[64] = 'b';
-	buffer->Write(character_buffer+lz, 65-lz);
+	CopyMemory(out, characters + 64 - bits, bits);
+	out[bits] = 'b';
+	return bits + 1;
 }
 
+static void Write(OutputBuffer* buffer, u64 n) {
+	char characters[FORMAT_U64_MAX];
+	buffer->Write(characters, FormatU64(characters, n));
+}
+
+static void Write(OutputBuffer* buffer, s64 n) {
+	char characters[FORMAT_S64_MAX];
+	buffer->Write(characters, FormatS64(characters, n));
+}
+
+static void Write(OutputBuffer* buffer, void* p) { Write(buffer, Hex((u64)p)); }
+
 static void Write(OutputBuffer* buffer, IntFormat format) {
+	char characters[FORMAT_BINARY_MAX];
+	u32 length = 0;
+
 	switch (format.base) {
-		case BASE_2:  WriteBase2(buffer, format.value);  break;
-		case BASE_10: Write(buffer, format.value);       break;
-		case BASE_16: WriteBase16(buffer, format.value); break;
+		case BASE_2:  length = FormatBinary(characters, format.value); break;
+		case BASE_10: length = FormatU64(characters, format.value);    break;
+		case BASE_16: length = FormatHex(characters, format.value);    break;
 	}
+
+	buffer->Write(characters, length);
 }
 
 static void Write(OutputBuffer* buffer, String str) {
@@ -113,18 +140,25 @@ static void Write(OutputBuffer* buffer, String str) {
 }
 
 static void Write(OutputBuffer* buffer, f32 f) {
-	Write(buffer, (f64)f);
+	char characters[FORMAT_FLOAT_MAX];
+	buffer->Write(characters, FormatF32(characters, f));
 }
 
 static void Write(OutputBuffer* buffer, f64 f) {
-	// @FixMe: This really isn't that great, but it's good enough for now.
-	Write(buffer, (s64)f);
-	buffer->Write('.');
-	s64 frac = (s64)Abs((f-(s64)f) * Pow(10, 9));
-	// Pad with leading zeros (9 digits)
-	for (s64 threshold = 100000000; threshold > 1; threshold /= 10)
-		if (frac < threshold) buffer->Write('0');
-	Write(buffer, frac);
+	char characters[FORMAT_FLOAT_MAX];
+	buffer->Write(characters, FormatF64(characters, f));
+}
+
+static void Write(OutputBuffer* buffer, FloatFormat format) {
+	char characters[FORMAT_FIXED_MAX];
+	u32 length = 0;
+
+	switch (format.mode) {
+		case FLOAT_FIXED:      length = FormatFixed(characters, format.value, format.precision);      break;
+		case FLOAT_SCIENTIFIC: length = FormatScientific(characters, format.value, format.precision); break;
+	}
+
+	buffer->Write(characters, length);
 }
 
 static void Write(OutputBuffer* buffer, Vector2 v) {
@@ -5,8 +5,6 @@
 #include "file_system.h"
 #include "string.h"
 
-#define Log(var) Print("%:%: note: " #var " = %\n", CString(__FILE__), __LINE__, var)
-
 struct OutputBuffer;
 
 enum Base {
@@ -20,8 +18,45 @@ struct IntFormat {
 	u64  value;
 };
 
+// Maximum lengths of the Format functions' output, including the sign and the 'h'/'b' suffixes.
+static const u32 FORMAT_U64_MAX    = 20;
+static const u32 FORMAT_S64_MAX    = 20;
+static const u32 FORMAT_HEX_MAX    = 17;
+static const u32 FORMAT_BINARY_MAX = 65;
+
+// Write the characters without a terminator and return how many there are.
+static u32 FormatU64(char* out, u64 n);
+static u32 FormatS64(char* out, s64 n);
+static u32 FormatHex(char* out, u64 n);    // Uppercase with an 'h' suffix.
+static u32 FormatBinary(char* out, u64 n); // With a 'b' suffix.
+
+// Floats: shortest digits that round-trip, or a fixed number of decimals (capped at FLOAT_MAX_PRECISION).
+static const u32 FLOAT_MAX_PRECISION   = 100;
+static const u32 FORMAT_FLOAT_MAX      = 25;
+static const u32 FORMAT_FIXED_MAX      = 1 + 309 + 1 + FLOAT_MAX_PRECISION + 1;
+static const u32 FORMAT_SCIENTIFIC_MAX = 1 + 1 + 1 + FLOAT_MAX_PRECISION + 5;
+
+static u32 FormatF64(char* out, f64 f);                              // 0.1, 123.0, 1e+21, -inf, nan
+static u32 FormatF32(char* out, f32 f);                              // Shortest for f32, 0.1f prints as 0.1.
+static u32 FormatFixed(char* out, f64 f, u32 precision);             // 3.14
+static u32 FormatScientific(char* out, f64 f, u32 precision);        // 3.14e+00
+
+enum FloatMode {
+	FLOAT_FIXED,
+	FLOAT_SCIENTIFIC,
+};
+
+struct FloatFormat {
+	FloatMode mode;
+	u32       precision;
+	f64       value;
+};
+
 static inline IntFormat Bin(u64 n) { return (IntFormat){ .base = BASE_2,  .value = n }; }
 static inline IntFormat Hex(u64 n) { return (IntFormat){ .base = BASE_16, .value = n }; }
+static inline FloatFormat Fixed(f64 f, u32 precision)      { return (FloatFormat){ .mode = FLOAT_FIXED,      .precision = precision, .value = f }; }
+static inline FloatFormat Scientific(f64 f, u32 precision) { return (FloatFormat){ .mode = FLOAT_SCIENTIFIC, .precision = precision, .value = f }; }
+static void Write(OutputBuffer* buffer, FloatFormat format);
 static void Write(OutputBuffer* buffer, IntFormat format);
 static void Write(OutputBuffer* buffer, char c);
 static void Write(OutputBuffer* buffer, u64  n);
@@ -57,35 +92,83 @@ static void Write(OutputBuffer* buffer, Array<T> array) {
 	buffer->Write(" }", 2);
 }
 
+template<typename T> struct NoDeduceType { using Type = T; };
+template<typename T> using NoDeduce = typename NoDeduceType<T>::Type;
+
+// Called when a format string doesn't match its arguments, it isn't constexpr so the compiler stops here.
+static void FormatStringHasWrongNumberOfArguments() { }
+
+// A Print format string split into literal pieces at compile time, each '%' is replaced by the next argument.
+// There's always one more piece than there are arguments, so Print is left with copies and Write calls.
 template<typename ...Args>
-static void Print(OutputBuffer* buffer, String format, Args&&... args) {
-	char* end = format.data + format.length;
-	char* p = format.data;
+struct FormatString {
+	struct Piece {
+		u32 offset;
+		u32 length;
+	};
+
+	const char* data;
+	Piece pieces[sizeof...(Args) + 1];
 
-	auto internal_print = [=, &p]<typename T>(T&& t) {
-		char* start = p;
+	template<u32 N>
+	consteval FormatString(const char (&format)[N]) : data(format), pieces() {
+		u32 count = 0;
+		u32 start = 0;
 
-		while (p < end && *p != '%') p++;
+		for (u32 i = 0; i < N-1; i++) {
+			if (format[i] != '%')
+				continue;
 
-		if (start != p)
-			buffer->Write(start, p-start);
+			if (count == sizeof...(Args))
+				FormatStringHasWrongNumberOfArguments();
 
-		if (p < end)
-		{
-			Write(buffer, t);
-			p++;
+			pieces[count++] = { start, i - start };
+			start = i + 1;
 		}
+
+		if (count != sizeof...(Args))
+			FormatStringHasWrongNumberOfArguments();
+
+		pieces[count] = { start, N-1 - start };
+	}
+};
+
+template<typename ...Args>
+static void Print(OutputBuffer* buffer, FormatString<NoDeduce<Args>...> format, Args&&... args) {
+	u32 piece_index = 0;
+
+	auto write_piece = [&]() {
+		auto piece = format.pieces[piece_index++];
+		if (piece.length)
+			buffer->Write(format.data + piece.offset, piece.length);
 	};
 
-	(internal_print(args),...);
+	((write_piece(), Write(buffer, args)), ...);
+	write_piece();
+}
 
-	if (p < end)
-		buffer->Write(p, end - p);
+template<typename ...Args>
+static void Print(FormatString<NoDeduce<Args>...> format, Args&&... args) {
+	Print<Args...>(&standard_output_buffer, format, static_cast<Args&&>(args)...);
 }
 
+// Formats into out without a terminator, cut off at capacity. Returns the length.
+template<typename ...Args>
+static u32 FormatInto(char* out, u32 capacity, FormatString<NoDeduce<Args>...> format, Args&&... args) {
+	OutputBuffer buffer = FixedOutput(out, capacity);
+	Print<Args...>(&buffer, format, static_cast<Args&&>(args)...);
+	return buffer.head;
+}
+
+static const u32 FORMAT_STACK_SIZE = 256;
+
+// Formats into a new String (Free it). Results up to FORMAT_STACK_SIZE are built on the stack and allocated once.
 template<typename ...Args>
-static void Print(String format, Args&&... args) {
-	Print(&standard_output_buffer, format, args...);
+static String Format(FormatString<NoDeduce<Args>...> format, Args&&... args) {
+	char characters[FORMAT_STACK_SIZE];
+	OutputBuffer buffer = GrowableOutput(characters, FORMAT_STACK_SIZE);
+	Print<Args...>(&buffer, format, static_cast<Args&&>(args)...);
+	return buffer.TakeString();
 }
 
 static void Write(OutputBuffer* buffer, bool b) {
@@ -0,0 +1,465 @@
+#include "print.h"
+
+// Shortest round-trip output is Grisu2 (Florian Loitsch, "Printing Floating-Point Numbers Quickly and
+// Accurately with Integers", 2010), following Milo Yip's implementation. The digits always parse back to
+// the same value. In rare cases (well under 1%) they're one digit longer than the shortest possible.
+//
+// Fixed and scientific output with a precision uses exact big integer arithmetic instead, so rounding
+// matches what the value really is rather than its shortest representation.
+
+// A floating point number f * 2^e with a 64 bit significand and no hidden bit.
+struct DiyFp {
+	u64 f;
+	s32 e;
+
+	DiyFp operator -(DiyFp b) const { return { f - b.f, e }; }
+
+	// Rounded upper 64 bits of the 128 bit product.
+	DiyFp operator *(DiyFp b) const {
+		unsigned __int128 p = (unsigned __int128)f * b.f;
+		u64 hi = p >> 64;
+		u64 lo = (u64)p;
+		return { hi + (lo >> 63), e + b.e + 64 };
+	}
+
+	DiyFp Normalize() const {
+		s32 shift = Clz64(f);
+		return { f << shift, e - shift };
+	}
+};
+
+// The value and the boundaries halfway to its neighbours, m- and m+.
+// Works for both f32 and f64, significand_bits excludes the hidden bit.
+struct DiyFpBoundaries {
+	DiyFp value;
+	DiyFp minus;
+	DiyFp plus;
+};
+
+static DiyFpBoundaries ComputeBoundaries(u64 bits, u32 significand_bits, u32 exponent_bits) {
+	u64 hidden   = 1llu << significand_bits;
+	u64 fraction = bits & (hidden - 1);
+	u32 biased   = (bits >> significand_bits) & ((1u << exponent_bits) - 1);
+	s32 bias     = (1 << (exponent_bits - 1)) - 1 + significand_bits;
+
+	DiyFp v = biased ? DiyFp { fraction | hidden, (s32)biased - bias } : DiyFp { fraction, 1 - bias };
+
+	DiyFp plus  = DiyFp { (v.f << 1) + 1, v.e - 1 }.Normalize();
+	DiyFp minus = fraction == 0 && biased > 1 ? DiyFp { (v.f << 2) - 1, v.e - 2 } : DiyFp { (v.f << 1) - 1, v.e - 1 };
+	minus.f <<= minus.e - plus.e;
+	minus.e = plus.e;
+
+	return { v.Normalize(), minus, plus };
+}
+
+// Normalized 10^k for k = -348, -340, ..., 340.
+static const DiyFp cached_powers_of_10[87] = {
+	{ 0xfa8fd5a0081c0288, -1220 }, { 0xbaaee17fa23ebf76, -1193 }, { 0x8b16fb203055ac76, -1166 },
+	{ 0xcf42894a5dce35ea, -1140 }, { 0x9a6bb0aa55653b2d, -1113 }, { 0xe61acf033d1a45df, -1087 },
+	{ 0xab70fe17c79ac6ca, -1060 }, { 0xff77b1fcbebcdc4f, -1034 }, { 0xbe5691ef416bd60c, -1007 },
+	{ 0x8dd01fad907ffc3c,  -980 }, { 0xd3515c2831559a83,  -954 }, { 0x9d71ac8fada6c9b5,  -927 },
+	{ 0xea9c227723ee8bcb,  -901 }, { 0xaecc49914078536d,  -874 }, { 0x823c12795db6ce57,  -847 },
+	{ 0xc21094364dfb5637,  -821 }, { 0x9096ea6f3848984f,  -794 }, { 0xd77485cb25823ac7,  -768 },
+	{ 0xa086cfcd97bf97f4,  -741 }, { 0xef340a98172aace5,  -715 }, { 0xb23867fb2a35b28e,  -688 },
+	{ 0x84c8d4dfd2c63f3b,  -661 }, { 0xc5dd44271ad3cdba,  -635 }, { 0x936b9fcebb25c996,  -608 },
+	{ 0xdbac6c247d62a584,  -582 }, { 0xa3ab66580d5fdaf6,  -555 }, { 0xf3e2f893dec3f126,  -529 },
+	{ 0xb5b5ada8aaff80b8,  -502 }, { 0x87625f056c7c4a8b,  -475 }, { 0xc9bcff6034c13053,  -449 },
+	{ 0x964e858c91ba2655,  -422 }, { 0xdff9772470297ebd,  -396 }, { 0xa6dfbd9fb8e5b88f,  -369 },
+	{ 0xf8a95fcf88747d94,  -343 }, { 0xb94470938fa89bcf,  -316 }, { 0x8a08f0f8bf0f156b,  -289 },
+	{ 0xcdb02555653131b6,  -263 }, { 0x993fe2c6d07b7fac,  -236 }, { 0xe45c10c42a2b3b06,  -210 },
+	{ 0xaa242499697392d3,  -183 }, { 0xfd87b5f28300ca0e,  -157 }, { 0xbce5086492111aeb,  -130 },
+	{ 0x8cbccc096f5088cc,  -103 }, { 0xd1b71758e219652c,   -77 }, { 0x9c40000000000000,   -50 },
+	{ 0xe8d4a51000000000,   -24 }, { 0xad78ebc5ac620000,     3 }, { 0x813f3978f8940984,    30 },
+	{ 0xc097ce7bc90715b3,    56 }, { 0x8f7e32ce7bea5c70,    83 }, { 0xd5d238a4abe98068,   109 },
+	{ 0x9f4f2726179a2245,   136 }, { 0xed63a231d4c4fb27,   162 }, { 0xb0de65388cc8ada8,   189 },
+	{ 0x83c7088e1aab65db,   216 }, { 0xc45d1df942711d9a,   242 }, { 0x924d692ca61be758,   269 },
+	{ 0xda01ee641a708dea,   295 }, { 0xa26da3999aef774a,   322 }, { 0xf209787bb47d6b85,   348 },
+	{ 0xb454e4a179dd1877,   375 }, { 0x865b86925b9bc5c2,   402 }, { 0xc83553c5c8965d3d,   428 },
+	{ 0x952ab45cfa97a0b3,   455 }, { 0xde469fbd99a05fe3,   481 }, { 0xa59bc234db398c25,   508 },
+	{ 0xf6c69a72a3989f5c,   534 }, { 0xb7dcbf5354e9bece,   561 }, { 0x88fcf317f22241e2,   588 },
+	{ 0xcc20ce9bd35c78a5,   614 }, { 0x98165af37b2153df,   641 }, { 0xe2a0b5dc971f303a,   667 },
+	{ 0xa8d9d1535ce3b396,   694 }, { 0xfb9b7cd9a4a7443c,   720 }, { 0xbb764c4ca7a44410,   747 },
+	{ 0x8bab8eefb6409c1a,   774 }, { 0xd01fef10a657842c,   800 }, { 0x9b10a4e5e9913129,   827 },
+	{ 0xe7109bfba19c0c9d,   853 }, { 0xac2820d9623bf429,   880 }, { 0x80444b5e7aa7cf85,   907 },
+	{ 0xbf21e44003acdd2d,   933 }, { 0x8e679c2f5e44ff8f,   960 }, { 0xd433179d9c8cb841,   986 },
+	{ 0x9e19db92b4e31ba9,  1013 }, { 0xeb96bf6ebadf77d9,  1039 }, { 0xaf87023b9bf0ee6b,  1066 },
+};
+
+// Picks a power of ten that brings the binary exponent into [-60, -32], so the integer part fits in 32 bits.
+static DiyFp GetCachedPower(s32 e, s32* k) {
+	f64 dk = (-61 - e) * 0.30102999566398114 + 347; // log10(2)
+	s32 ik = (s32)dk;
+	if (dk - ik > 0) ik++;
+
+	u32 index = (ik >> 3) + 1;
+	*k = -(-348 + (s32)(index << 3));
+	return cached_powers_of_10[index];
+}
+
+static const u32 small_powers_of_10[10] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+
+static void GrisuRound(char* digits, u32 length, u64 delta, u64 rest, u64 ten_kappa, u64 wp_w) {
+	// Move the last digit towards the real value while staying inside the rounding interval.
+	while (rest < wp_w && delta - rest >= ten_kappa && (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+		digits[length - 1]--;
+		rest += ten_kappa;
+	}
+}
+
+static u32 GrisuDigits(DiyFp w, DiyFp mp, u64 delta, char* digits, s32* k) {
+	DiyFp one  = { 1llu << -mp.e, mp.e };
+	DiyFp wp_w = mp - w;
+	u32 p1 = (u32)(mp.f >> -one.e);
+	u64 p2 = mp.f & (one.f - 1);
+	s32 kappa = CountDecimalDigits(p1);
+	u32 length = 0;
+
+	while (kappa > 0) {
+		u32 d = p1 / small_powers_of_10[kappa - 1];
+		p1 %= small_powers_of_10[kappa - 1];
+
+		if (d || length)
+			digits[length++] = '0' + d;
+
+		kappa--;
+		u64 rest = ((u64)p1 << -one.e) + p2;
+		if (rest <= delta) {
+			*k += kappa;
+			GrisuRound(digits, length, delta, rest, (u64)small_powers_of_10[kappa] << -one.e, wp_w.f);
+			return length;
+		}
+	}
+
+	for (;;) {
+		p2    *= 10;
+		delta *= 10;
+		char d = p2 >> -one.e;
+
+		if (d || length)
+			digits[length++] = '0' + d;
+
+		p2 &= one.f - 1;
+		kappa--;
+		if (p2 < delta) {
+			*k += kappa;
+			GrisuRound(digits, length, delta, p2, one.f, -kappa < 9 ? wp_w.f * small_powers_of_10[-kappa] : 0);
+			return length;
+		}
+	}
+}
+
+// Shortest digits for a finite, non-zero value; the value is digits * 10^k.
+static u32 Grisu2(DiyFpBoundaries boundaries, char* digits, s32* k) {
+	DiyFp c_mk = GetCachedPower(boundaries.plus.e, k);
+	DiyFp w  = boundaries.value * c_mk;
+	DiyFp wp = boundaries.plus  * c_mk;
+	DiyFp wm = boundaries.minus * c_mk;
+	wm.f++;
+	wp.f--;
+	return GrisuDigits(w, wp, wp.f - wm.f, digits, k);
+}
+
+static u32 FormatExponent(char* out, s32 exponent) {
+	char* p = out;
+	*p++ = 'e';
+	*p++ = exponent < 0 ? '-' : '+';
+	p += FormatU64(p, exponent < 0 ? -exponent : exponent);
+	return p - out;
+}
+
+// Lays out length digits with the value digits * 10^k, fixed notation for moderate exponents like JavaScript.
+static u32 LayoutShortest(char* out, char* digits, u32 length, s32 k) {
+	s32 point = length + k; // Position of the decimal point relative to the first digit.
+	char* p = out;
+
+	if (k >= 0 && point <= 21) {
+		// Integer: 1234e2 -> 123400.0
+		CopyMemory(p, digits, length);
+		p += length;
+		SetMemory(p, '0', k);
+		p += k;
+		CopyMemory(p, ".0", 2);
+		p += 2;
+	} else if (point > 0 && point <= 21) {
+		// 1234e-2 -> 12.34
+		CopyMemory(p, digits, point);
+		p += point;
+		*p++ = '.';
+		CopyMemory(p, digits + point, length - point);
+		p += length - point;
+	} else if (point > -6 && point <= 0) {
+		// 1234e-6 -> 0.001234
+		CopyMemory(p, "0.", 2);
+		p += 2;
+		SetMemory(p, '0', -point);
+		p += -point;
+		CopyMemory(p, digits, length);
+		p += length;
+	} else {
+		// 1234e30 -> 1.234e+33
+		*p++ = digits[0];
+		if (length > 1) {
+			*p++ = '.';
+			CopyMemory(p, digits + 1, length - 1);
+			p += length - 1;
+		}
+
+		p += FormatExponent(p, point - 1);
+	}
+
+	return p - out;
+}
+
+// Writes the sign, nan, inf and zero, returns 0 when the value needs digits.
+static u32 FormatSpecial(char* out, bool negative, bool nan, bool inf, bool zero, bool* sign_written) {
+	char* p = out;
+	*sign_written = negative && !nan;
+	if (*sign_written) *p++ = '-';
+
+	if (nan)  { CopyMemory(p, "nan", 3); return p - out + 3; }
+	if (inf)  { CopyMemory(p, "inf", 3); return p - out + 3; }
+	if (zero) { CopyMemory(p, "0.0", 3); return p - out + 3; }
+	return 0;
+}
+
+static u32 FormatShortest(char* out, u64 bits, u32 significand_bits, u32 exponent_bits) {
+	u32 total_bits   = 1 + exponent_bits + significand_bits;
+	u64 magnitude    = bits & ((1llu << (total_bits - 1)) - 1);
+	u64 exponent_max = ((1llu << exponent_bits) - 1) << significand_bits;
+
+	bool sign;
+	u32 special = FormatSpecial(out, bits >> (total_bits - 1), magnitude > exponent_max, magnitude == exponent_max, magnitude == 0, &sign);
+	if (special) return special;
+
+	char digits[20];
+	s32 k = 0;
+	u32 length = Grisu2(ComputeBoundaries(bits, significand_bits, exponent_bits), digits, &k);
+	return sign + LayoutShortest(out + sign, digits, length, k);
+}
+
+static u32 FormatF64(char* out, f64 f) { return FormatShortest(out, __builtin_bit_cast(u64, f), 52, 11); }
+static u32 FormatF32(char* out, f32 f) { return FormatShortest(out, __builtin_bit_cast(u32, f), 23, 8);  }
+
+// ------------------------------------------------------------------------------------------------ //
+// Exact digits
+
+// Enough for 2^1024 and for the 1074 bit fraction of the smallest subnormal times 10.
+static const u32 BIG_WORDS = 36;
+
+struct BigInt {
+	u32 words[BIG_WORDS];
+	u32 count; // Used words, the rest are zero.
+
+	bool IsZero() const { return count == 0; }
+
+	void Trim() { while (count && !words[count - 1]) count--; }
+
+	void MultiplyAdd(u32 m, u32 add) {
+		u64 carry = add;
+		for (u32 i = 0; i < count; i++) {
+			u64 p = (u64)words[i] * m + carry;
+			words[i] = (u32)p;
+			carry = p >> 32;
+		}
+
+		if (carry) words[count++] = (u32)carry;
+	}
+
+	// Divides in place and returns the remainder.
+	u32 Divide(u32 d) {
+		u64 remainder = 0;
+		for (u32 i = count; i-- > 0;) {
+			u64 n = remainder << 32 | words[i];
+			words[i]  = (u32)(n / d);
+			remainder = n % d;
+		}
+
+		Trim();
+		return remainder;
+	}
+};
+
+static BigInt BigIntFromShifted(u64 n, u32 shift) {
+	BigInt result = { };
+	u32 word = shift / 32;
+	unsigned __int128 wide = (unsigned __int128)n << (shift % 32);
+	result.words[word]     = (u32)wide;
+	result.words[word + 1] = (u32)(wide >> 32);
+	result.words[word + 2] = (u32)(wide >> 64);
+	result.count = word + 3;
+	result.Trim();
+	return result;
+}
+
+// Produces the decimal digits of a finite value's magnitude one at a time:
+// all integer digits first, then the fraction digits forever (zeros once it runs out).
+struct ExactDigits {
+	char integer[320];
+	u32  integer_length;
+	u32  integer_next;
+
+	BigInt fraction; // The fraction is fraction / 2^fraction_bits.
+	u32    fraction_bits;
+
+	static ExactDigits From(f64 f) {
+		ExactDigits result = { };
+
+		u64 bits     = __builtin_bit_cast(u64, f);
+		u32 biased   = (bits >> 52) & 0x7FF;
+		u64 mantissa = bits & ((1llu << 52) - 1);
+		s32 exponent = biased ? (s32)biased - 1075 : -1074;
+		if (biased) mantissa |= 1llu << 52;
+
+		u64 integer = 0;
+		if (exponent >= 0) {
+			// Large integers: shift into a big integer and peel off 9 digits per division.
+			BigInt n = BigIntFromShifted(mantissa, exponent);
+			char reversed[320];
+			u32 length = 0;
+
+			while (!n.IsZero()) {
+				u32 chunk = n.Divide(1000000000);
+				for (u32 i = 0; i < 9; i++, chunk /= 10) reversed[length++] = '0' + chunk % 10;
+			}
+
+			while (length > 1 && reversed[length - 1] == '0') length--;
+			for (u32 i = 0; i < length; i++) result.integer[i] = reversed[length - 1 - i];
+			result.integer_length = length;
+			return result;
+		}
+
+		u32 shift = -exponent;
+		if (shift < 64) {
+			integer  = mantissa >> shift;
+			mantissa = mantissa & ((1llu << shift) - 1);
+		}
+
+		result.integer_length = FormatU64(result.integer, integer);
+		result.fraction       = BigIntFromShifted(mantissa, 0);
+		result.fraction_bits  = shift;
+		return result;
+	}
+
+	u32 Next() {
+		if (integer_next < integer_length)
+			return integer[integer_next++] - '0';
+
+		if (fraction.IsZero())
+			return 0;
+
+		// Multiply by 10 and take the bits above the binary point as the digit.
+		fraction.MultiplyAdd(10, 0);
+		u32 word = fraction_bits / 32, bit = fraction_bits % 32;
+		u64 top = word + 1 < BIG_WORDS ? (u64)fraction.words[word + 1] << 32 | fraction.words[word] : fraction.words[word];
+		u32 digit = (u32)(top >> bit) & 15;
+
+		fraction.words[word] &= (1u << bit) - 1;
+		for (u32 i = word + 1; i < BIG_WORDS; i++) fraction.words[i] = 0;
+		fraction.count = Min(fraction.count, word + 1);
+		fraction.Trim();
+		return digit;
+	}
+
+	bool RestIsZero() const {
+		for (u32 i = integer_next; i < integer_length; i++)
+			if (integer[i] != '0') return false;
+
+		return fraction.IsZero();
+	}
+};
+
+// Rounds digits[0..length) half to even given the digit after them, returns true if it carried out of the first digit.
+static bool RoundDigits(char* digits, u32 length, u32 next, bool rest_zero) {
+	bool odd = length ? (digits[length - 1] - '0') & 1 : false;
+	if (next < 5 || (next == 5 && rest_zero && !odd))
+		return false;
+
+	for (u32 i = length; i-- > 0;) {
+		if (digits[i] != '9') { digits[i]++; return false; }
+		digits[i] = '0';
+	}
+
+	return true;
+}
+
+static u32 FormatFixed(char* out, f64 f, u32 precision) {
+	precision = Min(precision, FLOAT_MAX_PRECISION);
+	u64 bits = __builtin_bit_cast(u64, f);
+	bool sign;
+	u32 special = FormatSpecial(out, bits >> 63, f != f, (bits << 1) == 0xFFEllu << 52, false, &sign);
+	if (special) return special;
+
+	ExactDigits exact = ExactDigits::From(f);
+	char digits[FORMAT_FIXED_MAX];
+	u32 integer_length = exact.integer_length;
+
+	// A spare leading zero takes the carry when rounding up 9.99 -> 10.0.
+	digits[0] = '0';
+	u32 length = 1;
+	for (u32 i = 0; i < integer_length + precision; i++)
+		digits[length++] = '0' + exact.Next();
+
+	u32 next = exact.Next();
+	RoundDigits(digits, length, next, exact.RestIsZero());
+
+	char* p = out + sign;
+	u32 start = digits[0] == '0' ? 1 : 0;
+	u32 integer_end = 1 + integer_length;
+
+	CopyMemory(p, digits + start, integer_end - start);
+	p += integer_end - start;
+
+	if (precision) {
+		*p++ = '.';
+		CopyMemory(p, digits + integer_end, precision);
+		p += precision;
+	}
+
+	return p - out;
+}
+
+static u32 FormatScientific(char* out, f64 f, u32 precision) {
+	precision = Min(precision, FLOAT_MAX_PRECISION);
+	u64 bits = __builtin_bit_cast(u64, f);
+	bool sign;
+	u32 special = FormatSpecial(out, bits >> 63, f != f, (bits << 1) == 0xFFEllu << 52, false, &sign);
+	if (special) return special;
+
+	char* p = out + sign;
+	char digits[FLOAT_MAX_PRECISION + 2];
+	s32 exponent = 0;
+
+	if ((bits << 1) == 0) {
+		SetMemory(digits, '0', precision + 1);
+	} else {
+		ExactDigits exact = ExactDigits::From(f);
+
+		// Skip leading zeros, the exponent is the position of the first significant digit.
+		exponent = exact.integer_length - 1;
+		u32 d = exact.Next();
+		while (d == 0) {
+			d = exact.Next();
+			exponent--;
+		}
+
+		digits[0] = '0' + d;
+		for (u32 i = 1; i < precision + 1; i++)
+			digits[i] = '0' + exact.Next();
+
+		u32 next = exact.Next();
+		if (RoundDigits(digits, precision + 1, next, exact.RestIsZero())) {
+			digits[0] = '1';
+			exponent++;
+		}
+	}
+
+	*p++ = digits[0];
+	if (precision) {
+		*p++ = '.';
+		CopyMemory(p, digits + 1, precision);
+		p += precision;
+	}
+
+	p += FormatExponent(p, exponent);
+	return p - out;
+}
@@ -9,10 +9,10 @@ struct Quaternion {
 	f32 k;
 	f32 r;
 
-	explicit Quaternion(f32 r, f32 i, f32 j, f32 k) : r(r), i(i), j(j), k(k) { }
-	explicit Quaternion() : Quaternion(1, 0, 0, 0) { }
+	explicit constexpr Quaternion(f32 r, f32 i, f32 j, f32 k) : r(r), i(i), j(j), k(k) { }
+	explicit constexpr Quaternion() : Quaternion(1, 0, 0, 0) { }
 
-	static Quaternion CreateRotation(Vector3 axis, f32 angle) {
+	static constexpr Quaternion CreateRotation(Vector3 axis, f32 angle) {
 		f32 h = angle * 0.5f;
 		Vector3 n = axis.Normal();
 		return Quaternion(
@@ -23,7 +23,7 @@ struct Quaternion {
 		);
 	}
 
-	static Quaternion FromEuler(f32 pitch, f32 yaw, f32 roll) {
+	static constexpr Quaternion FromEuler(f32 pitch, f32 yaw, f32 roll) {
 		f32 cp = Cos(pitch * 0.5f), sp = Sin(pitch * 0.5f);
 		f32 cy = Cos(yaw   * 0.5f), sy = Sin(yaw   * 0.5f);
 		f32 cr = Cos(roll  * 0.5f), sr = Sin(roll  * 0.5f);
@@ -35,24 +35,24 @@ struct Quaternion {
 		);
 	}
 
-	static Quaternion FromEuler(Vector3 angles) {
+	static constexpr Quaternion FromEuler(Vector3 angles) {
 		return FromEuler(angles.x, angles.y, angles.z);
 	}
 
-	f32 Dot(Quaternion q) { return r*q.r + i*q.i + j*q.j + k*q.k; }
-	f32 Length() { return Sqrt(r*r + i*i + j*j + k*k); }
-	Quaternion Normal() { f32 len = Length(); return Quaternion(r/len, i/len, j/len, k/len); }
-	Quaternion Conjugate() { return Quaternion(r, -i, -j, -k); }
-	Quaternion Inverse() { f32 len2 = r*r + i*i + j*j + k*k; return Quaternion(r/len2, -i/len2, -j/len2, -k/len2); }
+	constexpr f32 Dot(Quaternion q) const { return r*q.r + i*q.i + j*q.j + k*q.k; }
+	constexpr f32 Length() const { return Sqrt(r*r + i*i + j*j + k*k); }
+	constexpr Quaternion Normal() const { f32 len = Length(); return Quaternion(r/len, i/len, j/len, k/len); }
+	constexpr Quaternion Conjugate() const { return Quaternion(r, -i, -j, -k); }
+	constexpr Quaternion Inverse() const { f32 len2 = r*r + i*i + j*j + k*k; return Quaternion(r/len2, -i/len2, -j/len2, -k/len2); }
 
-	Quaternion operator +(Quaternion q) { return Quaternion(r + q.r, i + q.i, j + q.j, k + q.k); }
-	Quaternion operator -(Quaternion q) { return Quaternion(r - q.r, i - q.i, j - q.j, k - q.k); }
-	Quaternion operator -() { return Quaternion(-r, -i, -j, -k); }
+	constexpr Quaternion operator +(Quaternion q) const { return Quaternion(r + q.r, i + q.i, j + q.j, k + q.k); }
+	constexpr Quaternion operator -(Quaternion q) const { return Quaternion(r - q.r, i - q.i, j - q.j, k - q.k); }
+	constexpr Quaternion operator -() const { return Quaternion(-r, -i, -j, -k); }
 
-	Quaternion operator *(f32 s) { return Quaternion(r * s, i * s, j * s, k * s); }
-	Quaternion operator /(f32 s) { return Quaternion(r / s, i / s, j / s, k / s); }
+	constexpr Quaternion operator *(f32 s) const { return Quaternion(r * s, i * s, j * s, k * s); }
+	constexpr Quaternion operator /(f32 s) const { return Quaternion(r / s, i / s, j / s, k / s); }
 
-	Quaternion operator *(Quaternion q) {
+	constexpr Quaternion operator *(Quaternion q) const {
 		return Quaternion(
 			r*q.r - i*q.i - j*q.j - k*q.k,
 			r*q.i + i*q.r + j*q.k - k*q.j,
@@ -61,17 +61,17 @@ struct Quaternion {
 		);
 	}
 
-	Quaternion& operator *=(Quaternion q) { *this = *this * q; return *this; }
+	constexpr Quaternion& operator *=(Quaternion q) { *this = *this * q; return *this; }
 
-	Vector3 Rotate(Vector3 v) {
+	constexpr Vector3 Rotate(Vector3 v) const {
 		Quaternion result = *this * Quaternion(0, v.x, v.y, v.z) * Conjugate();
 		return { result.i, result.j, result.k };
 	}
 
-	Vector3 operator *(Vector3 v) { return Rotate(v); }
-	Vector4 operator *(Vector4 v) { Vector3 rotated = Rotate(Vector3(v.x, v.y, v.z)); return Vector4(rotated.x, rotated.y, rotated.z, v.w); }
+	constexpr Vector3 operator *(Vector3 v) const { return Rotate(v); }
+	constexpr Vector4 operator *(Vector4 v) const { Vector3 rotated = Rotate(Vector3(v.x, v.y, v.z)); return Vector4(rotated.x, rotated.y, rotated.z, v.w); }
 
-	Matrix4 ToMatrix() {
+	constexpr Matrix4 ToMatrix() const {
 		f32 ii = i * i, jj = j * j, kk = k * k;
 		f32 ij = i * j, ik = i * k, jk = j * k;
 		f32 ri = r * i, rj = r * j, rk = r * k;
@@ -84,9 +84,9 @@ struct Quaternion {
 	}
 };
 
-static f32 Dot(Quaternion a, Quaternion b) { return a.Dot(b); }
+static constexpr f32 Dot(Quaternion a, Quaternion b) { return a.Dot(b); }
 
-static Quaternion Slerp(Quaternion a, Quaternion b, f32 t) {
+static constexpr Quaternion Slerp(Quaternion a, Quaternion b, f32 t) {
 	f32 dot = a.Dot(b);
 	if (dot < 0) {
 		b = -b;
@@ -0,0 +1,73 @@
+#include "random.h"
+#include "simd.h"
+
+static inline void MulHiLo(u32 m, u32x4 x, u32x4* hi, u32x4* lo) {
+	u64x4 p = __builtin_convertvector(x, u64x4) * m;
+	*lo = __builtin_convertvector(p, u32x4);
+	*hi = __builtin_convertvector(p >> 32, u32x4);
+}
+
+// Philox for the four consecutive blocks starting at first_block, one block per lane.
+// Writes their 16 numbers to out in stream order.
+static inline void PhiloxLanes(u32* out, u64 seed, u64 first_block) {
+	u32x4 c0 = (u32x4){ 0, 1, 2, 3 } + (u32)first_block;
+	u32x4 c1 = (u32x4){ 0, 0, 0, 0 } + (u32)(first_block >> 32) + ((u32x4)(c0 < (u32)first_block) & 1);
+	u32x4 c2 = { };
+	u32x4 c3 = { };
+	u32 key0 = (u32)seed;
+	u32 key1 = (u32)(seed >> 32);
+
+	for (u32 round = 0; round < 10; round++) {
+		u32x4 hi0, lo0, hi1, lo1;
+		MulHiLo(PHILOX_M0, c0, &hi0, &lo0);
+		MulHiLo(PHILOX_M1, c2, &hi1, &lo1);
+		c0 = hi1 ^ c1 ^ key0;
+		c1 = lo1;
+		c2 = hi0 ^ c3 ^ key1;
+		c3 = lo0;
+		key0 += PHILOX_W0;
+		key1 += PHILOX_W1;
+	}
+
+	// Lanes hold blocks, transpose so each register holds one block's words.
+	f32x4 w0 = (f32x4)c0, w1 = (f32x4)c1, w2 = (f32x4)c2, w3 = (f32x4)c3;
+	Transpose4x4(&w0, &w1, &w2, &w3);
+	StoreVector(out + 0,  w0);
+	StoreVector(out + 4,  w1);
+	StoreVector(out + 8,  w2);
+	StoreVector(out + 12, w3);
+}
+
+static void FillRandomU32(u32* out, u64 count, u64 seed, u64 first_index) {
+	u64 i = 0;
+
+	// Scalar up to a block boundary so the lanes line up with whole blocks.
+	for (; i < count && ((first_index + i) & 3); i++)
+		out[i] = RandomU32(seed, first_index + i);
+
+	for (; i + 16 <= count; i += 16)
+		PhiloxLanes(out + i, seed, (first_index + i) >> 2);
+
+	for (; i < count; i++)
+		out[i] = RandomU32(seed, first_index + i);
+}
+
+static void FillRandomF32(f32* out, u64 count, u64 seed, u64 first_index, f32 lo, f32 hi) {
+	// Generate into out and convert in place, u32 and f32 have the same size.
+	FillRandomU32((u32*)out, count, seed, first_index);
+
+	f32 scale = (hi - lo) * (1.0f / (1 << 24));
+	u64 i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		u32x8 n = LoadVector<u32x8>(out + i);
+		StoreF32x8(out + i, lo + __builtin_convertvector(n >> 8, f32x8) * scale);
+	}
+
+	for (; i < count; i++)
+		out[i] = lo + (__builtin_bit_cast(u32, out[i]) >> 8) * scale;
+}
+
+static void FillRandomF32(f32* out, u64 count, u64 seed, u64 first_index) {
+	FillRandomF32(out, count, seed, first_index, 0.0f, 1.0f);
+}
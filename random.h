@@ -0,0 +1,58 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include "general.h"
+
+// Counter-based random numbers (Philox4x32-10, Salmon et al. 2011). The n-th number of a stream only depends on
+// the seed and n, so splitting a range across any number of threads or batches produces exactly the same values.
+// Each counter gives four numbers: number n is word n%4 of the block for counter n/4, with the seed as key.
+
+static const u32 PHILOX_M0 = 0xD2511F53;
+static const u32 PHILOX_M1 = 0xCD9E8D57;
+static const u32 PHILOX_W0 = 0x9E3779B9;
+static const u32 PHILOX_W1 = 0xBB67AE85;
+
+struct PhiloxBlock {
+	u32 words[4];
+};
+
+static constexpr PhiloxBlock Philox(PhiloxBlock counter, u32 key0, u32 key1) {
+	u32* c = counter.words;
+
+	for (u32 round = 0; round < 10; round++) {
+		u64 p0 = (u64)PHILOX_M0 * c[0];
+		u64 p1 = (u64)PHILOX_M1 * c[2];
+		counter = { (u32)(p1 >> 32) ^ c[1] ^ key0, (u32)p1, (u32)(p0 >> 32) ^ c[3] ^ key1, (u32)p0 };
+		key0 += PHILOX_W0;
+		key1 += PHILOX_W1;
+	}
+
+	return counter;
+}
+
+static constexpr PhiloxBlock PhiloxBlockAt(u64 seed, u64 block) {
+	return Philox({ (u32)block, (u32)(block >> 32), 0, 0 }, (u32)seed, (u32)(seed >> 32));
+}
+
+// The top 24 bits scaled to [0, 1), every result is exactly representable.
+static constexpr f32 UnitF32(u32 n) { return (n >> 8) * (1.0f / (1 << 24)); }
+
+static constexpr u32 RandomU32(u64 seed, u64 index) { return PhiloxBlockAt(seed, index >> 2).words[index & 3]; }
+static constexpr f32 RandomF32(u64 seed, u64 index) { return UnitF32(RandomU32(seed, index)); }
+
+// out[i] is the number at first_index + i.
+static void FillRandomU32(u32* out, u64 count, u64 seed, u64 first_index);
+static void FillRandomF32(f32* out, u64 count, u64 seed, u64 first_index);                 // [0, 1)
+static void FillRandomF32(f32* out, u64 count, u64 seed, u64 first_index, f32 lo, f32 hi); // [lo, hi)
+
+// Sequential draws from one stream, for when the index doesn't matter.
+struct Random {
+	u64 seed;
+	u64 index = 0;
+
+	u32 NextU32() { return RandomU32(seed, index++); }
+	f32 NextF32() { return RandomF32(seed, index++); }
+	f32 NextF32(f32 lo, f32 hi) { return lo + (hi - lo) * NextF32(); }
+};
+
+#endif // RANDOM_H
@@ -0,0 +1,139 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include "general.h"
+
+#if defined(__SSE__)
+	#include <immintrin.h>
+#endif
+
+// Portable vector types. The compiler lowers these to SSE/AVX on x86 and NEON on arm64,
+// wider types are split into multiple native registers when the target doesn't have them.
+
+typedef f32 f32x4 __attribute__((vector_size(16)));
+typedef s32 s32x4 __attribute__((vector_size(16)));
+typedef u32 u32x4 __attribute__((vector_size(16)));
+
+typedef f32 f32x8 __attribute__((vector_size(32)));
+typedef s32 s32x8 __attribute__((vector_size(32)));
+typedef u32 u32x8 __attribute__((vector_size(32)));
+
+typedef u64 u64x4 __attribute__((vector_size(32)));
+
+typedef u16 u16x4 __attribute__((vector_size(8)));
+typedef s16 s16x4 __attribute__((vector_size(8)));
+typedef u16 u16x8 __attribute__((vector_size(16)));
+typedef u16 u16x16 __attribute__((vector_size(32)));
+typedef u8  u8x4  __attribute__((vector_size(4)));
+typedef s8  s8x4  __attribute__((vector_size(4)));
+typedef u8  u8x8  __attribute__((vector_size(8)));
+typedef u8  u8x16 __attribute__((vector_size(16)));
+
+// Unaligned loads and stores.
+static inline f32x4 LoadF32x4(const f32* p) { f32x4 v; CopyMemory(&v, p, sizeof(v)); return v; }
+static inline f32x8 LoadF32x8(const f32* p) { f32x8 v; CopyMemory(&v, p, sizeof(v)); return v; }
+static inline u32x4 LoadU32x4(const u32* p) { u32x4 v; CopyMemory(&v, p, sizeof(v)); return v; }
+static inline u32x8 LoadU32x8(const u32* p) { u32x8 v; CopyMemory(&v, p, sizeof(v)); return v; }
+static inline u8x8  LoadU8x8(const u8* p)   { u8x8  v; CopyMemory(&v, p, sizeof(v)); return v; }
+
+static inline void StoreF32x4(f32* p, f32x4 v) { CopyMemory(p, &v, sizeof(v)); }
+static inline void StoreF32x8(f32* p, f32x8 v) { CopyMemory(p, &v, sizeof(v)); }
+static inline void StoreU32x4(u32* p, u32x4 v) { CopyMemory(p, &v, sizeof(v)); }
+static inline void StoreU32x8(u32* p, u32x8 v) { CopyMemory(p, &v, sizeof(v)); }
+
+template<typename V> static inline V    LoadVector(const void* p)  { V v; CopyMemory(&v, p, sizeof(v)); return v; }
+template<typename V> static inline void StoreVector(void* p, V v)  { CopyMemory(p, &v, sizeof(v)); }
+
+// Eight bytes widened to floats. Spelled out for AVX2 because GCC widens byte vectors a lane at a time.
+static inline f32x8 LoadU8x8AsF32x8(const u8* p) {
+#if defined(__AVX2__)
+	return (f32x8)_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)p)));
+#else
+	return __builtin_convertvector(LoadU8x8(p), f32x8);
+#endif
+}
+
+static inline f32x4 BroadcastF32x4(f32 f) { return (f32x4){ f, f, f, f }; }
+static inline f32x8 BroadcastF32x8(f32 f) { return (f32x8){ f, f, f, f, f, f, f, f }; }
+
+static inline f32x4 AbsF32x4(f32x4 v) { return (f32x4)((u32x4)v & 0x7FFFFFFF); }
+static inline f32x8 AbsF32x8(f32x8 v) { return (f32x8)((u32x8)v & 0x7FFFFFFF); }
+
+// Per lane mask ? a : b, the mask lanes must be all ones or all zeros.
+static inline u32x4 Select(s32x4 mask, u32x4 a, u32x4 b) { return ((u32x4)mask & a) | (~(u32x4)mask & b); }
+static inline f32x4 Select(s32x4 mask, f32x4 a, f32x4 b) { return (f32x4)Select(mask, (u32x4)a, (u32x4)b); }
+static inline u32x8 Select(s32x8 mask, u32x8 a, u32x8 b) { return ((u32x8)mask & a) | (~(u32x8)mask & b); }
+static inline f32x8 Select(s32x8 mask, f32x8 a, f32x8 b) { return (f32x8)Select(mask, (u32x8)a, (u32x8)b); }
+
+// Rows to columns, used to turn four AoS structs into SoA lanes and back.
+static inline void Transpose4x4(f32x4* a, f32x4* b, f32x4* c, f32x4* d) {
+	f32x4 ab_lo = __builtin_shufflevector(*a, *b, 0, 4, 1, 5);
+	f32x4 ab_hi = __builtin_shufflevector(*a, *b, 2, 6, 3, 7);
+	f32x4 cd_lo = __builtin_shufflevector(*c, *d, 0, 4, 1, 5);
+	f32x4 cd_hi = __builtin_shufflevector(*c, *d, 2, 6, 3, 7);
+	*a = __builtin_shufflevector(ab_lo, cd_lo, 0, 1, 4, 5);
+	*b = __builtin_shufflevector(ab_lo, cd_lo, 2, 3, 6, 7);
+	*c = __builtin_shufflevector(ab_hi, cd_hi, 0, 1, 4, 5);
+	*d = __builtin_shufflevector(ab_hi, cd_hi, 2, 3, 6, 7);
+}
+
+static inline void Transpose8x8(f32x8 m[8]) {
+	f32x8 t[8], u[8];
+
+	for (u32 i = 0; i < 8; i += 2) {
+		t[i]     = __builtin_shufflevector(m[i], m[i + 1], 0, 8, 1, 9, 4, 12, 5, 13);
+		t[i + 1] = __builtin_shufflevector(m[i], m[i + 1], 2, 10, 3, 11, 6, 14, 7, 15);
+	}
+
+	for (u32 i = 0; i < 8; i += 4) {
+		u[i]     = __builtin_shufflevector(t[i],     t[i + 2], 0, 1, 8, 9, 4, 5, 12, 13);
+		u[i + 1] = __builtin_shufflevector(t[i],     t[i + 2], 2, 3, 10, 11, 6, 7, 14, 15);
+		u[i + 2] = __builtin_shufflevector(t[i + 1], t[i + 3], 0, 1, 8, 9, 4, 5, 12, 13);
+		u[i + 3] = __builtin_shufflevector(t[i + 1], t[i + 3], 2, 3, 10, 11, 6, 7, 14, 15);
+	}
+
+	for (u32 i = 0; i < 4; i++) {
+		m[i]     = __builtin_shufflevector(u[i], u[i + 4], 0, 1, 2, 3, 8, 9, 10, 11);
+		m[i + 4] = __builtin_shufflevector(u[i], u[i + 4], 4, 5, 6, 7, 12, 13, 14, 15);
+	}
+}
+
+static inline f32x4 MinF32x4(f32x4 a, f32x4 b) { return a < b ? a : b; }
+static inline f32x4 MaxF32x4(f32x4 a, f32x4 b) { return a > b ? a : b; }
+static inline f32x8 MinF32x8(f32x8 a, f32x8 b) { return a < b ? a : b; }
+static inline f32x8 MaxF32x8(f32x8 a, f32x8 b) { return a > b ? a : b; }
+
+static inline f32x8 SqrtF32x8(f32x8 v) {
+#if defined(__AVX__)
+	return (f32x8)_mm256_sqrt_ps((__m256)v);
+#elif defined(__SSE__)
+	f32x4 lo = (f32x4)_mm_sqrt_ps((__m128)__builtin_shufflevector(v, v, 0, 1, 2, 3));
+	f32x4 hi = (f32x4)_mm_sqrt_ps((__m128)__builtin_shufflevector(v, v, 4, 5, 6, 7));
+	return __builtin_shufflevector(lo, hi, 0, 1, 2, 3, 4, 5, 6, 7);
+#else
+	for (u32 i = 0; i < 8; i++) v[i] = __builtin_sqrtf(v[i]);
+	return v;
+#endif
+}
+
+// Comparisons yield -1 (all bits set) per true lane. Gather the sign bits into an integer like movmskps.
+static inline u32 MoveMask(s32x4 m) {
+#if defined(__SSE__)
+	return _mm_movemask_ps((__m128)m);
+#else
+	u32x4 bits = (u32x4)m >> 31;
+	return bits[0] | bits[1] << 1 | bits[2] << 2 | bits[3] << 3;
+#endif
+}
+
+static inline u32 MoveMask(s32x8 m) {
+#if defined(__AVX__)
+	return _mm256_movemask_ps((__m256)m);
+#else
+	s32x4 lo = __builtin_shufflevector(m, m, 0, 1, 2, 3);
+	s32x4 hi = __builtin_shufflevector(m, m, 4, 5, 6, 7);
+	return MoveMask(lo) | MoveMask(hi) << 4;
+#endif
+}
+
+#endif // SIMD_H
@@ -68,10 +68,7 @@ void Swapchain::Init(Window* window) {
 	};
 	vkCreateImage(device.logical_device, &depth_image_info, null, &depth_image);
 
-	VkMemoryRequirements memreq;
-	vkGetImageMemoryRequirements(device.logical_device, depth_image, &memreq);
-	depth_memory = device.AllocateMemory(memreq.size, device.FindMemoryType(memreq.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
-	vkBindImageMemory(device.logical_device, depth_image, depth_memory, 0);
+	depth_memory = AllocateImageMemory(depth_image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
 	VkImageViewCreateInfo depth_view_info = {
 		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
@@ -173,7 +170,7 @@ Optional<u32> Swapchain::GetNextImageIndex(VkSemaphore image_available) {
 void Swapchain::Destroy() {
 	vkDestroyImageView(device.logical_device, depth_view, null);
 	vkDestroyImage(device.logical_device, depth_image, null);
-	vkFreeMemory(device.logical_device, depth_memory, null);
+	FreeGpuMemory(&depth_memory);
 
 	vkDestroySwapchainKHR(device.logical_device, handle, null); // Destroys images.
 	images.Reset();
@@ -6,6 +6,7 @@
 #include "optional.h"
 #include "window.h"
 #include "vector.h"
+#include "gpu_memory.h"
 
 struct Swapchain {
 	VkSwapchainKHR handle = 0;
@@ -19,7 +20,7 @@ struct Swapchain {
 	List<VkFramebuffer> framebuffers;
 
 	VkImage        depth_image;
-	VkDeviceMemory depth_memory;
+	GpuAllocation  depth_memory;
 	VkImageView    depth_view;
 	VkFormat       depth_format;
 
@@ -0,0 +1,147 @@
+#include "texture.h"
+#include "image.h"
+#include "mips.h"
+#include "block_compress.h"
+#include "asset_cache.h"
+#include "print.h"
+#include "log.h"
+
+// In every texture's cache key. Bump it when the encoders or the layout change, so old textures are rebuilt.
+static const u32 TEXTURE_BUILD_VERSION = 1;
+
+static VkFormat GetTextureFormat(TextureEncoding encoding, bool srgb) {
+	switch (encoding) {
+	case TEXTURE_ENCODING_RGBA8: return srgb ? VK_FORMAT_R8G8B8A8_SRGB   : VK_FORMAT_R8G8B8A8_UNORM;
+	case TEXTURE_ENCODING_BC1:   return srgb ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+	case TEXTURE_ENCODING_BC3:   return srgb ? VK_FORMAT_BC3_SRGB_BLOCK  : VK_FORMAT_BC3_UNORM_BLOCK;
+	case TEXTURE_ENCODING_BC7:   return srgb ? VK_FORMAT_BC7_SRGB_BLOCK  : VK_FORMAT_BC7_UNORM_BLOCK;
+	}
+
+	return VK_FORMAT_UNDEFINED;
+}
+
+static u64 GetTextureHeaderSize(u32 level_count) {
+	u64 size = sizeof(TextureHeader) + level_count * sizeof(TextureLevel);
+	return (size + TEXTURE_ALIGNMENT - 1) & ~(u64)(TEXTURE_ALIGNMENT - 1);
+}
+
+// The encoding format is one of GetTextureFormat's, false for any other VkFormat.
+static bool GetTextureEncoding(u32 format, TextureEncoding* encoding) {
+	for (u32 i = TEXTURE_ENCODING_RGBA8; i <= TEXTURE_ENCODING_BC7; i++) {
+		if (format == GetTextureFormat((TextureEncoding)i, false) || format == GetTextureFormat((TextureEncoding)i, true)) {
+			*encoding = (TextureEncoding)i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Bytes a level of this size takes at least, in u64 so no width a file can hold overflows it.
+static u64 GetTextureLevelSize(TextureEncoding encoding, u32 width, u32 height) {
+	if (encoding == TEXTURE_ENCODING_RGBA8)
+		return (u64)width * height * 4;
+
+	return ((u64)width + 3) / 4 * (((u64)height + 3) / 4) * GetBlockBytes((BlockFormat)(encoding - TEXTURE_ENCODING_BC1));
+}
+
+static const TextureHeader* ParseTexture(const byte* data, u64 size) {
+	const TextureHeader* header = (const TextureHeader*)data;
+
+	if (size < sizeof(TextureHeader) || header->magic != TEXTURE_MAGIC)
+		return null;
+
+	if (!header->level_count || header->level_count > MIP_MAX_LEVELS || size < GetTextureHeaderSize(header->level_count))
+		return null;
+
+	// Uploads take the format and every level's extent and size from here, so they have to be ones Vulkan accepts
+	// and the bytes have to cover them: a mip chain of level 0, no longer than a full one.
+	TextureEncoding encoding;
+
+	if (!GetTextureEncoding(header->format, &encoding) || !header->width || !header->height)
+		return null;
+
+	if (header->level_count > 32 - Clz32(Max(header->width, header->height)))
+		return null;
+
+	for (u32 i = 0; i < header->level_count; i++) {
+		const TextureLevel* level = &header->levels[i];
+		if (level->offset > size || level->size > size - level->offset)
+			return null;
+
+		if (level->width != Max(header->width >> i, 1u) || level->height != Max(header->height >> i, 1u))
+			return null;
+
+		if (level->size < GetTextureLevelSize(encoding, level->width, level->height))
+			return null;
+	}
+
+	return header;
+}
+
+static bool BuildTexture(const byte* source, u64 size, OutputBuffer* output, void* context) {
+	TextureSettings* settings = (TextureSettings*)context;
+	Image* image = DecodeImage(source, size);
+
+	if (!image)
+		return false;
+
+	MipChain* mips = GenerateMips(image, settings->filter, settings->srgb);
+	FreeImage(image);
+
+	// The whole file is put together in one buffer and written once.
+	u64 file_size = GetTextureHeaderSize(mips->level_count);
+	TextureLevel levels[MIP_MAX_LEVELS];
+
+	for (u32 i = 0; i < mips->level_count; i++) {
+		MipLevel* mip = &mips->levels[i];
+		levels[i].width  = mip->width;
+		levels[i].height = mip->height;
+		levels[i].offset = file_size;
+		levels[i].size   = GetTextureLevelSize(settings->encoding, mip->width, mip->height);
+
+		file_size = (file_size + levels[i].size + TEXTURE_ALIGNMENT - 1) & ~(u64)(TEXTURE_ALIGNMENT - 1);
+	}
+
+	u8* file = Alloc<u8>(file_size);
+	ZeroMemory(file, file_size);
+
+	TextureHeader* header = (TextureHeader*)file;
+	header->magic       = TEXTURE_MAGIC;
+	header->format      = GetTextureFormat(settings->encoding, settings->srgb);
+	header->width       = mips->levels[0].width;
+	header->height      = mips->levels[0].height;
+	header->level_count = mips->level_count;
+	CopyMemory(header->levels, levels, mips->level_count * sizeof(TextureLevel));
+
+	for (u32 i = 0; i < mips->level_count; i++) {
+		MipLevel* mip = &mips->levels[i];
+		u8* dst = file + levels[i].offset;
+
+		if (settings->encoding == TEXTURE_ENCODING_RGBA8)
+			CopyMemory(dst, mips->data + mip->offset, mip->size);
+		else
+			CompressImage((BlockFormat)(settings->encoding - TEXTURE_ENCODING_BC1), dst, mips->data + mip->offset, mip->width, mip->height);
+	}
+
+	output->Write((const char*)file, file_size);
+	Free(file, file_size);
+	FreeMips(mips);
+	return true;
+}
+
+static MappedFile LoadTexture(String path, TextureSettings settings) {
+	OutputBuffer parameters = GrowableOutput();
+	Print(&parameters, "texture % encoding % srgb % filter %", TEXTURE_BUILD_VERSION, (u32)settings.encoding, settings.srgb, (u32)settings.filter);
+
+	MappedFile texture = LoadDerivedAsset(path, parameters.GetString(), BuildTexture, &settings);
+	parameters.Free();
+
+	if (texture.IsValid() && !ParseTexture(texture.data, texture.length)) {
+		LogWarning("%: the cached texture is corrupt", path);
+		texture.Unmap();
+		return MappedFile();
+	}
+
+	return texture;
+}
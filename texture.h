@@ -0,0 +1,64 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include "general.h"
+#include "string.h"
+#include "file_system.h"
+#include "mips.h"
+
+#include <vulkan/vulkan_core.h>
+
+// Textures ready for the GPU, made from image files at asset build time and kept in the asset cache
+// (asset_cache.h): a header, then every mip level in its final format, each TEXTURE_ALIGNMENT aligned. A texture
+// is uploaded by copying the file to a staging GpuBuffer whole, then one vkCmdCopyBufferToImage with a
+// VkBufferImageCopy per level: bufferOffset = offset, imageExtent = width x height. Block compressed levels
+// round their size up to whole 4x4 blocks, Vulkan takes the extent as it is.
+
+// The BC encodings are in BlockFormat's order.
+enum TextureEncoding : u8 {
+	TEXTURE_ENCODING_RGBA8, // Uncompressed, for devices without BC formats and textures that can't lose anything.
+	TEXTURE_ENCODING_BC1,   // See block_compress.h.
+	TEXTURE_ENCODING_BC3,
+	TEXTURE_ENCODING_BC7,
+};
+
+struct TextureSettings {
+	TextureEncoding encoding;
+	bool      srgb;   // Colors rather than data like normals or masks, filtered in linear light and sampled as sRGB.
+	MipFilter filter;
+};
+
+static const u32 TEXTURE_MAGIC     = 'T' | 'E' << 8 | 'X' << 16 | '1' << 24;
+static const u32 TEXTURE_ALIGNMENT = 16; // Covers the texel block size vkCmdCopyBufferToImage wants offsets aligned to.
+
+struct TextureLevel {
+	u32 width;
+	u32 height;
+	u64 offset; // From the start of the file.
+	u64 size;
+};
+
+struct TextureHeader {
+	u32 magic;
+	u32 format; // VkFormat.
+	u32 width;
+	u32 height;
+	u32 level_count;
+	u32 unused;
+	TextureLevel levels[];
+};
+
+static VkFormat GetTextureFormat(TextureEncoding encoding, bool srgb);
+
+// The header of a texture file, null if data isn't one or its levels run past size.
+static const TextureHeader* ParseTexture(const byte* data, u64 size);
+
+// An AssetProcessor with TextureSettings as its context: decodes an image file (image.h), makes its mips and
+// encodes every level. Level 0 and the mips are compressed on the job threads (jobs.h).
+static bool BuildTexture(const byte* source, u64 size, OutputBuffer* output, void* context);
+
+// The texture made from the image file at path, from the asset cache when it's there and built and stored
+// first when it isn't. Invalid if the image can't be read or decoded.
+static MappedFile LoadTexture(String path, TextureSettings settings);
+
+#endif // TEXTURE_H
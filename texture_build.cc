@@ -0,0 +1,110 @@
+// Makes a texture (see texture.h) from an image file through the asset cache and writes it out, with what it
+// came to. Images already built with the same settings come straight out of the cache.
+// Build and run with: make texture_build && ./texture_build brick.tex brick.jpg
+//                     ./texture_build -bc1 -linear -kaiser mask.tex mask.png
+// The encoding is one of -rgba8, -bc1, -bc3 or -bc7 (the default). -linear is for data rather than colors.
+
+#include "general.h"
+#include "math.h"
+#include "os.h"
+
+#include "assert.cc"
+#include "alloc.cc"
+#include "unix.cc"
+#include "print.cc"
+#include "print_float.cc"
+#include "log.cc"
+#include "file_system.cc"
+#include "hash.cc"
+#include "compress.cc"
+#include "asset_cache.cc"
+#include "jobs.cc"
+#include "pixels.cc"
+#include "packing.cc"
+#include "image.cc"
+#include "mips.cc"
+#include "block_compress.cc"
+#include "texture.cc"
+
+#include "texture.h"
+#include "jobs.h"
+
+static bool WriteWholeFile(String path, const byte* data, u64 size) {
+	File file = OpenFile(path, FILE_MODE_CREATE_OR_TRUNCATE, FILE_ACCESS_WRITE);
+
+	if (!file.IsValid())
+		return false;
+
+	file.Write(data, size);
+	bool complete = file.QueryFileSize() == size;
+	file.Close();
+	return complete;
+}
+
+static int BuildTextureFile(String output, String input, TextureSettings settings) {
+	MappedFile texture = LoadTexture(input, settings);
+
+	if (!texture.IsValid()) {
+		Print("%: can't make a texture of it\n", input);
+		return 1;
+	}
+
+	const TextureHeader* header = ParseTexture(texture.data, texture.length);
+	bool written = WriteWholeFile(output, texture.data, texture.length);
+	u64 uncompressed = 0;
+
+	for (u32 i = 0; i < header->level_count; i++)
+		uncompressed += (u64)header->levels[i].width * header->levels[i].height * 4;
+
+	Print("%: %x%, % levels, % bytes, % of RGBA8\n", output, header->width, header->height, header->level_count,
+		texture.length, (f64)texture.length / uncompressed);
+
+	texture.Unmap();
+
+	if (!written) {
+		Print("%: can't write\n", output);
+		return 1;
+	}
+
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	InitGlobalAllocator();
+	InitJobs();
+
+	TextureSettings settings = {
+		.encoding = TEXTURE_ENCODING_BC7,
+		.srgb     = true,
+		.filter   = MIP_FILTER_BOX,
+	};
+
+	s32 i = 1;
+	bool options_valid = true;
+
+	for (; i < argc && argv[i][0] == '-'; i++) {
+		String option = CString(argv[i]);
+
+		if      (option == "-rgba8")  settings.encoding = TEXTURE_ENCODING_RGBA8;
+		else if (option == "-bc1")    settings.encoding = TEXTURE_ENCODING_BC1;
+		else if (option == "-bc3")    settings.encoding = TEXTURE_ENCODING_BC3;
+		else if (option == "-bc7")    settings.encoding = TEXTURE_ENCODING_BC7;
+		else if (option == "-linear") settings.srgb     = false;
+		else if (option == "-kaiser") settings.filter   = MIP_FILTER_KAISER;
+		else options_valid = false;
+	}
+
+	int result;
+
+	if (options_valid && i + 2 == argc) {
+		result = BuildTextureFile(CString(argv[i]), CString(argv[i + 1]), settings);
+	}
+	else {
+		Print("usage: texture_build [-rgba8|-bc1|-bc3|-bc7] [-linear] [-kaiser] <output> <image>\n");
+		result = 1;
+	}
+
+	ShutdownJobs();
+	standard_output_buffer.Flush();
+	return result;
+}
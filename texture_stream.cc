@@ -0,0 +1,745 @@
+#include "texture_stream.h"
+#include "texture.h"
+#include "async_io.h"
+#include "device.h"
+#include "gpu_buffer.h"
+#include "gpu_memory.h"
+#include "command_buffer.h"
+#include "file_system.h"
+#include "math.h"
+#include "log.h"
+
+static const u32 STREAM_NO_LEVEL        = ~0u;
+static const u32 STREAM_MAX_BATCHES     = 8;
+static const u32 STREAM_STAGING_REGIONS = 128; // Reads in flight and uploads the GPU hasn't done yet.
+
+struct StreamedTexture {
+	File         file = File(-1);
+	VkFormat     format;
+	u32          level_count;
+	TextureLevel levels[MIP_MAX_LEVELS];
+
+	u32 tail_level;      // The biggest level that's always resident.
+	u32 top_level;       // The biggest level that can stream: it fits in staging and reading it hasn't failed.
+	u32 resident_level;  // The biggest level in the image.
+	u32 wanted_level;    // What it was last asked for, the tail until then.
+	u32 requested_level; // The biggest asked for since the last update, level_count when it wasn't.
+	u32 loading_level;   // STREAM_NO_LEVEL when nothing is being read.
+	u32 staging_region;
+	IoRequest request;
+	u64 last_used;       // The update it was last asked for in.
+
+	VkImage       image;
+	VkImageView   view;
+	GpuAllocation memory;
+	u32           version;
+
+	bool in_use;
+	bool read_finished; // Waiting for a rebuild.
+	bool closing;       // Closed while a read was in flight, the slot is free once it completes.
+};
+
+// Destroyed once the GPU has done the update's submission, which comes after every frame that may still use it.
+struct StreamRetired {
+	u64           update;
+	VkImage       image;
+	VkImageView   view;
+	GpuAllocation memory;
+	u32           staging_region; // STREAM_STAGING_REGIONS when there's none.
+};
+
+struct StreamBatch {
+	CommandBuffer command_buffer;
+	VkFence       fence;
+	u64           update;
+	bool          submitted;
+};
+
+// Regions of the staging buffer are handed out in a ring and come back in any order, the ring only moves past
+// the oldest once it's back.
+struct StagingRegion {
+	u64  offset;
+	u64  end;
+	bool freed;
+};
+
+static struct {
+	TextureStreamSettings settings;
+	StreamedTexture       textures[STREAM_MAX_TEXTURES];
+
+	GpuBuffer     staging;
+	StagingRegion regions[STREAM_STAGING_REGIONS];
+	u32           region_head; // The oldest.
+	u32           region_count;
+
+	StreamBatch batches[STREAM_MAX_BATCHES];
+	u32         batch_count;
+	u64         update_count;    // Updates submitted, the number of the one being put together.
+	u64         completed_count; // Updates the GPU has done.
+	u32         rebuild_count;   // In the current update.
+
+	List<StreamRetired> retired;
+
+	u64 resident_bytes;
+	u64 retiring_bytes;
+	u64 pending_bytes;
+	u64 streamed_bytes;
+	u64 evictions;
+	u32 texture_count;
+	u32 reads_in_flight;
+} stream;
+
+static u64 AlignStaging(u64 offset) {
+	return (offset + TEXTURE_ALIGNMENT - 1) & ~(u64)(TEXTURE_ALIGNMENT - 1);
+}
+
+// STREAM_STAGING_REGIONS when there's no room.
+static u32 AllocateStagingRegion(u64 size) {
+	if (stream.region_count == STREAM_STAGING_REGIONS || size > stream.staging.size)
+		return STREAM_STAGING_REGIONS;
+
+	u64 offset = 0;
+
+	if (stream.region_count) {
+		StagingRegion* first = &stream.regions[stream.region_head];
+		StagingRegion* last  = &stream.regions[(stream.region_head + stream.region_count - 1) % STREAM_STAGING_REGIONS];
+		u64 head = AlignStaging(last->end);
+
+		if (last->offset >= first->offset) {
+			// Not wrapped: after the newest, or from the start up to the oldest.
+			if (head + size <= stream.staging.size)
+				offset = head;
+			else if (size <= first->offset)
+				offset = 0;
+			else
+				return STREAM_STAGING_REGIONS;
+		}
+		else {
+			if (head + size > first->offset)
+				return STREAM_STAGING_REGIONS;
+
+			offset = head;
+		}
+	}
+
+	u32 index = (stream.region_head + stream.region_count++) % STREAM_STAGING_REGIONS;
+	stream.regions[index] = { offset, offset + size, false };
+	return index;
+}
+
+static void FreeStagingRegion(u32 index) {
+	stream.regions[index].freed = true;
+
+	while (stream.region_count && stream.regions[stream.region_head].freed) {
+		stream.region_head = (stream.region_head + 1) % STREAM_STAGING_REGIONS;
+		stream.region_count--;
+	}
+}
+
+static void RetireStreamed(VkImage image, VkImageView view, GpuAllocation memory, u32 staging_region) {
+	stream.retired.Add({
+		.update         = stream.update_count,
+		.image          = image,
+		.view           = view,
+		.memory         = memory,
+		.staging_region = staging_region,
+	});
+
+	stream.retiring_bytes += memory.size;
+}
+
+static void DestroyRetired(StreamRetired* retired) {
+	if (retired->image) {
+		vkDestroyImageView(device.logical_device, retired->view, null);
+		vkDestroyImage(device.logical_device, retired->image, null);
+		stream.retiring_bytes -= retired->memory.size;
+		FreeGpuMemory(&retired->memory);
+	}
+
+	if (retired->staging_region != STREAM_STAGING_REGIONS)
+		FreeStagingRegion(retired->staging_region);
+}
+
+static void DestroyCompletedRetired() {
+	for (u32 i = 0; i < stream.batch_count; i++) {
+		StreamBatch* batch = &stream.batches[i];
+
+		if (batch->submitted && batch->update >= stream.completed_count && vkGetFenceStatus(device.logical_device, batch->fence) == VK_SUCCESS)
+			stream.completed_count = batch->update + 1;
+	}
+
+	u32 kept = 0;
+
+	for (u32 i = 0; i < stream.retired.count; i++) {
+		if (stream.retired[i].update < stream.completed_count)
+			DestroyRetired(&stream.retired[i]);
+		else
+			stream.retired[kept++] = stream.retired[i];
+	}
+
+	stream.retired.count = kept;
+}
+
+static StreamedTexture* GetStreamedTexture(TextureHandle handle) {
+	Assert(handle && handle <= STREAM_MAX_TEXTURES);
+	StreamedTexture* texture = &stream.textures[handle - 1];
+	Assert(texture->in_use && !texture->closing);
+	return texture;
+}
+
+// Replaces the texture's image with one holding levels top to the end. Levels it already has are copied on the
+// GPU, the ones it doesn't come from source, one after another from offset, each TEXTURE_ALIGNMENT aligned.
+static void RebuildStreamedImage(StreamedTexture* texture, u32 top, CommandBuffer* command_buffer, VkBuffer source, u64 offset) {
+	u32 old_top   = texture->image ? texture->resident_level : texture->level_count;
+	u32 mip_count = texture->level_count - top;
+
+	VkImageCreateInfo image_info = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+		.imageType = VK_IMAGE_TYPE_2D,
+		.format = texture->format,
+		.extent = { texture->levels[top].width, texture->levels[top].height, 1 },
+		.mipLevels = mip_count,
+		.arrayLayers = 1,
+		.samples = VK_SAMPLE_COUNT_1_BIT,
+		.tiling = VK_IMAGE_TILING_OPTIMAL,
+		.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+	};
+
+	VkImage image;
+	VkResult vk_result = vkCreateImage(device.logical_device, &image_info, null, &image);
+	Assert(vk_result == VK_SUCCESS);
+
+	GpuAllocation memory = AllocateImageMemory(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	// Sampling only reads, so the frames before only have to finish before the old image changes layout.
+	VkImageMemoryBarrier to_transfer[2] = {
+		{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			.srcAccessMask = 0,
+			.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+			.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = image,
+			.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mip_count, 0, 1 },
+		},
+		{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			.srcAccessMask = 0,
+			.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+			.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = texture->image,
+			.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, texture->level_count - old_top, 0, 1 },
+		},
+	};
+
+	vkCmdPipelineBarrier(command_buffer->handle, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+		0, null, 0, null, texture->image ? 2 : 1, to_transfer);
+
+	if (texture->image) {
+		VkImageCopy copies[MIP_MAX_LEVELS];
+		u32 copy_count = 0;
+
+		for (u32 level = Max(top, old_top); level < texture->level_count; level++) {
+			copies[copy_count++] = {
+				.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - old_top, 0, 1 },
+				.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - top,     0, 1 },
+				.extent = { texture->levels[level].width, texture->levels[level].height, 1 },
+			};
+		}
+
+		vkCmdCopyImage(command_buffer->handle, texture->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, copy_count, copies);
+	}
+
+	if (top < old_top) {
+		VkBufferImageCopy uploads[MIP_MAX_LEVELS];
+		u32 upload_count = 0;
+
+		for (u32 level = top; level < old_top; level++) {
+			uploads[upload_count++] = {
+				.bufferOffset = offset,
+				.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - top, 0, 1 },
+				.imageExtent = { texture->levels[level].width, texture->levels[level].height, 1 },
+			};
+
+			offset = AlignStaging(offset + texture->levels[level].size);
+		}
+
+		vkCmdCopyBufferToImage(command_buffer->handle, source, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, upload_count, uploads);
+	}
+
+	VkImageMemoryBarrier to_shader = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+		.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = image,
+		.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mip_count, 0, 1 },
+	};
+
+	vkCmdPipelineBarrier(command_buffer->handle, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+		0, null, 0, null, 1, &to_shader);
+
+	VkImageViewCreateInfo view_info = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+		.image = image,
+		.viewType = VK_IMAGE_VIEW_TYPE_2D,
+		.format = texture->format,
+		.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mip_count, 0, 1 },
+	};
+
+	VkImageView view;
+	vk_result = vkCreateImageView(device.logical_device, &view_info, null, &view);
+	Assert(vk_result == VK_SUCCESS);
+
+	// The old image stays in TRANSFER_SRC, nothing samples it after this.
+	if (texture->image) {
+		RetireStreamed(texture->image, texture->view, texture->memory, STREAM_STAGING_REGIONS);
+		stream.resident_bytes -= texture->memory.size;
+	}
+
+	texture->image          = image;
+	texture->view           = view;
+	texture->memory         = memory;
+	texture->resident_level = top;
+	texture->version++;
+	stream.resident_bytes += memory.size;
+}
+
+static void InitTextureStreaming(TextureStreamSettings settings) {
+	Assert(settings.frames_in_flight + 1 <= STREAM_MAX_BATCHES);
+
+	stream.settings    = settings;
+	stream.batch_count = settings.frames_in_flight + 1;
+
+	// Reads land straight in the mapping, coherent so the copies see them without a flush.
+	stream.staging = CreateBuffer(settings.staging_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	stream.staging.Map();
+
+	for (u32 i = 0; i < stream.batch_count; i++) {
+		stream.batches[i].command_buffer = device.CreateCommandBuffer();
+		stream.batches[i].fence = device.CreateFence();
+	}
+}
+
+static void FreeStreamedTexture(StreamedTexture* texture) {
+	texture->file.Close();
+	texture->in_use  = false;
+	texture->closing = false;
+	stream.texture_count--;
+}
+
+static TextureHandle OpenStreamedTexture(String path) {
+	File file = OpenFile(path, FILE_MODE_OPEN, FILE_ACCESS_READ);
+
+	if (!file.IsValid()) {
+		LogWarning("%: can't open the texture", path);
+		return 0;
+	}
+
+	// ParseTexture only looks at the header and the levels it lists, so the header is checked against the size of
+	// the whole file without reading the rest. It checks the format, extents and sizes the uploads rely on.
+	alignas(8) byte header_data[sizeof(TextureHeader) + MIP_MAX_LEVELS * sizeof(TextureLevel)];
+	u64 file_size = file.QueryFileSize();
+	u64 header_size = file.ReadAt(header_data, Min(file_size, (u64)sizeof(header_data)), 0);
+	const TextureHeader* header = header_size >= sizeof(TextureHeader) ? ParseTexture(header_data, file_size) : null;
+
+	if (!header) {
+		LogWarning("%: not a texture", path);
+		file.Close();
+		return 0;
+	}
+
+	u32 max_size = device.physical_properties.limits.maxImageDimension2D;
+
+	if (header->width > max_size || header->height > max_size) {
+		LogWarning("%: % x % is too big for the device", path, header->width, header->height);
+		file.Close();
+		return 0;
+	}
+
+	bool block_compressed = header->format != VK_FORMAT_R8G8B8A8_UNORM && header->format != VK_FORMAT_R8G8B8A8_SRGB;
+
+	if (block_compressed && !device.supports_bc_textures) {
+		LogWarning("%: the device can't sample BC textures", path);
+		file.Close();
+		return 0;
+	}
+
+	u32 index = 0;
+	while (index < STREAM_MAX_TEXTURES && stream.textures[index].in_use)
+		index++;
+
+	if (index == STREAM_MAX_TEXTURES) {
+		LogWarning("%: already streaming % textures", path, STREAM_MAX_TEXTURES);
+		file.Close();
+		return 0;
+	}
+
+	StreamedTexture* texture = &stream.textures[index];
+	*texture = {
+		.file        = file,
+		.format      = (VkFormat)header->format,
+		.level_count = header->level_count,
+	};
+
+	CopyMemory(texture->levels, header->levels, header->level_count * sizeof(TextureLevel));
+
+	texture->tail_level = texture->level_count - 1;
+	while (texture->tail_level && Max(texture->levels[texture->tail_level - 1].width, texture->levels[texture->tail_level - 1].height) <= STREAM_TAIL_SIZE)
+		texture->tail_level--;
+
+	texture->top_level = 0;
+	while (texture->top_level < texture->tail_level && texture->levels[texture->top_level].size > stream.settings.staging_size)
+		texture->top_level++;
+
+	texture->wanted_level    = texture->tail_level;
+	texture->requested_level = texture->level_count;
+	texture->loading_level   = STREAM_NO_LEVEL;
+	texture->last_used       = stream.update_count;
+	texture->in_use          = true;
+	stream.texture_count++;
+
+	// The tail is small, it's read and uploaded now so the texture can be drawn before anything streams.
+	u64 tail_size = 0;
+	for (u32 level = texture->tail_level; level < texture->level_count; level++)
+		tail_size = AlignStaging(tail_size + texture->levels[level].size);
+
+	GpuBuffer staging = CreateBuffer(tail_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	byte* mapping = (byte*)staging.Map();
+	bool complete = true;
+
+	for (u64 level = texture->tail_level, offset = 0; level < texture->level_count; level++) {
+		TextureLevel* source = &texture->levels[level];
+		complete = complete && file.ReadAt(mapping + offset, source->size, source->offset) == source->size;
+		offset = AlignStaging(offset + source->size);
+	}
+
+	if (complete) {
+		CommandBuffer command_buffer = device.CreateCommandBuffer();
+		command_buffer.Begin(true);
+		RebuildStreamedImage(texture, texture->tail_level, &command_buffer, staging.buffer, 0);
+		command_buffer.End();
+
+		device.general_queue->Execute(command_buffer);
+		command_buffer.Destroy();
+	}
+
+	staging.Unmap();
+	staging.Destroy();
+
+	if (!complete) {
+		LogWarning("%: can't read the texture's mip tail", path);
+		FreeStreamedTexture(texture);
+		return 0;
+	}
+
+	return index + 1;
+}
+
+static void CloseStreamedTexture(TextureHandle handle) {
+	StreamedTexture* texture = GetStreamedTexture(handle);
+
+	RetireStreamed(texture->image, texture->view, texture->memory, STREAM_STAGING_REGIONS);
+	stream.resident_bytes -= texture->memory.size;
+	texture->image = VK_NULL_HANDLE;
+
+	if (texture->loading_level != STREAM_NO_LEVEL) {
+		// A finished read isn't on the GPU yet, its region can go now. One in flight still writes to it.
+		if (!texture->read_finished) {
+			CancelAsyncIo(texture->request);
+			texture->closing = true;
+			return;
+		}
+
+		FreeStagingRegion(texture->staging_region);
+		stream.pending_bytes -= texture->levels[texture->loading_level].size;
+	}
+
+	FreeStreamedTexture(texture);
+}
+
+static void RequestTextureDetail(TextureHandle handle, f32 screen_size) {
+	StreamedTexture* texture = GetStreamedTexture(handle);
+
+	// The smallest level still at least as big as it is on screen.
+	f32 texels = Max(texture->levels[0].width, texture->levels[0].height);
+	f32 ratio  = texels / Max(screen_size, 1.0f);
+	u32 level  = ratio > 1 ? (u32)Floor(Log2(ratio)) : 0;
+
+	texture->requested_level = Min(texture->requested_level, Min(level, texture->tail_level));
+	texture->last_used = stream.update_count;
+}
+
+static VkImageView GetTextureView(TextureHandle handle, u32* version) {
+	StreamedTexture* texture = GetStreamedTexture(handle);
+
+	if (version)
+		*version = texture->version;
+
+	return texture->view;
+}
+
+static bool CanRebuild() {
+	return stream.rebuild_count < STREAM_MAX_REBUILDS;
+}
+
+static void FinishStreamReads(CommandBuffer* command_buffer) {
+	IoCompletion completions[STREAM_MAX_READS];
+	u32 count;
+
+	while ((count = PollAsyncIo(completions, STREAM_MAX_READS))) {
+		for (u32 i = 0; i < count; i++) {
+			StreamedTexture* texture = &stream.textures[completions[i].user_data];
+			u64 size = texture->levels[texture->loading_level].size;
+			stream.reads_in_flight--;
+
+			if (texture->closing || completions[i].status != IO_DONE || completions[i].bytes != size) {
+				if (!texture->closing) {
+					LogWarning("Texture streaming: reading level % failed, the texture stops at level %", texture->loading_level, texture->loading_level + 1);
+					texture->top_level = texture->loading_level + 1;
+				}
+
+				FreeStagingRegion(texture->staging_region);
+				stream.pending_bytes -= size;
+				texture->loading_level = STREAM_NO_LEVEL;
+
+				if (texture->closing)
+					FreeStreamedTexture(texture);
+
+				continue;
+			}
+
+			texture->read_finished = true;
+		}
+	}
+
+	// Reads left over when the update's rebuilds run out are picked up by the next one.
+	for (u32 i = 0; i < STREAM_MAX_TEXTURES && CanRebuild(); i++) {
+		StreamedTexture* texture = &stream.textures[i];
+
+		if (!texture->in_use || !texture->read_finished)
+			continue;
+
+		u64 size = texture->levels[texture->loading_level].size;
+		RebuildStreamedImage(texture, texture->loading_level, command_buffer, stream.staging.buffer, stream.regions[texture->staging_region].offset);
+		RetireStreamed(VK_NULL_HANDLE, VK_NULL_HANDLE, { }, texture->staging_region);
+		stream.rebuild_count++;
+
+		stream.pending_bytes  -= size;
+		stream.streamed_bytes += size;
+		texture->loading_level = STREAM_NO_LEVEL;
+		texture->read_finished = false;
+	}
+}
+
+// The texture to drop a level from to make room: one holding more than it was last asked for first, otherwise
+// the least recently used of those used before used_before. Never below the tail, never one being read.
+static StreamedTexture* FindEvictionVictim(u64 used_before, StreamedTexture* except) {
+	StreamedTexture* victim = null;
+	bool victim_surplus = false;
+
+	for (u32 i = 0; i < STREAM_MAX_TEXTURES; i++) {
+		StreamedTexture* texture = &stream.textures[i];
+
+		if (!texture->in_use || texture->closing || texture == except)
+			continue;
+
+		if (texture->loading_level != STREAM_NO_LEVEL || texture->resident_level >= texture->tail_level)
+			continue;
+
+		bool surplus = texture->resident_level < texture->wanted_level;
+
+		if (!surplus && texture->last_used >= used_before)
+			continue;
+
+		if (!victim || (surplus && !victim_surplus) || (surplus == victim_surplus && texture->last_used < victim->last_used)) {
+			victim = texture;
+			victim_surplus = surplus;
+		}
+	}
+
+	return victim;
+}
+
+static bool EvictStreamedLevel(CommandBuffer* command_buffer, u64 used_before, StreamedTexture* except) {
+	if (!CanRebuild())
+		return false;
+
+	StreamedTexture* victim = FindEvictionVictim(used_before, except);
+
+	if (!victim)
+		return false;
+
+	RebuildStreamedImage(victim, victim->resident_level + 1, command_buffer, VK_NULL_HANDLE, 0);
+	stream.rebuild_count++;
+	stream.evictions++;
+	return true;
+}
+
+static bool IsOverStreamBudget(u64 extra) {
+	return stream.resident_bytes + stream.pending_bytes + extra > stream.settings.budget;
+}
+
+static void StartStreamReads(CommandBuffer* command_buffer) {
+	u32 candidates[STREAM_MAX_TEXTURES];
+	u32 candidate_count = 0;
+
+	for (u32 i = 0; i < STREAM_MAX_TEXTURES; i++) {
+		StreamedTexture* texture = &stream.textures[i];
+
+		if (!texture->in_use || texture->closing || texture->loading_level != STREAM_NO_LEVEL)
+			continue;
+
+		if (texture->resident_level > Max(texture->wanted_level, texture->top_level))
+			candidates[candidate_count++] = i;
+	}
+
+	// The most levels short first, then the most recently used.
+	auto read_before = [](u32 a, u32 b) {
+		StreamedTexture* ta = &stream.textures[a];
+		StreamedTexture* tb = &stream.textures[b];
+		u32 deficit_a = ta->resident_level - Max(ta->wanted_level, ta->top_level);
+		u32 deficit_b = tb->resident_level - Max(tb->wanted_level, tb->top_level);
+
+		if (deficit_a != deficit_b) return deficit_a > deficit_b;
+		return ta->last_used > tb->last_used;
+	};
+
+	for (u32 i = 1; i < candidate_count; i++) {
+		u32 index = candidates[i];
+		u32 j = i;
+
+		for (; j > 0 && read_before(index, candidates[j - 1]); j--)
+			candidates[j] = candidates[j - 1];
+
+		candidates[j] = index;
+	}
+
+	for (u32 i = 0; i < candidate_count && stream.reads_in_flight < STREAM_MAX_READS; i++) {
+		StreamedTexture* texture = &stream.textures[candidates[i]];
+		u32 level = texture->resident_level - 1;
+		u64 size  = texture->levels[level].size;
+
+		// Less recently used textures make room. The level the image grows by is a fair estimate of what it costs.
+		while (IsOverStreamBudget(size) && EvictStreamedLevel(command_buffer, texture->last_used, texture));
+
+		if (IsOverStreamBudget(size))
+			continue;
+
+		u32 region = AllocateStagingRegion(size);
+
+		if (region == STREAM_STAGING_REGIONS)
+			break;
+
+		IoRequest request = ReadAsync(texture->file, texture->levels[level].offset, (byte*)stream.staging.mapping + stream.regions[region].offset, size, candidates[i]);
+
+		if (!request) {
+			FreeStagingRegion(region);
+			break;
+		}
+
+		texture->loading_level  = level;
+		texture->staging_region = region;
+		texture->request        = request;
+		stream.pending_bytes += size;
+		stream.reads_in_flight++;
+	}
+
+	SubmitAsyncIo();
+}
+
+static void UpdateTextureStreaming() {
+	StreamBatch* batch = &stream.batches[stream.update_count % stream.batch_count];
+
+	// Normally long done, the ring is a submission longer than the frames in flight.
+	if (batch->submitted)
+		vkWaitForFences(device.logical_device, 1, &batch->fence, true, -1);
+
+	// Before the fence is reset, while it still says the batch is done.
+	DestroyCompletedRetired();
+	vkResetFences(device.logical_device, 1, &batch->fence);
+
+	stream.rebuild_count = 0;
+	batch->command_buffer.Reset();
+	batch->command_buffer.Begin(true);
+
+	for (u32 i = 0; i < STREAM_MAX_TEXTURES; i++) {
+		StreamedTexture* texture = &stream.textures[i];
+
+		if (!texture->in_use || texture->closing || texture->requested_level == texture->level_count)
+			continue;
+
+		texture->wanted_level    = texture->requested_level;
+		texture->requested_level = texture->level_count;
+	}
+
+	FinishStreamReads(&batch->command_buffer);
+
+	while (IsOverStreamBudget(0) && EvictStreamedLevel(&batch->command_buffer, -1, null));
+
+	StartStreamReads(&batch->command_buffer);
+
+	// Submitted even when empty: the fence is what says the GPU is past the frames before it.
+	batch->command_buffer.End();
+	device.general_queue->ExecuteAsync(batch->command_buffer, batch->fence);
+	batch->update    = stream.update_count;
+	batch->submitted = true;
+	stream.update_count++;
+}
+
+static TextureStreamStats GetTextureStreamStats() {
+	return {
+		.budget          = stream.settings.budget,
+		.resident_bytes  = stream.resident_bytes,
+		.retiring_bytes  = stream.retiring_bytes,
+		.pending_bytes   = stream.pending_bytes,
+		.streamed_bytes  = stream.streamed_bytes,
+		.texture_count   = stream.texture_count,
+		.reads_in_flight = stream.reads_in_flight,
+		.evictions       = stream.evictions,
+	};
+}
+
+static void ShutdownTextureStreaming() {
+	for (u32 i = 0; i < STREAM_MAX_TEXTURES; i++)
+		if (stream.textures[i].in_use && !stream.textures[i].closing)
+			CloseStreamedTexture(i + 1);
+
+	// Closing cancelled the reads, their completions free the slots.
+	IoCompletion completions[STREAM_MAX_READS];
+	u32 count;
+
+	while (stream.reads_in_flight && (count = WaitAsyncIo(completions, STREAM_MAX_READS))) {
+		for (u32 i = 0; i < count; i++) {
+			StreamedTexture* texture = &stream.textures[completions[i].user_data];
+			FreeStagingRegion(texture->staging_region);
+			stream.pending_bytes -= texture->levels[texture->loading_level].size;
+			stream.reads_in_flight--;
+			FreeStreamedTexture(texture);
+		}
+	}
+
+	for (StreamRetired& retired : stream.retired)
+		DestroyRetired(&retired);
+
+	stream.retired.Free();
+
+	for (u32 i = 0; i < stream.batch_count; i++) {
+		stream.batches[i].command_buffer.Destroy();
+		vkDestroyFence(device.logical_device, stream.batches[i].fence, null);
+	}
+
+	stream.staging.Unmap();
+	stream.staging.Destroy();
+}
@@ -0,0 +1,69 @@
+#ifndef TEXTURE_STREAM_H
+#define TEXTURE_STREAM_H
+
+#include "general.h"
+#include "string.h"
+
+#include <vulkan/vulkan.h>
+
+// Sampled images for texture files (texture.h) that hold only the mip levels the screen needs, within a fixed
+// amount of device memory. Opening a texture uploads its mip tail, the levels up to STREAM_TAIL_SIZE, so it can be
+// drawn straight away. Every frame the renderer says how big each texture is on screen, and the levels that
+// size needs are read in the background (async_io.h), one level per texture at a time, the biggest shortfalls
+// first. When the budget is full, levels are dropped from textures that have more than they were last asked
+// for, then from the least recently used.
+//
+// A texture's image always holds exactly its resident levels: a level is added or dropped by making a new image
+// one level bigger or smaller and copying the levels it keeps on the GPU. The view changes when that happens,
+// so descriptors have to be rewritten when the version from GetTextureView changes. Old images are destroyed
+// once the GPU is past every frame submitted before they were replaced.
+//
+// Streaming polls async_io itself, so nothing else on the thread may poll it for its own reads. Everything here
+// belongs to the thread that calls UpdateTextureStreaming.
+
+typedef u32 TextureHandle; // 0 is never a valid texture.
+
+static const u32 STREAM_MAX_TEXTURES = 1024;
+static const u32 STREAM_TAIL_SIZE    = 64;  // Levels this big or smaller are always resident.
+static const u32 STREAM_MAX_READS    = 32;  // Levels being read at once.
+static const u32 STREAM_MAX_REBUILDS = 16;  // Images replaced per update, by levels arriving and by eviction.
+
+struct TextureStreamSettings {
+	u64 budget;           // Bytes of device memory for streamed images, mip tails included.
+	u64 staging_size;     // Bytes of host visible memory levels are read into. A level bigger than this never streams.
+	u32 frames_in_flight; // The copies go in a ring of this many submissions and one more, so the GPU is normally
+	                      // done with one by the time it comes round again.
+};
+
+struct TextureStreamStats {
+	u64 budget;
+	u64 resident_bytes; // In images that are in use.
+	u64 retiring_bytes; // In replaced images waiting for the GPU to be done with them, briefly over the budget.
+	u64 pending_bytes;  // Levels being read, counted against the budget before they arrive.
+	u64 streamed_bytes; // Read since streaming started.
+	u32 texture_count;
+	u32 reads_in_flight;
+	u64 evictions;      // Levels dropped to make room.
+};
+
+static void InitTextureStreaming(TextureStreamSettings settings);
+static void ShutdownTextureStreaming(); // After the device is idle.
+
+// 0 if path isn't a texture file, or is in a format the device can't sample.
+static TextureHandle OpenStreamedTexture(String path);
+static void          CloseStreamedTexture(TextureHandle texture);
+
+// How many pixels across the texture covers on screen this frame. Call it for every draw that uses the texture,
+// the biggest size wins, and a texture that isn't asked for keeps what it has until the memory is needed.
+static void RequestTextureDetail(TextureHandle texture, f32 screen_size);
+
+// Once a frame, before the frame's commands are submitted on the general queue: picks up finished reads,
+// replaces images, evicts and starts new reads. The copies go in a submission of their own, ahead of the frame.
+static void UpdateTextureStreaming();
+
+// The view of every level resident now. version changes whenever the view does.
+static VkImageView GetTextureView(TextureHandle texture, u32* version = null);
+
+static TextureStreamStats GetTextureStreamStats();
+
+#endif // TEXTURE_STREAM_H
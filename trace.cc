@@ -0,0 +1,83 @@
+#include "trace.h"
+#include "log.h"
+#include "print.h"
+
+static u32 trace_site_count = 0;
+
+static void StartTracing(File file) {
+	u64 header[2] = { TRACE_MAGIC, log_start_time };
+	file.Write((const char*)header, sizeof(header));
+
+	log_state.trace_file = file;
+	__atomic_store_n(&trace_enabled, true, __ATOMIC_RELEASE);
+}
+
+static u32 RegisterTraceSite(TraceSite* site, const char* format, u32 format_length, const TraceType* types, u32 type_count) {
+	u16 file_length = 0;
+	while (site->file[file_length] && file_length < LOG_MAX_MESSAGE) file_length++;
+	format_length = Min(format_length, LOG_MAX_MESSAGE);
+
+	LogEntry* entry = ReserveLogEntry(LOG_ENTRY_TRACE_SITE, 4 + 4 + 1 + type_count + 2 + file_length + 2 + format_length);
+
+	if (!entry)
+		return 0;
+
+	u32 id = __atomic_add_fetch(&trace_site_count, 1, __ATOMIC_RELAXED);
+	u16 length = format_length;
+
+	byte* p = (byte*)(entry + 1);
+	CopyMemory(p, &id, 4);                  p += 4;
+	CopyMemory(p, &site->line, 4);          p += 4;
+	*p++ = type_count;
+	CopyMemory(p, types, type_count);       p += type_count;
+	CopyMemory(p, &file_length, 2);         p += 2;
+	CopyMemory(p, site->file, file_length); p += file_length;
+	CopyMemory(p, &length, 2);              p += 2;
+	CopyMemory(p, format, format_length);
+	CommitLogEntry();
+
+	// Two threads can get here for the same site, both descriptions are written so either id decodes.
+	u32 expected = 0;
+	__atomic_compare_exchange_n(&site->id, &expected, id, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+	return id;
+}
+
+template<typename T>
+static const byte* WriteTraceValueAs(OutputBuffer* buffer, const byte* p) {
+	alignas(T) byte value[sizeof(T)];
+	CopyMemory(value, p, sizeof(T));
+	Write(buffer, *(T*)value);
+	return p + sizeof(T);
+}
+
+static const byte* WriteTraceValue(OutputBuffer* buffer, TraceType type, const byte* p) {
+	switch (type) {
+		case TRACE_BOOL:       Write(buffer, (bool)*p); return p + 1;
+		case TRACE_CHAR:       Write(buffer, (char)*p); return p + 1;
+		case TRACE_U64:        return WriteTraceValueAs<u64>(buffer, p);
+		case TRACE_S64:        return WriteTraceValueAs<s64>(buffer, p);
+		case TRACE_F32:        return WriteTraceValueAs<f32>(buffer, p);
+		case TRACE_F64:        return WriteTraceValueAs<f64>(buffer, p);
+		case TRACE_POINTER:    return WriteTraceValueAs<void*>(buffer, p);
+		case TRACE_VECTOR2:    return WriteTraceValueAs<Vector2>(buffer, p);
+		case TRACE_VECTOR3:    return WriteTraceValueAs<Vector3>(buffer, p);
+		case TRACE_VECTOR4:    return WriteTraceValueAs<Vector4>(buffer, p);
+		case TRACE_QUATERNION: return WriteTraceValueAs<Quaternion>(buffer, p);
+
+		case TRACE_INT_FORMAT: {
+			IntFormat format = { .base = (Base)*p };
+			CopyMemory(&format.value, p + 1, 8);
+			Write(buffer, format);
+			return p + 9;
+		}
+
+		case TRACE_STRING: {
+			u16 length;
+			CopyMemory(&length, p, 2);
+			buffer->Write((const char*)p + 2, length);
+			return p + 2 + length;
+		}
+	}
+
+	return p;
+}
@@ -0,0 +1,153 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "general.h"
+#include "log.h"
+#include "vector.h"
+#include "quaternion.h"
+
+// Binary logging for heavy instrumentation. A trace records a call site id and the raw bytes of its arguments
+// into the thread's log ring, nothing is formatted. The flusher appends the records to the trace file untouched
+// and trace_decode turns the file back into the same text the log would have printed.
+// Each call site describes itself (file, line, format, argument types) in the stream the first time it's hit.
+//
+// A trace file is TRACE_MAGIC, the log start time (u64), then LogEntry records:
+//   LOG_ENTRY_TRACE_SITE: u32 id, u32 line, u8 argument count, the TraceTypes, u16 + file, u16 + format
+//   LOG_ENTRY_TRACE:      u32 id, then each argument as in TraceEncode
+
+static const u64 TRACE_MAGIC = 0x31454341525445ull; // "ETRACE1"
+
+enum TraceType : u8 {
+	TRACE_BOOL,
+	TRACE_CHAR,
+	TRACE_U64,
+	TRACE_S64,
+	TRACE_F32,
+	TRACE_F64,
+	TRACE_POINTER,
+	TRACE_INT_FORMAT, // u8 Base, u64
+	TRACE_STRING,     // u16 length, characters
+	TRACE_VECTOR2,
+	TRACE_VECTOR3,
+	TRACE_VECTOR4,
+	TRACE_QUATERNION,
+};
+
+struct TraceSite {
+	u32 id; // 0 until the site's first record.
+	u32 line;
+	const char* file;
+};
+
+static bool trace_enabled = false;
+
+static void StartTracing(File file); // Writes the file header, records before this are skipped.
+
+// Writes the site's description and returns its id, 0 if the ring was full (the record is dropped then).
+static u32 RegisterTraceSite(TraceSite* site, const char* format, u32 format_length, const TraceType* types, u32 type_count);
+
+// Writes one argument the way Print would have, returns the bytes after it. Used by trace_decode.
+static const byte* WriteTraceValue(OutputBuffer* buffer, TraceType type, const byte* p);
+
+template<typename T> struct TraceTypeOf;
+template<> struct TraceTypeOf<bool>              { static const TraceType type = TRACE_BOOL;       };
+template<> struct TraceTypeOf<char>              { static const TraceType type = TRACE_CHAR;       };
+template<> struct TraceTypeOf<u8>                { static const TraceType type = TRACE_U64;        };
+template<> struct TraceTypeOf<u16>               { static const TraceType type = TRACE_U64;        };
+template<> struct TraceTypeOf<u32>               { static const TraceType type = TRACE_U64;        };
+template<> struct TraceTypeOf<u64>               { static const TraceType type = TRACE_U64;        };
+template<> struct TraceTypeOf<unsigned long>     { static const TraceType type = TRACE_U64;        };
+template<> struct TraceTypeOf<s8>                { static const TraceType type = TRACE_S64;        };
+template<> struct TraceTypeOf<s16>               { static const TraceType type = TRACE_S64;        };
+template<> struct TraceTypeOf<s32>               { static const TraceType type = TRACE_S64;        };
+template<> struct TraceTypeOf<s64>               { static const TraceType type = TRACE_S64;        };
+template<> struct TraceTypeOf<f32>               { static const TraceType type = TRACE_F32;        };
+template<> struct TraceTypeOf<f64>               { static const TraceType type = TRACE_F64;        };
+template<> struct TraceTypeOf<void*>             { static const TraceType type = TRACE_POINTER;    };
+template<> struct TraceTypeOf<IntFormat>         { static const TraceType type = TRACE_INT_FORMAT; };
+template<> struct TraceTypeOf<String>            { static const TraceType type = TRACE_STRING;     };
+template<> struct TraceTypeOf<Vector2>           { static const TraceType type = TRACE_VECTOR2;    };
+template<> struct TraceTypeOf<Vector3>           { static const TraceType type = TRACE_VECTOR3;    };
+template<> struct TraceTypeOf<Vector4>           { static const TraceType type = TRACE_VECTOR4;    };
+template<> struct TraceTypeOf<Quaternion>        { static const TraceType type = TRACE_QUATERNION; };
+
+// Strings are cut off so a record always fits in one entry.
+static const u32 TRACE_MAX_STRING = 255;
+
+static u32 TraceSize(bool)       { return 1; }
+static u32 TraceSize(char)       { return 1; }
+static u32 TraceSize(u64)        { return 8; }
+static u32 TraceSize(s64)        { return 8; }
+static u32 TraceSize(f32)        { return 4; }
+static u32 TraceSize(f64)        { return 8; }
+static u32 TraceSize(void*)      { return 8; }
+static u32 TraceSize(IntFormat)  { return 9; }
+static u32 TraceSize(String s)   { return 2 + Min(s.length, TRACE_MAX_STRING); }
+static u32 TraceSize(Vector2)    { return 8; }
+static u32 TraceSize(Vector3)    { return 12; }
+static u32 TraceSize(Vector4)    { return 16; }
+static u32 TraceSize(Quaternion) { return 16; }
+
+static byte* TraceEncode(byte* p, bool b)        { *p = b; return p + 1; }
+static byte* TraceEncode(byte* p, char c)        { *p = c; return p + 1; }
+static byte* TraceEncode(byte* p, u64 n)         { CopyMemory(p, &n, 8); return p + 8; }
+static byte* TraceEncode(byte* p, s64 n)         { CopyMemory(p, &n, 8); return p + 8; }
+static byte* TraceEncode(byte* p, f32 f)         { CopyMemory(p, &f, 4); return p + 4; }
+static byte* TraceEncode(byte* p, f64 f)         { CopyMemory(p, &f, 8); return p + 8; }
+static byte* TraceEncode(byte* p, void* pointer) { return TraceEncode(p, (u64)pointer); }
+static byte* TraceEncode(byte* p, IntFormat f)   { *p = f.base; return TraceEncode(p + 1, f.value); }
+static byte* TraceEncode(byte* p, Vector2 v)     { CopyMemory(p, &v, 8);  return p + 8;  }
+static byte* TraceEncode(byte* p, Vector3 v)     { CopyMemory(p, &v, 12); return p + 12; }
+static byte* TraceEncode(byte* p, Vector4 v)     { CopyMemory(p, &v, 16); return p + 16; }
+static byte* TraceEncode(byte* p, Quaternion q)  { CopyMemory(p, &q, 16); return p + 16; }
+
+static byte* TraceEncode(byte* p, String s) {
+	u16 length = Min(s.length, TRACE_MAX_STRING);
+	CopyMemory(p, &length, 2);
+	CopyMemory(p + 2, s.data, length);
+	return p + 2 + length;
+}
+
+// Widened to the type that's stored, so u8..u64 all take the u64 overloads.
+template<typename T>
+static auto TraceValue(T t) {
+	if constexpr (TraceTypeOf<T>::type == TRACE_U64) return (u64)t;
+	else if constexpr (TraceTypeOf<T>::type == TRACE_S64) return (s64)t;
+	else return t;
+}
+
+template<typename ...Args>
+static void TraceRecord(TraceSite* site, FormatString<NoDeduce<Args>...> format, Args... args) {
+	if (!__atomic_load_n(&trace_enabled, __ATOMIC_RELAXED))
+		return;
+
+	u32 id = __atomic_load_n(&site->id, __ATOMIC_ACQUIRE);
+
+	if (!id) {
+		static const TraceType types[sizeof...(Args) + 1] = { TraceTypeOf<Args>::type... };
+		auto last = format.pieces[sizeof...(Args)];
+		id = RegisterTraceSite(site, format.data, last.offset + last.length, types, sizeof...(Args));
+
+		if (!id)
+			return;
+	}
+
+	LogEntry* entry = ReserveLogEntry(LOG_ENTRY_TRACE, (4 + ... + TraceSize(TraceValue(args))));
+
+	if (!entry)
+		return;
+
+	byte* p = (byte*)(entry + 1);
+	CopyMemory(p, &id, 4);
+	p += 4;
+	((p = TraceEncode(p, TraceValue(args))), ...);
+	CommitLogEntry();
+}
+
+// Like LogDebug but in the binary format, decoded as "file:line: " followed by the message.
+#define Trace(format, ...) do { \
+	static TraceSite trace_site = { .id = 0, .line = __LINE__, .file = __FILE__ }; \
+	TraceRecord(&trace_site, format __VA_OPT__(,) __VA_ARGS__); \
+} while (0)
+
+#endif // TRACE_H
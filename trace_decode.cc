@@ -0,0 +1,123 @@
+// Turns a trace file (see trace.h) back into log text. Build and run with: make trace_decode && ./trace_decode trace.bin
+
+#include "general.h"
+#include "math.h"
+#include "os.h"
+
+#include "assert.cc"
+#include "alloc.cc"
+#include "unix.cc"
+#include "print.cc"
+#include "print_float.cc"
+#include "log.cc"
+#include "trace.cc"
+#include "file_system.cc"
+
+#include "trace.h"
+
+struct DecodedSite {
+	u32 line;
+	u32 type_count;
+	const TraceType* types;
+	String file;
+	String format;
+};
+
+template<typename T>
+static T ReadTrace(const byte** p) {
+	T value;
+	CopyMemory(&value, *p, sizeof(T));
+	*p += sizeof(T);
+	return value;
+}
+
+static String ReadTraceString(const byte** p) {
+	u16 length = ReadTrace<u16>(p);
+	String result((const char*)*p, length, 0);
+	*p += length;
+	return result;
+}
+
+int main(int argc, char** argv) {
+	InitGlobalAllocator();
+
+	if (argc != 2) {
+		Print("usage: trace_decode <trace file>\n");
+		standard_output_buffer.Flush();
+		return 1;
+	}
+
+	MappedFile file = MapFile(CString(argv[1]), FILE_ADVICE_SEQUENTIAL);
+	const byte* start = file.data;
+	const byte* end   = file.data + file.length;
+
+	if (file.length < 16 || *(u64*)start != TRACE_MAGIC) {
+		Print("%: not a trace file\n", CString(argv[1]));
+		standard_output_buffer.Flush();
+		return 1;
+	}
+
+	log_start_time = *(u64*)(start + 8);
+	start += 16;
+
+	// Sites can show up after their first records when two threads race to register them, so read them all first.
+	u32 site_count = 0;
+	for (const byte* p = start; p + sizeof(LogEntry) <= end; p += ((LogEntry*)p)->size) {
+		if (!((LogEntry*)p)->size) break;
+		if (((LogEntry*)p)->level == LOG_ENTRY_TRACE_SITE)
+			site_count = Max(site_count, *(u32*)(p + sizeof(LogEntry)) + 1);
+	}
+
+	DecodedSite* sites = (DecodedSite*)AllocMemory(sizeof(DecodedSite) * Max(site_count, 1u));
+	ZeroMemory(sites, sizeof(DecodedSite) * Max(site_count, 1u));
+
+	for (const byte* p = start; p + sizeof(LogEntry) <= end; p += ((LogEntry*)p)->size) {
+		if (!((LogEntry*)p)->size) break;
+		if (((LogEntry*)p)->level != LOG_ENTRY_TRACE_SITE) continue;
+
+		const byte* q = p + sizeof(LogEntry);
+		DecodedSite* site = &sites[ReadTrace<u32>(&q)];
+		site->line       = ReadTrace<u32>(&q);
+		site->type_count = ReadTrace<u8>(&q);
+		site->types      = (const TraceType*)q;
+		q += site->type_count;
+		site->file   = ReadTraceString(&q);
+		site->format = ReadTraceString(&q);
+	}
+
+	OutputBuffer* buffer = &standard_output_buffer;
+
+	for (const byte* p = start; p + sizeof(LogEntry) <= end; p += ((LogEntry*)p)->size) {
+		LogEntry* entry = (LogEntry*)p;
+		if (!entry->size) break;
+		if (entry->level != LOG_ENTRY_TRACE) continue;
+
+		const byte* q = p + sizeof(LogEntry);
+		u32 id = ReadTrace<u32>(&q);
+
+		char prefix[LOG_PREFIX_MAX];
+		buffer->Write(prefix, FormatLogPrefix(prefix, entry->time, LOG_DEBUG));
+
+		if (id >= site_count || !sites[id].file.data) {
+			Print(buffer, "unknown trace site %\n", id);
+			continue;
+		}
+
+		DecodedSite* site = &sites[id];
+		Print(buffer, "%:%: ", site->file, site->line);
+
+		// Same substitution as Print: each '%' takes the next argument.
+		u32 argument = 0;
+		for (u32 i = 0; i < site->format.length; i++) {
+			char c = site->format.data[i];
+
+			if (c == '%' && argument < site->type_count) q = WriteTraceValue(buffer, site->types[argument++], q);
+			else buffer->Write(c);
+		}
+
+		buffer->Write('\n');
+	}
+
+	standard_output_buffer.Flush();
+	return 0;
+}
@@ -5,6 +5,11 @@
 #include <sys/mman.h>
 #include <sys/time.h>
 #include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/wait.h>
+#include <errno.h>
 
 static void* AllocPages(u64 size) {
 	size = size+(PAGE_SIZE-1) & -PAGE_SIZE;
@@ -23,6 +28,115 @@ static u64 GetTimeMicroseconds() {
 	return seconds + micros;
 }
 
+static u64 GetTimeNanoseconds() {
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000llu + ts.tv_nsec;
+}
+
 static void ExitProgram() {
 	exit(0);
 }
+
+struct ThreadStart {
+	void (*function)(void*);
+	void* argument;
+};
+
+static void* ThreadEntry(void* p) {
+	ThreadStart start = *(ThreadStart*)p;
+	FreePages(p, sizeof(ThreadStart));
+	start.function(start.argument);
+	return null;
+}
+
+static ThreadHandle CreateThread(void (*function)(void*), void* argument) {
+	// Pages rather than AllocMemory, the global allocator isn't thread safe.
+	ThreadStart* start = (ThreadStart*)AllocPages(sizeof(ThreadStart));
+	*start = { function, argument };
+
+	pthread_t thread;
+	pthread_create(&thread, null, ThreadEntry, start);
+	return (ThreadHandle)thread;
+}
+
+static void JoinThread(ThreadHandle thread) {
+	pthread_join((pthread_t)thread, null);
+}
+
+static u32 GetProcessorCount() {
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? count : 1;
+}
+
+static void SleepNanoseconds(u64 nanoseconds) {
+	timespec ts = { .tv_sec = (time_t)(nanoseconds / 1000000000), .tv_nsec = (long)(nanoseconds % 1000000000) };
+	nanosleep(&ts, null);
+}
+
+static void YieldThread() {
+	sched_yield();
+}
+
+struct UnixSemaphore {
+	pthread_mutex_t mutex;
+	pthread_cond_t  condition;
+	u32 count;
+};
+
+static Semaphore CreateSemaphore(u32 count) {
+	UnixSemaphore* semaphore = (UnixSemaphore*)AllocPages(sizeof(UnixSemaphore));
+	pthread_mutex_init(&semaphore->mutex, null);
+	pthread_cond_init(&semaphore->condition, null);
+	semaphore->count = count;
+	return semaphore;
+}
+
+static void DestroySemaphore(Semaphore p) {
+	UnixSemaphore* semaphore = (UnixSemaphore*)p;
+	pthread_cond_destroy(&semaphore->condition);
+	pthread_mutex_destroy(&semaphore->mutex);
+	FreePages(semaphore, sizeof(UnixSemaphore));
+}
+
+static void SignalSemaphore(Semaphore p, u32 count) {
+	UnixSemaphore* semaphore = (UnixSemaphore*)p;
+	pthread_mutex_lock(&semaphore->mutex);
+	semaphore->count += count;
+	pthread_mutex_unlock(&semaphore->mutex);
+
+	if (count == 1) pthread_cond_signal(&semaphore->condition);
+	else            pthread_cond_broadcast(&semaphore->condition);
+}
+
+static void WaitSemaphore(Semaphore p) {
+	UnixSemaphore* semaphore = (UnixSemaphore*)p;
+	pthread_mutex_lock(&semaphore->mutex);
+
+	while (!semaphore->count)
+		pthread_cond_wait(&semaphore->condition, &semaphore->mutex);
+
+	semaphore->count--;
+	pthread_mutex_unlock(&semaphore->mutex);
+}
+
+static s32 RunProcess(char** arguments) {
+	pid_t child = fork();
+
+	if (child < 0)
+		return -1;
+
+	if (child == 0) {
+		execvp(arguments[0], arguments);
+		_exit(127);
+	}
+
+	s32 status;
+
+	while (waitpid(child, &status, 0) < 0) {
+		if (errno != EINTR)
+			return -1;
+	}
+
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
@@ -3,6 +3,7 @@
 #include <GLFW/glfw3.h>
 
 #include "print.h"
+#include "log.h"
 #include "assert.h"
 
 List<VkLayerProperties> QueryValidationLayers() {
@@ -69,7 +70,7 @@ static VKAPI_ATTR VkBool32 ValidationLayerDebugMessageCallback(
 		return false;
 
 	if (severity & (VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)) {
-		Print("%: %\n", ToString(severity), CString(msg->pMessage));
+		LogError("%: %", ToString(severity), CString(msg->pMessage));
 		Assert(false);
 	}
 